@@ -65,26 +65,13 @@ QV4::Function *CompilationUnit::linkToEngine(ExecutionEngine *engine)
 
     Q_ASSERT(!runtimeStrings);
     Q_ASSERT(data);
-    runtimeStrings = (QV4::Heap::String **)malloc(data->stringTableSize * sizeof(QV4::Heap::String*));
-    // memset the strings to 0 in case a GC run happens while we're within the loop below
-    memset(runtimeStrings, 0, data->stringTableSize * sizeof(QV4::Heap::String*));
-    for (uint i = 0; i < data->stringTableSize; ++i)
-        runtimeStrings[i] = engine->newIdentifier(data->stringAt(i));
+    // Strings, regular expressions and classes are created on first use, most
+    // of them are never needed at runtime.
+    runtimeStrings = (QV4::Heap::String **)calloc(data->stringTableSize, sizeof(QV4::Heap::String*));
 
     runtimeRegularExpressions = new QV4::Value[data->regexpTableSize];
-    // memset the regexps to 0 in case a GC run happens while we're within the loop below
-    memset(runtimeRegularExpressions, 0, data->regexpTableSize * sizeof(QV4::Value));
-    for (uint i = 0; i < data->regexpTableSize; ++i) {
-        const CompiledData::RegExp *re = data->regexpAt(i);
-        int flags = 0;
-        if (re->flags & CompiledData::RegExp::RegExp_Global)
-            flags |= IR::RegExp::RegExp_Global;
-        if (re->flags & CompiledData::RegExp::RegExp_IgnoreCase)
-            flags |= IR::RegExp::RegExp_IgnoreCase;
-        if (re->flags & CompiledData::RegExp::RegExp_Multiline)
-            flags |= IR::RegExp::RegExp_Multiline;
-        runtimeRegularExpressions[i] = engine->newRegExpObject(data->stringAt(re->stringIndex), flags);
-    }
+    for (uint i = 0; i < data->regexpTableSize; ++i)
+        runtimeRegularExpressions[i] = QV4::Primitive::undefinedValue();
 
     if (data->lookupTableSize) {
         runtimeLookups = new QV4::Lookup[data->lookupTableSize];
@@ -115,18 +102,8 @@ QV4::Function *CompilationUnit::linkToEngine(ExecutionEngine *engine)
         }
     }
 
-    if (data->jsClassTableSize) {
-        runtimeClasses = (QV4::InternalClass**)malloc(data->jsClassTableSize * sizeof(QV4::InternalClass*));
-        for (uint i = 0; i < data->jsClassTableSize; ++i) {
-            int memberCount = 0;
-            const CompiledData::JSClassMember *member = data->jsClassAt(i, &memberCount);
-            QV4::InternalClass *klass = engine->objectClass;
-            for (int j = 0; j < memberCount; ++j, ++member)
-                klass = klass->addMember(runtimeStrings[member->nameOffset]->identifier, member->isAccessor ? QV4::Attr_Accessor : QV4::Attr_Data);
-
-            runtimeClasses[i] = klass;
-        }
-    }
+    if (data->jsClassTableSize)
+        runtimeClasses = (QV4::InternalClass**)calloc(data->jsClassTableSize, sizeof(QV4::InternalClass*));
 
     linkBackendToEngine(engine);
 
@@ -147,9 +124,12 @@ void CompilationUnit::unlink()
     if (engine)
         engine->compilationUnits.erase(engine->compilationUnits.find(this));
     engine = 0;
-    if (data && !(data->flags & QV4::CompiledData::Unit::StaticData))
+    if (runtimeLookups)
+        QV4::Lookup::releaseLookups(runtimeLookups, data->lookupTableSize);
+    if (data && !dataOwner && !(data->flags & QV4::CompiledData::Unit::StaticData))
         free(data);
     data = 0;
+    dataOwner = QQmlRefPointer<QQmlRefCount>();
     free(runtimeStrings);
     runtimeStrings = 0;
     delete [] runtimeLookups;
@@ -162,6 +142,39 @@ void CompilationUnit::unlink()
     runtimeFunctions.clear();
 }
 
+QV4::Heap::String *CompilationUnit::createRuntimeString(uint index)
+{
+    // For StaticData units the string refers to the unit's string table without a copy.
+    QV4::Heap::String *s = engine->newIdentifier(data->stringAt(index));
+    runtimeStrings[index] = s;
+    return s;
+}
+
+QV4::ReturnedValue CompilationUnit::createRuntimeRegularExpression(uint index)
+{
+    const CompiledData::RegExp *re = data->regexpAt(index);
+    int flags = 0;
+    if (re->flags & CompiledData::RegExp::RegExp_Global)
+        flags |= IR::RegExp::RegExp_Global;
+    if (re->flags & CompiledData::RegExp::RegExp_IgnoreCase)
+        flags |= IR::RegExp::RegExp_IgnoreCase;
+    if (re->flags & CompiledData::RegExp::RegExp_Multiline)
+        flags |= IR::RegExp::RegExp_Multiline;
+    runtimeRegularExpressions[index] = engine->newRegExpObject(data->stringAt(re->stringIndex), flags);
+    return runtimeRegularExpressions[index].asReturnedValue();
+}
+
+QV4::InternalClass *CompilationUnit::createRuntimeClass(uint index)
+{
+    int memberCount = 0;
+    const CompiledData::JSClassMember *member = data->jsClassAt(index, &memberCount);
+    QV4::InternalClass *klass = engine->objectClass;
+    for (int j = 0; j < memberCount; ++j, ++member)
+        klass = klass->addMember(runtimeString(member->nameOffset)->identifier, member->isAccessor ? QV4::Attr_Accessor : QV4::Attr_Data);
+    runtimeClasses[index] = klass;
+    return klass;
+}
+
 void CompilationUnit::markObjects(QV4::ExecutionEngine *e)
 {
     for (uint i = 0; i < data->stringTableSize; ++i)
@@ -173,6 +186,21 @@ void CompilationUnit::markObjects(QV4::ExecutionEngine *e)
     }
 }
 
+bool CompilationUnit::saveCodeToDisk(QIODevice *device, QString *errorString)
+{
+    Q_UNUSED(device);
+    *errorString = QStringLiteral("Saving code to disk is not supported by this backend");
+    return false;
+}
+
+bool CompilationUnit::loadCodeFromDisk(const char *code, quint32 size, QString *errorString)
+{
+    Q_UNUSED(code);
+    Q_UNUSED(size);
+    *errorString = QStringLiteral("Loading code from disk is not supported by this backend");
+    return false;
+}
+
 #endif // V4_BOOTSTRAP
 
 Unit *CompilationUnit::createUnitData(QmlIR::Document *irDocument)
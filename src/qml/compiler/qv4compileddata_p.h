@@ -46,6 +46,12 @@
 
 QT_BEGIN_NAMESPACE
 
+// Bump this whenever the compiled data structures change in an incompatible way,
+// units stored on disk by the previous version are rejected then.
+#define QV4_DATA_STRUCTURE_VERSION 0x01
+
+class QIODevice;
+
 namespace QmlIR {
 struct Document;
 }
@@ -577,6 +583,7 @@ struct Q_QML_PRIVATE_EXPORT CompilationUnit : public QQmlRefCount
         , runtimeLookups(0)
         , runtimeRegularExpressions(0)
         , runtimeClasses(0)
+        , baseUnit(0)
     {}
     virtual ~CompilationUnit();
 #endif
@@ -591,22 +598,64 @@ struct Q_QML_PRIVATE_EXPORT CompilationUnit : public QQmlRefCount
     QString fileName() const { return data->stringAt(data->sourceFileIndex); }
     QUrl url() const { if (m_url.isNull) m_url = QUrl(fileName()); return m_url; }
 
+    // Strings, regular expressions and classes are created on first use, access
+    // them through runtimeString(), runtimeRegularExpression() and runtimeClass().
     QV4::Heap::String **runtimeStrings; // Array
     QV4::Lookup *runtimeLookups;
     QV4::Value *runtimeRegularExpressions;
     QV4::InternalClass **runtimeClasses;
     QVector<QV4::Function *> runtimeFunctions;
+    // Set on units compiled by a tier-up, to the unit whose functions they replace. Functions
+    // of both units with the same index are the same function of the source.
+    CompilationUnit *baseUnit;
+    // Keeps data alive when the unit doesn't own it, e.g. for units loaded from a
+    // mapped disk cache file. Released when the unit is unlinked.
+    QQmlRefPointer<QQmlRefCount> dataOwner;
     mutable QQmlNullableValue<QUrl> m_url;
 
     QV4::Function *linkToEngine(QV4::ExecutionEngine *engine);
     void unlink();
 
+    QV4::Heap::String *runtimeString(uint index)
+    {
+        Q_ASSERT(index < data->stringTableSize);
+        if (QV4::Heap::String *s = runtimeStrings[index])
+            return s;
+        return createRuntimeString(index);
+    }
+
+    QV4::ReturnedValue runtimeRegularExpression(uint index)
+    {
+        Q_ASSERT(index < data->regexpTableSize);
+        if (!runtimeRegularExpressions[index].isUndefined())
+            return runtimeRegularExpressions[index].asReturnedValue();
+        return createRuntimeRegularExpression(index);
+    }
+
+    QV4::InternalClass *runtimeClass(uint index)
+    {
+        Q_ASSERT(index < data->jsClassTableSize);
+        if (QV4::InternalClass *klass = runtimeClasses[index])
+            return klass;
+        return createRuntimeClass(index);
+    }
+
     virtual QV4::ExecutableAllocator::ChunkOfPages *chunkForFunction(int /*functionIndex*/) { return 0; }
 
     void markObjects(QV4::ExecutionEngine *e);
 
+    // Backend code storage for the on-disk unit cache. The unit data itself is
+    // stored by the caller; these only deal with the code of the functions.
+    virtual bool saveCodeToDisk(QIODevice *device, QString *errorString);
+    virtual bool loadCodeFromDisk(const char *code, quint32 size, QString *errorString);
+
 protected:
     virtual void linkBackendToEngine(QV4::ExecutionEngine *engine) = 0;
+
+private:
+    QV4::Heap::String *createRuntimeString(uint index);
+    QV4::ReturnedValue createRuntimeRegularExpression(uint index);
+    QV4::InternalClass *createRuntimeClass(uint index);
 #endif // V4_BOOTSTRAP
 };
 
@@ -60,6 +60,7 @@ QT_BEGIN_NAMESPACE
     F(StoreElementLookup, storeElementLookup) \
     F(LoadProperty, loadProperty) \
     F(GetLookup, getLookup) \
+    F(RecordType, recordType) \
     F(StoreProperty, storeProperty) \
     F(SetLookup, setLookup) \
     F(StoreQObjectProperty, storeQObjectProperty) \
@@ -93,6 +94,7 @@ QT_BEGIN_NAMESPACE
     F(CallBuiltinDefineObjectLiteral, callBuiltinDefineObjectLiteral) \
     F(CallBuiltinSetupArgumentsObject, callBuiltinSetupArgumentsObject) \
     F(CallBuiltinConvertThisToObject, callBuiltinConvertThisToObject) \
+    F(CallBuiltinIsClosure, callBuiltinIsClosure) \
     F(CreateValue, createValue) \
     F(CreateProperty, createProperty) \
     F(ConstructPropertyLookup, constructPropertyLookup) \
@@ -101,6 +103,8 @@ QT_BEGIN_NAMESPACE
     F(Jump, jump) \
     F(JumpEq, jumpEq) \
     F(JumpNe, jumpNe) \
+    F(CompareJumpEq, compareJumpEq) \
+    F(CompareJumpNe, compareJumpNe) \
     F(UNot, unot) \
     F(UNotBool, unotBool) \
     F(UPlus, uplus) \
@@ -215,6 +219,15 @@ struct Param {
     { return !(*this == other); }
 };
 
+// The types RecordType has seen in a type feedback slot, or-ed together.
+enum ObservedType {
+    ObservedInteger = 1,
+    ObservedDouble = 2,
+    ObservedBoolean = 4,
+    ObservedString = 8,
+    ObservedOther = 16
+};
+
 union Instr
 {
     enum Type {
@@ -293,6 +306,11 @@ union Instr
         Param base;
         Param result;
     };
+    struct instr_recordType {
+        MOTH_INSTR_HEADER
+        quint32 slot;
+        Param value;
+    };
     struct instr_loadQObjectProperty {
         MOTH_INSTR_HEADER
         int propertyIndex;
@@ -497,6 +515,13 @@ union Instr
     struct instr_callBuiltinConvertThisToObject {
         MOTH_INSTR_HEADER
     };
+    struct instr_callBuiltinIsClosure {
+        MOTH_INSTR_HEADER
+        int functionId;
+        int scopeDepth;
+        Param value;
+        Param result;
+    };
     struct instr_createValue {
         MOTH_INSTR_HEADER
         quint32 argc;
@@ -548,6 +573,20 @@ union Instr
         ptrdiff_t offset;
         Param condition;
     };
+    struct instr_compareJumpEq {
+        MOTH_INSTR_HEADER
+        ptrdiff_t offset;
+        QV4::Runtime::CompareOperation compare;
+        Param lhs;
+        Param rhs;
+    };
+    struct instr_compareJumpNe {
+        MOTH_INSTR_HEADER
+        ptrdiff_t offset;
+        QV4::Runtime::CompareOperation compare;
+        Param lhs;
+        Param rhs;
+    };
     struct instr_unot {
         MOTH_INSTR_HEADER
         Param source;
@@ -725,6 +764,7 @@ union Instr
     instr_storeElementLookup storeElementLookup;
     instr_loadProperty loadProperty;
     instr_getLookup getLookup;
+    instr_recordType recordType;
     instr_loadQObjectProperty loadQObjectProperty;
     instr_loadAttachedQObjectProperty loadAttachedQObjectProperty;
     instr_storeProperty storeProperty;
@@ -757,6 +797,7 @@ union Instr
     instr_callBuiltinDefineObjectLiteral callBuiltinDefineObjectLiteral;
     instr_callBuiltinSetupArgumentsObject callBuiltinSetupArgumentsObject;
     instr_callBuiltinConvertThisToObject callBuiltinConvertThisToObject;
+    instr_callBuiltinIsClosure callBuiltinIsClosure;
     instr_createValue createValue;
     instr_createProperty createProperty;
     instr_constructPropertyLookup constructPropertyLookup;
@@ -765,6 +806,8 @@ union Instr
     instr_jump jump;
     instr_jumpEq jumpEq;
     instr_jumpNe jumpNe;
+    instr_compareJumpEq compareJumpEq;
+    instr_compareJumpNe compareJumpNe;
     instr_unot unot;
     instr_unotBool unotBool;
     instr_uplus uplus;
@@ -40,6 +40,7 @@
 #include <private/qv4regexpobject_p.h>
 #include <private/qv4compileddata_p.h>
 #include <private/qqmlengine_p.h>
+#include <QtCore/qiodevice.h>
 
 #undef USE_TYPE_INFO
 
@@ -115,6 +116,44 @@ inline QV4::Runtime::BinaryOperation aluOpFunction(IR::AluOp op)
     }
 };
 
+inline QV4::Runtime::BinaryOperationContext aluOpContextFunction(IR::AluOp op)
+{
+    switch (op) {
+    case IR::OpInstanceof:
+        return QV4::Runtime::instanceof;
+    case IR::OpIn:
+        return QV4::Runtime::in;
+    case IR::OpAdd:
+        return QV4::Runtime::add;
+    default:
+        return 0;
+    }
+}
+
+inline QV4::Runtime::CompareOperation compareOpFunction(IR::AluOp op)
+{
+    switch (op) {
+    case IR::OpGt:
+        return QV4::Runtime::compareGreaterThan;
+    case IR::OpLt:
+        return QV4::Runtime::compareLessThan;
+    case IR::OpGe:
+        return QV4::Runtime::compareGreaterEqual;
+    case IR::OpLe:
+        return QV4::Runtime::compareLessEqual;
+    case IR::OpEqual:
+        return QV4::Runtime::compareEqual;
+    case IR::OpNotEqual:
+        return QV4::Runtime::compareNotEqual;
+    case IR::OpStrictEqual:
+        return QV4::Runtime::compareStrictEqual;
+    case IR::OpStrictNotEqual:
+        return QV4::Runtime::compareStrictNotEqual;
+    default:
+        return 0;
+    }
+}
+
 inline bool isNumberType(IR::Expr *e)
 {
     switch (e->type) {
@@ -667,6 +706,7 @@ void InstructionSelection::getProperty(IR::Expr *base, const QString &name, IR::
         load.index = registerGetterLookup(name);
         load.result = getResultParam(target);
         addInstruction(load);
+        recordType(target);
         return;
     }
     Instruction::LoadProperty load;
@@ -674,6 +714,7 @@ void InstructionSelection::getProperty(IR::Expr *base, const QString &name, IR::
     load.name = registerString(name);
     load.result = getResultParam(target);
     addInstruction(load);
+    recordType(target);
 }
 
 void InstructionSelection::setProperty(IR::Expr *source, IR::Expr *targetBase,
@@ -737,6 +778,7 @@ void InstructionSelection::getElement(IR::Expr *base, IR::Expr *index, IR::Expr
         load.index = getParam(index);
         load.result = getResultParam(target);
         addInstruction(load);
+        recordType(target);
         return;
     }
     Instruction::LoadElement load;
@@ -744,6 +786,20 @@ void InstructionSelection::getElement(IR::Expr *base, IR::Expr *index, IR::Expr
     load.index = getParam(index);
     load.result = getResultParam(target);
     addInstruction(load);
+    recordType(target);
+}
+
+void InstructionSelection::recordType(IR::Expr *target)
+{
+    // Only reads that were given a type feedback slot record anything, see the tiered mode.
+    IR::Move *move = _currentStatement ? _currentStatement->asMove() : 0;
+    if (!move || move->typeFeedbackSlot < 0 || move->target != target)
+        return;
+
+    Instruction::RecordType record;
+    record.slot = move->typeFeedbackSlot;
+    record.value = getParam(target);
+    addInstruction(record);
 }
 
 void InstructionSelection::setElement(IR::Expr *source, IR::Expr *targetBase,
@@ -860,6 +916,35 @@ void InstructionSelection::unop(IR::AluOp oper, IR::Expr *source, IR::Expr *targ
     Q_ASSERT(!"unreachable");
 }
 
+void InstructionSelection::compareJumpHelper(QV4::Runtime::CompareOperation compare, const Param &lhs,
+                                             const Param &rhs, IR::CJump *s)
+{
+    if (s->iftrue == _nextBlock) {
+        Instruction::CompareJumpNe jump;
+        jump.offset = 0;
+        jump.compare = compare;
+        jump.lhs = lhs;
+        jump.rhs = rhs;
+        ptrdiff_t falseLoc = addInstruction(jump) + (((const char *)&jump.offset) - ((const char *)&jump));
+        _patches[s->iffalse].append(falseLoc);
+    } else {
+        Instruction::CompareJumpEq jump;
+        jump.offset = 0;
+        jump.compare = compare;
+        jump.lhs = lhs;
+        jump.rhs = rhs;
+        ptrdiff_t trueLoc = addInstruction(jump) + (((const char *)&jump.offset) - ((const char *)&jump));
+        _patches[s->iftrue].append(trueLoc);
+
+        if (s->iffalse != _nextBlock) {
+            Instruction::Jump jump;
+            jump.offset = 0;
+            ptrdiff_t falseLoc = addInstruction(jump) + (((const char *)&jump.offset) - ((const char *)&jump));
+            _patches[s->iffalse].append(falseLoc);
+        }
+    }
+}
+
 void InstructionSelection::binop(IR::AluOp oper, IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *target)
 {
     binopHelper(oper, leftSource, rightSource, target);
@@ -980,12 +1065,7 @@ Param InstructionSelection::binopHelper(IR::AluOp oper, IR::Expr *leftSource, IR
 
     if (oper == IR::OpInstanceof || oper == IR::OpIn || oper == IR::OpAdd) {
         Instruction::BinopContext binop;
-        if (oper == IR::OpInstanceof)
-            binop.alu = QV4::Runtime::instanceof;
-        else if (oper == IR::OpIn)
-            binop.alu = QV4::Runtime::in;
-        else
-            binop.alu = QV4::Runtime::add;
+        binop.alu = aluOpContextFunction(oper);
         binop.lhs = getParam(leftSource);
         binop.rhs = getParam(rightSource);
         binop.result = getResultParam(target);
@@ -1060,10 +1140,20 @@ void InstructionSelection::visitCJump(IR::CJump *s)
         addInstruction(debug);
     }
 
+    // Comparisons feeding a conditional jump are fused into a single instruction, which saves
+    // the dispatch of the jump and the store and reload of the boolean in a scratch slot.
+    static const bool fuseCompareJumps = qgetenv("QV4_NO_MOTH_FUSION").isEmpty();
+
     Param condition;
     if (IR::Temp *t = s->cond->asTemp()) {
         condition = getResultParam(t);
     } else if (IR::Binop *b = s->cond->asBinop()) {
+        if (fuseCompareJumps) {
+            if (QV4::Runtime::CompareOperation compare = compareOpFunction(b->op)) {
+                compareJumpHelper(compare, getParam(b->left), getParam(b->right), s);
+                return;
+            }
+        }
         condition = binopHelper(b->op, b->left, b->right, /*target*/0);
     } else {
         Q_UNIMPLEMENTED();
@@ -1413,6 +1503,28 @@ void QV4::Moth::InstructionSelection::callBuiltinConvertThisToObject()
     addInstruction(call);
 }
 
+void InstructionSelection::callBuiltinIsClosure(IR::Expr *value, int functionId, int scopeDepth, IR::Expr *result)
+{
+    Instruction::CallBuiltinIsClosure call;
+    call.functionId = functionId;
+    call.scopeDepth = scopeDepth;
+    call.value = getParam(value);
+    call.result = getResultParam(result);
+    addInstruction(call);
+}
+
+void InstructionSelection::callBuiltinHasType(IR::Expr *value, IR::Type type, IR::Expr *result)
+{
+    Q_UNUSED(value);
+    Q_UNUSED(type);
+
+    // Only the JIT speculates on types, failing the check runs the generic code.
+    Instruction::MoveConst move;
+    move.source = QV4::Encode(false);
+    move.result = getResultParam(result);
+    addInstruction(move);
+}
+
 ptrdiff_t InstructionSelection::addInstructionHelper(Instr::Type type, Instr &instr)
 {
 
@@ -1516,3 +1628,222 @@ void CompilationUnit::linkBackendToEngine(QV4::ExecutionEngine *engine)
         runtimeFunctions[i] = runtimeFunction;
     }
 }
+
+// The bytecode refers to the interpreter's jump table (in threaded mode) and to
+// runtime functions by address. For storage these are replaced with the
+// instruction type and the IR::AluOp, and resolved again when loading.
+namespace {
+
+#define MOTH_COUNT_INSTR(I, FMT) + 1
+const int instructionCount = 0 FOR_EACH_MOTH_INSTR(MOTH_COUNT_INSTR);
+#undef MOTH_COUNT_INSTR
+
+template <typename T>
+inline quintptr storedValue(const T &field)
+{
+    Q_STATIC_ASSERT(sizeof(T) == sizeof(quintptr));
+    quintptr value;
+    memcpy(&value, &field, sizeof(value));
+    return value;
+}
+
+template <typename T>
+inline void setStoredValue(T &field, quintptr value)
+{
+    Q_STATIC_ASSERT(sizeof(T) == sizeof(quintptr));
+    memcpy(&field, &value, sizeof(value));
+}
+
+int instructionTypeForHeader(const Instr &instr)
+{
+#ifdef MOTH_THREADED_INTERPRETER
+    void **jumpTable = VME::instructionJumpTable();
+    for (int i = 0; i < instructionCount; ++i) {
+        if (jumpTable[i] == instr.common.code)
+            return i;
+    }
+    return -1;
+#else
+    return instr.common.instructionType;
+#endif
+}
+
+int aluOpForFunction(QV4::Runtime::BinaryOperation function)
+{
+    for (int op = IR::OpInvalid; op <= IR::LastAluOp; ++op) {
+        if (aluOpFunction(static_cast<IR::AluOp>(op)) == function)
+            return op;
+    }
+    return -1;
+}
+
+int aluOpForContextFunction(QV4::Runtime::BinaryOperationContext function)
+{
+    for (int op = IR::OpInvalid; op <= IR::LastAluOp; ++op) {
+        if (aluOpContextFunction(static_cast<IR::AluOp>(op)) == function)
+            return op;
+    }
+    return -1;
+}
+
+int aluOpForCompareFunction(QV4::Runtime::CompareOperation function)
+{
+    for (int op = IR::OpInvalid; op <= IR::LastAluOp; ++op) {
+        if (compareOpFunction(static_cast<IR::AluOp>(op)) == function)
+            return op;
+    }
+    return -1;
+}
+
+bool unrelocateCode(QByteArray *code)
+{
+    char *it = code->data();
+    char *end = it + code->size();
+    while (it < end) {
+        Instr *instr = reinterpret_cast<Instr *>(it);
+        const int type = instructionTypeForHeader(*instr);
+        if (type < 0)
+            return false;
+#ifdef MOTH_THREADED_INTERPRETER
+        setStoredValue(instr->common.code, quintptr(type));
+#endif
+        if (type == Instr::Binop) {
+            const int op = aluOpForFunction(instr->binop.alu);
+            if (op < 0)
+                return false;
+            setStoredValue(instr->binop.alu, quintptr(op));
+        } else if (type == Instr::BinopContext) {
+            const int op = aluOpForContextFunction(instr->binopContext.alu);
+            if (op < 0)
+                return false;
+            setStoredValue(instr->binopContext.alu, quintptr(op));
+        } else if (type == Instr::CompareJumpEq) {
+            const int op = aluOpForCompareFunction(instr->compareJumpEq.compare);
+            if (op < 0)
+                return false;
+            setStoredValue(instr->compareJumpEq.compare, quintptr(op));
+        } else if (type == Instr::CompareJumpNe) {
+            const int op = aluOpForCompareFunction(instr->compareJumpNe.compare);
+            if (op < 0)
+                return false;
+            setStoredValue(instr->compareJumpNe.compare, quintptr(op));
+        }
+        it += Instr::size(static_cast<Instr::Type>(type));
+    }
+    return true;
+}
+
+bool relocateCode(QByteArray *code)
+{
+    char *it = code->data();
+    char *end = it + code->size();
+    while (it < end) {
+        Instr *instr = reinterpret_cast<Instr *>(it);
+#ifdef MOTH_THREADED_INTERPRETER
+        const quintptr type = storedValue(instr->common.code);
+#else
+        const quintptr type = instr->common.instructionType;
+#endif
+        if (type >= quintptr(instructionCount))
+            return false;
+        const int size = Instr::size(static_cast<Instr::Type>(type));
+        if (size <= 0 || end - it < size)
+            return false;
+#ifdef MOTH_THREADED_INTERPRETER
+        instr->common.code = VME::instructionJumpTable()[type];
+#endif
+        if (type == Instr::Binop) {
+            const quintptr op = storedValue(instr->binop.alu);
+            if (op > IR::LastAluOp)
+                return false;
+            instr->binop.alu = aluOpFunction(static_cast<IR::AluOp>(op));
+            if (!instr->binop.alu)
+                return false;
+        } else if (type == Instr::BinopContext) {
+            const quintptr op = storedValue(instr->binopContext.alu);
+            if (op > IR::LastAluOp)
+                return false;
+            instr->binopContext.alu = aluOpContextFunction(static_cast<IR::AluOp>(op));
+            if (!instr->binopContext.alu)
+                return false;
+        } else if (type == Instr::CompareJumpEq) {
+            const quintptr op = storedValue(instr->compareJumpEq.compare);
+            if (op > IR::LastAluOp)
+                return false;
+            instr->compareJumpEq.compare = compareOpFunction(static_cast<IR::AluOp>(op));
+            if (!instr->compareJumpEq.compare)
+                return false;
+        } else if (type == Instr::CompareJumpNe) {
+            const quintptr op = storedValue(instr->compareJumpNe.compare);
+            if (op > IR::LastAluOp)
+                return false;
+            instr->compareJumpNe.compare = compareOpFunction(static_cast<IR::AluOp>(op));
+            if (!instr->compareJumpNe.compare)
+                return false;
+        }
+        it += size;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+bool CompilationUnit::saveCodeToDisk(QIODevice *device, QString *errorString)
+{
+    // Layout: for every function a quint32 size followed by the code, padded to 8 bytes.
+    static const char padding[8] = { 0 };
+    foreach (const QByteArray &ref, codeRefs) {
+        QByteArray code = ref;
+        code.detach();
+        if (!unrelocateCode(&code)) {
+            *errorString = QStringLiteral("Unable to relocate function code");
+            return false;
+        }
+        const quint32 codeSize = code.size();
+        const quint32 paddedSize = (sizeof(quint32) + codeSize + 7) & ~7;
+        if (device->write(reinterpret_cast<const char *>(&codeSize), sizeof(codeSize)) != sizeof(codeSize)
+            || device->write(code.constData(), codeSize) != qint64(codeSize)
+            || device->write(padding, paddedSize - sizeof(quint32) - codeSize) != qint64(paddedSize - sizeof(quint32) - codeSize)) {
+            *errorString = device->errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompilationUnit::loadCodeFromDisk(const char *code, quint32 size, QString *errorString)
+{
+    Q_ASSERT(data);
+    const char *it = code;
+    const char *end = code + size;
+    codeRefs.resize(data->functionTableSize);
+    for (int i = 0; i < codeRefs.size(); ++i) {
+        quint32 codeSize;
+        if (end - it < qptrdiff(sizeof(codeSize))) {
+            *errorString = QStringLiteral("Truncated code section");
+            return false;
+        }
+        memcpy(&codeSize, it, sizeof(codeSize));
+        const quint64 paddedSize = (sizeof(quint32) + quint64(codeSize) + 7) & ~quint64(7);
+        if (quint64(end - it) < paddedSize) {
+            *errorString = QStringLiteral("Truncated code section");
+            return false;
+        }
+        // Copy the code, the relocated addresses are only valid for this process.
+        codeRefs[i] = QByteArray(it + sizeof(quint32), codeSize);
+        if (!relocateCode(&codeRefs[i])) {
+            *errorString = QStringLiteral("Invalid function code");
+            codeRefs.clear();
+            return false;
+        }
+        it += paddedSize;
+    }
+    return true;
+}
+
+QQmlRefPointer<CompiledData::CompilationUnit> ISelFactory::createUnitForLoading()
+{
+    QQmlRefPointer<CompiledData::CompilationUnit> result;
+    result.take(new Moth::CompilationUnit);
+    return result;
+}
@@ -50,6 +50,8 @@ struct CompilationUnit : public QV4::CompiledData::CompilationUnit
 {
     virtual ~CompilationUnit();
     virtual void linkBackendToEngine(QV4::ExecutionEngine *engine);
+    virtual bool saveCodeToDisk(QIODevice *device, QString *errorString);
+    virtual bool loadCodeFromDisk(const char *code, quint32 size, QString *errorString);
 
     QVector<QByteArray> codeRefs;
 
@@ -94,6 +96,8 @@ protected:
     virtual void callBuiltinDefineObjectLiteral(IR::Expr *result, int keyValuePairCount, IR::ExprList *keyValuePairs, IR::ExprList *arrayEntries, bool needSparseArray);
     virtual void callBuiltinSetupArgumentObject(IR::Expr *result);
     virtual void callBuiltinConvertThisToObject();
+    virtual void callBuiltinIsClosure(IR::Expr *value, int functionId, int scopeDepth, IR::Expr *result);
+    virtual void callBuiltinHasType(IR::Expr *value, IR::Type type, IR::Expr *result);
     virtual void callValue(IR::Expr *value, IR::ExprList *args, IR::Expr *result);
     virtual void callProperty(IR::Expr *base, const QString &name, IR::ExprList *args, IR::Expr *result);
     virtual void callSubscript(IR::Expr *base, IR::Expr *index, IR::ExprList *args, IR::Expr *result);
@@ -126,6 +130,7 @@ protected:
 
 private:
     Param binopHelper(IR::AluOp oper, IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *target);
+    void compareJumpHelper(QV4::Runtime::CompareOperation compare, const Param &lhs, const Param &rhs, IR::CJump *s);
 
     struct Instruction {
 #define MOTH_INSTR_DATA_TYPEDEF(I, FMT) typedef InstrData<Instr::I> I;
@@ -146,6 +151,7 @@ private:
     }
 
     void simpleMove(IR::Move *);
+    void recordType(IR::Expr *target);
     void prepareCallArgs(IR::ExprList *, quint32 &, quint32 * = 0);
 
     int scratchTempIndex() const { return _function->tempCount; }
@@ -188,6 +194,9 @@ public:
     { return new InstructionSelection(qmlEngine, execAllocator, module, jsGenerator); }
     virtual bool jitCompileRegexps() const
     { return false; }
+    virtual QQmlRefPointer<CompiledData::CompilationUnit> createUnitForLoading();
+    virtual bool canLoadUnits() const
+    { return true; }
 };
 
 template<int InstrT>
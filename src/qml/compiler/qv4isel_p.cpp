@@ -36,6 +36,7 @@
 #include "qv4jsir_p.h"
 #include "qv4isel_p.h"
 #include "qv4isel_util_p.h"
+#include "qv4ssa_p.h"
 #include <private/qv4value_inl_p.h>
 #ifndef V4_BOOTSTRAP
 #include <private/qqmlpropertycache_p.h>
@@ -69,8 +70,15 @@ EvalInstructionSelection::~EvalInstructionSelection()
 EvalISelFactory::~EvalISelFactory()
 {}
 
+QQmlRefPointer<CompiledData::CompilationUnit> EvalISelFactory::createUnitForLoading()
+{
+    return QQmlRefPointer<CompiledData::CompilationUnit>();
+}
+
 QQmlRefPointer<CompiledData::CompilationUnit> EvalInstructionSelection::compile(bool generateUnitData)
 {
+    for (int i = 0; i < irModule->functions.size(); ++i)
+        IR::Optimizer::inlineCalls(irModule->functions.at(i));
     for (int i = 0; i < irModule->functions.size(); ++i)
         run(i);
 
@@ -80,6 +88,18 @@ QQmlRefPointer<CompiledData::CompilationUnit> EvalInstructionSelection::compile(
     return unit;
 }
 
+QQmlRefPointer<CompiledData::CompilationUnit> EvalInstructionSelection::compile(const QVector<int> &functionIndexes)
+{
+    foreach (int i, functionIndexes)
+        IR::Optimizer::inlineCalls(irModule->functions.at(i));
+    foreach (int i, functionIndexes)
+        run(i);
+
+    QQmlRefPointer<QV4::CompiledData::CompilationUnit> unit = backendCompileStep();
+    unit->data = jsGenerator->generateUnit();
+    return unit;
+}
+
 void IRDecoder::visitMove(IR::Move *s)
 {
     if (IR::Name *n = s->target->asName()) {
@@ -394,6 +414,19 @@ void IRDecoder::callBuiltin(IR::Call *call, Expr *result)
         callBuiltinConvertThisToObject();
         return;
 
+    case IR::Name::builtin_is_closure: {
+        IR::Expr *value = call->args->expr;
+        const int functionId = call->args->next->expr->asConst()->value;
+        const int scopeDepth = call->args->next->next->expr->asConst()->value;
+        callBuiltinIsClosure(value, functionId, scopeDepth, result);
+    } return;
+
+    case IR::Name::builtin_has_type: {
+        IR::Expr *value = call->args->expr;
+        const IR::Type type = IR::Type(int(call->args->next->expr->asConst()->value));
+        callBuiltinHasType(value, type, result);
+    } return;
+
     default:
         break;
     }
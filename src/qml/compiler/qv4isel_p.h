@@ -58,6 +58,9 @@ public:
     virtual ~EvalInstructionSelection() = 0;
 
     QQmlRefPointer<QV4::CompiledData::CompilationUnit> compile(bool generateUnitData = true);
+    // Only generates code for the given functions. The others stay in the unit without code,
+    // so that function indexes don't change.
+    QQmlRefPointer<QV4::CompiledData::CompilationUnit> compile(const QVector<int> &functionIndexes);
 
     void setUseFastLookups(bool b) { useFastLookups = b; }
     void setUseTypeInference(bool onoff) { useTypeInference = onoff; }
@@ -90,6 +93,11 @@ public:
     virtual ~EvalISelFactory() = 0;
     virtual EvalInstructionSelection *create(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator) = 0;
     virtual bool jitCompileRegexps() const = 0;
+    // Creates an empty unit that can be filled from the disk cache, or null if
+    // the backend cannot load code from disk.
+    virtual QQmlRefPointer<CompiledData::CompilationUnit> createUnitForLoading();
+    virtual bool canLoadUnits() const
+    { return false; }
 };
 
 namespace IR {
@@ -128,6 +136,8 @@ public: // to implement by subclasses:
     virtual void callBuiltinDefineObjectLiteral(IR::Expr *result, int keyValuePairCount, IR::ExprList *keyValuePairs, IR::ExprList *arrayEntries, bool needSparseArray) = 0;
     virtual void callBuiltinSetupArgumentObject(IR::Expr *result) = 0;
     virtual void callBuiltinConvertThisToObject() = 0;
+    virtual void callBuiltinIsClosure(IR::Expr *value, int functionId, int scopeDepth, IR::Expr *result) = 0;
+    virtual void callBuiltinHasType(IR::Expr *value, IR::Type type, IR::Expr *result) = 0;
     virtual void callValue(IR::Expr *value, IR::ExprList *args, IR::Expr *result) = 0;
     virtual void callProperty(IR::Expr *base, const QString &name, IR::ExprList *args, IR::Expr *result) = 0;
     virtual void callSubscript(IR::Expr *base, IR::Expr *index, IR::ExprList *args, IR::Expr *result) = 0;
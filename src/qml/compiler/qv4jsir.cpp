@@ -338,6 +338,10 @@ const char *builtin_to_string(Name::Builtin b)
         return "builtin_setup_argument_object";
     case IR::Name::builtin_convert_this_to_object:
         return "builtin_convert_this_to_object";
+    case IR::Name::builtin_is_closure:
+        return "builtin_is_closure";
+    case IR::Name::builtin_has_type:
+        return "builtin_has_type";
     case IR::Name::builtin_qml_id_array:
         return "builtin_qml_id_array";
     case IR::Name::builtin_qml_imported_scripts_object:
@@ -386,6 +390,108 @@ void Module::setFileName(const QString &name)
     }
 }
 
+Module *Module::clone() const
+{
+    Module *m = new Module(debugMode);
+    m->fileName = fileName;
+    m->isQmlModule = isQmlModule;
+
+    QHash<Function *, Function *> functionMap;
+    m->functions.reserve(functions.size());
+    foreach (Function *f, functions) {
+        Function *cf = new Function(m, 0, *f->name);
+        functionMap.insert(f, cf);
+        m->functions.append(cf);
+    }
+    m->rootFunction = functionMap.value(rootFunction);
+
+    CloneExpr cloneExpr;
+    foreach (Function *f, functions) {
+        Function *cf = functionMap.value(f);
+        cf->tempCount = f->tempCount;
+        cf->maxNumberOfArguments = f->maxNumberOfArguments;
+        foreach (const QString *formal, f->formals)
+            cf->formals.append(cf->newString(*formal));
+        foreach (const QString *local, f->locals)
+            cf->locals.append(cf->newString(*local));
+        foreach (Function *nested, f->nestedFunctions)
+            cf->nestedFunctions.append(functionMap.value(nested));
+        cf->outer = functionMap.value(f->outer);
+        cf->insideWithOrCatch = f->insideWithOrCatch;
+        cf->hasDirectEval = f->hasDirectEval;
+        cf->usesArgumentsObject = f->usesArgumentsObject;
+        cf->usesThis = f->usesThis;
+        cf->isStrict = f->isStrict;
+        cf->isNamedExpression = f->isNamedExpression;
+        cf->hasTry = f->hasTry;
+        cf->hasWith = f->hasWith;
+        cf->line = f->line;
+        cf->column = f->column;
+        cf->typeFeedbackSlots = f->typeFeedbackSlots;
+        cf->observedTypes = f->observedTypes;
+        cf->idObjectDependencies = f->idObjectDependencies;
+        cf->contextObjectPropertyDependencies = f->contextObjectPropertyDependencies;
+        cf->scopeObjectPropertyDependencies = f->scopeObjectPropertyDependencies;
+
+        // Create all blocks first, the statements and edges can point forward.
+        foreach (BasicBlock *bb, f->basicBlocks()) {
+            Q_ASSERT(!bb->isRemoved());
+            cf->newBasicBlock(0);
+        }
+
+        foreach (BasicBlock *bb, f->basicBlocks()) {
+            BasicBlock *cbb = cf->basicBlock(bb->index());
+            if (bb->catchBlock)
+                cbb->catchBlock = cf->basicBlock(bb->catchBlock->index());
+            if (bb->containingGroup())
+                cbb->setContainingGroup(cf->basicBlock(bb->containingGroup()->index()));
+            cbb->markAsGroupStart(bb->isGroupStart());
+            cbb->setExceptionHandler(bb->isExceptionHandler());
+            foreach (BasicBlock *in, bb->in)
+                cbb->in.append(cf->basicBlock(in->index()));
+            foreach (BasicBlock *out, bb->out)
+                cbb->out.append(cf->basicBlock(out->index()));
+
+            cloneExpr.setBasicBlock(cbb);
+            foreach (Stmt *s, bb->statements()) {
+                Stmt *cs = 0;
+                if (Exp *exp = s->asExp()) {
+                    Exp *e = cf->NewStmt<Exp>();
+                    e->init(cloneExpr(exp->expr));
+                    cs = e;
+                } else if (Move *move = s->asMove()) {
+                    Move *mv = cf->NewStmt<Move>();
+                    mv->init(cloneExpr(move->target), cloneExpr(move->source));
+                    mv->swap = move->swap;
+                    mv->typeFeedbackSlot = move->typeFeedbackSlot;
+                    cs = mv;
+                } else if (Jump *jump = s->asJump()) {
+                    Jump *j = cf->NewStmt<Jump>();
+                    j->init(cf->basicBlock(jump->target->index()));
+                    cs = j;
+                } else if (CJump *cjump = s->asCJump()) {
+                    CJump *cj = cf->NewStmt<CJump>();
+                    cj->init(cloneExpr(cjump->cond), cf->basicBlock(cjump->iftrue->index()),
+                             cf->basicBlock(cjump->iffalse->index()),
+                             cjump->parent ? cf->basicBlock(cjump->parent->index()) : 0);
+                    cs = cj;
+                } else if (Ret *ret = s->asRet()) {
+                    Ret *r = cf->NewStmt<Ret>();
+                    r->init(ret->expr ? cloneExpr(ret->expr) : 0);
+                    cs = r;
+                } else {
+                    Q_UNREACHABLE();
+                }
+                cbb->appendStatement(cs);
+                cs->location = s->location;
+            }
+            cbb->nextLocation = bb->nextLocation;
+        }
+    }
+
+    return m;
+}
+
 Function::Function(Module *module, Function *outer, const QString &name)
     : module(module)
     , pool(&module->pool)
@@ -402,6 +508,7 @@ Function::Function(Module *module, Function *outer, const QString &name)
     , unused(0)
     , line(-1)
     , column(-1)
+    , typeFeedbackSlots(0)
     , _allBasicBlocks(0)
     , _statementCount(0)
 {
@@ -858,12 +965,12 @@ void CloneExpr::visitConst(Const *e)
 
 void CloneExpr::visitString(String *e)
 {
-    cloned = block->STRING(e->value);
+    cloned = block->STRING(block->function->newString(*e->value));
 }
 
 void CloneExpr::visitRegExp(RegExp *e)
 {
-    cloned = block->REGEXP(e->value, e->flags);
+    cloned = block->REGEXP(block->function->newString(*e->value), e->flags);
 }
 
 void CloneExpr::visitName(Name *e)
@@ -919,7 +1026,7 @@ void CloneExpr::visitSubscript(Subscript *e)
 void CloneExpr::visitMember(Member *e)
 {
     Expr *clonedBase = clone(e->base);
-    cloned = block->MEMBER(clonedBase, e->name, e->property, e->kind, e->attachedPropertiesIdOrEnumValue);
+    cloned = block->MEMBER(clonedBase, block->function->newString(*e->name), e->property, e->kind, e->attachedPropertiesIdOrEnumValue);
 }
 
 IRPrinter::IRPrinter(QTextStream *out)
@@ -338,6 +338,8 @@ struct Name: Expr {
         builtin_define_object_literal,
         builtin_setup_argument_object,
         builtin_convert_this_to_object,
+        builtin_is_closure,
+        builtin_has_type,
         builtin_qml_id_array,
         builtin_qml_imported_scripts_object,
         builtin_qml_context_object,
@@ -663,14 +665,17 @@ struct Move: Stmt {
     Expr *target; // LHS - Temp, Name, Member or Subscript
     Expr *source;
     bool swap;
+    // Index into the function's type feedback for property and element reads, or -1.
+    int typeFeedbackSlot;
 
-    Move(int id): Stmt(id) {}
+    Move(int id): Stmt(id), typeFeedbackSlot(-1) {}
 
     void init(Expr *target, Expr *source)
     {
         this->target = target;
         this->source = source;
         this->swap = false;
+        this->typeFeedbackSlot = -1;
     }
 
     virtual void accept(StmtVisitor *v) { v->visitMove(this); }
@@ -759,6 +764,10 @@ struct Q_QML_PRIVATE_EXPORT Module {
     ~Module();
 
     void setFileName(const QString &name);
+
+    // Deep copy that shares no memory with this module. Only valid before the module is
+    // optimized, as SSA form and removed blocks are not copied.
+    Module *clone() const;
 };
 
 struct BasicBlock {
@@ -985,6 +994,11 @@ struct Function {
     int line;
     int column;
 
+    // Number of Moves with a typeFeedbackSlot, and the types the interpreter saw in each of them
+    // (or-ed Type values), if any.
+    int typeFeedbackSlots;
+    QVector<int> observedTypes;
+
     // Qml extension:
     QSet<int> idObjectDependencies;
     PropertyDependencyMap contextObjectPropertyDependencies;
@@ -1046,6 +1060,8 @@ private:
     int _statementCount;
 };
 
+// Strings are interned again in the function of the target block, so a clone does not point
+// into the module it was taken from.
 class CloneExpr: protected IR::ExprVisitor
 {
 public:
@@ -1080,7 +1096,7 @@ public:
     {
         Name *newName = f->New<Name>();
         newName->type = n->type;
-        newName->id = n->id;
+        newName->id = n->id ? f->newString(*n->id) : 0;
         newName->builtin = n->builtin;
         newName->global = n->global;
         newName->qmlSingleton = n->qmlSingleton;
@@ -1127,8 +1143,6 @@ protected:
 
 protected:
     IR::BasicBlock *block;
-
-private:
     IR::Expr *cloned;
 };
 
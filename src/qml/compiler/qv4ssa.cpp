@@ -1728,6 +1728,478 @@ void cleanupPhis(DefUses &defUses)
     defUses.cleanup();
 }
 
+// Replaces object and array literals that do not escape the function by the values they were
+// initialized with, so the object is never allocated:
+//
+//     %3 = builtin_define_object_literal(2, x, true, %1, y, true, %2)
+//     %4 = %3.x
+//   becomes:
+//     %4 = %1
+//
+// A literal escapes when it (or a copy of it) is used for anything else than reading one of its
+// own properties: storing it, passing it to a call, comparing it or writing to it all keep the
+// allocation. Only plain data properties are handled, so literals with getters, setters, numeric
+// keys or a __proto__ key are left alone, and arrays have to be small and without holes.
+//
+// A literal that is merged with other values by a phi-node, which is what the result of an
+// inlined helper looks like, is replaced too if the merged value is only read at the start of the
+// join block. The reads of the other incoming values are then done at the end of the respective
+// predecessors, and their results are merged by new phi-nodes.
+class ScalarReplacement
+{
+    enum { MaxArrayElements = 16 };
+
+    struct Allocation {
+        Allocation(): move(0), block(0), escapes(false) {}
+
+        Move *move;
+        BasicBlock *block;
+        QHash<QString, Expr *> fields;
+        QVector<Move *> copies;
+        QVector<Move *> reads;
+        QVector<int> merges;
+        bool escapes;
+    };
+
+    struct Merge {
+        Merge(): phi(0), block(0), replaceable(true) {}
+
+        Phi *phi;
+        BasicBlock *block;
+        QSet<int> aliases; // the phi target and its copies
+        QVector<Move *> copies;
+        QVector<Move *> reads; // in statement order
+        bool replaceable;
+    };
+
+public:
+    ScalarReplacement(IR::Function *function, DefUses &defUses)
+        : function(function)
+        , defUses(defUses)
+    {}
+
+    // Returns the number of eliminated allocations.
+    int run()
+    {
+        collectAllocations();
+        if (allocations.empty())
+            return 0;
+
+        for (int i = 0, ei = allocations.size(); i != ei; ++i)
+            collectUses(i);
+        for (int i = 0, ei = merges.size(); i != ei; ++i)
+            collectUses(merges[i]);
+        propagateEscapes();
+
+        for (int i = 0, ei = merges.size(); i != ei; ++i) {
+            if (merges[i].replaceable && hasLiteralIncoming(merges[i]))
+                replace(merges[i]);
+        }
+
+        int eliminated = 0;
+        for (int i = 0, ei = allocations.size(); i != ei; ++i) {
+            if (!allocations[i].escapes) {
+                replace(allocations[i]);
+                ++eliminated;
+            }
+        }
+
+        defUses.cleanup();
+        return eliminated;
+    }
+
+private:
+    void collectAllocations()
+    {
+        foreach (BasicBlock *bb, function->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+
+            foreach (Stmt *s, bb->statements()) {
+                Move *m = s->asMove();
+                if (!m)
+                    continue;
+                Temp *target = m->target->asTemp();
+                Call *call = m->source->asCall();
+                if (!target || target->kind != Temp::VirtualRegister || !call || !call->base->asName())
+                    continue;
+
+                Allocation allocation;
+                allocation.move = m;
+                allocation.block = bb;
+                bool ok = false;
+                switch (call->base->asName()->builtin) {
+                case Name::builtin_define_object_literal:
+                    ok = collectObjectLiteralFields(call->args, allocation.fields);
+                    break;
+                case Name::builtin_define_array:
+                    ok = collectArrayFields(call->args, allocation.fields);
+                    break;
+                default:
+                    break;
+                }
+
+                if (ok) {
+                    aliasOf.insert(target->index, allocations.size());
+                    allocations.push_back(allocation);
+                }
+            }
+        }
+    }
+
+    bool collectObjectLiteralFields(ExprList *args, QHash<QString, Expr *> &fields) const
+    {
+        // The arguments are the number of key/value entries, then the entries themselves, and
+        // then the array entries for numeric keys.
+        Const *entryCount = args ? args->expr->asConst() : 0;
+        if (!entryCount)
+            return false;
+
+        ExprList *it = args->next;
+        for (int i = 0, ei = int(entryCount->value); i < ei; ++i) {
+            Name *key = it->expr->asName();
+            Const *isData = it->next->expr->asConst();
+            if (!key || !key->id || !isData || !isData->value) // getter/setter pair
+                return false;
+            if (*key->id == QLatin1String("__proto__"))
+                return false;
+            Temp *value = it->next->next->expr->asTemp();
+            if (!value)
+                return false;
+            fields.insert(*key->id, value);
+            it = it->next->next->next;
+        }
+
+        return it == 0;
+    }
+
+    bool collectArrayFields(ExprList *args, QHash<QString, Expr *> &fields) const
+    {
+        int length = 0;
+        for (ExprList *it = args; it; it = it->next, ++length) {
+            if (length == MaxArrayElements)
+                return false;
+            Const *c = it->expr->asConst();
+            if (!it->expr->asTemp() && !(c && c->type != MissingType))
+                return false;
+            fields.insert(QString::number(length), it->expr);
+        }
+
+        Const *lengthValue = function->New<Const>();
+        lengthValue->init(NumberType, length);
+        fields.insert(QStringLiteral("length"), lengthValue);
+        return true;
+    }
+
+    static Move *asCopy(Stmt *s)
+    {
+        Move *m = s->asMove();
+        if (m && m->target->asTemp() && m->source->asTemp())
+            return m;
+        return 0;
+    }
+
+    // Matches "%target = %base.key" and "%target = %base[key]" with a constant key.
+    static Move *asRead(Stmt *s, Temp **base = 0, QString *key = 0)
+    {
+        Move *m = s->asMove();
+        if (!m || !m->target->asTemp())
+            return 0;
+
+        Expr *b = 0;
+        QString k;
+        if (Member *member = m->source->asMember()) {
+            if (member->kind != Member::UnspecifiedMember || member->property)
+                return 0;
+            b = member->base;
+            k = *member->name;
+        } else if (Subscript *subscript = m->source->asSubscript()) {
+            b = subscript->base;
+            if (Const *c = subscript->index->asConst()) {
+                if (!(c->type & NumberType) || !(c->value >= 0 && c->value < MaxArrayElements)
+                        || c->value != int(c->value))
+                    return 0;
+                k = QString::number(int(c->value));
+            } else if (String *str = subscript->index->asString()) {
+                k = *str->value;
+            } else {
+                return 0;
+            }
+        } else {
+            return 0;
+        }
+
+        if (!b->asTemp())
+            return 0;
+        if (base)
+            *base = b->asTemp();
+        if (key)
+            *key = k;
+        return m;
+    }
+
+    static QString readKey(Move *read)
+    {
+        QString key;
+        asRead(read, 0, &key);
+        return key;
+    }
+
+    static Temp *readBase(Move *read)
+    {
+        if (Member *member = read->source->asMember())
+            return member->base->asTemp();
+        return read->source->asSubscript()->base->asTemp();
+    }
+
+    static void setReadBase(Move *read, Temp *base)
+    {
+        if (Member *member = read->source->asMember())
+            member->base = base;
+        else
+            read->source->asSubscript()->base = base;
+    }
+
+    void collectUses(int index)
+    {
+        Allocation &allocation = allocations[index];
+        QVector<Temp> worklist;
+        worklist += *allocation.move->target->asTemp();
+        while (!worklist.isEmpty()) {
+            const Temp alias = worklist.takeLast();
+            foreach (Stmt *use, defUses.uses(alias)) {
+                Temp *base = 0;
+                QString key;
+                if (Move *copy = asCopy(use)) {
+                    allocation.copies += copy;
+                    worklist += *copy->target->asTemp();
+                    aliasOf.insert(copy->target->asTemp()->index, index);
+                } else if (Move *read = asRead(use, &base, &key)) {
+                    if (base->index != alias.index || !allocation.fields.contains(key)) {
+                        allocation.escapes = true;
+                        return;
+                    }
+                    allocation.reads += read;
+                } else if (Phi *phi = use->asPhi()) {
+                    allocation.merges += mergeIndex(phi);
+                } else {
+                    allocation.escapes = true;
+                    return;
+                }
+            }
+        }
+    }
+
+    int mergeIndex(Phi *phi)
+    {
+        QHash<Phi *, int>::const_iterator it = mergeOf.find(phi);
+        if (it != mergeOf.end())
+            return *it;
+
+        Merge merge;
+        merge.phi = phi;
+        merge.block = defUses.defStmtBlock(*phi->targetTemp);
+        mergeOf.insert(phi, merges.size());
+        merges.push_back(merge);
+        return merges.size() - 1;
+    }
+
+    void collectUses(Merge &merge)
+    {
+        QVector<Temp> worklist;
+        worklist += *merge.phi->targetTemp;
+        while (!worklist.isEmpty()) {
+            const Temp alias = worklist.takeLast();
+            merge.aliases.insert(alias.index);
+            foreach (Stmt *use, defUses.uses(alias)) {
+                Temp *base = 0;
+                if (Move *copy = asCopy(use)) {
+                    merge.copies += copy;
+                    worklist += *copy->target->asTemp();
+                } else if (Move *read = asRead(use, &base)) {
+                    if (base->index != alias.index) {
+                        merge.replaceable = false;
+                        return;
+                    }
+                    merge.reads += read;
+                } else {
+                    merge.replaceable = false;
+                    return;
+                }
+            }
+        }
+
+        // The reads of the other incoming values are moved to the end of the predecessors, so
+        // they may only be preceded by phi-nodes, copies and other such reads in the join block.
+        QVector<Move *> orderedReads;
+        int remaining = merge.copies.size() + merge.reads.size();
+        foreach (Stmt *s, merge.block->statements()) {
+            if (remaining == 0)
+                break;
+            if (s->asPhi())
+                continue;
+            Move *m = s->asMove();
+            if (asCopy(s)) {
+                if (merge.copies.contains(m))
+                    --remaining;
+            } else if (m && merge.reads.contains(m)) {
+                orderedReads += m;
+                --remaining;
+            } else {
+                break;
+            }
+        }
+
+        if (remaining == 0)
+            merge.reads = orderedReads;
+        else
+            merge.replaceable = false;
+    }
+
+    const Allocation *literal(Expr *e) const
+    {
+        Temp *t = e->asTemp();
+        if (!t)
+            return 0;
+        const int index = aliasOf.value(t->index, -1);
+        if (index == -1 || allocations[index].escapes)
+            return 0;
+        return &allocations[index];
+    }
+
+    bool hasLiteralIncoming(const Merge &merge) const
+    {
+        foreach (Expr *incoming, merge.phi->d->incoming)
+            if (literal(incoming))
+                return true;
+        return false;
+    }
+
+    bool canReplace(const Merge &merge) const
+    {
+        const QVector<Expr *> &incoming = merge.phi->d->incoming;
+        for (int i = 0, ei = incoming.size(); i != ei; ++i) {
+            Temp *t = incoming.at(i)->asTemp();
+            if (!t)
+                return false;
+            if (const Allocation *allocation = literal(t)) {
+                foreach (Move *read, merge.reads)
+                    if (!allocation->fields.contains(readKey(read)))
+                        return false;
+            } else if (merge.aliases.contains(t->index) || merge.block->in.at(i)->out.size() != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void propagateEscapes()
+    {
+        for (bool changed = true; changed; ) {
+            changed = false;
+            for (int i = 0, ei = merges.size(); i != ei; ++i) {
+                if (merges[i].replaceable && !canReplace(merges[i])) {
+                    merges[i].replaceable = false;
+                    changed = true;
+                }
+            }
+
+            for (int i = 0, ei = allocations.size(); i != ei; ++i) {
+                Allocation &allocation = allocations[i];
+                if (allocation.escapes)
+                    continue;
+                foreach (int merge, allocation.merges) {
+                    if (!merges[merge].replaceable) {
+                        allocation.escapes = true;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    void replace(Merge &merge)
+    {
+        BasicBlock *bb = merge.block;
+        CloneExpr clone(bb);
+        const QVector<Expr *> incoming = merge.phi->d->incoming;
+
+        foreach (Move *read, merge.reads) {
+            const QString key = readKey(read);
+            Phi *phi = function->NewStmt<Phi>();
+            phi->d = new Stmt::Data;
+            phi->d->incoming.resize(incoming.size());
+            phi->targetTemp = bb->TEMP(bb->newTemp());
+            defUses.registerNewStatement(phi);
+            defUses.addDef(phi->targetTemp, phi, bb);
+
+            for (int i = 0, ei = incoming.size(); i != ei; ++i) {
+                Expr *value = 0;
+                if (const Allocation *allocation = literal(incoming.at(i))) {
+                    value = clone(allocation->fields.value(key));
+                } else {
+                    BasicBlock *pred = bb->in.at(i);
+                    Temp *object = incoming.at(i)->asTemp();
+                    Move *load = function->NewStmt<Move>();
+                    load->init(pred->TEMP(pred->newTemp()), clone(read->source));
+                    load->location = read->location;
+                    setReadBase(load, clone(object));
+                    pred->insertStatementBeforeTerminator(load);
+                    defUses.registerNewStatement(load);
+                    defUses.addDef(load->target->asTemp(), load, pred);
+                    defUses.addUse(*object, load);
+                    value = clone(load->target);
+                }
+
+                phi->d->incoming[i] = value;
+                if (Temp *t = value->asTemp())
+                    defUses.addUse(*t, phi);
+            }
+            bb->prependStatement(phi);
+
+            // The read itself becomes a copy of the merged value.
+            defUses.removeUse(read, *readBase(read));
+            read->source = clone(phi->targetTemp);
+            defUses.addUse(*phi->targetTemp, read);
+        }
+
+        foreach (Move *copy, merge.copies) {
+            defUses.removeDefUses(copy);
+            bb->removeStatement(copy);
+        }
+        defUses.removeDefUses(merge.phi);
+        bb->removeStatement(merge.phi);
+    }
+
+    void replace(Allocation &allocation)
+    {
+        CloneExpr clone(allocation.block);
+        foreach (Move *read, allocation.reads) {
+            Expr *value = allocation.fields.value(readKey(read));
+            defUses.removeUse(read, *readBase(read));
+            read->source = clone(value);
+            if (Temp *t = read->source->asTemp())
+                defUses.addUse(*t, read);
+        }
+
+        foreach (Move *copy, allocation.copies) {
+            BasicBlock *bb = defUses.defStmtBlock(*copy->target->asTemp());
+            defUses.removeDefUses(copy);
+            bb->removeStatement(copy);
+        }
+        defUses.removeDefUses(allocation.move);
+        allocation.block->removeStatement(allocation.move);
+    }
+
+    IR::Function *function;
+    DefUses &defUses;
+    std::vector<Allocation> allocations;
+    std::vector<Merge> merges;
+    QHash<int, int> aliasOf; // temp index -> allocation
+    QHash<Phi *, int> mergeOf;
+};
+
 class StatementWorklist
 {
     IR::Function *theFunction;
@@ -2425,7 +2897,11 @@ protected:
         _ty = run(e->base);
         for (ExprList *it = e->args; it; it = it->next)
             _ty.fullyTyped &= run(it->expr).fullyTyped;
-        _ty.type = VarType;
+        Name *name = e->base->asName();
+        if (name && name->builtin == Name::builtin_has_type)
+            _ty.type = BoolType;
+        else
+            _ty.type = VarType;
     }
     virtual void visitNew(New *e) {
         _ty = run(e->base);
@@ -2441,7 +2917,8 @@ protected:
     virtual void visitMember(Member *e) {
         _ty = run(e->base);
 
-        if (_ty.fullyTyped && _ty.type.memberResolver.isValid()) {
+        // Without an engine (when compiling on a background thread) QML members stay untyped.
+        if (_ty.fullyTyped && qmlEngine && _ty.type.memberResolver.isValid()) {
             MemberExpressionResolver &resolver = _ty.type.memberResolver;
             _ty.type.type = resolver.resolveMember(qmlEngine, &resolver, e);
         } else
@@ -2650,6 +3127,211 @@ private:
     }
 };
 
+// Narrows integer induction variables from double to int32.
+//
+// Type inference has to assume that "i + 1" can overflow, so a loop counter like the one in
+//    for (var i = 0; i < n; ++i) ...
+// ends up as a double, even when n is known to be an int32. This pass finds the values that
+// are built from int32 values by copies and by increments (or decrements) by one, and checks
+// that every such increment is guarded by a dominating comparison against an int32 bound:
+// when "i < n" holds and n fits in an int32, "i + 1" fits in an int32 too.
+//
+// The analysis is optimistic: all candidates are assumed to be int32, and candidates that
+// depend on a value that is not are removed until nothing changes anymore.
+class InductionVariableInference
+{
+    const DefUses &_defUses;
+    const DominatorTree &_dt;
+    QVector<UntypedTemp> _candidates;
+
+public:
+    InductionVariableInference(const DefUses &defUses, const DominatorTree &dt)
+        : _defUses(defUses)
+        , _dt(dt)
+    {}
+
+    void run(IR::Function *f)
+    {
+        Q_UNUSED(f);
+
+        foreach (const Temp *t, _defUses.defs()) {
+            if (t->type != DoubleType)
+                continue;
+            Stmt *s = _defUses.defStmt(*t);
+            if (s && (s->asPhi() || isCopy(s) || incrementedValue(s)))
+                _candidates.append(*t);
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int i = 0; i < _candidates.size(); ) {
+                if (isInt32(_candidates.at(i))) {
+                    ++i;
+                } else {
+                    _candidates.remove(i);
+                    changed = true;
+                }
+            }
+        }
+
+        PropagateTempTypes propagator(_defUses);
+        foreach (const UntypedTemp &t, _candidates) {
+            propagator.run(t, SInt32Type);
+            if (Move *m = _defUses.defStmt(t.temp)->asMove()) {
+                if (Unop *u = m->source->asUnop())
+                    u->type = SInt32Type;
+                else if (Binop *b = m->source->asBinop())
+                    b->type = SInt32Type;
+            }
+        }
+    }
+
+private:
+    static Expr *copiedValue(Stmt *s)
+    {
+        Move *m = s->asMove();
+        if (!m || !m->target->asTemp())
+            return 0;
+        if (m->source->asTemp())
+            return m->source;
+        if (Unop *u = m->source->asUnop())
+            if (u->op == OpUPlus && u->expr->asTemp())
+                return u->expr;
+        return 0;
+    }
+
+    static bool isCopy(Stmt *s)
+    { return copiedValue(s) != 0; }
+
+    static bool isOne(Expr *e)
+    {
+        Const *c = e->asConst();
+        return c && c->type == SInt32Type && c->value == 1;
+    }
+
+    // Returns the operand of "x + 1", "1 + x" or "x - 1", and sets increasing accordingly.
+    static Temp *incrementedValue(Stmt *s, bool *increasing = 0)
+    {
+        Move *m = s->asMove();
+        if (!m || !m->target->asTemp())
+            return 0;
+        Binop *b = m->source->asBinop();
+        if (!b)
+            return 0;
+
+        Temp *operand = 0;
+        if (b->op == OpAdd) {
+            if (isOne(b->right))
+                operand = b->left->asTemp();
+            else if (isOne(b->left))
+                operand = b->right->asTemp();
+        } else if (b->op == OpSub && isOne(b->right)) {
+            operand = b->left->asTemp();
+        }
+        if (increasing)
+            *increasing = b->op == OpAdd;
+        return operand;
+    }
+
+    bool isInt32(Expr *e) const
+    {
+        if (Const *c = e->asConst())
+            return c->type == SInt32Type;
+        if (Temp *t = e->asTemp())
+            return t->type == SInt32Type || _candidates.contains(*t);
+        return false;
+    }
+
+    bool isInt32(const UntypedTemp &t) const
+    {
+        Stmt *s = _defUses.defStmt(t.temp);
+        if (Phi *phi = s->asPhi()) {
+            foreach (Expr *incoming, phi->d->incoming)
+                if (!isInt32(incoming))
+                    return false;
+            return true;
+        }
+        if (Expr *copied = copiedValue(s))
+            return isInt32(copied);
+
+        bool increasing = true;
+        Temp *operand = incrementedValue(s, &increasing);
+        return operand && isInt32(operand)
+                && isBounded(*operand, increasing, _defUses.defStmtBlock(t.temp));
+    }
+
+    // Strips copies, so that "+i" and "i" compare equal.
+    UntypedTemp origin(const Temp &t) const
+    {
+        UntypedTemp result(t);
+        for (int depth = 0; depth < 8; ++depth) {
+            Stmt *s = _defUses.defStmt(result.temp);
+            Expr *copied = s ? copiedValue(s) : 0;
+            if (!copied)
+                break;
+            result = *copied->asTemp();
+        }
+        return result;
+    }
+
+    // Checks whether block bb can only be reached through an edge where value was compared to
+    // be less than (or greater than, when decrementing) an int32 bound.
+    bool isBounded(const Temp &value, bool increasing, BasicBlock *bb) const
+    {
+        const UntypedTemp v = origin(value);
+        for (BasicBlock *it = bb; it; it = _dt.immediateDominator(it)) {
+            if (it->in.size() != 1)
+                continue;
+            Stmt *terminator = it->in.first()->terminator();
+            CJump *cjump = terminator ? terminator->asCJump() : 0;
+            if (!cjump || cjump->iftrue == cjump->iffalse)
+                continue;
+            Binop *cond = cjump->cond->asBinop();
+            if (!cond || !isInt32(cond->left) || !isInt32(cond->right))
+                continue;
+
+            AluOp op = cond->op;
+            if (cjump->iffalse == it) {
+                // both sides are int32, so there is no NaN to worry about
+                switch (op) {
+                case OpLt: op = OpGe; break;
+                case OpLe: op = OpGt; break;
+                case OpGt: op = OpLe; break;
+                case OpGe: op = OpLt; break;
+                default: continue;
+                }
+            }
+
+            Expr *bound;
+            if (cond->left->asTemp() && origin(*cond->left->asTemp()) == v) {
+                bound = cond->right;
+            } else if (cond->right->asTemp() && origin(*cond->right->asTemp()) == v) {
+                bound = cond->left;
+                switch (op) {
+                case OpLt: op = OpGt; break;
+                case OpLe: op = OpGe; break;
+                case OpGt: op = OpLt; break;
+                case OpGe: op = OpLe; break;
+                default: continue;
+                }
+            } else {
+                continue;
+            }
+
+            Const *c = bound->asConst();
+            if (increasing) {
+                if (op == OpLt || (op == OpLe && c && c->value < INT_MAX))
+                    return true;
+            } else {
+                if (op == OpGt || (op == OpGe && c && c->value > INT_MIN))
+                    return true;
+            }
+        }
+        return false;
+    }
+};
+
 void convertConst(Const *c, Type targetType)
 {
     switch (targetType) {
@@ -2999,24 +3681,160 @@ void splitCriticalEdges(IR::Function *f, DominatorTree &df, StatementWorklist &w
                 Q_ASSERT(!"Unknown terminator!");
             }
 
-//            qDebug() << "splitting edge" << fromBB->index() << "->" << toBB->index()
-//                     << "by inserting block" << newBB->index();
+//            qDebug() << "splitting edge" << fromBB->index() << "->" << toBB->index()
+//                     << "by inserting block" << newBB->index();
+
+            // Set the immediate dominator of the new block to inBB
+            df.setImmediateDominator(newBB, fromBB);
+
+            bool toNeedsNewIdom = true;
+            foreach (BasicBlock *bb, toBB->in) {
+                if (bb != newBB && !df.dominates(toBB, bb)) {
+                    toNeedsNewIdom = false;
+                    break;
+                }
+            }
+            if (toNeedsNewIdom)
+                df.setImmediateDominator(toBB, newBB);
+        }
+    }
+}
+
+// Hoists loop-invariant computations into the loop's pre-header.
+//
+// This runs on edge-split SSA form, so a loop that is entered from a single block outside of it
+// has a pre-header: a block with the loop header as its only successor. Only computations that
+// cannot have side-effects and cannot throw are moved: arithmetic, comparisons and conversions
+// on numbers and booleans. Those can safely be executed even if the part of the loop body they
+// came from is never run. Inner loops are handled first, so that invariants of an inner loop
+// that are also invariant in the outer loop end up in front of the outer loop.
+class LoopInvariantCodeMotion
+{
+    IR::Function *function;
+
+    struct InnerLoopsFirst
+    {
+        static int loopDepth(BasicBlock *header)
+        {
+            int depth = 0;
+            for (BasicBlock *it = header->containingGroup(); it; it = it->containingGroup())
+                ++depth;
+            return depth;
+        }
+
+        bool operator()(BasicBlock *a, BasicBlock *b) const
+        {
+            const int depthA = loopDepth(a);
+            const int depthB = loopDepth(b);
+            return depthA != depthB ? depthA > depthB : a->index() < b->index();
+        }
+    };
+
+public:
+    LoopInvariantCodeMotion(IR::Function *function)
+        : function(function)
+    {}
+
+    void run()
+    {
+        QHash<BasicBlock *, QVector<BasicBlock *> > loops;
+        foreach (BasicBlock *bb, function->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+            for (BasicBlock *header = bb->isGroupStart() ? bb : bb->containingGroup(); header;
+                 header = header->containingGroup())
+                loops[header].append(bb);
+        }
+
+        QVector<BasicBlock *> headers = loops.keys().toVector();
+        std::sort(headers.begin(), headers.end(), InnerLoopsFirst());
+        foreach (BasicBlock *header, headers)
+            hoist(header, loops.value(header));
+    }
+
+private:
+    void hoist(BasicBlock *header, const QVector<BasicBlock *> &body)
+    {
+        BasicBlock *preHeader = 0;
+        foreach (BasicBlock *in, header->in) {
+            if (body.contains(in))
+                continue;
+            if (preHeader)
+                return; // more than one way into the loop
+            preHeader = in;
+        }
+        if (!preHeader || preHeader->out.size() != 1)
+            return;
+
+        std::vector<bool> definedInLoop(function->tempCount, false);
+        foreach (BasicBlock *bb, body) {
+            foreach (Stmt *s, bb->statements()) {
+                if (Move *m = s->asMove()) {
+                    if (Temp *t = m->target->asTemp())
+                        definedInLoop[t->index] = true;
+                } else if (Phi *phi = s->asPhi()) {
+                    definedInLoop[phi->targetTemp->index] = true;
+                }
+            }
+        }
 
-            // Set the immediate dominator of the new block to inBB
-            df.setImmediateDominator(newBB, fromBB);
+        // Statements can depend on each other, so repeat until nothing moves anymore. The
+        // hoisted statements are appended to the pre-header, which keeps them in dependency
+        // order.
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            foreach (BasicBlock *bb, body) {
+                for (int i = 0; i < bb->statementCount(); ) {
+                    Stmt *s = bb->statements().at(i);
+                    if (!isInvariant(s, definedInLoop)) {
+                        ++i;
+                        continue;
+                    }
 
-            bool toNeedsNewIdom = true;
-            foreach (BasicBlock *bb, toBB->in) {
-                if (bb != newBB && !df.dominates(toBB, bb)) {
-                    toNeedsNewIdom = false;
-                    break;
+                    bb->removeStatement(i);
+                    preHeader->insertStatementBeforeTerminator(s);
+                    definedInLoop[s->asMove()->target->asTemp()->index] = false;
+                    changed = true;
                 }
             }
-            if (toNeedsNewIdom)
-                df.setImmediateDominator(toBB, newBB);
         }
     }
-}
+
+    static bool isPrimitiveNumberOrBool(Expr *e)
+    { return e->type & NumberType || e->type == BoolType; }
+
+    static bool isInvariantOperand(Expr *e, const std::vector<bool> &definedInLoop)
+    {
+        if (!isPrimitiveNumberOrBool(e))
+            return false;
+        if (e->asConst())
+            return true;
+        if (Temp *t = e->asTemp())
+            return t->kind == Temp::VirtualRegister && !definedInLoop[t->index];
+        return false;
+    }
+
+    static bool isInvariant(Stmt *s, const std::vector<bool> &definedInLoop)
+    {
+        Move *m = s->asMove();
+        if (!m || !m->target->asTemp() || m->target->asTemp()->kind != Temp::VirtualRegister)
+            return false;
+
+        if (Binop *b = m->source->asBinop()) {
+            if (b->op == OpInstanceof || b->op == OpIn)
+                return false;
+            return isInvariantOperand(b->left, definedInLoop)
+                    && isInvariantOperand(b->right, definedInLoop);
+        } else if (Unop *u = m->source->asUnop()) {
+            return isInvariantOperand(u->expr, definedInLoop);
+        } else if (Convert *c = m->source->asConvert()) {
+            return isPrimitiveNumberOrBool(c) && isInvariantOperand(c->expr, definedInLoop);
+        }
+
+        return false;
+    }
+};
 
 // Detect all (sub-)loops in a function.
 //
@@ -4496,6 +5314,192 @@ private:
     std::vector<int> tempForLocal;
 };
 
+// Speculates that property and element reads keep returning the kind of numbers the interpreter
+// saw them return in the tiered mode (see Function::observedTypes). A read that only returned
+// integers, or only numbers, is followed by a check of the value's type. When it passes, the
+// value is converted, so that the code using it can work on unboxed numbers:
+//
+//     %1 = %0.x
+//     %2 = builtin_has_type(%1, <type>)
+//     cjump %2, L_speculated, L_generic
+//   L_speculated:
+//     %1 = convert %1 to <type>
+//     ... the rest of the function
+//   L_generic:
+//     ... a copy of the rest of the function
+//
+// Everything that can run after a read is copied once. A failing check continues in the copy,
+// which has neither checks nor conversions, and stays there until the function returns. Booleans
+// and strings are not speculated on, because no conversion makes them cheaper to use.
+class TypeSpeculation
+{
+    enum { MaxStatements = 400 };
+
+    struct Site {
+        BasicBlock *head;
+        BasicBlock *tail;
+        Temp *value;
+        Type type;
+        QQmlJS::AST::SourceLocation location;
+    };
+
+public:
+    TypeSpeculation(Function *function)
+        : function(function)
+    {}
+
+    bool run()
+    {
+        if (function->observedTypes.isEmpty())
+            return false;
+
+        // The rest of the function is copied, so keep that to small functions.
+        int statementCount = 0;
+        foreach (BasicBlock *bb, function->basicBlocks()) {
+            if (!bb->isRemoved())
+                statementCount += bb->statementCount();
+        }
+        if (statementCount > MaxStatements)
+            return false;
+
+        // New blocks are appended, so the tails are visited too.
+        QVector<Site> sites;
+        for (int i = 0; i < function->basicBlockCount(); ++i) {
+            BasicBlock *bb = function->basicBlock(i);
+            if (bb->isRemoved())
+                continue;
+            for (int j = 0, ej = bb->statementCount(); j != ej; ++j) {
+                Move *move = bb->statements().at(j)->asMove();
+                if (!move)
+                    continue;
+                Temp *value = move->target->asTemp();
+                const Type type = speculatedType(move);
+                if (!value || value->kind != Temp::VirtualRegister || type == UnknownType)
+                    continue;
+
+                Site site;
+                site.head = bb;
+                site.tail = split(bb, j + 1);
+                site.value = value;
+                site.type = type;
+                site.location = move->location;
+                sites.append(site);
+                break;
+            }
+        }
+        if (sites.isEmpty())
+            return false;
+
+        const QHash<BasicBlock *, BasicBlock *> generic = copyReachableBlocks(sites);
+
+        foreach (const Site &site, sites) {
+            BasicBlock *head = site.head;
+            head->removeStatement(head->statementCount() - 1);
+            head->out.clear();
+            site.tail->in.removeOne(head);
+
+            const QQmlJS::AST::SourceLocation nextLocation = head->nextLocation;
+            head->nextLocation = site.location;
+            ExprList *args = function->New<ExprList>();
+            args->init(CloneExpr::cloneTemp(site.value, function));
+            args->next = function->New<ExprList>();
+            args->next->init(head->CONST(SInt32Type, site.type));
+            const unsigned checkTemp = head->newTemp();
+            head->MOVE(head->TEMP(checkTemp), head->CALL(head->NAME(Name::builtin_has_type, 0, 0), args));
+            head->CJUMP(head->TEMP(checkTemp), site.tail, generic.value(site.tail));
+            head->nextLocation = nextLocation;
+
+            Move *convert = function->NewStmt<Move>();
+            convert->init(CloneExpr::cloneTemp(site.value, function),
+                          site.tail->CONVERT(CloneExpr::cloneTemp(site.value, function), site.type));
+            convert->location = site.location;
+            site.tail->prependStatement(convert);
+        }
+
+        return true;
+    }
+
+private:
+    Type speculatedType(Move *move) const
+    {
+        const int slot = move->typeFeedbackSlot;
+        if (slot < 0 || slot >= function->observedTypes.size())
+            return UnknownType;
+
+        const int observed = function->observedTypes.at(slot);
+        if (observed == SInt32Type)
+            return SInt32Type;
+        if (observed != UnknownType && !(observed & ~NumberType))
+            return DoubleType;
+        return UnknownType;
+    }
+
+    // Moves the statements from statementIndex on into a new block, which bb jumps to.
+    BasicBlock *split(BasicBlock *bb, int statementIndex)
+    {
+        BasicBlock *tail = function->newBasicBlock(bb->catchBlock);
+        const QVector<Stmt *> statements = bb->statements().mid(statementIndex);
+        while (bb->statementCount() > statementIndex)
+            bb->removeStatement(bb->statementCount() - 1);
+        foreach (Stmt *s, statements) {
+            if (CJump *cjump = s->asCJump())
+                cjump->parent = tail;
+            tail->appendStatement(s);
+        }
+        tail->nextLocation = bb->nextLocation;
+        qSwap(tail->out, bb->out);
+        foreach (BasicBlock *out, tail->out)
+            out->in[out->in.indexOf(bb)] = tail;
+        bb->JUMP(tail);
+        return tail;
+    }
+
+    QHash<BasicBlock *, BasicBlock *> copyReachableBlocks(const QVector<Site> &sites)
+    {
+        QHash<BasicBlock *, BasicBlock *> copies;
+        QVector<BasicBlock *> originals;
+        QVector<BasicBlock *> worklist;
+        foreach (const Site &site, sites)
+            worklist.append(site.tail);
+        while (!worklist.isEmpty()) {
+            BasicBlock *bb = worklist.takeLast();
+            if (copies.contains(bb))
+                continue;
+            copies.insert(bb, function->newBasicBlock(bb->catchBlock));
+            originals.append(bb);
+            worklist += bb->out;
+        }
+
+        CloneExpr clone;
+        foreach (BasicBlock *original, originals) {
+            BasicBlock *copy = copies.value(original);
+            clone.setBasicBlock(copy);
+            foreach (Stmt *s, original->statements()) {
+                Stmt *cs = 0;
+                if (Exp *exp = s->asExp())
+                    cs = copy->EXP(clone(exp->expr));
+                else if (Move *move = s->asMove())
+                    cs = copy->MOVE(clone(move->target), clone(move->source));
+                else if (Jump *jump = s->asJump())
+                    cs = copy->JUMP(copies.value(jump->target));
+                else if (CJump *cjump = s->asCJump())
+                    cs = copy->CJUMP(clone(cjump->cond), copies.value(cjump->iftrue),
+                                     copies.value(cjump->iffalse));
+                else if (Ret *ret = s->asRet())
+                    cs = copy->RET(clone(ret->expr));
+                else
+                    Q_UNREACHABLE();
+                cs->location = s->location;
+            }
+            copy->nextLocation = original->nextLocation;
+        }
+
+        return copies;
+    }
+
+    Function *function;
+};
+
 class CloneBasicBlock: protected IR::StmtVisitor, protected CloneExpr
 {
 public:
@@ -4834,6 +5838,475 @@ static void verifyNoPointerSharing(IR::Function *function)
     V(function);
 }
 
+// Clones the body of an inlined function into the caller: its temps, formals and locals become
+// fresh temps of the caller, and accesses to outer scopes are rebased onto the caller's scopes.
+class InlinedExpr: public CloneExpr
+{
+public:
+    InlinedExpr(BasicBlock *block, int tempBase, int formalBase, int localBase, int scopeOffset)
+        : CloneExpr(block)
+        , tempBase(tempBase)
+        , formalBase(formalBase)
+        , localBase(localBase)
+        , scopeOffset(scopeOffset)
+    {}
+
+protected:
+    virtual void visitTemp(Temp *e)
+    {
+        Temp *t = block->TEMP(tempBase + e->index);
+        t->type = e->type;
+        cloned = t;
+    }
+
+    virtual void visitArgLocal(ArgLocal *e)
+    {
+        if (e->scope == 0) {
+            const bool isFormal = e->kind == ArgLocal::Formal;
+            cloned = block->TEMP((isFormal ? formalBase : localBase) + e->index);
+            return;
+        }
+
+        const unsigned scope = e->scope + scopeOffset;
+        if (e->kind == ArgLocal::ScopedFormal)
+            cloned = block->ARG(e->index, scope);
+        else
+            cloned = block->LOCAL(e->index, scope);
+    }
+
+private:
+    int tempBase;
+    int formalBase;
+    int localBase;
+    int scopeOffset;
+};
+
+// Replaces calls to small functions of the same module by a copy of their body. The callee has
+// to be a closure that is stored in a variable of an enclosing scope (or in a global of the
+// script), it may not create closures itself, use arguments, this, eval, with or try, and must
+// not contain loops. As the variable can be overwritten at run-time, the copy is guarded by a
+// builtin_is_closure check, which falls back to the original call:
+//
+//     %callee = clamp
+//     %check = builtin_is_closure(%callee, <function index>, <scope depth>)
+//     cjump %check, L_inlined, L_call
+//   L_inlined:
+//     <formals and locals of clamp as temps, body of clamp>
+//     jump L_continue
+//   L_call:
+//     %result = call %callee(...)
+//     jump L_continue
+//   L_continue:
+//     <rest of the original basic block>
+class FunctionInliner
+{
+    enum { MaxInlinedStatements = 32 };
+
+    struct Callee {
+        Callee() : inlinable(false), usesOuterScopes(false) {}
+
+        bool inlinable;
+        bool usesOuterScopes;
+        QSet<QString> names;
+    };
+
+    class CalleeChecker: protected StmtVisitor, protected ExprVisitor
+    {
+    public:
+        Callee check(Function *function)
+        {
+            callee = Callee();
+            callee.inlinable = !function->hasDirectEval && !function->usesArgumentsObject
+                    && !function->usesThis && !function->hasTry && !function->hasWith
+                    && !function->isNamedExpression && function->nestedFunctions.isEmpty();
+
+            int statementCount = 0;
+            foreach (BasicBlock *bb, function->basicBlocks()) {
+                if (!callee.inlinable)
+                    break;
+                if (bb->isRemoved() || bb->catchBlock || bb->isExceptionHandler()) {
+                    callee.inlinable = false;
+                    break;
+                }
+                statementCount += bb->statementCount();
+                currentBlock = bb;
+                foreach (Stmt *s, bb->statements())
+                    s->accept(this);
+            }
+
+            if (statementCount > MaxInlinedStatements)
+                callee.inlinable = false;
+            return callee;
+        }
+
+    protected:
+        virtual void visitExp(Exp *s) { s->expr->accept(this); }
+        virtual void visitMove(Move *s) { s->target->accept(this); s->source->accept(this); }
+        // Loops are not detected yet, but the code generator only jumps backwards in loops.
+        virtual void visitJump(Jump *s) { checkEdge(s->target); }
+        virtual void visitCJump(CJump *s)
+        {
+            s->cond->accept(this);
+            checkEdge(s->iftrue);
+            checkEdge(s->iffalse);
+        }
+        virtual void visitRet(Ret *s) { if (s->expr) s->expr->accept(this); }
+        virtual void visitPhi(Phi *) { callee.inlinable = false; }
+
+        void checkEdge(BasicBlock *target)
+        {
+            if (target->index() <= currentBlock->index())
+                callee.inlinable = false;
+        }
+
+        virtual void visitConst(Const *) {}
+        virtual void visitString(IR::String *) {}
+        virtual void visitRegExp(IR::RegExp *) {}
+        virtual void visitName(Name *e)
+        {
+            switch (e->builtin) {
+            case Name::builtin_invalid:
+                if (!e->id || e->qmlSingleton || *e->id == QStringLiteral("this"))
+                    callee.inlinable = false;
+                else
+                    callee.names.insert(*e->id);
+                break;
+            case Name::builtin_typeof:
+            case Name::builtin_delete:
+            case Name::builtin_throw:
+            case Name::builtin_define_array:
+            case Name::builtin_define_object_literal:
+                break;
+            default:
+                callee.inlinable = false;
+                break;
+            }
+        }
+        virtual void visitTemp(Temp *) {}
+        virtual void visitArgLocal(ArgLocal *e)
+        {
+            if (e->isArgumentsOrEval)
+                callee.inlinable = false;
+            if (e->scope)
+                callee.usesOuterScopes = true;
+        }
+        virtual void visitClosure(Closure *) { callee.inlinable = false; }
+        virtual void visitConvert(Convert *e) { e->expr->accept(this); }
+        virtual void visitUnop(Unop *e) { e->expr->accept(this); }
+        virtual void visitBinop(Binop *e) { e->left->accept(this); e->right->accept(this); }
+        virtual void visitCall(Call *e) { e->base->accept(this); visitList(e->args); }
+        virtual void visitNew(New *e) { e->base->accept(this); visitList(e->args); }
+        virtual void visitSubscript(Subscript *e) { e->base->accept(this); e->index->accept(this); }
+        virtual void visitMember(Member *e)
+        {
+            if (e->property || e->kind != Member::UnspecifiedMember)
+                callee.inlinable = false;
+            e->base->accept(this);
+        }
+
+        void visitList(ExprList *list)
+        {
+            for (ExprList *it = list; it; it = it->next)
+                it->expr->accept(this);
+        }
+
+    private:
+        Callee callee;
+        BasicBlock *currentBlock;
+    };
+
+public:
+    FunctionInliner(Function *function)
+        : function(function)
+        , module(function->module)
+        , globalClosuresCollected(false)
+    {}
+
+    void run()
+    {
+        QVector<BasicBlock *> worklist = function->basicBlocks();
+        while (!worklist.isEmpty()) {
+            BasicBlock *bb = worklist.takeFirst();
+            if (bb->isRemoved())
+                continue;
+
+            for (int i = 0, ei = bb->statementCount(); i != ei; ++i) {
+                // The rest of the block is moved into a new one, which is scanned later. The
+                // inlined body itself is not, so recursive functions are inlined only once.
+                if (BasicBlock *continuation = tryInline(bb, i)) {
+                    worklist.append(continuation);
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    static bool declares(Function *f, const QString &name)
+    {
+        foreach (const QString *formal, f->formals)
+            if (*formal == name)
+                return true;
+        foreach (const QString *local, f->locals)
+            if (*local == name)
+                return true;
+        return false;
+    }
+
+    // Returns the index of the only closure assigned by stmts to the variable, or -1.
+    template <typename Predicate>
+    static int closureStoredIn(Function *f, Predicate isVariable)
+    {
+        int closure = -1;
+        foreach (BasicBlock *bb, f->basicBlocks()) {
+            if (bb->isRemoved())
+                continue;
+            foreach (Stmt *s, bb->statements()) {
+                Move *m = s->asMove();
+                if (!m || !isVariable(m->target))
+                    continue;
+                Closure *c = m->source->asClosure();
+                if (!c || closure != -1)
+                    return -1;
+                closure = c->value;
+            }
+        }
+        return closure;
+    }
+
+    struct IsGlobal
+    {
+        const QString *name;
+        bool operator()(Expr *e) const
+        {
+            Name *n = e->asName();
+            return n && n->builtin == Name::builtin_invalid && n->id && *n->id == *name;
+        }
+    };
+
+    struct IsLocal
+    {
+        unsigned index;
+        bool operator()(Expr *e) const
+        {
+            ArgLocal *al = e->asArgLocal();
+            return al && al->kind == ArgLocal::Local && al->scope == 0 && al->index == index;
+        }
+    };
+
+    const Callee &callee(Function *f)
+    {
+        QHash<Function *, Callee>::iterator it = callees.find(f);
+        if (it == callees.end())
+            it = callees.insert(f, CalleeChecker().check(f));
+        return *it;
+    }
+
+    BasicBlock *tryInline(BasicBlock *bb, int statementIndex)
+    {
+        Stmt *s = bb->statements().at(statementIndex);
+        Call *call = 0;
+        Expr *target = 0;
+        if (Move *m = s->asMove()) {
+            call = m->source->asCall();
+            target = m->target;
+            if (!target->asTemp() && !target->asArgLocal())
+                return 0;
+        } else if (Exp *e = s->asExp()) {
+            call = e->expr->asCall();
+        }
+        if (!call)
+            return 0;
+        for (ExprList *it = call->args; it; it = it->next) {
+            if (!it->expr->asTemp() && !it->expr->asArgLocal() && !it->expr->asConst())
+                return 0;
+        }
+
+        // Find the function the callee is declared in, and how it is referenced from here.
+        Function *outer = 0;
+        int closure = -1;
+        int scopeDepth = -1;
+        if (Name *n = call->base->asName()) {
+            if (n->builtin != Name::builtin_invalid || !n->global || !n->id)
+                return 0;
+            outer = module->rootFunction;
+            if (!outer)
+                return 0;
+            closure = globalClosure(*n->id);
+        } else if (ArgLocal *al = call->base->asArgLocal()) {
+            if (al->kind != ArgLocal::Local && al->kind != ArgLocal::ScopedLocal)
+                return 0;
+            if (al->isArgumentsOrEval)
+                return 0;
+            outer = function;
+            for (unsigned i = 0; outer && i < al->scope; ++i)
+                outer = outer->outer;
+            if (!outer)
+                return 0;
+            IsLocal isLocal = { al->index };
+            closure = closureStoredIn(outer, isLocal);
+            scopeDepth = al->scope;
+        }
+        if (closure == -1)
+            return 0;
+
+        Function *inlined = module->functions.at(closure);
+        if (inlined == function || inlined->outer != outer || inlined->isStrict != function->isStrict)
+            return 0;
+        const Callee &info = callee(inlined);
+        if (!info.inlinable || (info.usesOuterScopes && scopeDepth < 0))
+            return 0;
+
+        // Names in the callee have to resolve to the same variables from here.
+        for (Function *f = function; f != outer; f = f->outer) {
+            if (!f || f->hasDirectEval)
+                return 0;
+            foreach (const QString &name, info.names) {
+                if (declares(f, name))
+                    return 0;
+            }
+        }
+
+        return inlineCall(bb, statementIndex, call, target, closure, scopeDepth);
+    }
+
+    int globalClosure(const QString &name)
+    {
+        if (!globalClosuresCollected) {
+            globalClosuresCollected = true;
+            foreach (Function *f, module->rootFunction->nestedFunctions) {
+                IsGlobal isGlobal = { f->name };
+                const int closure = closureStoredIn(module->rootFunction, isGlobal);
+                if (closure != -1)
+                    globalClosures.insert(*f->name, closure);
+            }
+        }
+        return globalClosures.value(name, -1);
+    }
+
+    BasicBlock *inlineCall(BasicBlock *bb, int statementIndex, Call *call, Expr *target,
+                           int closure, int scopeDepth)
+    {
+        Function *inlined = module->functions.at(closure);
+        Stmt *callStmt = bb->statements().at(statementIndex);
+        const QQmlJS::AST::SourceLocation location = callStmt->location;
+
+        // Split the block after the call. The statements keep their locations.
+        BasicBlock *continuation = newBlock(bb, QQmlJS::AST::SourceLocation());
+        const QVector<Stmt *> tail = bb->statements().mid(statementIndex + 1);
+        while (bb->statementCount() > statementIndex)
+            bb->removeStatement(bb->statementCount() - 1);
+        foreach (Stmt *s, tail) {
+            if (CJump *cjump = s->asCJump())
+                cjump->parent = continuation;
+            continuation->appendStatement(s);
+        }
+        continuation->nextLocation = bb->nextLocation;
+        qSwap(continuation->out, bb->out);
+        foreach (BasicBlock *out, continuation->out)
+            out->in[out->in.indexOf(bb)] = continuation;
+
+        CloneExpr clone(bb);
+
+        // The guard.
+        const QQmlJS::AST::SourceLocation nextLocation = bb->nextLocation;
+        bb->nextLocation = location;
+        const unsigned calleeTemp = bb->newTemp();
+        bb->MOVE(bb->TEMP(calleeTemp), clone(call->base));
+        ExprList *checkArgs = function->New<ExprList>();
+        checkArgs->init(bb->TEMP(calleeTemp));
+        checkArgs->next = function->New<ExprList>();
+        checkArgs->next->init(bb->CONST(NumberType, closure));
+        checkArgs->next->next = function->New<ExprList>();
+        checkArgs->next->next->init(bb->CONST(NumberType, scopeDepth));
+        const unsigned checkTemp = bb->newTemp();
+        bb->MOVE(bb->TEMP(checkTemp), bb->CALL(bb->NAME(Name::builtin_is_closure, 0, 0), checkArgs));
+        BasicBlock *entry = newBlock(bb, location);
+        BasicBlock *fallback = newBlock(bb, location);
+        bb->CJUMP(bb->TEMP(checkTemp), entry, fallback);
+        bb->nextLocation = nextLocation;
+
+        // The original call, for when the variable was overwritten.
+        ExprList *fallbackArgs = 0;
+        for (ExprList **it = &fallbackArgs, *arg = call->args; arg; arg = arg->next) {
+            *it = function->New<ExprList>();
+            (*it)->init(clone(arg->expr));
+            it = &(*it)->next;
+        }
+        Expr *fallbackCall = fallback->CALL(fallback->TEMP(calleeTemp), fallbackArgs);
+        if (target)
+            fallback->MOVE(clone(target), fallbackCall);
+        else
+            fallback->EXP(fallbackCall);
+        fallback->JUMP(continuation);
+
+        // The copy of the body, with the formals initialized from the arguments.
+        const int formalBase = function->tempCount;
+        const int localBase = formalBase + inlined->formals.size();
+        const int tempBase = localBase + inlined->locals.size();
+        function->tempCount = tempBase + inlined->tempCount;
+
+        ExprList *arg = call->args;
+        for (int i = 0; i < inlined->formals.size(); ++i) {
+            Expr *value = arg ? clone(arg->expr) : entry->CONST(UndefinedType, 0);
+            entry->MOVE(entry->TEMP(formalBase + i), value);
+            if (arg)
+                arg = arg->next;
+        }
+        // Locals start out undefined on every call, the temps may still hold the values of an
+        // earlier inlined call.
+        for (int i = 0; i < inlined->locals.size(); ++i)
+            entry->MOVE(entry->TEMP(localBase + i), entry->CONST(UndefinedType, 0));
+
+        QHash<BasicBlock *, BasicBlock *> blocks;
+        foreach (BasicBlock *original, inlined->basicBlocks())
+            blocks.insert(original, newBlock(bb, location));
+        entry->JUMP(blocks.value(inlined->basicBlock(0)));
+
+        InlinedExpr inlinedExpr(bb, tempBase, formalBase, localBase, scopeDepth - 1);
+        foreach (BasicBlock *original, inlined->basicBlocks()) {
+            BasicBlock *copy = blocks.value(original);
+            inlinedExpr.setBasicBlock(copy);
+            foreach (Stmt *s, original->statements()) {
+                if (Exp *exp = s->asExp()) {
+                    copy->EXP(inlinedExpr(exp->expr));
+                } else if (Move *move = s->asMove()) {
+                    copy->MOVE(inlinedExpr(move->target), inlinedExpr(move->source));
+                } else if (Jump *jump = s->asJump()) {
+                    copy->JUMP(blocks.value(jump->target));
+                } else if (CJump *cjump = s->asCJump()) {
+                    copy->CJUMP(inlinedExpr(cjump->cond), blocks.value(cjump->iftrue),
+                                blocks.value(cjump->iffalse));
+                } else if (Ret *ret = s->asRet()) {
+                    if (target && ret->expr)
+                        copy->MOVE(clone(target), inlinedExpr(ret->expr));
+                    else if (target)
+                        copy->MOVE(clone(target), copy->CONST(UndefinedType, 0));
+                    copy->JUMP(continuation);
+                } else {
+                    Q_UNREACHABLE();
+                }
+            }
+        }
+
+        return continuation;
+    }
+
+    BasicBlock *newBlock(BasicBlock *bb, const QQmlJS::AST::SourceLocation &location)
+    {
+        BasicBlock *block = function->newBasicBlock(bb->catchBlock);
+        // Exceptions thrown from the inlined code are reported at the call.
+        block->nextLocation = location;
+        return block;
+    }
+
+    Function *function;
+    Module *module;
+    QHash<Function *, Callee> callees;
+    bool globalClosuresCollected;
+    QHash<QString, int> globalClosures;
+};
+
 } // anonymous namespace
 
 void LifeTimeInterval::setFrom(int from) {
@@ -5066,6 +6539,10 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
         ConvertArgLocals(function).toTemps();
         showMeTheCode(function, "After converting arguments to locals");
 
+        static bool doSpeculation = qgetenv("QV4_NO_SPECULATION").isEmpty();
+        if (doTypeInference && doSpeculation && TypeSpeculation(function).run())
+            showMeTheCode(function, "After type speculation");
+
         // Calculate the dominator tree:
         DominatorTree df(function);
 
@@ -5109,6 +6586,13 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
         cleanupPhis(defUses);
         showMeTheCode(function, "After cleaning up phi-nodes");
 
+        static bool doOpt = qgetenv("QV4_NO_OPT").isEmpty();
+        if (const int eliminated = doOpt ? ScalarReplacement(function, defUses).run() : 0) {
+            const QByteArray marker = "After scalar replacement, eliminated allocations: "
+                    + QByteArray::number(eliminated);
+            showMeTheCode(function, marker.constData());
+        }
+
         StatementWorklist worklist(function);
 
         if (doTypeInference) {
@@ -5120,13 +6604,15 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
             ReverseInference(defUses).run(function);
 //            showMeTheCode(function);
 
+            InductionVariableInference(defUses, df).run(function);
+            showMeTheCode(function, "After induction variable inference");
+
 //            qout << "Doing type propagation..." << endl;
             TypePropagation(defUses).run(function, worklist);
 //            showMeTheCode(function);
             verifyNoPointerSharing(function);
         }
 
-        static bool doOpt = qgetenv("QV4_NO_OPT").isEmpty();
         if (doOpt) {
 //            qout << "Running SSA optimization..." << endl;
             worklist.reset();
@@ -5154,6 +6640,11 @@ void Optimizer::run(QQmlEnginePrivate *qmlEngine, bool doTypeInference, bool pee
         verifyImmediateDominators(df, function);
         verifyCFG(function);
 
+        if (doOpt) {
+            LoopInvariantCodeMotion(function).run();
+            showMeTheCode(function, "After loop-invariant code motion");
+        }
+
 //        qout << "Doing block scheduling..." << endl;
 //        df.dumpImmediateDominators();
         startEndLoops = BlockScheduler(function, df).go();
@@ -5265,6 +6756,16 @@ QSet<Jump *> Optimizer::calculateOptionalJumps()
     return optional;
 }
 
+void Optimizer::inlineCalls(Function *function)
+{
+    static bool doInlining = qgetenv("QV4_NO_INLINE").isEmpty();
+    if (!doInlining || function->module->debugMode || function->module->isQmlModule)
+        return;
+
+    FunctionInliner(function).run();
+    showMeTheCode(function, "After inlining");
+}
+
 void Optimizer::showMeTheCode(IR::Function *function, const char *marker)
 {
     ::showMeTheCode(function, marker);
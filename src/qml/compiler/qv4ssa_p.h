@@ -219,6 +219,10 @@ public:
 
     QSet<IR::Jump *> calculateOptionalJumps();
 
+    // Inlines calls to small functions of the same module. Has to run before any function of the
+    // module is optimized, as it copies the IR of the callees.
+    static void inlineCalls(Function *function);
+
     static void showMeTheCode(Function *function, const char *marker);
 
 private:
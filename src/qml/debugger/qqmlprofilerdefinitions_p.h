@@ -61,6 +61,10 @@ struct QQmlProfilerDefinitions {
         PixmapCacheEvent,
         SceneGraphFrame,
         MemoryAllocation,
+        AllocationSite,
+        HeapSnapshot,
+        TierUp,
+        JitStatistics,
 
         MaximumMessage
     };
@@ -137,6 +141,10 @@ struct QQmlProfilerDefinitions {
         ProfileBinding,
         ProfileHandlingSignal,
         ProfileInputEvents,
+        ProfileAllocationSites = QV4::Profiling::FeatureAllocationSites,
+        ProfileHeapSnapshot = QV4::Profiling::FeatureHeapSnapshot,
+        ProfileTierUp = QV4::Profiling::FeatureTierUp,
+        ProfileJitStatistics = QV4::Profiling::FeatureJitStatistics,
 
         MaximumProfileFeature
     };
@@ -359,7 +359,9 @@ void QQmlProfilerService::messageReceived(const QByteArray &message)
     QQmlDebugStream stream(&rwData, QIODevice::ReadOnly);
 
     int engineId = -1;
-    quint64 features = std::numeric_limits<quint64>::max();
+    // Taking a heap snapshot forces a full GC and a walk of the whole heap when profiling stops,
+    // so clients have to request it explicitly.
+    quint64 features = std::numeric_limits<quint64>::max() & ~(quint64(1) << ProfileHeapSnapshot);
     bool enabled;
     stream >> enabled;
     if (!stream.atEnd())
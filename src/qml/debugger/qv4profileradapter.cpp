@@ -55,6 +55,14 @@ QV4ProfilerAdapter::QV4ProfilerAdapter(QQmlProfilerService *service, QV4::Execut
                                                QList<QV4::Profiling::MemoryAllocationProperties>)),
             this, SLOT(receiveData(QList<QV4::Profiling::FunctionCallProperties>,
                                    QList<QV4::Profiling::MemoryAllocationProperties>)));
+    connect(engine->profiler, SIGNAL(heapDataReady(QList<QV4::Profiling::AllocationSiteProperties>,
+                                                   QList<QV4::Profiling::HeapSnapshotProperties>)),
+            this, SLOT(receiveHeapData(QList<QV4::Profiling::AllocationSiteProperties>,
+                                       QList<QV4::Profiling::HeapSnapshotProperties>)));
+    connect(engine->profiler, SIGNAL(tierUpDataReady(QList<QV4::Profiling::TierUpProperties>)),
+            this, SLOT(receiveTierUpData(QList<QV4::Profiling::TierUpProperties>)));
+    connect(engine->profiler, SIGNAL(jitDataReady(QList<QV4::Profiling::JitStatisticsProperties>)),
+            this, SLOT(receiveJitData(QList<QV4::Profiling::JitStatisticsProperties>)));
 }
 
 qint64 QV4ProfilerAdapter::appendMemoryEvents(qint64 until, QList<QByteArray> &messages)
@@ -70,6 +78,65 @@ qint64 QV4ProfilerAdapter::appendMemoryEvents(qint64 until, QList<QByteArray> &m
     return memory_data.empty() ? -1 : memory_data.front().timestamp;
 }
 
+qint64 QV4ProfilerAdapter::appendHeapEvents(qint64 until, QList<QByteArray> &messages)
+{
+    QByteArray message;
+    while (!allocation_site_data.empty() && allocation_site_data.front().timestamp <= until) {
+        QQmlDebugStream d(&message, QIODevice::WriteOnly);
+        QV4::Profiling::AllocationSiteProperties &props = allocation_site_data.front();
+        d << props.timestamp << AllocationSite << props.file << props.line << props.column
+          << props.name << props.samples << props.size;
+        allocation_site_data.pop_front();
+        messages.append(message);
+        message.clear();
+    }
+    if (!allocation_site_data.empty())
+        return allocation_site_data.front().timestamp;
+
+    while (!heap_data.empty() && heap_data.front().timestamp <= until) {
+        QQmlDebugStream d(&message, QIODevice::WriteOnly);
+        QV4::Profiling::HeapSnapshotProperties &props = heap_data.front();
+        d << props.timestamp << HeapSnapshot << props.className << props.count << props.shallowSize
+          << props.retainedSize << props.retainerPath;
+        heap_data.pop_front();
+        messages.append(message);
+        message.clear();
+    }
+    return heap_data.empty() ? -1 : heap_data.front().timestamp;
+}
+
+qint64 QV4ProfilerAdapter::appendTierUpEvents(qint64 until, QList<QByteArray> &messages)
+{
+    QByteArray message;
+    while (!tier_up_data.empty() && tier_up_data.front().start <= until) {
+        QQmlDebugStream d(&message, QIODevice::WriteOnly);
+        QV4::Profiling::TierUpProperties &props = tier_up_data.front();
+        d << props.start << TierUp << props.file << props.line << props.column << props.name
+          << (props.end - props.start) << props.calls << props.backEdges;
+        tier_up_data.pop_front();
+        messages.append(message);
+        message.clear();
+    }
+    return tier_up_data.empty() ? -1 : tier_up_data.front().start;
+}
+
+qint64 QV4ProfilerAdapter::appendJitEvents(qint64 until, QList<QByteArray> &messages)
+{
+    QByteArray message;
+    while (!jit_data.empty() && jit_data.front().timestamp <= until) {
+        QQmlDebugStream d(&message, QIODevice::WriteOnly);
+        QV4::Profiling::JitStatisticsProperties &props = jit_data.front();
+        const QV4::Profiling::JitStatistics &stats = props.statistics;
+        d << props.timestamp << JitStatistics << props.file << props.line << props.column
+          << props.name << stats.irStatements << stats.basicBlocks << stats.optimizeTime
+          << stats.regallocTime << stats.spills << stats.codeSize << stats.executableSize;
+        jit_data.pop_front();
+        messages.append(message);
+        message.clear();
+    }
+    return jit_data.empty() ? -1 : jit_data.front().timestamp;
+}
+
 qint64 QV4ProfilerAdapter::sendMessages(qint64 until, QList<QByteArray> &messages)
 {
     QByteArray message;
@@ -108,8 +175,18 @@ qint64 QV4ProfilerAdapter::sendMessages(qint64 until, QList<QByteArray> &message
             stack.push(props.end);
             data.pop_front();
         }
-        if (stack.empty() && data.empty())
-            return appendMemoryEvents(until, messages);
+        if (stack.empty() && data.empty()) {
+            // Tier-ups and JIT statistics are sent after the ranges they happened in. The heap
+            // data is collected when profiling stops, so it's sent last.
+            qint64 memory_next = appendMemoryEvents(until, messages);
+            if (memory_next != -1)
+                return memory_next;
+            qint64 tier_up_next = appendTierUpEvents(until, messages);
+            if (tier_up_next != -1)
+                return tier_up_next;
+            qint64 jit_next = appendJitEvents(until, messages);
+            return jit_next == -1 ? appendHeapEvents(until, messages) : jit_next;
+        }
     }
 }
 
@@ -122,4 +199,24 @@ void QV4ProfilerAdapter::receiveData(const QList<QV4::Profiling::FunctionCallPro
     service->dataReady(this);
 }
 
+void QV4ProfilerAdapter::receiveHeapData(
+        const QList<QV4::Profiling::AllocationSiteProperties> &new_allocation_site_data,
+        const QList<QV4::Profiling::HeapSnapshotProperties> &new_heap_data)
+{
+    allocation_site_data = new_allocation_site_data;
+    heap_data = new_heap_data;
+}
+
+void QV4ProfilerAdapter::receiveTierUpData(
+        const QList<QV4::Profiling::TierUpProperties> &new_tier_up_data)
+{
+    tier_up_data = new_tier_up_data;
+}
+
+void QV4ProfilerAdapter::receiveJitData(
+        const QList<QV4::Profiling::JitStatisticsProperties> &new_jit_data)
+{
+    jit_data = new_jit_data;
+}
+
 QT_END_NAMESPACE
@@ -65,12 +65,23 @@ public:
 public slots:
     void receiveData(const QList<QV4::Profiling::FunctionCallProperties> &,
                      const QList<QV4::Profiling::MemoryAllocationProperties> &);
+    void receiveHeapData(const QList<QV4::Profiling::AllocationSiteProperties> &,
+                         const QList<QV4::Profiling::HeapSnapshotProperties> &);
+    void receiveTierUpData(const QList<QV4::Profiling::TierUpProperties> &);
+    void receiveJitData(const QList<QV4::Profiling::JitStatisticsProperties> &);
 
 private:
     QList<QV4::Profiling::FunctionCallProperties> data;
     QList<QV4::Profiling::MemoryAllocationProperties> memory_data;
+    QList<QV4::Profiling::AllocationSiteProperties> allocation_site_data;
+    QList<QV4::Profiling::HeapSnapshotProperties> heap_data;
+    QList<QV4::Profiling::TierUpProperties> tier_up_data;
+    QList<QV4::Profiling::JitStatisticsProperties> jit_data;
     QStack<qint64> stack;
     qint64 appendMemoryEvents(qint64 until, QList<QByteArray> &messages);
+    qint64 appendHeapEvents(qint64 until, QList<QByteArray> &messages);
+    qint64 appendTierUpEvents(qint64 until, QList<QByteArray> &messages);
+    qint64 appendJitEvents(qint64 until, QList<QByteArray> &messages);
 };
 
 QT_END_NAMESPACE
@@ -10,7 +10,8 @@ HEADERS += \
     $$PWD/qv4isel_masm_p.h \
     $$PWD/qv4binop_p.h \
     $$PWD/qv4unop_p.h \
-    $$PWD/qv4registerinfo_p.h
+    $$PWD/qv4registerinfo_p.h \
+    $$PWD/qv4tiering_p.h
 
 SOURCES += \
     $$PWD/qv4assembler.cpp \
@@ -18,5 +19,6 @@ SOURCES += \
     $$PWD/qv4isel_masm.cpp \
     $$PWD/qv4binop.cpp \
     $$PWD/qv4unop.cpp \
+    $$PWD/qv4tiering.cpp \
 
 include(../../3rdparty/masm/masm.pri)
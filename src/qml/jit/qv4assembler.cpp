@@ -71,6 +71,15 @@ void CompilationUnit::linkBackendToEngine(ExecutionEngine *engine)
                                                            (ReturnedValue (*)(QV4::ExecutionEngine *, const uchar *)) codeRefs[i].code().executableAddress());
         runtimeFunctions[i] = runtimeFunction;
     }
+
+    Profiling::Profiler *profiler = engine->profiler;
+    if (profiler && (profiler->featuresEnabled & (1 << Profiling::FeatureJitStatistics))) {
+        for (int i = 0; i < runtimeFunctions.size(); ++i) {
+            // Units compiled for a tier-up only contain some of the functions.
+            if (i < statistics.size() && statistics.at(i).codeSize)
+                profiler->trackJitStatistics(runtimeFunctions.at(i), statistics.at(i));
+        }
+    }
 }
 
 QV4::ExecutableAllocator::ChunkOfPages *CompilationUnit::chunkForFunction(int functionIndex)
@@ -350,6 +359,12 @@ Assembler::Jump Assembler::genTryDoubleConversion(IR::Expr *src, Assembler::FPRe
 
 Assembler::Jump Assembler::branchDouble(bool invertCondition, IR::AluOp op,
                                                    IR::Expr *left, IR::Expr *right)
+{
+    return branchDouble(invertCondition, op, toDoubleRegister(left, FPGpr0), toDoubleRegister(right, FPGpr1));
+}
+
+Assembler::Jump Assembler::branchDouble(bool invertCondition, IR::AluOp op,
+                                        FPRegisterID left, FPRegisterID right)
 {
     Assembler::DoubleCondition cond;
     switch (op) {
@@ -367,7 +382,7 @@ Assembler::Jump Assembler::branchDouble(bool invertCondition, IR::AluOp op,
     if (invertCondition)
         cond = JSC::MacroAssembler::invert(cond);
 
-    return JSC::MacroAssembler::branchDouble(cond, toDoubleRegister(left, FPGpr0), toDoubleRegister(right, FPGpr1));
+    return JSC::MacroAssembler::branchDouble(cond, left, right);
 }
 
 Assembler::Jump Assembler::branchInt32(bool invertCondition, IR::AluOp op, IR::Expr *left, IR::Expr *right)
@@ -39,6 +39,7 @@
 #include "private/qv4isel_util_p.h"
 #include "private/qv4value_p.h"
 #include "private/qv4lookup_p.h"
+#include "private/qv4profiling_p.h"
 #include "qv4targetplatform_p.h"
 
 #include <QtCore/QHash>
@@ -75,6 +76,7 @@ struct CompilationUnit : public QV4::CompiledData::CompilationUnit
 
     QVector<JSC::MacroAssemblerCodeRef> codeRefs;
     QList<QVector<QV4::Primitive> > constantValues;
+    QVector<QV4::Profiling::JitStatistics> statistics;
 };
 
 struct RelativeCall {
@@ -371,6 +373,7 @@ public:
                                 IR::BasicBlock *falseBlock);
     Jump genTryDoubleConversion(IR::Expr *src, Assembler::FPRegisterID dest);
     Assembler::Jump branchDouble(bool invertCondition, IR::AluOp op, IR::Expr *left, IR::Expr *right);
+    Assembler::Jump branchDouble(bool invertCondition, IR::AluOp op, FPRegisterID left, FPRegisterID right);
     Assembler::Jump branchInt32(bool invertCondition, IR::AluOp op, IR::Expr *left, IR::Expr *right);
 
     Pointer loadAddress(RegisterID tmp, IR::Expr *t);
@@ -1051,6 +1054,16 @@ public:
         }
     }
 
+    static FPRegisterID getFreeFPReg(IR::Expr *shouldNotOverlap, unsigned hint)
+    {
+        if (IR::Temp *t = shouldNotOverlap->asTemp())
+            if (t->type == IR::DoubleType)
+                if (t->kind == IR::Temp::PhysicalRegister)
+                    if (t->index == hint)
+                        return FPRegisterID(hint + 1);
+        return FPRegisterID(hint);
+    }
+
     FPRegisterID toDoubleRegister(IR::Expr *e, FPRegisterID target = FPGpr0)
     {
         if (IR::Const *c = e->asConst()) {
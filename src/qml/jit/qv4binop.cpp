@@ -454,16 +454,6 @@ bool Binop::int32Binop(IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *ta
     return true;
 }
 
-static inline Assembler::FPRegisterID getFreeFPReg(IR::Expr *shouldNotOverlap, unsigned hint)
-{
-    if (IR::Temp *t = shouldNotOverlap->asTemp())
-        if (t->type == IR::DoubleType)
-            if (t->kind == IR::Temp::PhysicalRegister)
-                if (t->index == hint)
-                    return Assembler::FPRegisterID(hint + 1);
-    return Assembler::FPRegisterID(hint);
-}
-
 Assembler::Jump Binop::genInlineBinop(IR::Expr *leftSource, IR::Expr *rightSource, IR::Expr *target)
 {
     Assembler::Jump done;
@@ -478,8 +468,8 @@ Assembler::Jump Binop::genInlineBinop(IR::Expr *leftSource, IR::Expr *rightSourc
     //       register.
     switch (op) {
     case IR::OpAdd: {
-        Assembler::FPRegisterID lReg = getFreeFPReg(rightSource, 2);
-        Assembler::FPRegisterID rReg = getFreeFPReg(leftSource, 4);
+        Assembler::FPRegisterID lReg = Assembler::getFreeFPReg(rightSource, 2);
+        Assembler::FPRegisterID rReg = Assembler::getFreeFPReg(leftSource, 4);
         Assembler::Jump leftIsNoDbl = as->genTryDoubleConversion(leftSource, lReg);
         Assembler::Jump rightIsNoDbl = as->genTryDoubleConversion(rightSource, rReg);
 
@@ -493,8 +483,8 @@ Assembler::Jump Binop::genInlineBinop(IR::Expr *leftSource, IR::Expr *rightSourc
             rightIsNoDbl.link(as);
     } break;
     case IR::OpMul: {
-        Assembler::FPRegisterID lReg = getFreeFPReg(rightSource, 2);
-        Assembler::FPRegisterID rReg = getFreeFPReg(leftSource, 4);
+        Assembler::FPRegisterID lReg = Assembler::getFreeFPReg(rightSource, 2);
+        Assembler::FPRegisterID rReg = Assembler::getFreeFPReg(leftSource, 4);
         Assembler::Jump leftIsNoDbl = as->genTryDoubleConversion(leftSource, lReg);
         Assembler::Jump rightIsNoDbl = as->genTryDoubleConversion(rightSource, rReg);
 
@@ -508,8 +498,8 @@ Assembler::Jump Binop::genInlineBinop(IR::Expr *leftSource, IR::Expr *rightSourc
             rightIsNoDbl.link(as);
     } break;
     case IR::OpSub: {
-        Assembler::FPRegisterID lReg = getFreeFPReg(rightSource, 2);
-        Assembler::FPRegisterID rReg = getFreeFPReg(leftSource, 4);
+        Assembler::FPRegisterID lReg = Assembler::getFreeFPReg(rightSource, 2);
+        Assembler::FPRegisterID rReg = Assembler::getFreeFPReg(leftSource, 4);
         Assembler::Jump leftIsNoDbl = as->genTryDoubleConversion(leftSource, lReg);
         Assembler::Jump rightIsNoDbl = as->genTryDoubleConversion(rightSource, rReg);
 
@@ -523,8 +513,8 @@ Assembler::Jump Binop::genInlineBinop(IR::Expr *leftSource, IR::Expr *rightSourc
             rightIsNoDbl.link(as);
     } break;
     case IR::OpDiv: {
-        Assembler::FPRegisterID lReg = getFreeFPReg(rightSource, 2);
-        Assembler::FPRegisterID rReg = getFreeFPReg(leftSource, 4);
+        Assembler::FPRegisterID lReg = Assembler::getFreeFPReg(rightSource, 2);
+        Assembler::FPRegisterID rReg = Assembler::getFreeFPReg(leftSource, 4);
         Assembler::Jump leftIsNoDbl = as->genTryDoubleConversion(leftSource, lReg);
         Assembler::Jump rightIsNoDbl = as->genTryDoubleConversion(rightSource, rReg);
 
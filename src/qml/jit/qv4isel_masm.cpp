@@ -43,8 +43,10 @@
 #include "qv4assembler_p.h"
 #include "qv4unop_p.h"
 #include "qv4binop_p.h"
+#include <private/qv4isel_moth_p.h>
 
 #include <QtCore/QBuffer>
+#include <QtCore/QElapsedTimer>
 
 #include <assembler/LinkBuffer.h>
 #include <WTFStubs.h>
@@ -199,6 +201,7 @@ InstructionSelection::InstructionSelection(QQmlEnginePrivate *qmlEngine, QV4::Ex
     , qmlEngine(qmlEngine)
 {
     compilationUnit->codeRefs.resize(module->functions.size());
+    compilationUnit->statistics.resize(module->functions.size());
 }
 
 InstructionSelection::~InstructionSelection()
@@ -212,14 +215,25 @@ void InstructionSelection::run(int functionIndex)
     QVector<Lookup> lookups;
     qSwap(_function, function);
 
+    Profiling::JitStatistics &statistics = compilationUnit->statistics[functionIndex];
+    statistics.basicBlocks = _function->basicBlockCount();
+    foreach (IR::BasicBlock *bb, _function->basicBlocks())
+        statistics.irStatements += bb->statementCount();
+
+    QElapsedTimer timer;
+    timer.start();
     IR::Optimizer opt(_function);
     opt.run(qmlEngine);
+    statistics.optimizeTime = timer.nsecsElapsed();
 
     static const bool withRegisterAllocator = qgetenv("QV4_NO_REGALLOC").isEmpty();
     if (Assembler::RegAllocIsSupported && opt.isInSSA() && withRegisterAllocator) {
+        timer.restart();
         RegisterAllocator regalloc(Assembler::getRegisterInfo());
         regalloc.run(_function, opt);
         calculateRegistersToSave(regalloc.usedRegisters());
+        statistics.regallocTime = timer.nsecsElapsed();
+        statistics.spills = regalloc.spillCount();
     } else {
         if (opt.isInSSA())
             // No register allocator available for this platform, or env. var was set, so:
@@ -294,9 +308,11 @@ void InstructionSelection::run(int functionIndex)
     if (!_as->exceptionReturnLabel.isSet())
         visitRet(0);
 
-    int dummySize;
-    JSC::MacroAssemblerCodeRef codeRef =_as->link(&dummySize);
+    int codeSize;
+    JSC::MacroAssemblerCodeRef codeRef =_as->link(&codeSize);
     compilationUnit->codeRefs[functionIndex] = codeRef;
+    statistics.codeSize = codeSize;
+    statistics.executableSize = codeRef.size();
 
     qSwap(_function, function);
     delete _as;
@@ -304,6 +320,14 @@ void InstructionSelection::run(int functionIndex)
     qSwap(_removableJumps, removableJumps);
 }
 
+EvalInstructionSelection *ISelFactory::create(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator)
+{
+    // Units compiled after the executable memory limit was reached are interpreted.
+    if (execAllocator->isLimitReached())
+        return new Moth::InstructionSelection(qmlEngine, execAllocator, module, jsGenerator);
+    return new InstructionSelection(qmlEngine, execAllocator, module, jsGenerator);
+}
+
 const void *InstructionSelection::addConstantTable(QVector<Primitive> *values)
 {
     compilationUnit->constantValues.append(*values);
@@ -546,6 +570,55 @@ void InstructionSelection::callBuiltinConvertThisToObject()
     generateFunctionCall(Assembler::Void, Runtime::convertThisToObject, Assembler::EngineRegister);
 }
 
+void InstructionSelection::callBuiltinIsClosure(IR::Expr *value, int functionId, int scopeDepth, IR::Expr *result)
+{
+    generateFunctionCall(result, Runtime::isClosure, Assembler::EngineRegister,
+                         Assembler::PointerToValue(value), Assembler::TrustedImm32(functionId),
+                         Assembler::TrustedImm32(scopeDepth));
+}
+
+void InstructionSelection::callBuiltinHasType(IR::Expr *value, IR::Type type, IR::Expr *result)
+{
+    Q_ASSERT(type == IR::SInt32Type || type == IR::DoubleType);
+
+    if (value->type != IR::VarType) {
+        const bool hasType = value->type == type
+                || (type == IR::DoubleType && (value->type & IR::NumberType));
+        _as->storeBool(hasType, result);
+        return;
+    }
+
+    // load the tag:
+    Assembler::Pointer tagAddr = _as->loadAddress(Assembler::ScratchRegister, value);
+    tagAddr.offset += 4;
+    _as->load32(tagAddr, Assembler::ScratchRegister);
+
+    // Integers are accepted as doubles too, the conversion after the check widens them.
+    Assembler::Jump isInt = _as->branch32(Assembler::Equal, Assembler::ScratchRegister,
+                                          Assembler::TrustedImm32(Value::_Integer_Type));
+    Assembler::Jump isDbl;
+    if (type == IR::DoubleType) {
+#if QT_POINTER_SIZE == 8
+        _as->and32(Assembler::TrustedImm32(Value::IsDouble_Mask), Assembler::ScratchRegister);
+        isDbl = _as->branch32(Assembler::NotEqual, Assembler::ScratchRegister,
+                              Assembler::TrustedImm32(0));
+#else
+        _as->and32(Assembler::TrustedImm32(Value::NotDouble_Mask), Assembler::ScratchRegister);
+        isDbl = _as->branch32(Assembler::NotEqual, Assembler::ScratchRegister,
+                              Assembler::TrustedImm32(Value::NotDouble_Mask));
+#endif
+    }
+
+    _as->storeBool(false, result);
+    Assembler::Jump done = _as->jump();
+
+    isInt.link(_as);
+    if (isDbl.isSet())
+        isDbl.link(_as);
+    _as->storeBool(true, result);
+    done.link(_as);
+}
+
 void InstructionSelection::callValue(IR::Expr *value, IR::ExprList *args, IR::Expr *result)
 {
     Q_ASSERT(value);
@@ -630,6 +703,8 @@ void InstructionSelection::loadString(const QString &str, IR::Expr *target)
 {
     Pointer srcAddr = _as->loadStringAddress(Assembler::ReturnValueRegister, str);
     _as->loadPtr(srcAddr, Assembler::ReturnValueRegister);
+    // Runtime strings are created on first use, the runtime takes care of that.
+    Assembler::Jump notCreated = _as->branchTestPtr(Assembler::Zero, Assembler::ReturnValueRegister);
     Pointer destAddr = _as->loadAddress(Assembler::ScratchRegister, target);
 #if QT_POINTER_SIZE == 8
     _as->store64(Assembler::ReturnValueRegister, destAddr);
@@ -638,6 +713,12 @@ void InstructionSelection::loadString(const QString &str, IR::Expr *target)
     destAddr.offset += 4;
     _as->store32(Assembler::TrustedImm32(QV4::Value::Managed_Type), destAddr);
 #endif
+    Assembler::Jump done = _as->jump();
+
+    notCreated.link(_as);
+    generateFunctionCall(target, Runtime::stringLiteral, Assembler::EngineRegister, Assembler::TrustedImm32(registerString(str)));
+
+    done.link(_as);
 }
 
 void InstructionSelection::loadRegexp(IR::RegExp *sourceRegexp, IR::Expr *target)
@@ -672,8 +753,30 @@ void InstructionSelection::initClosure(IR::Closure *closure, IR::Expr *target)
 void InstructionSelection::getProperty(IR::Expr *base, const QString &name, IR::Expr *target)
 {
     if (useFastLookups) {
+#ifdef VALUE_FITS_IN_REGISTER
+        // Read the length of arrays inline, loop conditions like "i < a.length" do this on
+        // every iteration.
+        Assembler::Jump done;
+        IR::Temp *baseTemp = base->asTemp();
+        if (name == QLatin1String("length") && baseTemp && baseTemp->kind == IR::Temp::StackSlot) {
+            Assembler::JumpList slowPath;
+            loadArrayObject(baseTemp, slowPath);
+            _as->loadPtr(Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::Object, memberData)),
+                         Assembler::ReturnValueRegister);
+            _as->load64(Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::MemberData, data)
+                                + QV4::Heap::ArrayObject::LengthPropertyIndex * sizeof(QV4::Value)),
+                        Assembler::ReturnValueRegister);
+            _as->storeReturnValue(target);
+            done = _as->jump();
+            slowPath.link(_as);
+        }
+#endif
         uint index = registerGetterLookup(name);
         generateLookupCall(target, index, qOffsetOf(QV4::Lookup, getter), Assembler::EngineRegister, Assembler::PointerToValue(base), Assembler::Void);
+#ifdef VALUE_FITS_IN_REGISTER
+        if (done.isSet())
+            done.link(_as);
+#endif
     } else {
         generateFunctionCall(target, Runtime::getProperty, Assembler::EngineRegister,
                              Assembler::PointerToValue(base), Assembler::StringToIndex(name));
@@ -717,10 +820,23 @@ void InstructionSelection::setQObjectProperty(IR::Expr *source, IR::Expr *target
 void InstructionSelection::getElement(IR::Expr *base, IR::Expr *index, IR::Expr *target)
 {
     if (useFastLookups) {
+#ifdef VALUE_FITS_IN_REGISTER
+        Assembler::Jump done;
+        Assembler::JumpList slowPath;
+        if (loadSimpleArrayElement(base, index, slowPath)) {
+            _as->storeReturnValue(target);
+            done = _as->jump();
+            slowPath.link(_as);
+        }
+#endif
         uint lookup = registerIndexedGetterLookup();
         generateLookupCall(target, lookup, qOffsetOf(QV4::Lookup, indexedGetter),
                            Assembler::PointerToValue(base),
                            Assembler::PointerToValue(index));
+#ifdef VALUE_FITS_IN_REGISTER
+        if (done.isSet())
+            done.link(_as);
+#endif
         return;
     }
 
@@ -742,6 +858,103 @@ void InstructionSelection::setElement(IR::Expr *source, IR::Expr *targetBase, IR
                          Assembler::PointerToValue(source));
 }
 
+#ifdef VALUE_FITS_IN_REGISTER
+// Loads the heap object of the array stored in value into the ReturnValueRegister. Jumps to
+// slowPath when value is not a JS array. Clobbers the ScratchRegister.
+void InstructionSelection::loadArrayObject(IR::Temp *value, Assembler::JumpList &slowPath)
+{
+    Assembler::Pointer addr = _as->loadTempAddress(value);
+    Assembler::Pointer tag = addr;
+    tag.offset += qOffsetOf(QV4::Value, tag);
+    // see Value::isManaged(): the upper 17 bits are clear
+    slowPath.append(_as->branch32(Assembler::AboveOrEqual, tag,
+                                  Assembler::TrustedImm32(1 << (QV4::Value::IsManaged_Shift - 32))));
+    _as->load64(addr, Assembler::ReturnValueRegister);
+    slowPath.append(_as->branchTestPtr(Assembler::Zero, Assembler::ReturnValueRegister));
+
+    _as->loadPtr(Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::Base, internalClass)),
+                 Assembler::ScratchRegister);
+    _as->loadPtr(Address(Assembler::ScratchRegister, qOffsetOf(QV4::InternalClass, vtable)),
+                 Assembler::ScratchRegister);
+    slowPath.append(_as->branchPtr(Assembler::NotEqual, Assembler::ScratchRegister,
+                                   Assembler::TrustedImmPtr(QV4::ArrayObject::staticVTable())));
+}
+
+// Loads base[index] into the ReturnValueRegister when base is an array backed by a
+// SimpleArrayData, which is what Lookup::indexedGetterObjectInt does. Holes, indexes that are out
+// of range or not an integer, and all other objects jump to slowPath. Returns false without
+// generating any code when the operands cannot take this path.
+bool InstructionSelection::loadSimpleArrayElement(IR::Expr *base, IR::Expr *index, Assembler::JumpList &slowPath)
+{
+    IR::Temp *baseTemp = base->asTemp();
+    if (!baseTemp || baseTemp->kind != IR::Temp::StackSlot)
+        return false;
+    if (index->asConst()) {
+        if (index->type != IR::SInt32Type)
+            return false;
+    } else if (!index->asTemp() && !index->asArgLocal()) {
+        return false;
+    }
+    if (index->type != IR::SInt32Type && index->type != IR::DoubleType && index->type != IR::VarType)
+        return false;
+
+    loadArrayObject(baseTemp, slowPath);
+
+    // Get the index in the ScratchRegister. This can clobber the ReturnValueRegister, so the
+    // array is reloaded afterwards.
+    switch (index->type) {
+    case IR::SInt32Type:
+        _as->move(_as->toInt32Register(index, Assembler::ScratchRegister), Assembler::ScratchRegister);
+        break;
+    case IR::DoubleType:
+        _as->branchConvertDoubleToInt32(_as->toDoubleRegister(index, Assembler::FPGpr1),
+                                        Assembler::ScratchRegister, slowPath, Assembler::FPGpr0);
+        break;
+    default: {
+        Assembler::Pointer addr = _as->loadAddress(Assembler::ScratchRegister, index);
+        Assembler::Pointer tag = addr;
+        tag.offset += qOffsetOf(QV4::Value, tag);
+        slowPath.append(_as->branch32(Assembler::NotEqual, tag,
+                                      Assembler::TrustedImm32(QV4::Value::_Integer_Type)));
+        addr.offset += qOffsetOf(QV4::Value, int_32);
+        _as->load32(addr, Assembler::ScratchRegister);
+    } break;
+    }
+
+    _as->load64(_as->loadTempAddress(baseTemp), Assembler::ReturnValueRegister);
+    _as->loadPtr(Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::Object, arrayData)),
+                 Assembler::ReturnValueRegister);
+    slowPath.append(_as->branchTestPtr(Assembler::Zero, Assembler::ReturnValueRegister));
+    slowPath.append(_as->branch32(Assembler::NotEqual,
+                                  Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::ArrayData, type)),
+                                  Assembler::TrustedImm32(QV4::Heap::ArrayData::Simple)));
+
+    // This is an unsigned comparison, so negative indexes take the slow path too.
+    slowPath.append(_as->branch32(Assembler::AboveOrEqual, Assembler::ScratchRegister,
+                                  Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::ArrayData, len))));
+
+    // SimpleArrayData::mappedIndex(): (index + offset) % alloc, where both index and offset are
+    // smaller than alloc.
+    Address alloc(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::ArrayData, alloc));
+    _as->add32(Address(Assembler::ReturnValueRegister, qOffsetOf(QV4::Heap::ArrayData, offset)),
+               Assembler::ScratchRegister);
+    Assembler::Jump inRange = _as->branch32(Assembler::Below, Assembler::ScratchRegister, alloc);
+    _as->sub32(alloc, Assembler::ScratchRegister);
+    inRange.link(_as);
+
+    _as->load64(Assembler::BaseIndex(Assembler::ReturnValueRegister, Assembler::ScratchRegister,
+                                     Assembler::TimesEight, qOffsetOf(QV4::Heap::ArrayData, arrayData)),
+                Assembler::ReturnValueRegister);
+
+    // Holes have to be looked up in the prototype chain.
+    _as->move(Assembler::ReturnValueRegister, Assembler::ScratchRegister);
+    _as->urshift64(Assembler::TrustedImm32(QV4::Value::Tag_Shift), Assembler::ScratchRegister);
+    slowPath.append(_as->branch32(Assembler::Equal, Assembler::ScratchRegister,
+                                  Assembler::TrustedImm32(QV4::Value::Empty_Type)));
+    return true;
+}
+#endif // VALUE_FITS_IN_REGISTER
+
 void InstructionSelection::copyValue(IR::Expr *source, IR::Expr *target)
 {
     IR::Temp *sourceTemp = source->asTemp();
@@ -1339,6 +1552,26 @@ void InstructionSelection::visitCJump(IR::CJump *s)
             return;
         }
 
+        // When comparing against a value of unknown type, like a property, compare inline when
+        // both sides turn out to be numbers, and only call into the runtime otherwise.
+        Assembler::Jump leftIsNoDbl, rightIsNoDbl;
+        if (b->op >= IR::OpGt && b->op <= IR::OpLe
+                && (b->left->type == IR::VarType || b->right->type == IR::VarType)
+                && (b->left->type & (IR::NumberType | IR::VarType))
+                && (b->right->type & (IR::NumberType | IR::VarType))) {
+            Assembler::FPRegisterID lReg = Assembler::getFreeFPReg(b->right, 2);
+            Assembler::FPRegisterID rReg = Assembler::getFreeFPReg(b->left, 4);
+            leftIsNoDbl = _as->genTryDoubleConversion(b->left, lReg);
+            rightIsNoDbl = _as->genTryDoubleConversion(b->right, rReg);
+            _as->addPatch(s->iftrue, _as->branchDouble(false, b->op, lReg, rReg));
+            _as->addPatch(s->iffalse, _as->jump());
+
+            if (leftIsNoDbl.isSet())
+                leftIsNoDbl.link(_as);
+            if (rightIsNoDbl.isSet())
+                rightIsNoDbl.link(_as);
+        }
+
         Runtime::CompareOperation op = 0;
         Runtime::CompareOperationContext opContext = 0;
         const char *opName = 0;
@@ -90,6 +90,8 @@ protected:
     virtual void callBuiltinDefineObjectLiteral(IR::Expr *result, int keyValuePairCount, IR::ExprList *keyValuePairs, IR::ExprList *arrayEntries, bool needSparseArray);
     virtual void callBuiltinSetupArgumentObject(IR::Expr *result);
     virtual void callBuiltinConvertThisToObject();
+    virtual void callBuiltinIsClosure(IR::Expr *value, int functionId, int scopeDepth, IR::Expr *result);
+    virtual void callBuiltinHasType(IR::Expr *value, IR::Type type, IR::Expr *result);
     virtual void callValue(IR::Expr *value, IR::ExprList *args, IR::Expr *result);
     virtual void callProperty(IR::Expr *base, const QString &name, IR::ExprList *args, IR::Expr *result);
     virtual void callSubscript(IR::Expr *base, IR::Expr *index, IR::ExprList *args, IR::Expr *result);
@@ -161,6 +163,11 @@ protected:
     void visitCJumpEqual(IR::Binop *binop, IR::BasicBlock *trueBlock, IR::BasicBlock *falseBlock);
 
 private:
+#ifdef VALUE_FITS_IN_REGISTER
+    void loadArrayObject(IR::Temp *value, Assembler::JumpList &slowPath);
+    bool loadSimpleArrayElement(IR::Expr *base, IR::Expr *index, Assembler::JumpList &slowPath);
+#endif
+
     void convertTypeSlowPath(IR::Expr *source, IR::Expr *target);
     void convertTypeToDouble(IR::Expr *source, IR::Expr *target);
     void convertTypeToBool(IR::Expr *source, IR::Expr *target);
@@ -267,8 +274,7 @@ class Q_QML_EXPORT ISelFactory: public EvalISelFactory
 {
 public:
     virtual ~ISelFactory() {}
-    virtual EvalInstructionSelection *create(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator)
-    { return new InstructionSelection(qmlEngine, execAllocator, module, jsGenerator); }
+    virtual EvalInstructionSelection *create(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator);
     virtual bool jitCompileRegexps() const
     { return true; }
 };
@@ -298,6 +298,8 @@ protected: // IRDecoder
     virtual void callBuiltinDefineObjectLiteral(IR::Expr *, int, IR::ExprList *, IR::ExprList *, bool) {}
     virtual void callBuiltinSetupArgumentObject(IR::Expr *) {}
     virtual void callBuiltinConvertThisToObject() {}
+    virtual void callBuiltinIsClosure(IR::Expr *, int, int, IR::Expr *) {}
+    virtual void callBuiltinHasType(IR::Expr *, IR::Type, IR::Expr *) {}
 
     virtual void callValue(IR::Expr *value, IR::ExprList *args, IR::Expr *result)
     {
@@ -476,6 +478,7 @@ protected: // IRDecoder
         Q_UNUSED(str);
 
         addDef(targetTemp);
+        addCall(); // strings that were not created yet are created by calling into the runtime
     }
 
     virtual void loadRegexp(IR::RegExp *sourceRegexp, Expr *targetTemp)
@@ -709,7 +712,9 @@ protected:
         addDef(result);
         addUses(c->base, Use::CouldHaveRegister);
         addUses(c->args, Use::CouldHaveRegister);
-        addCall();
+        // Type checks are done inline.
+        if (c->base->asName()->builtin != Name::builtin_has_type)
+            addCall();
     }
 
 private:
@@ -1867,6 +1872,13 @@ void RegisterAllocator::splitInactiveAtEndOfLifetimeHole(int reg, bool isFPReg,
     }
 }
 
+// The number of temps that live in a stack slot for at least part of their life time.
+int RegisterAllocator::spillCount() const
+{
+    return int(_assignedSpillSlots.size())
+            - int(std::count(_assignedSpillSlots.begin(), _assignedSpillSlots.end(), int(InvalidSpillSlot)));
+}
+
 void RegisterAllocator::assignSpillSlot(const Temp &t, int startPos, int endPos)
 {
     if (_assignedSpillSlots[t.index] != InvalidSpillSlot)
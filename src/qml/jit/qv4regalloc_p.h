@@ -97,6 +97,7 @@ public:
 
     void run(IR::Function *function, const IR::Optimizer &opt);
     RegisterInformation usedRegisters() const;
+    int spillCount() const;
 
 private:
     void markInUse(int reg, bool isFPReg);
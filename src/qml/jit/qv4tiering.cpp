@@ -0,0 +1,346 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qv4tiering_p.h"
+#include "qv4isel_masm_p.h"
+#include "qv4vme_moth_p.h"
+#include "qv4function_p.h"
+#include "qv4context_p.h"
+#include "qv4profiling_p.h"
+
+#include <private/qv4compiler_p.h>
+#include <private/qqmlengine_p.h>
+
+#ifdef V4_ENABLE_JIT
+
+QT_BEGIN_NAMESPACE
+
+using namespace QV4;
+using namespace QV4::JIT;
+
+namespace {
+
+quint32 threshold(const char *name, quint32 defaultValue)
+{
+    bool ok;
+    quint32 value = qgetenv(name).toUInt(&ok);
+    return ok ? value : defaultValue;
+}
+
+quint32 callThreshold()
+{
+    static const quint32 value = threshold("QV4_JIT_CALL_THRESHOLD", 50);
+    return value;
+}
+
+quint32 backEdgeThreshold()
+{
+    static const quint32 value = threshold("QV4_JIT_LOOP_THRESHOLD", 1000);
+    return value;
+}
+
+// Gives the property and element reads into temps and variables a slot in their function's type
+// feedback.
+void assignTypeFeedbackSlots(IR::Module *module)
+{
+    foreach (IR::Function *function, module->functions) {
+        int slots = 0;
+        foreach (IR::BasicBlock *bb, function->basicBlocks()) {
+            foreach (IR::Stmt *s, bb->statements()) {
+                IR::Move *move = s->asMove();
+                if (!move || (!move->target->asTemp() && !move->target->asArgLocal()))
+                    continue;
+                IR::Member *member = move->source->asMember();
+                if ((member && member->kind == IR::Member::UnspecifiedMember && !member->property)
+                        || move->source->asSubscript()) {
+                    move->typeFeedbackSlot = slots++;
+                }
+            }
+        }
+        function->typeFeedbackSlots = slots;
+    }
+}
+
+int observedIRTypes(quint8 observed)
+{
+    int types = IR::UnknownType;
+    if (observed & Moth::ObservedInteger)
+        types |= IR::SInt32Type;
+    if (observed & Moth::ObservedDouble)
+        types |= IR::DoubleType;
+    if (observed & Moth::ObservedBoolean)
+        types |= IR::BoolType;
+    if (observed & Moth::ObservedString)
+        types |= IR::StringType;
+    if (observed & Moth::ObservedOther)
+        types |= IR::VarType;
+    return types;
+}
+
+} // anonymous namespace
+
+TieredCompilationUnit::TieredCompilationUnit(IR::Module *irModule)
+    : useFastLookups(true)
+    , irModule(irModule)
+{
+}
+
+TieredCompilationUnit::~TieredCompilationUnit()
+{
+}
+
+void TieredCompilationUnit::linkBackendToEngine(ExecutionEngine *engine)
+{
+    Moth::CompilationUnit::linkBackendToEngine(engine);
+
+    tieredFunctions.resize(runtimeFunctions.size());
+    for (int i = 0; i < runtimeFunctions.size(); ++i) {
+        QV4::Function *runtimeFunction = runtimeFunctions.at(i);
+        TieredFunction &function = tieredFunctions[i];
+        function.unit = this;
+        function.index = i;
+        function.bytecode = runtimeFunction->codeData;
+        function.callCount = 0;
+        function.backEdgeCount = 0;
+        function.triedTierUp = false;
+        function.typeFeedback.fill(0, irModule->functions.at(i)->typeFeedbackSlots);
+        function.jitUnit = 0;
+        function.jitCode = 0;
+
+        runtimeFunction->code = &TieredCompilationUnit::exec;
+        runtimeFunction->codeData = reinterpret_cast<const uchar *>(&function);
+    }
+}
+
+ReturnedValue TieredCompilationUnit::exec(ExecutionEngine *engine, const uchar *data)
+{
+    TieredFunction *function = reinterpret_cast<TieredFunction *>(const_cast<uchar *>(data));
+    if (!function->triedTierUp) {
+        if (++function->callCount >= callThreshold()
+                || function->backEdgeCount >= backEdgeThreshold()) {
+            function->unit->tierUp(function);
+        }
+    } else if (function->job && function->job->isFinished()) {
+        function->unit->install(function);
+    }
+
+    if (!function->jitCode) {
+        if (function->triedTierUp)
+            return Moth::VME::exec(engine, function->bytecode, 0, 0);
+        return Moth::VME::exec(engine, function->bytecode, &function->backEdgeCount,
+                               function->typeFeedback.data());
+    }
+
+    // The context was set up for the interpreted function. The compiled code has to find the
+    // strings, lookups and closures of the unit it was compiled into instead.
+    Heap::ExecutionContext *context = engine->currentContext();
+    CompiledData::CompilationUnit *compilationUnit = context->compilationUnit;
+    Lookup *lookups = context->lookups;
+    context->compilationUnit = function->jitUnit;
+    context->lookups = function->jitUnit->runtimeLookups;
+    ReturnedValue result = function->jitCode(engine, 0);
+    context->compilationUnit = compilationUnit;
+    context->lookups = lookups;
+    return result;
+}
+
+void TieredCompilationUnit::tierUp(TieredFunction *function)
+{
+    function->triedTierUp = true;
+    if (engine->debugger || engine->executableAllocator->isLimitReached())
+        return;
+
+    CompileQueue *queue = static_cast<TieredISelFactory *>(engine->iselFactory.data())
+            ->compileQueue(engine->executableAllocator);
+    if (!queue)
+        return;
+
+    QSharedPointer<CompileJob> job(new CompileJob);
+    // The IR is changed by the optimizer, so every compilation works on its own copy.
+    job->module.reset(irModule->clone());
+    job->useFastLookups = useFastLookups;
+    job->queuedAt = engine->profiler ? engine->profiler->timestamp() : 0;
+
+    // Closures created by the compiled code are looked up in the new unit, so the nested
+    // functions are compiled as well.
+    QVector<IR::Function *> pending;
+    pending.append(job->module->functions.at(function->index));
+    while (!pending.isEmpty()) {
+        IR::Function *irFunction = pending.takeLast();
+        const int index = job->module->functions.indexOf(irFunction);
+        job->functionIndexes.append(index);
+        pending += irFunction->nestedFunctions;
+
+        // Nested functions that did not run yet have no feedback, and are compiled without
+        // speculation.
+        const QVector<quint8> &typeFeedback = tieredFunctions.at(index).typeFeedback;
+        irFunction->observedTypes.resize(typeFeedback.size());
+        for (int slot = 0; slot < typeFeedback.size(); ++slot)
+            irFunction->observedTypes[slot] = observedIRTypes(typeFeedback.at(slot));
+    }
+
+    function->job = job;
+    queue->enqueue(job);
+}
+
+void TieredCompilationUnit::install(TieredFunction *function)
+{
+    QSharedPointer<CompileJob> job;
+    qSwap(job, function->job);
+    QQmlRefPointer<CompiledData::CompilationUnit> unit = job->result;
+    if (!unit)
+        return;
+    unit->baseUnit = this;
+    unit->linkToEngine(engine);
+
+    // Calls still set up the context with the interpreted function, so both have to agree on
+    // its layout.
+    const CompiledData::Function *interpreted = runtimeFunctions.at(function->index)->compiledFunction;
+    QV4::Function *compiled = unit->runtimeFunctions.at(function->index);
+    if (compiled->compiledFunction->nFormals != interpreted->nFormals
+            || compiled->compiledFunction->nLocals != interpreted->nLocals) {
+        return;
+    }
+
+    jitUnits.append(unit);
+    function->jitUnit = unit.data();
+    function->jitCode = compiled->code;
+
+    Profiling::Profiler *profiler = engine->profiler;
+    if (profiler && (profiler->featuresEnabled & (1 << Profiling::FeatureTierUp)))
+        profiler->trackTierUp(runtimeFunctions.at(function->index), job->queuedAt,
+                              function->callCount, function->backEdgeCount);
+}
+
+void CompileJob::run(ExecutableAllocator *executableAllocator)
+{
+    Compiler::JSUnitGenerator jsGenerator(module.data());
+    // No QML engine: its type information must not be used outside the engine's thread.
+    InstructionSelection isel(0, executableAllocator, module.data(), &jsGenerator);
+    isel.setUseFastLookups(useFastLookups);
+    result = isel.compile(functionIndexes);
+    state.storeRelease(Finished);
+}
+
+CompileQueue::CompileQueue(ExecutableAllocator *executableAllocator)
+    : executableAllocator(executableAllocator)
+    , stopped(false)
+{
+}
+
+CompileQueue::~CompileQueue()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopped = true;
+        condition.wakeOne();
+    }
+    wait();
+
+    // Finished jobs nobody installed yet hold code from the executable allocator, which is
+    // deleted together with the engine.
+    foreach (const QWeakPointer<CompileJob> &weakJob, jobs) {
+        QSharedPointer<CompileJob> job = weakJob.toStrongRef();
+        if (job)
+            job->result = 0;
+    }
+}
+
+void CompileQueue::enqueue(const QSharedPointer<CompileJob> &job)
+{
+    QMutexLocker locker(&mutex);
+    for (QList<QWeakPointer<CompileJob> >::iterator it = jobs.begin(); it != jobs.end(); ) {
+        if (it->isNull())
+            it = jobs.erase(it);
+        else
+            ++it;
+    }
+    jobs.append(job);
+    queue.append(job);
+    condition.wakeOne();
+
+    if (!isRunning())
+        start(QThread::LowPriority);
+}
+
+void CompileQueue::run()
+{
+    forever {
+        QSharedPointer<CompileJob> job;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopped && queue.isEmpty())
+                condition.wait(&mutex);
+            if (stopped)
+                return;
+            // A job whose function is gone was cancelled.
+            job = queue.takeFirst().toStrongRef();
+        }
+        if (job)
+            job->run(executableAllocator);
+    }
+}
+
+TieredISelFactory::TieredISelFactory()
+{
+}
+
+TieredISelFactory::~TieredISelFactory()
+{
+}
+
+CompileQueue *TieredISelFactory::compileQueue(ExecutableAllocator *executableAllocator)
+{
+    if (!queue)
+        queue.reset(new CompileQueue(executableAllocator));
+    return queue.data();
+}
+
+TieredInstructionSelection::TieredInstructionSelection(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator)
+    : Moth::InstructionSelection(qmlEngine, execAllocator, module, jsGenerator)
+{
+    // Both the interpreter's code and the copy refer to the same slots.
+    assignTypeFeedbackSlots(module);
+    // Taken before the interpreter's code generation changes the IR.
+    compilationUnit.reset(new TieredCompilationUnit(module->clone()));
+}
+
+QQmlRefPointer<CompiledData::CompilationUnit> TieredInstructionSelection::backendCompileStep()
+{
+    static_cast<TieredCompilationUnit *>(compilationUnit.data())->useFastLookups = useFastLookups;
+    return Moth::InstructionSelection::backendCompileStep();
+}
+
+QT_END_NAMESPACE
+
+#endif // V4_ENABLE_JIT
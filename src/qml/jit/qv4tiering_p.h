@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QV4TIERING_P_H
+#define QV4TIERING_P_H
+
+#include "private/qv4global_p.h"
+#include "private/qv4jsir_p.h"
+#include "private/qv4isel_moth_p.h"
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QSharedPointer>
+
+#ifdef V4_ENABLE_JIT
+
+QT_BEGIN_NAMESPACE
+
+namespace QV4 {
+namespace JIT {
+
+struct TieredCompilationUnit;
+
+// Compiles a copy of the IR with the JIT. Runs on the compile thread, so it only touches its own
+// module and the executable allocator, which is thread safe.
+struct CompileJob
+{
+    CompileJob() : state(Queued) {}
+
+    void run(QV4::ExecutableAllocator *executableAllocator);
+
+    bool isFinished() const { return state.loadAcquire() == Finished; }
+
+    enum State {
+        Queued,
+        Finished
+    };
+
+    QScopedPointer<IR::Module> module;
+    QVector<int> functionIndexes;
+    bool useFastLookups;
+    qint64 queuedAt;
+    QAtomicInt state;
+    // Not linked yet, that has to happen on the engine's thread.
+    QQmlRefPointer<QV4::CompiledData::CompilationUnit> result;
+};
+
+// Runs the optimizer and the JIT for tier-ups on a thread of its own, one job at a time.
+class CompileQueue : public QThread
+{
+public:
+    CompileQueue(QV4::ExecutableAllocator *executableAllocator);
+    ~CompileQueue();
+
+    void enqueue(const QSharedPointer<CompileJob> &job);
+
+protected:
+    virtual void run();
+
+private:
+    QV4::ExecutableAllocator *executableAllocator;
+    QMutex mutex;
+    QWaitCondition condition;
+    // Jobs are owned by the functions waiting for them, so that dropping the function cancels
+    // the job.
+    QList<QWeakPointer<CompileJob> > queue;
+    QList<QWeakPointer<CompileJob> > jobs;
+    bool stopped;
+};
+
+// The code data of a function in a tiered unit.
+struct TieredFunction
+{
+    TieredCompilationUnit *unit;
+    int index;
+    const uchar *bytecode;
+    quint32 callCount;
+    quint32 backEdgeCount;
+    bool triedTierUp;
+    // The Moth::ObservedType values seen by each of the function's type feedback slots.
+    QVector<quint8> typeFeedback;
+    QSharedPointer<CompileJob> job;
+    // The unit the JIT compiled this function into, and its code there.
+    QV4::CompiledData::CompilationUnit *jitUnit;
+    QV4::ReturnedValue (*jitCode)(QV4::ExecutionEngine *, const uchar *);
+};
+
+// A Moth unit that keeps a copy of its IR. Functions run in the interpreter until they are called
+// QV4_JIT_CALL_THRESHOLD times or take QV4_JIT_LOOP_THRESHOLD backward jumps, then the JIT
+// compiles them, together with the functions they create closures for, into a unit of their own.
+// The compilation runs on the CompileQueue, and the function keeps being interpreted until the
+// first call after it finished. Until then the interpreter records the types of the values its
+// property and element reads return, and the optimizer speculates on them.
+struct TieredCompilationUnit : public QV4::Moth::CompilationUnit
+{
+    TieredCompilationUnit(IR::Module *irModule);
+    virtual ~TieredCompilationUnit();
+
+    virtual void linkBackendToEngine(QV4::ExecutionEngine *engine);
+
+    static QV4::ReturnedValue exec(QV4::ExecutionEngine *engine, const uchar *data);
+
+    bool useFastLookups;
+
+private:
+    void tierUp(TieredFunction *function);
+    void install(TieredFunction *function);
+
+    QScopedPointer<IR::Module> irModule;
+    QVector<TieredFunction> tieredFunctions;
+    QVector<QQmlRefPointer<QV4::CompiledData::CompilationUnit> > jitUnits;
+};
+
+class Q_QML_EXPORT TieredInstructionSelection : public QV4::Moth::InstructionSelection
+{
+public:
+    TieredInstructionSelection(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator);
+
+protected:
+    virtual QQmlRefPointer<QV4::CompiledData::CompilationUnit> backendCompileStep();
+};
+
+class Q_QML_EXPORT TieredISelFactory : public QV4::Moth::ISelFactory
+{
+public:
+    TieredISelFactory();
+    virtual ~TieredISelFactory();
+    virtual EvalInstructionSelection *create(QQmlEnginePrivate *qmlEngine, QV4::ExecutableAllocator *execAllocator, IR::Module *module, QV4::Compiler::JSUnitGenerator *jsGenerator)
+    { return new TieredInstructionSelection(qmlEngine, execAllocator, module, jsGenerator); }
+    virtual bool jitCompileRegexps() const
+    { return true; }
+
+    CompileQueue *compileQueue(QV4::ExecutableAllocator *executableAllocator);
+
+private:
+    QScopedPointer<CompileQueue> queue;
+};
+
+} // end of namespace JIT
+} // end of namespace QV4
+
+QT_END_NAMESPACE
+
+#endif // V4_ENABLE_JIT
+
+#endif // QV4TIERING_P_H
@@ -70,6 +70,7 @@ Heap::ArgumentsObject::ArgumentsObject(QV4::CallContext *context)
     }
     Q_ASSERT(LengthPropertyIndex == args->internalClass()->find(context->d()->engine->id_length));
     args->memberData()->data[LengthPropertyIndex] = Primitive::fromInt32(context->d()->realArgumentCount);
+    writeBarrier();
 }
 
 void ArgumentsObject::fullyCreate()
@@ -84,12 +85,16 @@ void ArgumentsObject::fullyCreate()
 
     Scope scope(engine());
     Scoped<MemberData> md(scope, d()->mappedArguments);
-    if (!md || md->size() < numAccessors)
+    if (!md || md->size() < numAccessors) {
         d()->mappedArguments = md->reallocate(engine(), d()->mappedArguments, numAccessors);
+        d()->writeBarrier();
+    }
     for (uint i = 0; i < (uint)numAccessors; ++i) {
         mappedArguments()->data[i] = context()->callData->args[i];
         arraySet(i, context()->engine->argumentsAccessors + i, Attr_Accessor);
     }
+    if (d()->mappedArguments)
+        d()->mappedArguments->writeBarrier();
     arrayPut(numAccessors, context()->callData->args + numAccessors, argCount - numAccessors);
     for (uint i = numAccessors; i < argCount; ++i)
         setArrayAttributes(i, Attr_Data);
@@ -118,6 +123,7 @@ bool ArgumentsObject::defineOwnProperty(ExecutionEngine *engine, uint index, con
         setArrayAttributes(index, Attr_Data);
         pd = arrayData()->getProperty(index);
         pd->value = mappedArguments()->data[index];
+        d()->writeBarrier();
     }
 
     bool strict = engine->currentContext()->strictMode;
@@ -137,6 +143,7 @@ bool ArgumentsObject::defineOwnProperty(ExecutionEngine *engine, uint index, con
             setArrayAttributes(index, mapAttrs);
             pd = arrayData()->getProperty(index);
             pd->copy(map, mapAttrs);
+            d()->writeBarrier();
         }
     }
 
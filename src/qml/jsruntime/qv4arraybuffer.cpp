@@ -96,6 +96,12 @@ Heap::ArrayBuffer::ArrayBuffer(ExecutionEngine *e, int length)
     memset(data->data(), 0, length + 1);
 }
 
+Heap::ArrayBuffer::ArrayBuffer(ExecutionEngine *e, QTypedArrayData<char> *data)
+    : Heap::Object(e->arrayBufferClass, e->arrayBufferPrototype.asObject())
+    , data(data)
+{
+}
+
 Heap::ArrayBuffer::~ArrayBuffer()
 {
     if (!data->ref.deref())
@@ -109,6 +115,17 @@ QByteArray ArrayBuffer::asByteArray() const
     return QByteArray(ba);
 }
 
+void ArrayBuffer::neuter()
+{
+    QTypedArrayData<char> *empty = QTypedArrayData<char>::allocate(1);
+    Q_CHECK_PTR(empty);
+    empty->size = 0;
+    *empty->data() = 0;
+    if (!d()->data->ref.deref())
+        QTypedArrayData<char>::deallocate(d()->data);
+    d()->data = empty;
+}
+
 void ArrayBufferPrototype::init(ExecutionEngine *engine, Object *ctor)
 {
     Scope scope(engine);
@@ -48,6 +48,8 @@ struct ArrayBufferCtor : FunctionObject {
 
 struct ArrayBuffer : Object {
     ArrayBuffer(ExecutionEngine *e, int length);
+    // takes over a reference to data
+    ArrayBuffer(ExecutionEngine *e, QTypedArrayData<char> *data);
     ~ArrayBuffer();
     QTypedArrayData<char> *data;
 
@@ -83,6 +85,11 @@ struct ArrayBuffer : Object
         return d()->data->data();
     }
 
+    // Gives up the contents and leaves an empty buffer behind. Used when the
+    // contents are transferred to another engine; views on the buffer then
+    // have no elements.
+    void neuter();
+
 };
 
 struct ArrayBufferPrototype: Object
@@ -36,6 +36,8 @@
 #include "qv4mm_p.h"
 #include "qv4runtime_p.h"
 
+#include <algorithm>
+
 using namespace QV4;
 
 const QV4::ManagedVTable QV4::ArrayData::static_vtbl = {
@@ -86,8 +88,25 @@ const ArrayVTable SparseArrayData::static_vtbl =
     SparseArrayData::length
 };
 
+const ArrayVTable PackedArrayData::static_vtbl =
+{
+    DEFINE_MANAGED_VTABLE_INT(PackedArrayData, 0),
+    Heap::ArrayData::PackedInt32,
+    PackedArrayData::reallocate,
+    PackedArrayData::get,
+    PackedArrayData::put,
+    PackedArrayData::putArray,
+    PackedArrayData::del,
+    PackedArrayData::setAttribute,
+    PackedArrayData::push_front,
+    PackedArrayData::pop_front,
+    PackedArrayData::truncate,
+    PackedArrayData::length
+};
+
 Q_STATIC_ASSERT(sizeof(Heap::ArrayData) == sizeof(Heap::SimpleArrayData));
 Q_STATIC_ASSERT(sizeof(Heap::ArrayData) == sizeof(Heap::SparseArrayData));
+Q_STATIC_ASSERT(sizeof(Heap::ArrayData) == sizeof(Heap::PackedArrayData));
 
 void ArrayData::realloc(Object *o, Type newType, uint requested, bool enforceAttributes)
 {
@@ -98,6 +117,22 @@ void ArrayData::realloc(Object *o, Type newType, uint requested, bool enforceAtt
     uint toCopy = 0;
     uint offset = 0;
 
+    if (d && d->isPacked()) {
+        // growing keeps the store packed, everything else needs real Value slots
+        if (!enforceAttributes && (newType == Heap::ArrayData::Simple || newType >= Heap::ArrayData::PackedInt32)) {
+            PackedArrayData::grow(o, qMax(newType, d->type()), requested);
+            return;
+        }
+        unpack(o);
+        d = o->arrayData();
+    } else if (newType >= Heap::ArrayData::PackedInt32) {
+        if (!d && !enforceAttributes) {
+            PackedArrayData::grow(o, newType, requested);
+            return;
+        }
+        newType = Heap::ArrayData::Simple;
+    }
+
     if (d) {
         bool hasAttrs = d->attrs();
         enforceAttributes |= hasAttrs;
@@ -203,6 +238,44 @@ Heap::ArrayData *SimpleArrayData::reallocate(Object *o, uint n, bool enforceAttr
     return o->arrayData();
 }
 
+void ArrayData::unpack(Object *o)
+{
+    Scope scope(o->engine());
+    Scoped<ArrayData> d(scope, o->arrayData());
+    if (!d || !d->isPacked())
+        return;
+
+    uint alloc = d->alloc();
+    size_t size = sizeof(Heap::ArrayData) + (alloc - 1)*sizeof(Value);
+    Heap::SimpleArrayData *n = static_cast<Heap::SimpleArrayData *>(scope.engine->memoryManager->allocManaged(size));
+    new (n) Heap::SimpleArrayData(scope.engine);
+    n->alloc = alloc;
+    n->type = Heap::ArrayData::Simple;
+    n->attrs = 0;
+    n->offset = 0;
+
+    const Heap::PackedArrayData *p = static_cast<const Heap::PackedArrayData *>(d->d());
+    n->len = p->len;
+    for (uint i = 0; i < p->len; ++i)
+        n->arrayData[i] = p->data(i);
+
+    Scoped<ArrayData> newData(scope, n);
+    o->setArrayData(newData);
+}
+
+ArrayData::Type ArrayData::packedType(const Value *values, uint n)
+{
+    Type t = Heap::ArrayData::PackedInt32;
+    for (uint i = 0; i < n; ++i) {
+        if (values[i].isInteger())
+            continue;
+        if (!values[i].isNumber())
+            return Heap::ArrayData::Simple;
+        t = Heap::ArrayData::PackedDouble;
+    }
+    return t;
+}
+
 void ArrayData::ensureAttributes(Object *o)
 {
     if (o->arrayData() && o->arrayData()->attrs)
@@ -239,6 +312,7 @@ bool SimpleArrayData::put(Object *o, uint index, ValueRef value)
             dd->attrs[index] = Attr_Data;
         dd->len = index + 1;
     }
+    o->d()->writeBarrier();
     return true;
 }
 
@@ -277,6 +351,7 @@ void SimpleArrayData::push_front(Object *o, Value *values, uint n)
     dd->len += n;
     for (uint i = 0; i < n; ++i)
         dd->data(i) = values[i].asReturnedValue();
+    o->d()->writeBarrier();
 }
 
 ReturnedValue SimpleArrayData::pop_front(Object *o)
@@ -328,9 +403,190 @@ bool SimpleArrayData::putArray(Object *o, uint index, Value *values, uint n)
     for (uint i = 0; i < n; ++i)
         dd->data(index + i) = values[i];
     dd->len = qMax(dd->len, index + n);
+    o->d()->writeBarrier();
+    return true;
+}
+
+void PackedArrayData::grow(Object *o, Type newType, uint requested)
+{
+    Q_ASSERT(newType >= Heap::ArrayData::PackedInt32);
+    Scope scope(o->engine());
+    Scoped<ArrayData> d(scope, o->arrayData());
+    Q_ASSERT(!d || d->isPacked());
+
+    uint alloc = 8;
+    uint len = 0;
+    if (d) {
+        const Heap::PackedArrayData *old = static_cast<const Heap::PackedArrayData *>(d->d());
+        if (newType < old->type)
+            newType = old->type;
+        if (requested <= old->capacity() && newType == old->type)
+            return;
+        if (alloc < old->alloc)
+            alloc = old->alloc;
+        len = old->len;
+    }
+
+    while (alloc < requested)
+        alloc *= 2;
+    size_t size = sizeof(Heap::ArrayData) - sizeof(Value) + alloc*Heap::PackedArrayData::elementSize(newType);
+    Heap::PackedArrayData *n = static_cast<Heap::PackedArrayData *>(scope.engine->memoryManager->allocManaged(size));
+    new (n) Heap::PackedArrayData(scope.engine);
+    n->alloc = alloc;
+    n->type = newType;
+    n->attrs = 0;
+    n->len = len;
+    n->offset = 0;
+
+    if (d) {
+        const Heap::PackedArrayData *old = static_cast<const Heap::PackedArrayData *>(d->d());
+        if (old->type == newType) {
+            memcpy(n->payload(), old->payload(), len*Heap::PackedArrayData::elementSize(newType));
+        } else {
+            const int *from = old->int32Data();
+            double *to = n->doubleData();
+            for (uint i = 0; i < len; ++i)
+                to[i] = from[i];
+        }
+    }
+
+    Scoped<ArrayData> newData(scope, n);
+    o->setArrayData(newData);
+}
+
+Heap::ArrayData *PackedArrayData::reallocate(Object *o, uint n, bool enforceAttributes)
+{
+    ArrayData::realloc(o, Heap::ArrayData::Simple, n, enforceAttributes);
+    return o->arrayData();
+}
+
+void PackedArrayData::markObjects(Heap::Base *, ExecutionEngine *)
+{
+    // numbers only, nothing to mark
+}
+
+ReturnedValue PackedArrayData::get(const Heap::ArrayData *d, uint index)
+{
+    const Heap::PackedArrayData *dd = static_cast<const Heap::PackedArrayData *>(d);
+    if (index >= dd->len)
+        return Primitive::emptyValue().asReturnedValue();
+    return dd->data(index);
+}
+
+bool PackedArrayData::put(Object *o, uint index, ValueRef value)
+{
+    Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    if (!value->isNumber() || index > dd->len) {
+        unpack(o);
+        return SimpleArrayData::put(o, index, value);
+    }
+
+    Type type = value->isInteger() ? dd->type : Heap::ArrayData::PackedDouble;
+    if (index >= dd->capacity() || type != dd->type) {
+        grow(o, type, index + 1);
+        dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    }
+    dd->setData(index, *value);
+    if (index == dd->len)
+        ++dd->len;
+    return true;
+}
+
+bool PackedArrayData::putArray(Object *o, uint index, Value *values, uint n)
+{
+    Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    Type type = packedType(values, n);
+    if (type == Heap::ArrayData::Simple || index > dd->len) {
+        unpack(o);
+        return SimpleArrayData::putArray(o, index, values, n);
+    }
+
+    if (type < dd->type)
+        type = dd->type;
+    if (index + n > dd->capacity() || type != dd->type) {
+        grow(o, type, index + n);
+        dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    }
+    for (uint i = 0; i < n; ++i)
+        dd->setData(index + i, values[i]);
+    dd->len = qMax(dd->len, index + n);
     return true;
 }
 
+bool PackedArrayData::del(Object *o, uint index)
+{
+    Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    if (index >= dd->len)
+        return true;
+
+    // removing the last element leaves no hole in the store
+    if (index == dd->len - 1) {
+        --dd->len;
+        return true;
+    }
+    unpack(o);
+    return SimpleArrayData::del(o, index);
+}
+
+void PackedArrayData::setAttribute(Object *o, uint index, PropertyAttributes attrs)
+{
+    ensureAttributes(o);
+    o->arrayData()->vtable()->setAttribute(o, index, attrs);
+}
+
+void PackedArrayData::push_front(Object *o, Value *values, uint n)
+{
+    Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    Type type = packedType(values, n);
+    if (type == Heap::ArrayData::Simple) {
+        unpack(o);
+        SimpleArrayData::push_front(o, values, n);
+        return;
+    }
+
+    if (type < dd->type)
+        type = dd->type;
+    if (n <= dd->offset && type == dd->type) {
+        dd->offset -= n;
+    } else {
+        if (dd->len + n > dd->capacity() || type != dd->type) {
+            grow(o, type, dd->len + n);
+            dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+        }
+        uint size = Heap::PackedArrayData::elementSize(dd->type);
+        char *data = dd->payload();
+        memmove(data + n*size, data, dd->len*size);
+    }
+    dd->len += n;
+    for (uint i = 0; i < n; ++i)
+        dd->setData(i, values[i]);
+}
+
+ReturnedValue PackedArrayData::pop_front(Object *o)
+{
+    Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    if (!dd->len)
+        return Encode::undefined();
+
+    ReturnedValue v = dd->data(0);
+    ++dd->offset;
+    --dd->len;
+    return v;
+}
+
+uint PackedArrayData::truncate(Object *o, uint newLen)
+{
+    Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+    if (dd->len > newLen)
+        dd->len = newLen;
+    return newLen;
+}
+
+uint PackedArrayData::length(const Heap::ArrayData *d)
+{
+    return d->len;
+}
+
 void SparseArrayData::free(Heap::ArrayData *d, uint idx)
 {
     Q_ASSERT(d && d->type == Heap::ArrayData::Sparse);
@@ -427,6 +683,7 @@ bool SparseArrayData::put(Object *o, uint index, ValueRef value)
     s->arrayData[n->value] = value;
     if (s->attrs)
         s->attrs[n->value] = Attr_Data;
+    o->d()->writeBarrier();
     return true;
 }
 
@@ -493,6 +750,7 @@ void SparseArrayData::push_front(Object *o, Value *values, uint n)
         d->arrayData[idx] = values[i];
         d->sparse->push_front(idx);
     }
+    o->d()->writeBarrier();
 }
 
 ReturnedValue SparseArrayData::pop_front(Object *o)
@@ -565,6 +823,8 @@ uint ArrayData::append(Object *obj, ArrayObject *otherObj, uint n)
 
     if (other && other->isSparse())
         obj->initSparseArray();
+    else if (other && other->isPacked() && !obj->arrayData())
+        ArrayData::realloc(obj, other->type(), n, false);
     else
         obj->arrayCreate();
 
@@ -584,6 +844,12 @@ uint ArrayData::append(Object *obj, ArrayObject *otherObj, uint n)
                  it != os->sparse->end(); it = it->nextNode())
                 obj->arraySet(oldSize + it->key(), ValueRef(os->arrayData[it->value]));
         }
+    } else if (other->isPacked()) {
+        obj->arrayReserve(oldSize + n);
+        Heap::PackedArrayData *os = static_cast<Heap::PackedArrayData *>(other->d());
+        ScopedValue v(scope);
+        for (uint i = 0; i < n; ++i)
+            obj->arrayPut(oldSize + i, (v = os->data(i)));
     } else {
         Heap::SimpleArrayData *os = static_cast<Heap::SimpleArrayData *>(other->d());
         uint toCopy = n;
@@ -601,6 +867,9 @@ uint ArrayData::append(Object *obj, ArrayObject *otherObj, uint n)
 
 Property *ArrayData::insert(Object *o, uint index, bool isAccessor)
 {
+    if (o->d()->arrayData->isPacked())
+        unpack(o);
+
     if (!isAccessor && o->d()->arrayData->type != Heap::ArrayData::Sparse) {
         Heap::SimpleArrayData *d = static_cast<Heap::SimpleArrayData *>(o->d()->arrayData);
         if (index < 0x1000 || index < d->len + (d->len >> 2)) {
@@ -628,6 +897,19 @@ Property *ArrayData::insert(Object *o, uint index, bool isAccessor)
 }
 
 
+// The default sort order compares the string representations of the elements
+struct Int32StringLessThan
+{
+    bool operator()(int i1, int i2) const
+    {
+        char s1[12];
+        char s2[12];
+        qsnprintf(s1, sizeof(s1), "%d", i1);
+        qsnprintf(s2, sizeof(s2), "%d", i2);
+        return qstrcmp(s1, s2) < 0;
+    }
+};
+
 class ArrayElementLessThan
 {
 public:
@@ -738,6 +1020,19 @@ void ArrayData::sort(ExecutionEngine *engine, Object *thisObject, const ValueRef
         return;
     }
 
+    if (arrayData->isPacked()) {
+        Heap::PackedArrayData *d = static_cast<Heap::PackedArrayData *>(arrayData->d());
+        if (comparefn->isUndefined() && d->type == Heap::ArrayData::PackedInt32) {
+            if (len > d->len)
+                len = d->len;
+            std::sort(d->int32Data(), d->int32Data() + len, Int32StringLessThan());
+            return;
+        }
+        // elements have to be boxed to call the compare function anyway
+        unpack(thisObject);
+        arrayData = thisObject->arrayData();
+    }
+
     // The spec says the sorting goes through a series of get,put and delete operations.
     // this implies that the attributes don't get sorted around.
 
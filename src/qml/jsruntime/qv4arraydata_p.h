@@ -80,7 +80,9 @@ struct ArrayData : public Base {
         Simple = 0,
         Complex = 1,
         Sparse = 2,
-        Custom = 3
+        Custom = 3,
+        PackedInt32 = 4,
+        PackedDouble = 5
     };
 
     uint alloc;
@@ -97,6 +99,7 @@ struct ArrayData : public Base {
     Value arrayData[1];
 
     bool isSparse() const { return type == Sparse; }
+    bool isPacked() const { return type >= PackedInt32; }
 
     const ArrayVTable *vtable() const { return reinterpret_cast<const ArrayVTable *>(internalClass->vtable); }
 
@@ -139,6 +142,34 @@ struct SimpleArrayData : public ArrayData {
     }
 };
 
+// Dense arrays holding only numbers keep their elements unboxed. A packed
+// store never has holes or attributes. The elements start offset slots into
+// the buffer, so shift() is cheap; alloc counts elements of the current type.
+struct PackedArrayData : public ArrayData {
+    PackedArrayData(ExecutionEngine *engine)
+        : ArrayData(engine->packedArrayDataClass)
+    {}
+
+    static uint elementSize(Type t) { return t == PackedInt32 ? sizeof(int) : sizeof(double); }
+
+    uint capacity() const { return alloc - offset; }
+
+    int *int32Data() { return reinterpret_cast<int *>(arrayData) + offset; }
+    const int *int32Data() const { return reinterpret_cast<const int *>(arrayData) + offset; }
+    double *doubleData() { return reinterpret_cast<double *>(arrayData) + offset; }
+    const double *doubleData() const { return reinterpret_cast<const double *>(arrayData) + offset; }
+    char *payload() { return type == PackedInt32 ? reinterpret_cast<char *>(int32Data()) : reinterpret_cast<char *>(doubleData()); }
+    const char *payload() const { return type == PackedInt32 ? reinterpret_cast<const char *>(int32Data()) : reinterpret_cast<const char *>(doubleData()); }
+
+    ReturnedValue data(uint index) const {
+        Q_ASSERT(index < len);
+        if (type == PackedInt32)
+            return Encode(int32Data()[index]);
+        return Encode(doubleData()[index]);
+    }
+    inline void setData(uint index, const Value &v);
+};
+
 struct SparseArrayData : public ArrayData {
     inline SparseArrayData(ExecutionEngine *engine);
     inline ~SparseArrayData();
@@ -184,6 +215,7 @@ struct Q_QML_EXPORT ArrayData : public Managed
 
     const ArrayVTable *vtable() const { return reinterpret_cast<const ArrayVTable *>(internalClass()->vtable); }
     bool isSparse() const { return type() == Heap::ArrayData::Sparse; }
+    bool isPacked() const { return d()->isPacked(); }
 
     uint length() const {
         return d()->length();
@@ -209,6 +241,8 @@ struct Q_QML_EXPORT ArrayData : public Managed
 
     static void ensureAttributes(Object *o);
     static void realloc(Object *o, Type newType, uint alloc, bool enforceAttributes);
+    static void unpack(Object *o);
+    static Type packedType(const Value *values, uint n);
 
     static void sort(ExecutionEngine *engine, Object *thisObject, const ValueRef comparefn, uint dataLen);
     static uint append(Object *obj, ArrayObject *otherObj, uint n);
@@ -241,6 +275,30 @@ struct Q_QML_EXPORT SimpleArrayData : public ArrayData
     static uint length(const Heap::ArrayData *d);
 };
 
+struct Q_QML_EXPORT PackedArrayData : public ArrayData
+{
+    V4_ARRAYDATA(PackedArrayData)
+
+    uint &len() { return d()->len; }
+    uint len() const { return d()->len; }
+
+    static void grow(Object *o, Type newType, uint requested);
+
+    static Heap::ArrayData *reallocate(Object *o, uint n, bool enforceAttributes);
+
+    static void markObjects(Heap::Base *d, ExecutionEngine *e);
+
+    static ReturnedValue get(const Heap::ArrayData *d, uint index);
+    static bool put(Object *o, uint index, ValueRef value);
+    static bool putArray(Object *o, uint index, Value *values, uint n);
+    static bool del(Object *o, uint index);
+    static void setAttribute(Object *o, uint index, PropertyAttributes attrs);
+    static void push_front(Object *o, Value *values, uint n);
+    static ReturnedValue pop_front(Object *o);
+    static uint truncate(Object *o, uint newLen);
+    static uint length(const Heap::ArrayData *d);
+};
+
 struct Q_QML_EXPORT SparseArrayData : public ArrayData
 {
     V4_ARRAYDATA(SparseArrayData)
@@ -282,8 +340,21 @@ inline SparseArrayData::~SparseArrayData()
     delete sparse;
 }
 
+inline void PackedArrayData::setData(uint index, const Value &v)
+{
+    Q_ASSERT(index < capacity() && v.isNumber());
+    if (type == PackedInt32) {
+        Q_ASSERT(v.isInteger());
+        int32Data()[index] = v.integerValue();
+    } else {
+        doubleData()[index] = v.asDouble();
+    }
+}
+
 inline Property *ArrayData::getProperty(uint index)
 {
+    // packed stores have no Property slots; callers unpack them first
+    Q_ASSERT(!isPacked());
     if (isSparse())
         return static_cast<SparseArrayData *>(this)->getProperty(index);
     return static_cast<SimpleArrayData *>(this)->getProperty(index);
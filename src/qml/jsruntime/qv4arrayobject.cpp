@@ -64,7 +64,7 @@ ReturnedValue ArrayCtor::construct(Managed *m, CallData *callData)
             a->arrayReserve(len);
     } else {
         len = callData->argc;
-        a->arrayReserve(len);
+        ArrayData::realloc(a, ArrayData::packedType(callData->args, len), len, false);
         a->arrayPut(0, callData->args, len);
     }
     a->setArrayLengthUnchecked(len);
@@ -268,6 +268,8 @@ ReturnedValue ArrayPrototype::method_push(CallContext *ctx)
     if (!instance)
         return Encode::undefined();
 
+    if (!instance->arrayData() && instance->isArrayObject() && ctx->d()->callData->argc)
+        ArrayData::realloc(instance, ArrayData::packedType(ctx->d()->callData->args, ctx->d()->callData->argc), 0, false);
     instance->arrayCreate();
     Q_ASSERT(instance->arrayData());
 
@@ -293,7 +295,8 @@ ReturnedValue ArrayPrototype::method_push(CallContext *ctx)
 
     if (!ctx->d()->callData->argc)
         ;
-    else if (!instance->protoHasArray() && instance->arrayData()->length() <= len && instance->arrayData()->type == Heap::ArrayData::Simple) {
+    else if (!instance->protoHasArray() && instance->arrayData()->length() <= len
+             && (instance->arrayData()->type == Heap::ArrayData::Simple || instance->arrayData()->isPacked())) {
         instance->arrayData()->vtable()->putArray(instance, len, ctx->d()->callData->args, ctx->d()->callData->argc);
         len = instance->arrayData()->length();
     } else {
@@ -605,7 +608,8 @@ ReturnedValue ArrayPrototype::method_indexOf(CallContext *ctx)
 
     ScopedValue value(scope);
 
-    if (instance->hasAccessorProperty() || (instance->arrayType() >= Heap::ArrayData::Sparse) || instance->protoHasArray()) {
+    if (instance->hasAccessorProperty() || instance->arrayType() == Heap::ArrayData::Sparse
+            || instance->arrayType() == Heap::ArrayData::Custom || instance->protoHasArray()) {
         // lets be safe and slow
         for (uint i = fromIndex; i < len; ++i) {
             bool exists;
@@ -617,6 +621,27 @@ ReturnedValue ArrayPrototype::method_indexOf(CallContext *ctx)
         }
     } else if (!instance->arrayData()) {
         return Encode(-1);
+    } else if (instance->arrayData()->isPacked()) {
+        // only numbers can be strictly equal to an element
+        if (!searchValue->isNumber())
+            return Encode(-1);
+        const Heap::PackedArrayData *pa = static_cast<const Heap::PackedArrayData *>(instance->d()->arrayData);
+        if (len > pa->len)
+            len = pa->len;
+        double d = searchValue->asDouble();
+        if (pa->type == Heap::ArrayData::PackedInt32) {
+            const int *data = pa->int32Data();
+            for (uint idx = fromIndex; idx < len; ++idx) {
+                if (data[idx] == d)
+                    return Encode(idx);
+            }
+        } else {
+            const double *data = pa->doubleData();
+            for (uint idx = fromIndex; idx < len; ++idx) {
+                if (data[idx] == d)
+                    return Encode(idx);
+            }
+        }
     } else {
         Q_ASSERT(instance->arrayType() == Heap::ArrayData::Simple || instance->arrayType() == Heap::ArrayData::Complex);
         Heap::SimpleArrayData *sa = static_cast<Heap::SimpleArrayData *>(instance->d()->arrayData);
@@ -138,7 +138,7 @@ ReturnedValue DataViewPrototype::method_get_byteLength(CallContext *ctx)
     if (!v)
         return scope.engine->throwTypeError();
 
-    return Encode(v->d()->byteLength);
+    return Encode(v->byteLength());
 }
 
 ReturnedValue DataViewPrototype::method_get_byteOffset(CallContext *ctx)
@@ -160,7 +160,7 @@ ReturnedValue DataViewPrototype::method_getChar(CallContext *ctx)
         return scope.engine->throwTypeError();
     double l = ctx->d()->callData->args[0].toNumber();
     uint idx = (uint)l;
-    if (l != idx || idx + sizeof(T) > v->d()->byteLength)
+    if (l != idx || idx + sizeof(T) > v->byteLength())
         return scope.engine->throwTypeError();
     idx += v->d()->byteOffset;
 
@@ -178,7 +178,7 @@ ReturnedValue DataViewPrototype::method_get(CallContext *ctx)
         return scope.engine->throwTypeError();
     double l = ctx->d()->callData->args[0].toNumber();
     uint idx = (uint)l;
-    if (l != idx || idx + sizeof(T) > v->d()->byteLength)
+    if (l != idx || idx + sizeof(T) > v->byteLength())
         return scope.engine->throwTypeError();
     idx += v->d()->byteOffset;
 
@@ -200,7 +200,7 @@ ReturnedValue DataViewPrototype::method_getFloat(CallContext *ctx)
         return scope.engine->throwTypeError();
     double l = ctx->d()->callData->args[0].toNumber();
     uint idx = (uint)l;
-    if (l != idx || idx + sizeof(T) > v->d()->byteLength)
+    if (l != idx || idx + sizeof(T) > v->byteLength())
         return scope.engine->throwTypeError();
     idx += v->d()->byteOffset;
 
@@ -238,11 +238,14 @@ ReturnedValue DataViewPrototype::method_setChar(CallContext *ctx)
         return scope.engine->throwTypeError();
     double l = ctx->d()->callData->args[0].toNumber();
     uint idx = (uint)l;
-    if (l != idx || idx + sizeof(T) > v->d()->byteLength)
+    // valueOf() may neuter the buffer, so the value is converted before checking the bounds.
+    int val = ctx->d()->callData->argc >= 2 ? ctx->d()->callData->args[1].toInt32() : 0;
+    if (scope.engine->hasException)
+        return Encode::undefined();
+    if (l != idx || idx + sizeof(T) > v->byteLength())
         return scope.engine->throwTypeError();
     idx += v->d()->byteOffset;
 
-    int val = ctx->d()->callData->argc >= 2 ? ctx->d()->callData->args[1].toInt32() : 0;
     v->d()->buffer->data->data()[idx] = (char)val;
 
     return Encode::undefined();
@@ -257,12 +260,14 @@ ReturnedValue DataViewPrototype::method_set(CallContext *ctx)
         return scope.engine->throwTypeError();
     double l = ctx->d()->callData->args[0].toNumber();
     uint idx = (uint)l;
-    if (l != idx || idx + sizeof(T) > v->d()->byteLength)
+    // valueOf() may neuter the buffer, so the value is converted before checking the bounds.
+    int val = ctx->d()->callData->argc >= 2 ? ctx->d()->callData->args[1].toInt32() : 0;
+    if (scope.engine->hasException)
+        return Encode::undefined();
+    if (l != idx || idx + sizeof(T) > v->byteLength())
         return scope.engine->throwTypeError();
     idx += v->d()->byteOffset;
 
-    int val = ctx->d()->callData->argc >= 2 ? ctx->d()->callData->args[1].toInt32() : 0;
-
     bool littleEndian = ctx->d()->callData->argc < 3 ? false : ctx->d()->callData->args[2].toBoolean();
 
     if (littleEndian)
@@ -282,11 +287,14 @@ ReturnedValue DataViewPrototype::method_setFloat(CallContext *ctx)
         return scope.engine->throwTypeError();
     double l = ctx->d()->callData->args[0].toNumber();
     uint idx = (uint)l;
-    if (l != idx || idx + sizeof(T) > v->d()->byteLength)
+    // valueOf() may neuter the buffer, so the value is converted before checking the bounds.
+    double val = ctx->d()->callData->argc >= 2 ? ctx->d()->callData->args[1].toNumber() : qSNaN();
+    if (scope.engine->hasException)
+        return Encode::undefined();
+    if (l != idx || idx + sizeof(T) > v->byteLength())
         return scope.engine->throwTypeError();
     idx += v->d()->byteOffset;
 
-    double val = ctx->d()->callData->argc >= 2 ? ctx->d()->callData->args[1].toNumber() : qSNaN();
     bool littleEndian = ctx->d()->callData->argc < 3 ? false : ctx->d()->callData->args[2].toBoolean();
 
     if (sizeof(T) == 4) {
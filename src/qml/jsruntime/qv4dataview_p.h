@@ -67,6 +67,11 @@ struct DataView : Object
 {
     V4_OBJECT2(DataView, Object)
 
+    // views on a neutered buffer are empty
+    uint byteLength() const {
+        return d()->buffer->byteLength() ? d()->byteLength : 0;
+    }
+
     static void markObjects(Heap::Base *that, ExecutionEngine *e);
 };
 
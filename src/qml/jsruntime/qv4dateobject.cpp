@@ -72,6 +72,10 @@ static const double msPerHour = 3600000.0;
 static const double msPerDay = 86400000.0;
 
 static double LocalTZA = 0.0; // initialized at startup
+static QBasicAtomicInt timezoneGeneration = Q_BASIC_ATOMIC_INITIALIZER(0); // bumped when the timezone changes
+
+// The daylight saving offset changes at most once in this span of time
+static const double DaylightSavingSpan = 19 * msPerDay;
 
 static inline double TimeWithinDay(double t)
 {
@@ -303,14 +307,108 @@ static inline double DaylightSavingTA(double t)
     return (tmtm.tm_isdst > 0) ? msPerHour : 0;
 }
 
-static inline double LocalTime(double t)
+DaylightSavingCache::DaylightSavingCache()
+{
+    clear();
+}
+
+void DaylightSavingCache::clear()
+{
+    for (int i = 0; i < Size; ++i) {
+        spans[i].start = 1;
+        spans[i].end = 0; // empty
+        spans[i].offset = 0;
+        spans[i].lastUsed = 0;
+    }
+    clock = 0;
+    timezoneGeneration = ::timezoneGeneration.load();
+}
+
+double DaylightSavingCache::insert(double start, double end, double offset)
+{
+    Span *span = spans;
+    for (int i = 1; i < Size; ++i) {
+        if (spans[i].lastUsed < span->lastUsed)
+            span = spans + i;
+    }
+    span->start = start;
+    span->end = end;
+    span->offset = offset;
+    span->lastUsed = clock;
+    return offset;
+}
+
+double DaylightSavingCache::offset(double t)
+{
+    if (std::isnan(t))
+        return 0;
+    if (timezoneGeneration != ::timezoneGeneration.load())
+        clear();
+    ++clock;
+
+    Span *nearest = 0;
+    double distance = DaylightSavingSpan;
+    for (int i = 0; i < Size; ++i) {
+        Span &span = spans[i];
+        if (span.start > span.end)
+            continue;
+        if (t >= span.start && t <= span.end) {
+            span.lastUsed = clock;
+            return span.offset;
+        }
+        double d = t > span.end ? t - span.end : span.start - t;
+        if (d <= distance) {
+            nearest = &span;
+            distance = d;
+        }
+    }
+
+    if (!nearest)
+        return insert(t, t, DaylightSavingTA(t));
+
+    // Look a whole DaylightSavingSpan beyond the span. There is at most one
+    // transition in between, so if the offset there is unchanged, it holds
+    // all the way, and t is somewhere on the way.
+    nearest->lastUsed = clock;
+    const bool after = t > nearest->end;
+    const double probe = after ? nearest->end + DaylightSavingSpan : nearest->start - DaylightSavingSpan;
+    const double probeOffset = DaylightSavingTA(probe);
+    if (probeOffset == nearest->offset) {
+        if (after)
+            nearest->end = probe;
+        else
+            nearest->start = probe;
+        return probeOffset;
+    }
+
+    const double offset = DaylightSavingTA(t);
+    if (offset == nearest->offset) {
+        if (after)
+            nearest->end = t;
+        else
+            nearest->start = t;
+        return offset;
+    }
+
+    // t is past the transition, and so is the probe
+    return after ? insert(t, probe, offset) : insert(probe, t, offset);
+}
+
+static inline double DaylightSavingTA(ExecutionEngine *engine, double t)
+{
+    if (!engine->daylightSavingCache)
+        engine->daylightSavingCache = new DaylightSavingCache;
+    return engine->daylightSavingCache->offset(t);
+}
+
+static inline double LocalTime(ExecutionEngine *engine, double t)
 {
-    return t + LocalTZA + DaylightSavingTA(t);
+    return t + LocalTZA + DaylightSavingTA(engine, t);
 }
 
-static inline double UTC(double t)
+static inline double UTC(ExecutionEngine *engine, double t)
 {
-    return t - LocalTZA - DaylightSavingTA(t - LocalTZA);
+    return t - LocalTZA - DaylightSavingTA(engine, t - LocalTZA);
 }
 
 static inline double currentTime()
@@ -555,12 +653,12 @@ static inline QDateTime ToDateTime(double t, Qt::TimeSpec spec)
     return QDateTime::fromMSecsSinceEpoch(t, spec);
 }
 
-static inline QString ToString(double t)
+static inline QString ToString(ExecutionEngine *engine, double t)
 {
     if (std::isnan(t))
         return QStringLiteral("Invalid Date");
     QString str = ToDateTime(t, Qt::LocalTime).toString() + QStringLiteral(" GMT");
-    double tzoffset = LocalTZA + DaylightSavingTA(t);
+    double tzoffset = LocalTZA + DaylightSavingTA(engine, t);
     if (tzoffset) {
         int hours = static_cast<int>(::fabs(tzoffset) / 1000 / 60 / 60);
         int mins = int(::fabs(tzoffset) / 1000 / 60) % 60;
@@ -680,7 +778,7 @@ ReturnedValue DateCtor::construct(Managed *m, CallData *callData)
         if (year >= 0 && year <= 99)
             year += 1900;
         t = MakeDate(MakeDay(year, month, day), MakeTime(hours, mins, secs, ms));
-        t = TimeClip(UTC(t));
+        t = TimeClip(UTC(m->engine(), t));
     }
 
     return Encode(m->engine()->newDateObject(Primitive::fromDouble(t)));
@@ -689,7 +787,7 @@ ReturnedValue DateCtor::construct(Managed *m, CallData *callData)
 ReturnedValue DateCtor::call(Managed *m, CallData *)
 {
     double t = currentTime();
-    return m->engine()->newString(ToString(t))->asReturnedValue();
+    return m->engine()->newString(ToString(m->engine(), t))->asReturnedValue();
 }
 
 void DatePrototype::init(ExecutionEngine *engine, Object *ctor)
@@ -800,7 +898,7 @@ ReturnedValue DatePrototype::method_now(CallContext *ctx)
 ReturnedValue DatePrototype::method_toString(CallContext *ctx)
 {
     double t = getThisDate(ctx);
-    return ctx->d()->engine->newString(ToString(t))->asReturnedValue();
+    return ctx->d()->engine->newString(ToString(ctx->d()->engine, t))->asReturnedValue();
 }
 
 ReturnedValue DatePrototype::method_toDateString(CallContext *ctx)
@@ -849,7 +947,7 @@ ReturnedValue DatePrototype::method_getYear(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = YearFromTime(LocalTime(t)) - 1900;
+        t = YearFromTime(LocalTime(ctx->engine(), t)) - 1900;
     return Encode(t);
 }
 
@@ -857,7 +955,7 @@ ReturnedValue DatePrototype::method_getFullYear(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = YearFromTime(LocalTime(t));
+        t = YearFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -873,7 +971,7 @@ ReturnedValue DatePrototype::method_getMonth(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = MonthFromTime(LocalTime(t));
+        t = MonthFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -889,7 +987,7 @@ ReturnedValue DatePrototype::method_getDate(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = DateFromTime(LocalTime(t));
+        t = DateFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -905,7 +1003,7 @@ ReturnedValue DatePrototype::method_getDay(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = WeekDay(LocalTime(t));
+        t = WeekDay(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -921,7 +1019,7 @@ ReturnedValue DatePrototype::method_getHours(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = HourFromTime(LocalTime(t));
+        t = HourFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -937,7 +1035,7 @@ ReturnedValue DatePrototype::method_getMinutes(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = MinFromTime(LocalTime(t));
+        t = MinFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -953,7 +1051,7 @@ ReturnedValue DatePrototype::method_getSeconds(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = SecFromTime(LocalTime(t));
+        t = SecFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -969,7 +1067,7 @@ ReturnedValue DatePrototype::method_getMilliseconds(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = msFromTime(LocalTime(t));
+        t = msFromTime(LocalTime(ctx->engine(), t));
     return Encode(t);
 }
 
@@ -985,7 +1083,7 @@ ReturnedValue DatePrototype::method_getTimezoneOffset(CallContext *ctx)
 {
     double t = getThisDate(ctx);
     if (! std::isnan(t))
-        t = (t - LocalTime(t)) / msPerMinute;
+        t = (t - LocalTime(ctx->engine(), t)) / msPerMinute;
     return Encode(t);
 }
 
@@ -1008,9 +1106,9 @@ ReturnedValue DatePrototype::method_setMilliseconds(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     double ms = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
-    self->date().setDouble(TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), SecFromTime(t), ms)))));
+    self->date().setDouble(TimeClip(UTC(ctx->engine(), MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), SecFromTime(t), ms)))));
     return self->date().asReturnedValue();
 }
 
@@ -1032,10 +1130,10 @@ ReturnedValue DatePrototype::method_setSeconds(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     double sec = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
     double ms = (ctx->d()->callData->argc < 2) ? msFromTime(t) : ctx->d()->callData->args[1].toNumber();
-    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), sec, ms))));
+    t = TimeClip(UTC(ctx->engine(), MakeDate(Day(t), MakeTime(HourFromTime(t), MinFromTime(t), sec, ms))));
     self->date().setDouble(t);
     return self->date().asReturnedValue();
 }
@@ -1060,11 +1158,11 @@ ReturnedValue DatePrototype::method_setMinutes(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     double min = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
     double sec = (ctx->d()->callData->argc < 2) ? SecFromTime(t) : ctx->d()->callData->args[1].toNumber();
     double ms = (ctx->d()->callData->argc < 3) ? msFromTime(t) : ctx->d()->callData->args[2].toNumber();
-    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(HourFromTime(t), min, sec, ms))));
+    t = TimeClip(UTC(ctx->engine(), MakeDate(Day(t), MakeTime(HourFromTime(t), min, sec, ms))));
     self->date().setDouble(t);
     return self->date().asReturnedValue();
 }
@@ -1090,12 +1188,12 @@ ReturnedValue DatePrototype::method_setHours(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     double hour = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
     double min = (ctx->d()->callData->argc < 2) ? MinFromTime(t) : ctx->d()->callData->args[1].toNumber();
     double sec = (ctx->d()->callData->argc < 3) ? SecFromTime(t) : ctx->d()->callData->args[2].toNumber();
     double ms = (ctx->d()->callData->argc < 4) ? msFromTime(t) : ctx->d()->callData->args[3].toNumber();
-    t = TimeClip(UTC(MakeDate(Day(t), MakeTime(hour, min, sec, ms))));
+    t = TimeClip(UTC(ctx->engine(), MakeDate(Day(t), MakeTime(hour, min, sec, ms))));
     self->date().setDouble(t);
     return self->date().asReturnedValue();
 }
@@ -1122,9 +1220,9 @@ ReturnedValue DatePrototype::method_setDate(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     double date = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
-    t = TimeClip(UTC(MakeDate(MakeDay(YearFromTime(t), MonthFromTime(t), date), TimeWithinDay(t))));
+    t = TimeClip(UTC(ctx->engine(), MakeDate(MakeDay(YearFromTime(t), MonthFromTime(t), date), TimeWithinDay(t))));
     self->date().setDouble(t);
     return self->date().asReturnedValue();
 }
@@ -1148,10 +1246,10 @@ ReturnedValue DatePrototype::method_setMonth(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     double month = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
     double date = (ctx->d()->callData->argc < 2) ? DateFromTime(t) : ctx->d()->callData->args[1].toNumber();
-    t = TimeClip(UTC(MakeDate(MakeDay(YearFromTime(t), month, date), TimeWithinDay(t))));
+    t = TimeClip(UTC(ctx->engine(), MakeDate(MakeDay(YearFromTime(t), month, date), TimeWithinDay(t))));
     self->date().setDouble(t);
     return self->date().asReturnedValue();
 }
@@ -1180,7 +1278,7 @@ ReturnedValue DatePrototype::method_setYear(CallContext *ctx)
     if (std::isnan(t))
         t = 0;
     else
-        t = LocalTime(t);
+        t = LocalTime(ctx->engine(), t);
     double year = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
     double r;
     if (std::isnan(year)) {
@@ -1189,7 +1287,7 @@ ReturnedValue DatePrototype::method_setYear(CallContext *ctx)
         if ((Primitive::toInteger(year) >= 0) && (Primitive::toInteger(year) <= 99))
             year += 1900;
         r = MakeDay(year, MonthFromTime(t), DateFromTime(t));
-        r = UTC(MakeDate(r, TimeWithinDay(t)));
+        r = UTC(ctx->engine(), MakeDate(r, TimeWithinDay(t)));
         r = TimeClip(r);
     }
     self->date().setDouble(r);
@@ -1217,13 +1315,13 @@ ReturnedValue DatePrototype::method_setFullYear(CallContext *ctx)
     if (!self)
         return ctx->engine()->throwTypeError();
 
-    double t = LocalTime(self->date().asDouble());
+    double t = LocalTime(ctx->engine(), self->date().asDouble());
     if (std::isnan(t))
         t = 0;
     double year = ctx->d()->callData->argc ? ctx->d()->callData->args[0].toNumber() : qSNaN();
     double month = (ctx->d()->callData->argc < 2) ? MonthFromTime(t) : ctx->d()->callData->args[1].toNumber();
     double date = (ctx->d()->callData->argc < 3) ? DateFromTime(t) : ctx->d()->callData->args[2].toNumber();
-    t = TimeClip(UTC(MakeDate(MakeDay(year, month, date), TimeWithinDay(t))));
+    t = TimeClip(UTC(ctx->engine(), MakeDate(MakeDay(year, month, date), TimeWithinDay(t))));
     self->date().setDouble(t);
     return self->date().asReturnedValue();
 }
@@ -1313,4 +1411,5 @@ ReturnedValue DatePrototype::method_toJSON(CallContext *ctx)
 void DatePrototype::timezoneUpdated()
 {
     LocalTZA = getLocalTZA();
+    timezoneGeneration.ref();
 }
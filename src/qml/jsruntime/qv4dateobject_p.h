@@ -146,6 +146,33 @@ struct DatePrototype: DateObject
     static void timezoneUpdated();
 };
 
+// Remembers spans of time over which the daylight saving offset does not
+// change, so that converting times close to each other to local time is
+// arithmetic only. Each engine has its own cache; it is dropped when the
+// timezone changes.
+struct DaylightSavingCache {
+    enum { Size = 4 };
+    struct Span {
+        double start;
+        double end;
+        double offset;
+        uint lastUsed;
+    };
+
+    DaylightSavingCache();
+
+    // in ms, for the UTC time t
+    double offset(double t);
+
+    Span spans[Size];
+    uint clock;
+    int timezoneGeneration;
+
+private:
+    void clear();
+    double insert(double start, double end, double offset);
+};
+
 }
 
 QT_END_NAMESPACE
@@ -64,6 +64,7 @@
 #include "qv4arraybuffer_p.h"
 #include "qv4dataview_p.h"
 #include "qv4typedarray_p.h"
+#include "qv4lookup_p.h"
 #include <private/qv8engine_p.h>
 
 #include <QtCore/QTextStream>
@@ -71,6 +72,7 @@
 
 #ifdef V4_ENABLE_JIT
 #include "qv4isel_masm_p.h"
+#include "qv4tiering_p.h"
 #endif // V4_ENABLE_JIT
 
 #include "qv4isel_moth_p.h"
@@ -183,6 +185,8 @@ ExecutionEngine::ExecutionEngine(EvalISelFactory *factory)
     , nArgumentsAccessors(0)
     , m_engineId(engineSerial.fetchAndAddOrdered(1))
     , regExpCache(0)
+    , megamorphicLookupCache(0)
+    , daylightSavingCache(0)
     , m_multiplyWrappedQObjects(0)
     , m_qmlExtensions(0)
 {
@@ -195,8 +199,11 @@ ExecutionEngine::ExecutionEngine(EvalISelFactory *factory)
 
 #ifdef V4_ENABLE_JIT
         static const bool forceMoth = !qgetenv("QV4_FORCE_INTERPRETER").isEmpty();
+        static const bool tiered = !qgetenv("QV4_JIT_TIERED").isEmpty();
         if (forceMoth)
             factory = new Moth::ISelFactory;
+        else if (tiered)
+            factory = new JIT::TieredISelFactory;
         else
             factory = new JIT::ISelFactory;
 #else // !V4_ENABLE_JIT
@@ -205,6 +212,11 @@ ExecutionEngine::ExecutionEngine(EvalISelFactory *factory)
     }
     iselFactory.reset(factory);
 
+    // In kB. Code compiled after the limit was reached is interpreted.
+    static const size_t executableMemoryLimit = qgetenv("QV4_JIT_MEMORY_LIMIT").toULongLong() * 1024;
+    executableAllocator->setMemoryLimit(executableMemoryLimit);
+    regExpAllocator->setMemoryLimit(executableMemoryLimit);
+
     memoryManager->setExecutionEngine(this);
 
     // reserve space for the JS stack
@@ -285,6 +297,7 @@ ExecutionEngine::ExecutionEngine(EvalISelFactory *factory)
     arrayPrototype = memoryManager->alloc<ArrayPrototype>(arrayClass, objectPrototype.asObject());
 
     simpleArrayDataClass = InternalClass::create(this, SimpleArrayData::staticVTable());
+    packedArrayDataClass = InternalClass::create(this, PackedArrayData::staticVTable());
 
     InternalClass *argsClass = InternalClass::create(this, ArgumentsObject::staticVTable());
     argsClass = argsClass->addMember(id_length, Attr_NotEnumerable);
@@ -462,6 +475,8 @@ ExecutionEngine::ExecutionEngine(EvalISelFactory *factory)
 
 ExecutionEngine::~ExecutionEngine()
 {
+    // Stops any background compilation before the executable allocator goes away.
+    iselFactory.reset();
     delete debugger;
     debugger = 0;
     delete profiler;
@@ -481,6 +496,8 @@ ExecutionEngine::~ExecutionEngine()
     delete classPool;
     delete bumperPointerAllocator;
     delete regExpCache;
+    delete megamorphicLookupCache;
+    delete daylightSavingCache;
     delete regExpAllocator;
     delete executableAllocator;
     jsStack->deallocate();
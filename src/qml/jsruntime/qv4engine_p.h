@@ -37,6 +37,7 @@
 #include "private/qv4isel_p.h"
 #include "qv4managed_p.h"
 #include "qv4context_p.h"
+#include "qv4property_p.h"
 #include <private/qintrusivelist_p.h>
 
 namespace WTF {
@@ -169,6 +170,7 @@ public:
     InternalClass *objectClass;
     InternalClass *arrayClass;
     InternalClass *simpleArrayDataClass;
+    InternalClass *packedArrayDataClass;
     InternalClass *stringObjectClass;
     InternalClass *booleanClass;
     InternalClass *numberClass;
@@ -246,6 +248,11 @@ public:
     quint32 m_engineId;
 
     RegExpCache *regExpCache;
+    MegamorphicLookupCache *megamorphicLookupCache; // created with the first polymorphic lookup
+    DaylightSavingCache *daylightSavingCache; // created with the first local time conversion
+    // Elements of packed arrays have no Property to point to, the property lookups return a
+    // copy in here. Only ever holds numbers, so it needs no marking.
+    Property packedElement;
 
     // Scarce resources are "exceptionally high cost" QVariant types where allowing the
     // normal JavaScript GC to clean them up is likely to lead to out-of-memory or other
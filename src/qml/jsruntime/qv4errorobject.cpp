@@ -166,6 +166,7 @@ ReturnedValue ErrorObject::method_get_stack(CallContext *ctx)
             }
         }
         This->d()->stack = ctx->d()->engine->newString(trace);
+        This->d()->writeBarrier();
     }
     return This->d()->stack->asReturnedValue();
 }
@@ -35,6 +35,7 @@
 
 #include <wtf/StdLibExtras.h>
 #include <wtf/PageAllocation.h>
+#include <wtf/OSAllocator.h>
 
 using namespace QV4;
 
@@ -135,7 +136,9 @@ bool ExecutableAllocator::ChunkOfPages::contains(Allocation *alloc) const
 }
 
 ExecutableAllocator::ExecutableAllocator()
-    : mutex(QMutex::NonRecursive)
+    : committed(0)
+    , limit(0)
+    , mutex(QMutex::NonRecursive)
 {
 }
 
@@ -164,16 +167,21 @@ ExecutableAllocator::Allocation *ExecutableAllocator::allocate(size_t size)
         freeAllocations.erase(it);
     }
 
+    ChunkOfPages *chunk = 0;
     if (!allocation) {
-        ChunkOfPages *chunk = new ChunkOfPages;
+        chunk = new ChunkOfPages;
         size_t allocSize = WTF::roundUpToMultipleOf(WTF::pageSize(), size);
         chunk->pages = new WTF::PageAllocation(WTF::PageAllocation::allocate(allocSize, OSAllocator::JSJITCodePages));
+        chunk->decommittedPages.resize(int(allocSize / WTF::pageSize()));
         chunks.insert(reinterpret_cast<quintptr>(chunk->pages->base()) - 1, chunk);
+        committed += allocSize;
         allocation = new Allocation;
         allocation->addr = reinterpret_cast<quintptr>(chunk->pages->base());
         allocation->size = allocSize;
         allocation->free = true;
         chunk->firstAllocation = allocation;
+    } else {
+        chunk = findChunk(allocation->addr);
     }
 
     Q_ASSERT(allocation);
@@ -188,6 +196,9 @@ ExecutableAllocator::Allocation *ExecutableAllocator::allocate(size_t size)
             freeAllocations.insert(remainder->size, remainder);
     }
 
+    if (chunk->decommittedPageCount)
+        commitPages(chunk, allocation);
+
     return allocation;
 }
 
@@ -207,25 +218,54 @@ void ExecutableAllocator::free(Allocation *allocation)
     Q_ASSERT(chunk->contains(allocation));
 
     bool merged = allocation->mergeNext(this);
-    merged |= allocation->mergePrevious(this);
+    Allocation *previous = allocation->prev;
+    if (allocation->mergePrevious(this)) {
+        allocation = previous;
+        merged = true;
+    }
     if (!merged)
         freeAllocations.insert(allocation->size, allocation);
 
-    allocation = 0;
-
     if (!chunk->firstAllocation->next) {
         freeAllocations.remove(chunk->firstAllocation->size, chunk->firstAllocation);
         chunks.erase(it);
+        committed -= chunk->pages->size() - size_t(chunk->decommittedPageCount) * WTF::pageSize();
         delete chunk;
         return;
     }
+
+    // The chunk stays alive as long as any of its code does. Hand the pages nobody uses back
+    // to the system, so that a long running process doesn't keep the peak amount of code.
+    decommitFreePages(chunk, allocation);
 }
 
 ExecutableAllocator::ChunkOfPages *ExecutableAllocator::chunkForAllocation(Allocation *allocation) const
 {
     QMutexLocker locker(&mutex);
+    return findChunk(allocation->addr);
+}
+
+size_t ExecutableAllocator::committedSize() const
+{
+    QMutexLocker locker(&mutex);
+    return committed;
+}
 
-    QMap<quintptr, ChunkOfPages*>::ConstIterator it = chunks.lowerBound(allocation->addr);
+void ExecutableAllocator::setMemoryLimit(size_t limit)
+{
+    QMutexLocker locker(&mutex);
+    this->limit = limit;
+}
+
+bool ExecutableAllocator::isLimitReached() const
+{
+    QMutexLocker locker(&mutex);
+    return limit && committed >= limit;
+}
+
+ExecutableAllocator::ChunkOfPages *ExecutableAllocator::findChunk(quintptr addr) const
+{
+    QMap<quintptr, ChunkOfPages*>::ConstIterator it = chunks.lowerBound(addr);
     if (it != chunks.begin())
         --it;
     if (it == chunks.end())
@@ -233,3 +273,45 @@ ExecutableAllocator::ChunkOfPages *ExecutableAllocator::chunkForAllocation(Alloc
     return *it;
 }
 
+// Commits the decommitted pages the allocation overlaps with.
+void ExecutableAllocator::commitPages(ChunkOfPages *chunk, Allocation *allocation)
+{
+    const size_t pageSize = WTF::pageSize();
+    const quintptr base = reinterpret_cast<quintptr>(chunk->pages->base());
+    const quintptr end = allocation->addr + allocation->size;
+    for (quintptr page = allocation->addr & ~quintptr(pageSize - 1); page < end; page += pageSize) {
+        const int index = int((page - base) / pageSize);
+        if (!chunk->decommittedPages.testBit(index))
+            continue;
+        WTF::OSAllocator::commit(reinterpret_cast<void *>(page), pageSize, /*writable*/ true,
+                                 /*executable*/ true);
+        chunk->decommittedPages.clearBit(index);
+        --chunk->decommittedPageCount;
+        committed += pageSize;
+    }
+}
+
+// Decommits the pages that lie entirely within the free allocation.
+void ExecutableAllocator::decommitFreePages(ChunkOfPages *chunk, Allocation *allocation)
+{
+    Q_ASSERT(allocation->free);
+    const size_t pageSize = WTF::pageSize();
+    const quintptr base = reinterpret_cast<quintptr>(chunk->pages->base());
+    const quintptr end = (allocation->addr + allocation->size) & ~quintptr(pageSize - 1);
+    quintptr page = WTF::roundUpToMultipleOf(pageSize, allocation->addr);
+    while (page < end) {
+        if (chunk->decommittedPages.testBit(int((page - base) / pageSize))) {
+            page += pageSize;
+            continue;
+        }
+        const quintptr runStart = page;
+        while (page < end && !chunk->decommittedPages.testBit(int((page - base) / pageSize))) {
+            chunk->decommittedPages.setBit(int((page - base) / pageSize));
+            ++chunk->decommittedPageCount;
+            page += pageSize;
+        }
+        WTF::OSAllocator::decommit(reinterpret_cast<void *>(runStart), page - runStart);
+        committed -= page - runStart;
+    }
+}
+
@@ -40,6 +40,7 @@
 #include <QHash>
 #include <QVector>
 #include <QByteArray>
+#include <QBitArray>
 #include <QMutex>
 
 namespace WTF {
@@ -97,16 +98,29 @@ public:
     int freeAllocationCount() const { return freeAllocations.count(); }
     int chunkCount() const { return chunks.count(); }
 
+    // Bytes of executable memory backed by committed pages. Whole pages that are free are
+    // decommitted, so this goes down as code is released even if its chunk stays alive.
+    size_t committedSize() const;
+
+    // Once committedSize() reaches the limit, no new code should be generated. Callers check
+    // isLimitReached() before compiling and interpret instead. 0 means no limit.
+    void setMemoryLimit(size_t limit);
+    size_t memoryLimit() const { return limit; }
+    bool isLimitReached() const;
+
     struct ChunkOfPages
     {
         ChunkOfPages()
             : pages(0)
             , firstAllocation(0)
+            , decommittedPageCount(0)
         {}
         ~ChunkOfPages();
 
         WTF::PageAllocation *pages;
         Allocation *firstAllocation;
+        QBitArray decommittedPages;
+        int decommittedPageCount;
 
         bool contains(Allocation *alloc) const;
     };
@@ -114,8 +128,14 @@ public:
     ChunkOfPages *chunkForAllocation(Allocation *allocation) const;
 
 private:
+    ChunkOfPages *findChunk(quintptr addr) const;
+    void commitPages(ChunkOfPages *chunk, Allocation *allocation);
+    void decommitFreePages(ChunkOfPages *chunk, Allocation *allocation);
+
     QMultiMap<size_t, Allocation*> freeAllocations;
     QMap<quintptr, ChunkOfPages*> chunks;
+    size_t committed;
+    size_t limit;
     mutable QMutex mutex;
 };
 
@@ -55,7 +55,7 @@ struct Q_QML_EXPORT Function {
     ~Function();
 
     inline Heap::String *name() {
-        return compilationUnit->runtimeStrings[compiledFunction->nameIndex];
+        return compilationUnit->runtimeString(compiledFunction->nameIndex);
     }
     inline QString sourceFile() const { return compilationUnit->fileName(); }
 
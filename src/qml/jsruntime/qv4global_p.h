@@ -160,6 +160,8 @@ struct InternalClass;
 struct Property;
 struct Value;
 struct Lookup;
+struct MegamorphicLookupCache;
+struct DaylightSavingCache;
 struct ArrayData;
 struct ManagedVTable;
 
@@ -40,11 +40,14 @@
 #include <qv4runtime_p.h>
 
 #include <qjsondocument.h>
+#include <qiodevice.h>
 #include <qstack.h>
 #include <qstringlist.h>
 
 #include <wtf/MathExtras.h>
 
+#include "../../3rdparty/double-conversion/double-conversion.h"
+
 using namespace QV4;
 
 //#define PARSER_DEBUG
@@ -76,6 +79,8 @@ private:
     ReturnedValue parseObject();
     ReturnedValue parseArray();
     bool parseMember(Object *o);
+    bool parseMember(InternalClass **klass, Value *members);
+    ReturnedValue createObject(InternalClass *klass, const Value *members);
     bool parseString(QString *string);
     bool parseValue(ValueRef val);
     bool parseNumber(ValueRef val);
@@ -87,6 +92,19 @@ private:
 
     int nestingLevel;
     QJsonParseError::ParseError lastError;
+
+    // Member transitions taken during this parse, by the class they start
+    // from. Records with the same keys find their next class by comparing
+    // the key text, without building the key string or hashing it again.
+    struct KeyTransition {
+        QString key;
+        InternalClass *next;
+        uint index;
+    };
+    enum { MaxKeyTransitions = 8 };
+    // Members of one object kept on the JS stack before the object is created.
+    enum { MaxStackMembers = 64 };
+    QHash<InternalClass *, QVector<KeyTransition> > transitions;
 };
 
 static const int nestingLimit = 1024;
@@ -231,11 +249,31 @@ ReturnedValue JsonParser::parseObject()
     BEGIN << "parseObject pos=" << json;
     Scope scope(engine);
 
-    ScopedObject o(scope, engine->newObject());
+    // The members are parsed into consecutive stack slots, and the object is
+    // created with its final class and member data once all of them are
+    // known. Nested values unwind their own scopes, so the slots stay
+    // contiguous. A key that is an array index needs a real object, so the
+    // rest of the members are then added one by one. The same happens after
+    // MaxStackMembers members or when the JS stack runs out, so that large
+    // objects don't overflow it.
+    ScopedObject o(scope);
+    InternalClass *klass = engine->objectClass;
+    Value *members = engine->jsStackTop;
 
     QChar token = nextToken();
     while (token == Quote) {
-        if (!parseMember(o))
+        if (!o && (klass->size >= MaxStackMembers || engine->jsStackTop >= engine->jsStackLimit))
+            o = createObject(klass, members);
+        if (!o) {
+            if (engine->jsStackTop == members + klass->size)
+                scope.alloc(1);
+            if (!parseMember(&klass, members)) {
+                if (lastError != QJsonParseError::NoError)
+                    return Encode::undefined();
+                o = createObject(klass, members);
+            }
+        }
+        if (o && !parseMember(o))
             return Encode::undefined();
         token = nextToken();
         if (token != ValueSeparator)
@@ -253,12 +291,24 @@ ReturnedValue JsonParser::parseObject()
         return Encode::undefined();
     }
 
+    if (!o)
+        o = createObject(klass, members);
+
     END;
 
     --nestingLevel;
     return o.asReturnedValue();
 }
 
+ReturnedValue JsonParser::createObject(InternalClass *klass, const Value *members)
+{
+    Scope scope(engine);
+    ScopedObject o(scope, engine->newObject(klass, engine->objectPrototype.asObject()));
+    for (uint i = 0; i < klass->size; ++i)
+        o->memberData()->data[i] = members[i];
+    return o.asReturnedValue();
+}
+
 /*
     member = string name-separator value
 */
@@ -291,6 +341,73 @@ bool JsonParser::parseMember(Object *o)
     return true;
 }
 
+/*
+    Adds a member to an object that is still being parsed. members has a
+    free slot at klass->size for the value. If the key is an array index,
+    returns false without setting an error and leaves the input at the key.
+*/
+bool JsonParser::parseMember(InternalClass **klass, Value *members)
+{
+    BEGIN << "parseMember";
+    const QChar *key = json;
+
+    InternalClass *next = 0;
+    uint index = UINT_MAX;
+    QVector<KeyTransition> &cached = transitions[*klass];
+    for (int i = 0; i < cached.size(); ++i) {
+        const KeyTransition &t = cached.at(i);
+        const int length = t.key.length();
+        if (end - json > length && json[length] == Quote
+            && !memcmp(json, t.key.constData(), length * sizeof(QChar))) {
+            json += length + 1;
+            next = t.next;
+            index = t.index;
+            break;
+        }
+    }
+
+    if (!next) {
+        QString name;
+        if (!parseString(&name))
+            return false;
+        if (String::toArrayIndex(name) != UINT_MAX) {
+            json = key;
+            return false;
+        }
+        next = (*klass)->addMember(engine->identifierTable->identifier(name), Attr_Data, &index);
+
+        // only keys without escapes read the same in the input
+        bool plain = cached.size() < MaxKeyTransitions;
+        for (int i = 0; plain && i < name.length(); ++i) {
+            const ushort c = name.at(i).unicode();
+            plain = c >= 0x20 && c != Quote && c != '\\';
+        }
+        if (plain) {
+            KeyTransition t = { name, next, index };
+            cached.append(t);
+        }
+    }
+
+    QChar token = nextToken();
+    if (token != NameSeparator) {
+        lastError = QJsonParseError::MissingNameSeparator;
+        return false;
+    }
+    Value *val = members + (*klass)->size;
+    if (!parseValue(*val))
+        return false;
+
+    if (index < (*klass)->size) {
+        // a duplicate key replaces the earlier value
+        members[index] = *val;
+    } else {
+        *klass = next;
+    }
+
+    END;
+    return true;
+}
+
 /*
     array = begin-array [ value *( value-separator value ) ] end-array
 */
@@ -313,8 +430,8 @@ ReturnedValue JsonParser::parseArray()
         nextToken();
     } else {
         uint index = 0;
+        ScopedValue val(scope);
         while (1) {
-            ScopedValue val(scope);
             if (!parseValue(val))
                 return Encode::undefined();
             array->arraySet(index, val);
@@ -601,10 +718,13 @@ bool JsonParser::parseString(QString *string)
 {
     BEGIN << "parse string stringPos=" << json;
 
+    // characters up to the next escape are appended in one go
+    const QChar *run = json;
     while (json < end) {
         if (*json == '"')
             break;
         else if (*json == '\\') {
+            string->append(run, int(json - run));
             uint ch = 0;
             if (!scanEscapeSequence(json, end, &ch)) {
                 lastError = QJsonParseError::IllegalEscapeSequence;
@@ -616,15 +736,16 @@ bool JsonParser::parseString(QString *string)
             } else {
                 *string += QChar(ch);
             }
+            run = json;
         } else {
             if (json->unicode() <= 0x1f) {
                 lastError = QJsonParseError::IllegalEscapeSequence;
                 return false;
             }
-            *string += *json;
             ++json;
         }
     }
+    string->append(run, int(json - run));
     ++json;
 
     if (json > end) {
@@ -639,7 +760,8 @@ bool JsonParser::parseString(QString *string)
 
 struct Stringify
 {
-    ExecutionContext *ctx;
+    ExecutionEngine *engine;
+    String *toJSON;
     FunctionObject *replacerFunction;
     // ### GC
     QVector<Heap::String *> propertyList;
@@ -649,78 +771,162 @@ struct Stringify
     // ### GC
     QStack<Heap::Object *> stack;
 
-    Stringify(ExecutionContext *ctx) : ctx(ctx), replacerFunction(0) {}
-
-    QString Str(const QString &key, ValueRef v);
-    QString JA(ArrayObject *a);
-    QString JO(Object *o);
+    // All output is appended to one buffer. With a UTF-8 sink set, the buffer
+    // is converted and handed to the sink whenever it grows past ChunkSize.
+    QString out;
+    QIODevice *device;
+    QByteArray *utf8;
+    bool sinkFailed;
+
+    // bumped whenever script code may have run and changed the objects being
+    // serialized, so that the fast paths re-validate their assumptions
+    uint scriptCalls;
+
+    enum { ChunkSize = 16 * 1024 };
+
+    Stringify(ExecutionEngine *engine, String *toJSON)
+        : engine(engine), toJSON(toJSON), replacerFunction(0)
+        , device(0), utf8(0), sinkFailed(false), scriptCalls(0)
+    {}
+
+    bool Str(const QString &key, ValueRef v);
+    void JA(ArrayObject *a);
+    void JO(Object *o);
+
+    ReturnedValue resolve(const QString *key, uint index, ValueRef v);
+    void write(ValueRef value);
+    void writeMember(const QString &key, ValueRef v, bool *empty);
+
+    void quote(const QString &str);
+    void appendInt(int i);
+    void appendNumber(double d);
+    void newline() {
+        if (!gap.isEmpty()) {
+            out += QLatin1Char('\n');
+            out += indent;
+        }
+    }
 
-    QString makeMember(const QString &key, ValueRef v);
+    void flush(bool final);
+    void maybeFlush() {
+        if ((device || utf8) && out.size() >= ChunkSize)
+            flush(false);
+    }
 };
 
-static QString quote(const QString &str)
+static inline bool isSerializable(const ValueRef v)
+{
+    return v->isNull() || v->isBoolean() || v->isString() || v->isNumber()
+            || (v->isObject() && !v->asFunctionObject());
+}
+
+void Stringify::quote(const QString &str)
 {
-    QString product = QStringLiteral("\"");
-    for (int i = 0; i < str.length(); ++i) {
-        QChar c = str.at(i);
-        switch (c.unicode()) {
+    out += QLatin1Char('"');
+    const QChar *run = str.constData();
+    const QChar *end = run + str.length();
+    for (const QChar *c = run; c != end; ++c) {
+        const ushort u = c->unicode();
+        if (u >= 0x20 && u != '"' && u != '\\')
+            continue;
+        out.append(run, int(c - run));
+        run = c + 1;
+        switch (u) {
         case '"':
-            product += QStringLiteral("\\\"");
+            out += QLatin1String("\\\"");
             break;
         case '\\':
-            product += QStringLiteral("\\\\");
+            out += QLatin1String("\\\\");
             break;
         case '\b':
-            product += QStringLiteral("\\b");
+            out += QLatin1String("\\b");
             break;
         case '\f':
-            product += QStringLiteral("\\f");
+            out += QLatin1String("\\f");
             break;
         case '\n':
-            product += QStringLiteral("\\n");
+            out += QLatin1String("\\n");
             break;
         case '\r':
-            product += QStringLiteral("\\r");
+            out += QLatin1String("\\r");
             break;
         case '\t':
-            product += QStringLiteral("\\t");
+            out += QLatin1String("\\t");
             break;
         default:
-            if (c.unicode() <= 0x1f) {
-                product += QStringLiteral("\\u00");
-                product += c.unicode() > 0xf ? QLatin1Char('1') : QLatin1Char('0');
-                product += QLatin1Char("0123456789abcdef"[c.unicode() & 0xf]);
-            } else {
-                product += c;
-            }
+            out += QLatin1String("\\u00");
+            out += u > 0xf ? QLatin1Char('1') : QLatin1Char('0');
+            out += QLatin1Char("0123456789abcdef"[u & 0xf]);
         }
     }
-    product += QLatin1Char('"');
-    return product;
+    out.append(run, int(end - run));
+    out += QLatin1Char('"');
 }
 
-QString Stringify::Str(const QString &key, ValueRef v)
+void Stringify::appendInt(int i)
 {
-    Scope scope(ctx);
+    char buffer[12];
+    char *p = buffer + sizeof(buffer);
+    uint u = i < 0 ? 0u - uint(i) : uint(i);
+    do {
+        *--p = char('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (i < 0)
+        *--p = '-';
+    out += QLatin1String(p, int(buffer + sizeof(buffer) - p));
+}
+
+void Stringify::appendNumber(double d)
+{
+    if (!std::isfinite(d)) {
+        out += QLatin1String("null");
+        return;
+    }
+    char buffer[100];
+    double_conversion::StringBuilder builder(buffer, sizeof(buffer));
+    double_conversion::DoubleToStringConverter::EcmaScriptConverter().ToShortest(d, &builder);
+    out += QLatin1String(builder.Finalize());
+}
+
+void Stringify::flush(bool final)
+{
+    int n = out.size();
+    // never split a surrogate pair between two chunks
+    if (!final && n && out.at(n - 1).isHighSurrogate())
+        --n;
+    const QByteArray chunk = out.leftRef(n).toUtf8();
+    if (utf8)
+        utf8->append(chunk);
+    else if (device && !sinkFailed && device->write(chunk) != chunk.size())
+        sinkFailed = true;
+    out.remove(0, n);
+}
+
+ReturnedValue Stringify::resolve(const QString *key, uint index, ValueRef v)
+{
+    Scope scope(engine);
 
     ScopedValue value(scope, *v);
     ScopedObject o(scope, value);
     if (o) {
-        ScopedString s(scope, ctx->d()->engine->newString(QStringLiteral("toJSON")));
-        ScopedFunctionObject toJSON(scope, o->get(s));
-        if (!!toJSON) {
+        // the lookup may run a getter
+        ++scriptCalls;
+        ScopedFunctionObject toJSONFunction(scope, o->get(toJSON));
+        if (!!toJSONFunction) {
             ScopedCallData callData(scope, 1);
             callData->thisObject = value;
-            callData->args[0] = ctx->d()->engine->newString(key);
-            value = toJSON->call(callData);
+            callData->args[0] = engine->newString(key ? *key : QString::number(index));
+            value = toJSONFunction->call(callData);
         }
     }
 
     if (replacerFunction) {
-        ScopedObject holder(scope, ctx->d()->engine->newObject());
+        ++scriptCalls;
+        ScopedObject holder(scope, engine->newObject());
         holder->put(scope.engine, QString(), value);
         ScopedCallData callData(scope, 2);
-        callData->args[0] = ctx->d()->engine->newString(key);
+        callData->args[0] = engine->newString(key ? *key : QString::number(index));
         callData->args[1] = value;
         callData->thisObject = holder;
         value = replacerFunction->call(callData);
@@ -736,146 +942,199 @@ QString Stringify::Str(const QString &key, ValueRef v)
             value = b->value();
     }
 
-    if (value->isNull())
-        return QStringLiteral("null");
-    if (value->isBoolean())
-        return value->booleanValue() ? QStringLiteral("true") : QStringLiteral("false");
-    if (value->isString())
-        return quote(value->stringValue()->toQString());
-
-    if (value->isNumber()) {
-        double d = value->toNumber();
-        return std::isfinite(d) ? value->toQString() : QStringLiteral("null");
-    }
+    return value.asReturnedValue();
+}
 
-    o = value.asReturnedValue();
-    if (o) {
-        if (!o->asFunctionObject()) {
-            if (o->asArrayObject()) {
-                ScopedArrayObject a(scope, o);
-                return JA(a);
-            } else {
-                return JO(o);
-            }
+void Stringify::write(ValueRef value)
+{
+    Q_ASSERT(isSerializable(value));
+
+    if (value->isNull()) {
+        out += QLatin1String("null");
+    } else if (value->isBoolean()) {
+        out += value->booleanValue() ? QLatin1String("true") : QLatin1String("false");
+    } else if (value->isString()) {
+        quote(value->stringValue()->toQString());
+    } else if (value->isInteger()) {
+        appendInt(value->integerValue());
+    } else if (value->isNumber()) {
+        appendNumber(value->asDouble());
+    } else {
+        Scope scope(engine);
+        ScopedObject o(scope, value);
+        if (o->asArrayObject()) {
+            ScopedArrayObject a(scope, o);
+            JA(a);
+        } else {
+            JO(o);
         }
     }
+}
 
-    return QString();
+bool Stringify::Str(const QString &key, ValueRef v)
+{
+    Scope scope(engine);
+    ScopedValue value(scope, resolve(&key, 0, v));
+    if (engine->hasException || !isSerializable(value))
+        return false;
+    write(value);
+    return !engine->hasException;
 }
 
-QString Stringify::makeMember(const QString &key, ValueRef v)
+void Stringify::writeMember(const QString &key, ValueRef v, bool *empty)
 {
-    QString strP = Str(key, v);
-    if (!strP.isEmpty()) {
-        QString member = quote(key) + QLatin1Char(':');
-        if (!gap.isEmpty())
-            member += QLatin1Char(' ');
-        member += strP;
-        return member;
-    }
-    return QString();
+    Scope scope(engine);
+    ScopedValue value(scope, resolve(&key, 0, v));
+    if (!isSerializable(value))
+        return;
+
+    if (!*empty)
+        out += QLatin1Char(',');
+    *empty = false;
+    newline();
+    quote(key);
+    out += QLatin1Char(':');
+    if (!gap.isEmpty())
+        out += QLatin1Char(' ');
+    write(value);
+    maybeFlush();
+}
+
+// Plain objects without accessors or indexed properties keep all their
+// enumerable properties in the member data, in internal class order.
+static inline bool hasPlainMembers(Object *o)
+{
+    if (o->internalClass()->vtable != Object::staticVTable() || o->hasAccessorProperty())
+        return false;
+    Heap::ArrayData *arrayData = o->arrayData();
+    return !arrayData || (!arrayData->isSparse() && !arrayData->len);
 }
 
-QString Stringify::JO(Object *o)
+void Stringify::JO(Object *o)
 {
     if (stack.contains(o->d())) {
-        ctx->engine()->throwTypeError();
-        return QString();
+        engine->throwTypeError();
+        return;
     }
 
-    Scope scope(ctx);
+    Scope scope(engine);
 
-    QString result;
     stack.push(o->d());
-    QString stepback = indent;
+    const int stepback = indent.length();
     indent += gap;
 
-    QStringList partial;
-    if (propertyList.isEmpty()) {
-        ObjectIterator it(scope, o, ObjectIterator::EnumerableOnly);
-        ScopedValue name(scope);
-
-        ScopedValue val(scope);
-        while (1) {
-            name = it.nextPropertyNameAsString(val);
-            if (name->isNull())
-                break;
-            QString key = name->toQString();
-            QString member = makeMember(key, val);
-            if (!member.isEmpty())
-                partial += member;
-        }
-    } else {
+    out += QLatin1Char('{');
+    bool empty = true;
+    ScopedValue val(scope);
+    if (!propertyList.isEmpty()) {
         ScopedString s(scope);
-        for (int i = 0; i < propertyList.size(); ++i) {
+        for (int i = 0; i < propertyList.size() && !engine->hasException; ++i) {
             bool exists;
             s = propertyList.at(i);
-            ScopedValue v(scope, o->get(s, &exists));
+            val = o->get(s, &exists);
             if (!exists)
                 continue;
-            QString member = makeMember(s->toQString(), v);
-            if (!member.isEmpty())
-                partial += member;
+            writeMember(s->toQString(), val, &empty);
+        }
+    } else if (hasPlainMembers(o)) {
+        // The keys are taken from the internal class the object has now. If
+        // a toJSON or replacer call changes the object, the remaining values
+        // are looked up by name instead.
+        InternalClass *ic = o->internalClass();
+        ScopedString s(scope);
+        for (uint i = 0; i < ic->size && !engine->hasException; ++i) {
+            Identifier *id = ic->nameMap.at(i);
+            if (!id || !ic->propertyData.at(i).isEnumerable())
+                continue;
+            if (o->internalClass() == ic) {
+                val = o->propertyAt(i)->value;
+            } else {
+                s = engine->newString(id->string);
+                val = o->get(s);
+            }
+            writeMember(id->string, val, &empty);
         }
-    }
-
-    if (partial.isEmpty()) {
-        result = QStringLiteral("{}");
-    } else if (gap.isEmpty()) {
-        result = QStringLiteral("{") + partial.join(QLatin1Char(',')) + QStringLiteral("}");
     } else {
-        QString separator = QStringLiteral(",\n") + indent;
-        result = QStringLiteral("{\n") + indent + partial.join(separator) + QStringLiteral("\n") + stepback + QStringLiteral("}");
+        ObjectIterator it(scope, o, ObjectIterator::EnumerableOnly);
+        ScopedValue name(scope);
+        while (!engine->hasException) {
+            name = it.nextPropertyNameAsString(val);
+            if (name->isNull())
+                break;
+            writeMember(name->toQString(), val, &empty);
+        }
     }
 
-    indent = stepback;
+    indent.truncate(stepback);
+    if (!empty)
+        newline();
+    out += QLatin1Char('}');
     stack.pop();
-    return result;
 }
 
-QString Stringify::JA(ArrayObject *a)
+void Stringify::JA(ArrayObject *a)
 {
     if (stack.contains(a->d())) {
-        ctx->engine()->throwTypeError();
-        return QString();
+        engine->throwTypeError();
+        return;
     }
 
     Scope scope(a->engine());
 
-    QString result;
     stack.push(a->d());
-    QString stepback = indent;
+    const int stepback = indent.length();
     indent += gap;
 
-    QStringList partial;
+    out += QLatin1Char('[');
     uint len = a->getLength();
+    // Without accessors or indexed properties on the prototypes, elements
+    // are read straight from simple and packed array data.
+    uint checkedCalls = scriptCalls;
+    bool plain = !a->hasAccessorProperty() && !a->protoHasArray();
     ScopedValue v(scope);
-    for (uint i = 0; i < len; ++i) {
-        bool exists;
-        v = a->getIndexed(i, &exists);
-        if (!exists) {
-            partial += QStringLiteral("null");
+    for (uint i = 0; i < len && !engine->hasException; ++i) {
+        if (i)
+            out += QLatin1Char(',');
+        newline();
+
+        if (checkedCalls != scriptCalls) {
+            checkedCalls = scriptCalls;
+            plain = !a->hasAccessorProperty() && !a->protoHasArray();
+        }
+        Heap::ArrayData *arrayData = a->arrayData();
+        if (plain && arrayData && arrayData->isPacked() && i < arrayData->len && !replacerFunction) {
+            Heap::PackedArrayData *pa = static_cast<Heap::PackedArrayData *>(arrayData);
+            if (pa->type == Heap::ArrayData::PackedInt32)
+                appendInt(pa->int32Data()[i]);
+            else
+                appendNumber(pa->doubleData()[i]);
+            maybeFlush();
             continue;
         }
-        QString strP = Str(QString::number(i), v);
-        if (!strP.isEmpty())
-            partial += strP;
-        else
-            partial += QStringLiteral("null");
-    }
+        if (plain && (!arrayData || (arrayData->type == Heap::ArrayData::Simple && !arrayData->attrs))) {
+            if (arrayData && i < arrayData->len)
+                v = static_cast<Heap::SimpleArrayData *>(arrayData)->data(i);
+            else
+                v = Primitive::emptyValue();
+            if (v->isEmpty())
+                v = Primitive::undefinedValue();
+        } else {
+            v = a->getIndexed(i);
+        }
 
-    if (partial.isEmpty()) {
-        result = QStringLiteral("[]");
-    } else if (gap.isEmpty()) {
-        result = QStringLiteral("[") + partial.join(QLatin1Char(',')) + QStringLiteral("]");
-    } else {
-        QString separator = QStringLiteral(",\n") + indent;
-        result = QStringLiteral("[\n") + indent + partial.join(separator) + QStringLiteral("\n") + stepback + QStringLiteral("]");
+        v = resolve(0, i, v);
+        if (isSerializable(v))
+            write(v);
+        else
+            out += QLatin1String("null");
+        maybeFlush();
     }
 
-    indent = stepback;
+    indent.truncate(stepback);
+    if (len)
+        newline();
+    out += QLatin1Char(']');
     stack.pop();
-    return result;
 }
 
 
@@ -912,7 +1171,8 @@ ReturnedValue JsonObject::method_stringify(CallContext *ctx)
 {
     Scope scope(ctx);
 
-    Stringify stringify(ctx);
+    ScopedString toJSON(scope, scope.engine->newString(QStringLiteral("toJSON")));
+    Stringify stringify(scope.engine, toJSON);
 
     ScopedObject o(scope, ctx->argument(1));
     if (o) {
@@ -947,10 +1207,48 @@ ReturnedValue JsonObject::method_stringify(CallContext *ctx)
 
 
     ScopedValue arg0(scope, ctx->argument(0));
-    QString result = stringify.Str(QString(), arg0);
-    if (result.isEmpty() || scope.engine->hasException)
+    if (!stringify.Str(QString(), arg0))
         return Encode::undefined();
-    return ctx->d()->engine->newString(result)->asReturnedValue();
+    return ctx->d()->engine->newString(stringify.out)->asReturnedValue();
+}
+
+QString JsonObject::stringify(ExecutionEngine *engine, const ValueRef value, const QString &gap)
+{
+    Scope scope(engine);
+    ScopedString toJSON(scope, engine->newString(QStringLiteral("toJSON")));
+    Stringify stringify(engine, toJSON);
+    stringify.gap = gap.left(10);
+    if (!stringify.Str(QString(), value))
+        return QString();
+    return stringify.out;
+}
+
+bool JsonObject::stringify(ExecutionEngine *engine, const ValueRef value, QIODevice *device, const QString &gap)
+{
+    Q_ASSERT(device);
+    Scope scope(engine);
+    ScopedString toJSON(scope, engine->newString(QStringLiteral("toJSON")));
+    Stringify stringify(engine, toJSON);
+    stringify.gap = gap.left(10);
+    stringify.device = device;
+    if (!stringify.Str(QString(), value))
+        return false;
+    stringify.flush(true);
+    return !stringify.sinkFailed;
+}
+
+QByteArray JsonObject::stringifyToUtf8(ExecutionEngine *engine, const ValueRef value, const QString &gap)
+{
+    QByteArray result;
+    Scope scope(engine);
+    ScopedString toJSON(scope, engine->newString(QStringLiteral("toJSON")));
+    Stringify stringify(engine, toJSON);
+    stringify.gap = gap.left(10);
+    stringify.utf8 = &result;
+    if (!stringify.Str(QString(), value))
+        return QByteArray();
+    stringify.flush(true);
+    return result;
 }
 
 
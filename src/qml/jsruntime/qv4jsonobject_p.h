@@ -40,6 +40,8 @@
 
 QT_BEGIN_NAMESPACE
 
+class QIODevice;
+
 namespace QV4 {
 
 namespace Heap {
@@ -50,7 +52,7 @@ struct JsonObject : Object {
 
 }
 
-struct JsonObject : Object {
+struct Q_QML_EXPORT JsonObject : Object {
     Q_MANAGED_TYPE(JsonObject)
     V4_OBJECT2(JsonObject, Object)
 private:
@@ -61,6 +63,14 @@ public:
     static ReturnedValue method_parse(CallContext *ctx);
     static ReturnedValue method_stringify(CallContext *ctx);
 
+    // JSON.stringify for C++ callers. gap is the indentation string as passed
+    // to JSON.stringify. The result is empty, or false, if the value cannot be
+    // serialized or an exception was thrown. The device and byte array
+    // variants write UTF-8 in chunks, without building the whole text first.
+    static QString stringify(ExecutionEngine *engine, const ValueRef value, const QString &gap = QString());
+    static bool stringify(ExecutionEngine *engine, const ValueRef value, QIODevice *device, const QString &gap = QString());
+    static QByteArray stringifyToUtf8(ExecutionEngine *engine, const ValueRef value, const QString &gap = QString());
+
     static ReturnedValue fromJsonValue(ExecutionEngine *engine, const QJsonValue &value);
     static ReturnedValue fromJsonObject(ExecutionEngine *engine, const QJsonObject &object);
     static ReturnedValue fromJsonArray(ExecutionEngine *engine, const QJsonArray &array);
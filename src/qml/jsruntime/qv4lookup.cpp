@@ -33,16 +33,145 @@
 #include "qv4lookup_p.h"
 #include "qv4functionobject_p.h"
 #include "qv4scopedvalue_p.h"
+#include "qv4compileddata_p.h"
+
+#include <QtCore/qdebug.h>
 
 QT_BEGIN_NAMESPACE
 
 using namespace QV4;
 
+namespace {
+
+bool lookupStatisticsEnabled()
+{
+    static const bool enabled = !qgetenv("QV4_LOOKUP_STATS").isEmpty();
+    return enabled;
+}
+
+MegamorphicLookupCache *megamorphicLookupCache(ExecutionEngine *engine)
+{
+    if (!engine->megamorphicLookupCache)
+        engine->megamorphicLookupCache = new MegamorphicLookupCache;
+    return engine->megamorphicLookupCache;
+}
+
+// Runs a lookup of l's name on a scratch Lookup, so that the state of l is left
+// alone. The probe's getter tells whether the property can be cached by class.
+ReturnedValue probeLookup(Lookup *l, Object *o, Lookup *probe)
+{
+    *probe = *l;
+    probe->getter = 0;
+    return o->getLookup(probe);
+}
+
+bool isCacheableProbe(const Lookup &probe)
+{
+    return probe.getter == Lookup::getter0 || probe.getter == Lookup::getter1;
+}
+
+inline ReturnedValue cachedValue(Heap::Object *o, InternalClass *protoClass, uint index)
+{
+    if (!protoClass)
+        return o->memberData->data[index].asReturnedValue();
+    return o->prototype->memberData->data[index].asReturnedValue();
+}
+
+void switchToMegamorphic(Lookup *l, ExecutionEngine *engine)
+{
+    delete l->polymorphicCache;
+    l->polymorphicCache = 0;
+    l->getter = Lookup::getterMegamorphic;
+    ++megamorphicLookupCache(engine)->megamorphicSites;
+    if (lookupStatisticsEnabled()) {
+        Heap::ExecutionContext *context = engine->currentContext();
+        qDebug() << "Lookup of" << context->compilationUnit->runtimeString(l->nameIndex)->toQString()
+                 << "went megamorphic at" << context->compilationUnit->fileName() << "line" << context->lineNumber;
+    }
+}
+
+// Replaces the monomorphic or two class state of l with a polymorphic cache,
+// seeded with the classes l already knows about and with the class of the lookup
+// that was just resolved, if any.
+void switchToPolymorphic(Lookup *l, ExecutionEngine *engine, const Lookup *resolved)
+{
+    Lookup::PolymorphicCache *cache = new Lookup::PolymorphicCache;
+    cache->count = 0;
+    Lookup::PolymorphicCache::Entry *entries = cache->entries;
+    if (l->getter == Lookup::getter0) {
+        Lookup::PolymorphicCache::Entry e = { l->classList[0], 0, l->index };
+        entries[cache->count++] = e;
+    } else if (l->getter == Lookup::getter1) {
+        Lookup::PolymorphicCache::Entry e = { l->classList[0], l->classList[1], l->index };
+        entries[cache->count++] = e;
+    } else if (l->getter == Lookup::getter0getter0
+               || l->getter == Lookup::getter0getter1
+               || l->getter == Lookup::getter1getter1) {
+        Lookup::PolymorphicCache::Entry e1 = { l->classList[0], l->getter == Lookup::getter1getter1 ? l->classList[1] : 0, l->index };
+        Lookup::PolymorphicCache::Entry e2 = { l->classList[2], l->getter == Lookup::getter0getter0 ? 0 : l->classList[3], l->index2 };
+        entries[cache->count++] = e1;
+        entries[cache->count++] = e2;
+    }
+    if (resolved && isCacheableProbe(*resolved)) {
+        Lookup::PolymorphicCache::Entry e = { resolved->classList[0], resolved->getter == Lookup::getter1 ? resolved->classList[1] : 0, resolved->index };
+        entries[cache->count++] = e;
+    }
+
+    l->polymorphicCache = cache;
+    l->lookupName = engine->currentContext()->compilationUnit->runtimeString(l->nameIndex)->identifier;
+    l->getter = Lookup::getterPolymorphic;
+    ++megamorphicLookupCache(engine)->polymorphicSites;
+}
+
+// Miss path of the monomorphic and two class getters. The property is resolved
+// only once, accessors must not run a second time through getterPolymorphic.
+ReturnedValue resolvePolymorphic(Lookup *l, ExecutionEngine *engine, const ValueRef object)
+{
+    Object *o = object->asObject();
+    if (!o) {
+        switchToPolymorphic(l, engine, 0);
+        return Lookup::getterFallback(l, engine, object);
+    }
+
+    Lookup probe;
+    ReturnedValue v = probeLookup(l, o, &probe);
+    switchToPolymorphic(l, engine, &probe);
+    return v;
+}
+
+}
+
+MegamorphicLookupCache::MegamorphicLookupCache()
+    : polymorphicSites(0)
+    , megamorphicSites(0)
+    , hits(0)
+    , misses(0)
+{
+    memset(entries, 0, sizeof(entries));
+}
+
+MegamorphicLookupCache::~MegamorphicLookupCache()
+{
+    if (lookupStatisticsEnabled()) {
+        qDebug() << "Lookup statistics:" << polymorphicSites << "polymorphic sites,"
+                 << megamorphicSites << "megamorphic sites," << hits << "stub cache hits,"
+                 << misses << "stub cache misses";
+    }
+}
+
+void Lookup::releaseLookups(Lookup *lookups, uint count)
+{
+    for (uint i = 0; i < count; ++i) {
+        if (lookups[i].getter == getterPolymorphic)
+            delete lookups[i].polymorphicCache;
+    }
+}
+
 
 ReturnedValue Lookup::lookup(ValueRef thisObject, Object *o, PropertyAttributes *attrs)
 {
     ExecutionEngine *engine = o->engine();
-    Identifier *name = engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]->identifier;
+    Identifier *name = engine->currentContext()->compilationUnit->runtimeString(nameIndex)->identifier;
     int i = 0;
     Heap::Object *obj = o->d();
     while (i < Size && obj) {
@@ -76,7 +205,7 @@ ReturnedValue Lookup::lookup(Object *thisObject, PropertyAttributes *attrs)
 {
     Heap::Object *obj = thisObject->d();
     ExecutionEngine *engine = thisObject->engine();
-    Identifier *name = engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]->identifier;
+    Identifier *name = engine->currentContext()->compilationUnit->runtimeString(nameIndex)->identifier;
     int i = 0;
     while (i < Size && obj) {
         classList[i] = obj->internalClass;
@@ -172,6 +301,10 @@ ReturnedValue Lookup::indexedGetterObjectInt(Lookup *l, const ValueRef object, c
         if (idx < s->len)
             if (!s->data(idx).isEmpty())
                 return s->data(idx).asReturnedValue();
+    } else if (o->d()->arrayData && o->d()->arrayData->isPacked()) {
+        Heap::PackedArrayData *p = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+        if (idx < p->len)
+            return p->data(idx);
     }
 
     return indexedGetterFallback(l, object, index);
@@ -181,7 +314,8 @@ void Lookup::indexedSetterGeneric(Lookup *l, const ValueRef object, const ValueR
 {
     if (object->isObject()) {
         Object *o = object->objectValue();
-        if (o->d()->arrayData && o->d()->arrayData->type == Heap::ArrayData::Simple && index->asArrayIndex() < UINT_MAX) {
+        if (o->d()->arrayData && (o->d()->arrayData->type == Heap::ArrayData::Simple || o->d()->arrayData->isPacked())
+                && index->asArrayIndex() < UINT_MAX) {
             l->indexedSetter = indexedSetterObjectInt;
             indexedSetterObjectInt(l, object, index, v);
             return;
@@ -203,6 +337,13 @@ void Lookup::indexedSetterFallback(Lookup *l, const ValueRef object, const Value
             Heap::SimpleArrayData *s = static_cast<Heap::SimpleArrayData *>(o->d()->arrayData);
             if (idx < s->len) {
                 s->data(idx) = value;
+                o->d()->writeBarrier();
+                return;
+            }
+        } else if (o->d()->arrayData && o->d()->arrayData->isPacked()) {
+            Heap::PackedArrayData *p = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+            if (idx < p->len && (value->isInteger() || (value->isNumber() && p->type == Heap::ArrayData::PackedDouble))) {
+                p->setData(idx, *value);
                 return;
             }
         }
@@ -227,6 +368,13 @@ void Lookup::indexedSetterObjectInt(Lookup *l, const ValueRef object, const Valu
         Heap::SimpleArrayData *s = static_cast<Heap::SimpleArrayData *>(o->d()->arrayData);
         if (idx < s->len) {
             s->data(idx) = v;
+            o->d()->writeBarrier();
+            return;
+        }
+    } else if (o->d()->arrayData && o->d()->arrayData->isPacked()) {
+        Heap::PackedArrayData *p = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+        if (idx < p->len && (v->isInteger() || (v->isNumber() && p->type == Heap::ArrayData::PackedDouble))) {
+            p->setData(idx, *v);
             return;
         }
     }
@@ -250,7 +398,7 @@ ReturnedValue Lookup::getterGeneric(Lookup *l, ExecutionEngine *engine, const Va
         Q_ASSERT(object->isString());
         proto = engine->stringPrototype.asObject();
         Scope scope(engine);
-        ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+        ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
         if (name->equals(engine->id_length)) {
             // special case, as the property is on the object itself
             l->getter = stringLengthGetter;
@@ -315,7 +463,12 @@ ReturnedValue Lookup::getterTwoClasses(Lookup *l, ExecutionEngine *engine, const
                 }
                 return v;
             }
+            // Restore the state the polymorphic cache gets seeded from.
+            *l = l1;
+            switchToPolymorphic(l, engine, &l2);
+            return v;
         }
+        return resolvePolymorphic(l, engine, object);
     }
 
     l->getter = getterFallback;
@@ -328,10 +481,77 @@ ReturnedValue Lookup::getterFallback(Lookup *l, ExecutionEngine *engine, const V
     QV4::ScopedObject o(scope, object->toObject(scope.engine));
     if (!o)
         return Encode::undefined();
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
     return o->get(name);
 }
 
+ReturnedValue Lookup::getterPolymorphic(Lookup *l, ExecutionEngine *engine, const ValueRef object)
+{
+    if (object->isManaged()) {
+        // we can safely cast to a QV4::Object here. If object is actually a string,
+        // the internal class won't match
+        Heap::Object *o = object->objectValue()->d();
+        const PolymorphicCache *cache = l->polymorphicCache;
+        for (int i = 0; i < cache->count; ++i) {
+            const PolymorphicCache::Entry &e = cache->entries[i];
+            if (e.objectClass == o->internalClass
+                && (!e.protoClass || (o->prototype && e.protoClass == o->prototype->internalClass)))
+                return cachedValue(o, e.protoClass, e.index);
+        }
+    }
+
+    Object *o = object->asObject();
+    if (!o)
+        return getterFallback(l, engine, object);
+
+    Lookup probe;
+    ReturnedValue v = probeLookup(l, o, &probe);
+    if (!isCacheableProbe(probe))
+        return v;
+
+    PolymorphicCache *cache = l->polymorphicCache;
+    if (cache->count < PolymorphicCache::Size) {
+        PolymorphicCache::Entry e = { probe.classList[0], probe.getter == getter1 ? probe.classList[1] : 0, probe.index };
+        cache->entries[cache->count++] = e;
+        return v;
+    }
+
+    switchToMegamorphic(l, engine);
+    return getterMegamorphic(l, engine, object);
+}
+
+ReturnedValue Lookup::getterMegamorphic(Lookup *l, ExecutionEngine *engine, const ValueRef object)
+{
+    MegamorphicLookupCache *cache = engine->megamorphicLookupCache;
+    if (object->isManaged()) {
+        // we can safely cast to a QV4::Object here. If object is actually a string,
+        // the internal class won't match
+        Heap::Object *o = object->objectValue()->d();
+        const MegamorphicLookupCache::Entry &e = cache->entries[MegamorphicLookupCache::hash(o->internalClass, l->lookupName)];
+        if (e.objectClass == o->internalClass && e.name == l->lookupName
+            && (!e.protoClass || (o->prototype && e.protoClass == o->prototype->internalClass))) {
+            ++cache->hits;
+            return cachedValue(o, e.protoClass, e.index);
+        }
+    }
+    ++cache->misses;
+
+    Object *o = object->asObject();
+    if (!o)
+        return getterFallback(l, engine, object);
+
+    Lookup probe;
+    ReturnedValue v = probeLookup(l, o, &probe);
+    if (isCacheableProbe(probe)) {
+        MegamorphicLookupCache::Entry &e = cache->entries[MegamorphicLookupCache::hash(probe.classList[0], l->lookupName)];
+        e.objectClass = probe.classList[0];
+        e.name = l->lookupName;
+        e.protoClass = probe.getter == getter1 ? probe.classList[1] : 0;
+        e.index = probe.index;
+    }
+    return v;
+}
+
 ReturnedValue Lookup::getter0(Lookup *l, ExecutionEngine *engine, const ValueRef object)
 {
     if (object->isManaged()) {
@@ -372,8 +592,7 @@ ReturnedValue Lookup::getter2(Lookup *l, ExecutionEngine *engine, const ValueRef
             }
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0getter0(Lookup *l, ExecutionEngine *engine, const ValueRef object)
@@ -387,8 +606,7 @@ ReturnedValue Lookup::getter0getter0(Lookup *l, ExecutionEngine *engine, const V
         if (l->classList[2] == o->internalClass())
             return o->memberData()->data[l->index2].asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter0getter1(Lookup *l, ExecutionEngine *engine, const ValueRef object)
@@ -403,8 +621,7 @@ ReturnedValue Lookup::getter0getter1(Lookup *l, ExecutionEngine *engine, const V
             l->classList[3] == o->prototype()->internalClass)
             return o->prototype()->memberData->data[l->index2].asReturnedValue();
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getter1getter1(Lookup *l, ExecutionEngine *engine, const ValueRef object)
@@ -419,10 +636,8 @@ ReturnedValue Lookup::getter1getter1(Lookup *l, ExecutionEngine *engine, const V
         if (l->classList[2] == o->internalClass() &&
             l->classList[3] == o->prototype()->internalClass)
             return o->prototype()->memberData->data[l->index2].asReturnedValue();
-        return getterFallback(l, engine, object);
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 
@@ -443,8 +658,7 @@ ReturnedValue Lookup::getterAccessor0(Lookup *l, ExecutionEngine *engine, const
             return getter->call(callData);
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getterAccessor1(Lookup *l, ExecutionEngine *engine, const ValueRef object)
@@ -465,8 +679,7 @@ ReturnedValue Lookup::getterAccessor1(Lookup *l, ExecutionEngine *engine, const
             return getter->call(callData);
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::getterAccessor2(Lookup *l, ExecutionEngine *engine, const ValueRef object)
@@ -492,8 +705,7 @@ ReturnedValue Lookup::getterAccessor2(Lookup *l, ExecutionEngine *engine, const
             }
         }
     }
-    l->getter = getterFallback;
-    return getterFallback(l, engine, object);
+    return resolvePolymorphic(l, engine, object);
 }
 
 ReturnedValue Lookup::primitiveGetter0(Lookup *l, ExecutionEngine *engine, const ValueRef object)
@@ -602,7 +814,7 @@ ReturnedValue Lookup::globalGetterGeneric(Lookup *l, ExecutionEngine *engine)
         }
     }
     Scope scope(engine);
-    ScopedString n(scope, engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+    ScopedString n(scope, engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
     return engine->throwReferenceError(n);
 }
 
@@ -709,7 +921,7 @@ void Lookup::setterGeneric(Lookup *l, ExecutionEngine *engine, const ValueRef ob
         o = RuntimeHelpers::convertToObject(scope.engine, object);
         if (!o) // type error
             return;
-        ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+        ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
         o->put(name, value);
         return;
     }
@@ -740,7 +952,7 @@ void Lookup::setterFallback(Lookup *l, ExecutionEngine *engine, const ValueRef o
     QV4::Scope scope(engine);
     QV4::ScopedObject o(scope, object->toObject(scope.engine));
     if (o) {
-        ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+        ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
         o->put(name, value);
     }
 }
@@ -750,6 +962,7 @@ void Lookup::setter0(Lookup *l, ExecutionEngine *engine, const ValueRef object,
     Object *o = static_cast<Object *>(object->asManaged());
     if (o && o->internalClass() == l->classList[0]) {
         o->memberData()->data[l->index] = *value;
+        o->d()->writeBarrier();
         return;
     }
 
@@ -764,6 +977,7 @@ void Lookup::setterInsert0(Lookup *l, ExecutionEngine *engine, const ValueRef ob
             if (!o->memberData() || l->index >= o->memberData()->size)
                 o->ensureMemberIndex(l->index);
             o->memberData()->data[l->index] = *value;
+            o->d()->writeBarrier();
             o->setInternalClass(l->classList[3]);
             return;
         }
@@ -782,6 +996,7 @@ void Lookup::setterInsert1(Lookup *l, ExecutionEngine *engine, const ValueRef ob
             if (!o->memberData() || l->index >= o->memberData()->size)
                 o->ensureMemberIndex(l->index);
             o->memberData()->data[l->index] = *value;
+            o->d()->writeBarrier();
             o->setInternalClass(l->classList[3]);
             return;
         }
@@ -802,6 +1017,7 @@ void Lookup::setterInsert2(Lookup *l, ExecutionEngine *engine, const ValueRef ob
                 if (!o->memberData() || l->index >= o->memberData()->size)
                     o->ensureMemberIndex(l->index);
                 o->memberData()->data[l->index] = *value;
+                o->d()->writeBarrier();
                 o->setInternalClass(l->classList[3]);
                 return;
             }
@@ -818,10 +1034,12 @@ void Lookup::setter0setter0(Lookup *l, ExecutionEngine *engine, const ValueRef o
     if (o) {
         if (o->internalClass() == l->classList[0]) {
             o->memberData()->data[l->index] = *value;
+            o->d()->writeBarrier();
             return;
         }
         if (o->internalClass() == l->classList[1]) {
             o->memberData()->data[l->index2] = *value;
+            o->d()->writeBarrier();
             return;
         }
     }
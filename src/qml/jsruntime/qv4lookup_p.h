@@ -46,6 +46,20 @@ namespace QV4 {
 
 struct Lookup {
     enum { Size = 4 };
+
+    // Shapes seen by a getter that went beyond two classes. Only data properties
+    // of the object itself or of its direct prototype are cached.
+    struct PolymorphicCache {
+        enum { Size = 8 };
+        struct Entry {
+            InternalClass *objectClass;
+            InternalClass *protoClass; // 0 for properties of the object itself
+            uint index;
+        };
+        Entry entries[Size];
+        int count;
+    };
+
     union {
         ReturnedValue (*indexedGetter)(Lookup *l, const ValueRef object, const ValueRef index);
         void (*indexedSetter)(Lookup *l, const ValueRef object, const ValueRef index, const ValueRef v);
@@ -62,6 +76,10 @@ struct Lookup {
             Object *proto;
             unsigned type;
         };
+        struct {
+            PolymorphicCache *polymorphicCache;
+            Identifier *lookupName;
+        };
     };
     union {
         int level;
@@ -81,6 +99,8 @@ struct Lookup {
     static ReturnedValue getterGeneric(Lookup *l, ExecutionEngine *engine, const ValueRef object);
     static ReturnedValue getterTwoClasses(Lookup *l, ExecutionEngine *engine, const ValueRef object);
     static ReturnedValue getterFallback(Lookup *l, ExecutionEngine *engine, const ValueRef object);
+    static ReturnedValue getterPolymorphic(Lookup *l, ExecutionEngine *engine, const ValueRef object);
+    static ReturnedValue getterMegamorphic(Lookup *l, ExecutionEngine *engine, const ValueRef object);
 
     static ReturnedValue getter0(Lookup *l, ExecutionEngine *engine, const ValueRef object);
     static ReturnedValue getter1(Lookup *l, ExecutionEngine *engine, const ValueRef object);
@@ -119,6 +139,35 @@ struct Lookup {
     ReturnedValue lookup(ValueRef thisObject, Object *obj, PropertyAttributes *attrs);
     ReturnedValue lookup(Object *obj, PropertyAttributes *attrs);
 
+    static void releaseLookups(Lookup *lookups, uint count);
+};
+
+// Per engine stub cache shared by all megamorphic lookup sites, keyed by
+// (InternalClass, Identifier). Also keeps the statistics of polymorphic and
+// megamorphic sites, printed on destruction when QV4_LOOKUP_STATS is set.
+struct MegamorphicLookupCache {
+    enum { Size = 1024 };
+    struct Entry {
+        InternalClass *objectClass;
+        Identifier *name;
+        InternalClass *protoClass; // 0 for properties of the object itself
+        uint index;
+    };
+
+    MegamorphicLookupCache();
+    ~MegamorphicLookupCache();
+
+    static uint hash(InternalClass *objectClass, Identifier *name)
+    {
+        return ((quintptr(objectClass) >> 4) ^ (quintptr(name) >> 4)) & (Size - 1);
+    }
+
+    Entry entries[Size];
+
+    uint polymorphicSites;
+    uint megamorphicSites;
+    quint64 hits;
+    quint64 misses;
 };
 
 }
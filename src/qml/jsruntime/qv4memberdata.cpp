@@ -52,7 +52,9 @@ Heap::MemberData *MemberData::reallocate(ExecutionEngine *e, Heap::MemberData *o
         return old;
 
     int newAlloc = qMax((uint)4, 2*idx);
-    uint alloc = sizeof(Heap::MemberData) + (newAlloc)*sizeof(Value);
+    uint alloc = MemoryManager::align(sizeof(Heap::MemberData) + (newAlloc)*sizeof(Value));
+    // make use of the space the rounding to the slot size adds
+    newAlloc = (alloc - sizeof(Heap::MemberData)) / sizeof(Value);
     Scope scope(e);
     Scoped<MemberData> newMemberData(scope, static_cast<Heap::MemberData *>(e->memoryManager->allocManaged(alloc)));
     if (old)
@@ -41,9 +41,13 @@
 #include "StdLibExtras.h"
 
 #include <QTime>
-#include <QVector>
+#include <QElapsedTimer>
 #include <QVector>
 #include <QMap>
+#include <QHash>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 
 #include <iostream>
 #include <cstdlib>
@@ -74,15 +78,15 @@ struct MemoryManager::Data
     bool gcBlocked;
     bool aggressiveGC;
     bool gcStats;
+    bool generational;
+    bool markingInProgress;
+    bool parallelSweep;
+    bool allocationTracking;
     ExecutionEngine *engine;
 
-    enum { MaxItemSize = 512 };
-    Heap::Base *smallItems[MaxItemSize/16];
-    uint nChunks[MaxItemSize/16];
-    uint availableItems[MaxItemSize/16];
-    uint allocCount[MaxItemSize/16];
+    uint nChunks[MemoryManager::NumSizeClasses];
+    uint availableItems[MemoryManager::NumSizeClasses];
     int totalItems;
-    int totalAlloc;
     uint maxShift;
     std::size_t maxChunkSize;
     struct Chunk {
@@ -108,28 +112,94 @@ struct MemoryManager::Data
 
     GCDeletable *deletable;
 
+    // Set while traverseHeap() is running.
+    HeapVisitor *heapVisitor;
+    QHash<const Heap::Base *, std::size_t> largeItemSizes;
+
+    // Threads sweeping chunks in parallel to the GUI thread, created on first use.
+    QScopedPointer<QThreadPool> sweepThreadPool;
+
+    // generational collection:
+    // Small items allocated since the last collection, per size class. Survivors of a collection
+    // keep their mark bit and are thereby promoted to the old generation.
+    QVector<Heap::Base *> youngItems[MemoryManager::NumSizeClasses];
+    // Old objects that had a reference stored into them since the last collection.
+    QVector<Heap::Base *> rememberedSet;
+    // Old execution contexts. Their locals are written directly by generated code without
+    // going through the write barrier, so every minor collection rescans them.
+    QVector<Heap::Base *> oldContexts;
+    uint maxMinorCollections;
+    uint minorCollectionsSinceMajor;
+    uint promotedSinceMajor;
+
+    // incremental marking:
+    // Maximum time in microseconds spent in one marking slice. Incremental marking is disabled if 0.
+    int incrementalMarkingBudget;
+    // Allocations since the allocator last ran a marking slice.
+    uint allocationsSinceSlice;
+    enum { AllocationsPerSlice = 512 };
+    // Marked objects whose children haven't been marked yet, saved between two slices.
+    QVector<Heap::Base *> greyItems;
+    // Items allocated while marking is in progress. They are considered live by the current cycle.
+    QVector<Heap::Base *> itemsAllocatedWhileMarking;
+    LargeItem *largeItemsAtMarkingStart;
+    // Execution contexts marked in a slice. Generated code writes their locals without going
+    // through the write barrier, so they are rescanned when marking finishes.
+    QVector<Heap::Base *> markedContexts;
+
     // statistics:
+    uint minorCollections;
+    uint majorCollections;
+    uint markingSlices;
+    uint incrementalCycles;
+    qint64 minorPauseTime;
+    qint64 majorPauseTime;
+    qint64 maxMinorPauseTime;
+    qint64 maxMajorPauseTime;
+    // Small items counted before the last reset of the per size class counters, and large items.
+    quint64 allocationsBeforeReset;
 #ifdef DETAILED_MM_STATS
     QVector<unsigned> allocSizeCounters;
 #endif // DETAILED_MM_STATS
 
     Data()
         : gcBlocked(false)
+        , markingInProgress(false)
+        , allocationTracking(false)
         , engine(0)
         , totalItems(0)
-        , totalAlloc(0)
         , maxShift(6)
         , maxChunkSize(32*1024)
         , largeItems(0)
         , totalLargeItemsAllocated(0)
         , deletable(0)
+        , heapVisitor(0)
+        , maxMinorCollections(8)
+        , minorCollectionsSinceMajor(0)
+        , promotedSinceMajor(0)
+        , incrementalMarkingBudget(0)
+        , allocationsSinceSlice(0)
+        , largeItemsAtMarkingStart(0)
+        , minorCollections(0)
+        , majorCollections(0)
+        , markingSlices(0)
+        , incrementalCycles(0)
+        , minorPauseTime(0)
+        , majorPauseTime(0)
+        , maxMinorPauseTime(0)
+        , maxMajorPauseTime(0)
+        , allocationsBeforeReset(0)
     {
-        memset(smallItems, 0, sizeof(smallItems));
         memset(nChunks, 0, sizeof(nChunks));
         memset(availableItems, 0, sizeof(availableItems));
-        memset(allocCount, 0, sizeof(allocCount));
         aggressiveGC = !qgetenv("QV4_MM_AGGRESSIVE_GC").isEmpty();
         gcStats = !qgetenv("QV4_MM_STATS").isEmpty();
+        generational = !qgetenv("QV4_MM_GENERATIONAL").isEmpty();
+#ifndef V4_USE_VALGRIND
+        parallelSweep = !qgetenv("QV4_MM_PARALLEL_SWEEP").isEmpty() && QThread::idealThreadCount() > 1;
+#else
+        parallelSweep = false;
+#endif
 
         QByteArray overrideMaxShift = qgetenv("QV4_MM_MAXBLOCK_SHIFT");
         bool ok;
@@ -141,10 +211,39 @@ struct MemoryManager::Data
         std::size_t tmpMaxChunkSize = maxChunkString.toUInt(&ok);
         if (ok)
             maxChunkSize = tmpMaxChunkSize;
+
+        uint tmpMaxMinorCollections = qgetenv("QV4_MM_MAX_MINOR_GC").toUInt(&ok);
+        if (ok)
+            maxMinorCollections = tmpMaxMinorCollections;
+
+        int tmpIncrementalMarkingBudget = qgetenv("QV4_MM_INCREMENTAL_BUDGET").toInt(&ok);
+        if (ok && tmpIncrementalMarkingBudget > 0)
+            incrementalMarkingBudget = tmpIncrementalMarkingBudget;
+    }
+
+    std::size_t itemSize(const Heap::Base *object) const
+    {
+        // heapChunks is sorted by address
+        const char *item = reinterpret_cast<const char *>(object);
+        int begin = 0;
+        int end = heapChunks.size();
+        while (begin < end) {
+            const int mid = (begin + end) / 2;
+            const char *chunkStart = reinterpret_cast<const char *>(heapChunks.at(mid).memory.base());
+            if (item < chunkStart)
+                end = mid;
+            else if (item >= chunkStart + heapChunks.at(mid).memory.size())
+                begin = mid + 1;
+            else
+                return heapChunks.at(mid).chunkSize;
+        }
+        return largeItemSizes.value(object);
     }
 
     ~Data()
     {
+        if (sweepThreadPool)
+            sweepThreadPool->waitForDone();
         for (QVector<Chunk>::iterator i = heapChunks.begin(), ei = heapChunks.end(); i != ei; ++i) {
             Q_V4_PROFILE_DEALLOC(engine, 0, i->memory.size(), Profiling::HeapPage);
             i->memory.deallocate();
@@ -165,13 +264,19 @@ bool operator<(const MemoryManager::Data::Chunk &a, const MemoryManager::Data::C
 namespace {
 
 struct ChunkSweepData {
-    ChunkSweepData() : tail(&head), head(0), isEmpty(true) { }
+    ChunkSweepData() : end(0), tail(&head), head(0), isEmpty(true), itemsInUse(0), freedItems(0) { }
+    // Items at and after this address have never been allocated, if non-null.
+    char *end;
     Heap::Base **tail;
     Heap::Base *head;
     bool isEmpty;
+    uint itemsInUse;
+    uint freedItems;
+    // Dead items that need their destroy function called, which has to happen on the GUI thread.
+    QVector<Heap::Base *> pendingDestruction;
 };
 
-void sweepChunk(const MemoryManager::Data::Chunk &chunk, ChunkSweepData *sweepData, uint *itemsInUse, ExecutionEngine *engine)
+void sweepChunk(const MemoryManager::Data::Chunk &chunk, ChunkSweepData *sweepData, ExecutionEngine *engine, bool keepMarks, bool deferDestruction)
 {
     char *chunkStart = reinterpret_cast<char*>(chunk.memory.base());
     std::size_t itemSize = chunk.chunkSize;
@@ -180,21 +285,29 @@ void sweepChunk(const MemoryManager::Data::Chunk &chunk, ChunkSweepData *sweepDa
 #ifdef V4_USE_VALGRIND
     VALGRIND_DISABLE_ERROR_REPORTING;
 #endif
-    for (char *item = chunkStart, *chunkEnd = item + chunk.memory.size() - itemSize; item <= chunkEnd; item += itemSize) {
+    char *chunkEnd = sweepData->end ? sweepData->end - itemSize : chunkStart + chunk.memory.size() - itemSize;
+    for (char *item = chunkStart; item <= chunkEnd; item += itemSize) {
         Heap::Base *m = reinterpret_cast<Heap::Base *>(item);
 //        qDebug("chunk @ %p, size = %lu, in use: %s, mark bit: %s",
 //               item, m->size, (m->inUse ? "yes" : "no"), (m->markBit ? "true" : "false"));
 
-        Q_ASSERT((qintptr) item % 16 == 0);
+        Q_ASSERT((qintptr) item % MemoryManager::SlotSize == 0);
 
         if (m->markBit) {
             Q_ASSERT(m->inUse);
-            m->markBit = 0;
+            if (!keepMarks)
+                m->markBit = 0;
             sweepData->isEmpty = false;
-            ++(*itemsInUse);
+            ++sweepData->itemsInUse;
         } else {
             if (m->inUse) {
 //                qDebug() << "-- collecting it." << m << sweepData->tail << m->nextFree();
+                ++sweepData->itemsInUse;
+                if (deferDestruction && m->internalClass->vtable->destroy) {
+                    // Linked into the free list by finishChunkSweep()
+                    sweepData->pendingDestruction.append(m);
+                    continue;
+                }
 #ifdef V4_USE_VALGRIND
                 VALGRIND_ENABLE_ERROR_REPORTING;
 #endif
@@ -206,8 +319,10 @@ void sweepChunk(const MemoryManager::Data::Chunk &chunk, ChunkSweepData *sweepDa
                 VALGRIND_DISABLE_ERROR_REPORTING;
                 VALGRIND_MEMPOOL_FREE(engine->memoryManager, m);
 #endif
-                Q_V4_PROFILE_DEALLOC(engine, m, itemSize, Profiling::SmallItem);
-                ++(*itemsInUse);
+                if (deferDestruction)
+                    ++sweepData->freedItems;
+                else
+                    Q_V4_PROFILE_DEALLOC(engine, m, itemSize, Profiling::SmallItem);
             }
             // Relink all free blocks to rewrite references to any released chunk.
             *sweepData->tail = m;
@@ -220,35 +335,209 @@ void sweepChunk(const MemoryManager::Data::Chunk &chunk, ChunkSweepData *sweepDa
 #endif
 }
 
+// Runs on the GUI thread after a parallel sweep.
+void finishChunkSweep(const MemoryManager::Data::Chunk &chunk, ChunkSweepData *sweepData, ExecutionEngine *engine)
+{
+    std::size_t itemSize = chunk.chunkSize;
+    for (int i = 0; i < sweepData->pendingDestruction.size(); ++i) {
+        Heap::Base *m = sweepData->pendingDestruction.at(i);
+        m->internalClass->vtable->destroy(m);
+        memset(m, 0, itemSize);
+        *sweepData->tail = m;
+        sweepData->tail = m->nextFreeRef();
+    }
+    *sweepData->tail = 0;
+
+    sweepData->freedItems += sweepData->pendingDestruction.size();
+    sweepData->pendingDestruction.clear();
+    if (sweepData->freedItems)
+        Q_V4_PROFILE_DEALLOC(engine, 0, sweepData->freedItems * itemSize, Profiling::SmallItem);
+}
+
+class ChunkSweeper : public QRunnable
+{
+public:
+    ChunkSweeper(const QVector<MemoryManager::Data::Chunk> &chunks, ChunkSweepData *sweepData,
+                 int begin, int end, bool keepMarks)
+        : chunks(chunks), sweepData(sweepData), begin(begin), end(end), keepMarks(keepMarks)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = begin; i < end; ++i)
+            sweepChunk(chunks.at(i), &sweepData[i], 0, keepMarks, /*deferDestruction*/true);
+    }
+
+private:
+    const QVector<MemoryManager::Data::Chunk> &chunks;
+    ChunkSweepData *sweepData;
+    int begin;
+    int end;
+    bool keepMarks;
+};
+
+void sweepWeakValues(MemoryManager *mm, ExecutionEngine *engine)
+{
+    PersistentValuePrivate *weak = mm->m_weakValues;
+    while (weak) {
+        if (!weak->refcount) {
+            PersistentValuePrivate *n = weak->next;
+            weak->removeFromList();
+            delete weak;
+            weak = n;
+            continue;
+        }
+        if (Managed *m = weak->value.asManaged()) {
+            if (!m->markBit()) {
+                weak->value = Primitive::undefinedValue();
+                PersistentValuePrivate *n = weak->next;
+                weak->removeFromList();
+                weak = n;
+                continue;
+            }
+        }
+        weak = weak->next;
+    }
+
+    if (MultiplyWrappedQObjectMap *multiplyWrappedQObjects = engine->m_multiplyWrappedQObjects) {
+        for (MultiplyWrappedQObjectMap::Iterator it = multiplyWrappedQObjects->begin(); it != multiplyWrappedQObjects->end();) {
+            if (!it.value()->markBit())
+                it = multiplyWrappedQObjects->erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+void sweepLargeItems(MemoryManager::Data *d)
+{
+    MemoryManager::Data::LargeItem *i = d->largeItems;
+    MemoryManager::Data::LargeItem **last = &d->largeItems;
+    while (i) {
+        Heap::Base *m = i->heapObject();
+        Q_ASSERT(m->inUse);
+        if (m->markBit) {
+            if (!d->generational)
+                m->markBit = 0;
+            last = &i->next;
+            i = i->next;
+            continue;
+        }
+        if (m->internalClass->vtable->destroy)
+            m->internalClass->vtable->destroy(m);
+
+        *last = i->next;
+        free(Q_V4_PROFILE_DEALLOC(d->engine, i, i->size + sizeof(MemoryManager::Data::LargeItem),
+                                  Profiling::LargeItem));
+        i = *last;
+    }
+}
+
+void sweepDeletables(MemoryManager::Data *d, bool lastSweep)
+{
+    GCDeletable *deletable = d->deletable;
+    d->deletable = 0;
+    while (deletable) {
+        GCDeletable *next = deletable->next;
+        deletable->lastCall = lastSweep;
+        delete deletable;
+        deletable = next;
+    }
+}
+
+bool isUnmarked(Heap::Base *m)
+{
+    return !m->markBit;
+}
+
+void markChildren(Heap::Base *h, ExecutionEngine *engine)
+{
+    const ManagedVTable *vtable = h->internalClass->vtable;
+    Q_ASSERT(vtable->markObjects);
+    vtable->markObjects(h, engine);
+    if (!vtable->isObject)
+        return;
+
+    // The write barrier is only applied to the object itself, not to its member and array
+    // data, so those have to be rescanned as well, even if they are old.
+    Heap::Object *o = static_cast<Heap::Object *>(h);
+    if (o->memberData)
+        o->memberData->internalClass->vtable->markObjects(o->memberData, engine);
+    if (o->arrayData)
+        o->arrayData->internalClass->vtable->markObjects(o->arrayData, engine);
+}
+
 } // namespace
 
 MemoryManager::MemoryManager()
     : m_d(new Data)
+    , m_inlineAllocation(false)
     , m_persistentValues(0)
     , m_weakValues(0)
 {
+    memset(m_sizeClasses, 0, sizeof(m_sizeClasses));
+    updateInlineAllocation();
 #ifdef V4_USE_VALGRIND
     VALGRIND_CREATE_MEMPOOL(this, 0, true);
 #endif
 }
 
+void MemoryManager::updateInlineAllocation()
+{
+    // Allocating inline skips the bookkeeping in allocData(), which these modes depend on.
+#if defined(V4_USE_VALGRIND) || defined(DETAILED_MM_STATS)
+    m_inlineAllocation = false;
+#else
+    m_inlineAllocation = !m_d->aggressiveGC && !m_d->generational && !m_d->markingInProgress
+            && !m_d->allocationTracking;
+#endif
+}
+
+void MemoryManager::setAllocationTracking(bool enabled)
+{
+    m_d->allocationTracking = enabled;
+    updateInlineAllocation();
+}
+
+uint MemoryManager::allocatedItems() const
+{
+    uint total = 0;
+    for (int pos = 0; pos < NumSizeClasses; ++pos)
+        total += m_sizeClasses[pos].allocCount;
+    return total;
+}
+
+void MemoryManager::resetAllocCounts()
+{
+    m_d->allocationsBeforeReset += allocatedItems();
+    for (int pos = 0; pos < NumSizeClasses; ++pos)
+        m_sizeClasses[pos].allocCount = 0;
+}
+
 Heap::Base *MemoryManager::allocData(std::size_t size)
 {
+    // runs minor collections in generational mode, so that missing write barriers show up
     if (m_d->aggressiveGC)
-        runGC();
+        collectGarbage();
+    // Advance a running cycle from here as well, idle time is only reported by windows
+    // with an animation driver.
+    if (m_d->markingInProgress && ++m_d->allocationsSinceSlice >= MemoryManager::Data::AllocationsPerSlice)
+        runGCSlice();
 #ifdef DETAILED_MM_STATS
     willAllocate(size);
 #endif // DETAILED_MM_STATS
 
-    Q_ASSERT(size >= 16);
-    Q_ASSERT(size % 16 == 0);
+    Q_ASSERT(size >= SlotSize);
+    Q_ASSERT(size % SlotSize == 0);
 
-    size_t pos = size >> 4;
+    size_t pos = size >> SlotSizeShift;
 
     // doesn't fit into a small bucket
-    if (size >= MemoryManager::Data::MaxItemSize) {
+    if (size >= MaxItemSize) {
+        if (!m_d->markingInProgress)
+            runGCSlice();
         if (m_d->totalLargeItemsAllocated > 8 * 1024 * 1024)
-            runGC();
+            collectGarbage();
 
         // we use malloc for this
         MemoryManager::Data::LargeItem *item = static_cast<MemoryManager::Data::LargeItem *>(
@@ -259,17 +548,27 @@ Heap::Base *MemoryManager::allocData(std::size_t size)
         item->size = size;
         m_d->largeItems = item;
         m_d->totalLargeItemsAllocated += size;
+        ++m_d->allocationsBeforeReset;
         return item->heapObject();
     }
 
-    Heap::Base *m = m_d->smallItems[pos];
+    SizeClass &sizeClass = m_sizeClasses[pos];
+    Heap::Base *m = takeFreeItem(sizeClass, size);
     if (m)
         goto found;
 
+    // start an incremental cycle once enough has been allocated, it is finished by the slices above
+    if (!m_d->markingInProgress && m_d->incrementalMarkingBudget) {
+        runGCSlice();
+        m = takeFreeItem(sizeClass, size);
+        if (m)
+            goto found;
+    }
+
     // try to free up space, otherwise allocate
-    if (m_d->allocCount[pos] > (m_d->availableItems[pos] >> 1) && m_d->totalAlloc > (m_d->totalItems >> 1) && !m_d->aggressiveGC) {
-        runGC();
-        m = m_d->smallItems[pos];
+    if (sizeClass.allocCount > (m_d->availableItems[pos] >> 1) && allocatedItems() > uint(m_d->totalItems >> 1) && !m_d->aggressiveGC) {
+        collectGarbage();
+        m = takeFreeItem(sizeClass, size);
         if (m)
             goto found;
     }
@@ -289,18 +588,16 @@ Heap::Base *MemoryManager::allocData(std::size_t size)
         allocation.chunkSize = int(size);
         m_d->heapChunks.append(allocation);
         std::sort(m_d->heapChunks.begin(), m_d->heapChunks.end());
+
+        // Hand out the new chunk front to back instead of threading all of it into the free list,
+        // so that its pages are only touched once they are needed. Any remainder of the previous
+        // chunk for this size is left for the next sweep to pick up.
         char *chunk = (char *)allocation.memory.base();
-        char *end = chunk + allocation.memory.size() - size;
-
-        Heap::Base **last = &m_d->smallItems[pos];
-        while (chunk <= end) {
-            Heap::Base *o = reinterpret_cast<Heap::Base *>(chunk);
-            *last = o;
-            last = o->nextFreeRef();
-            chunk += size;
-        }
-        *last = 0;
-        m = m_d->smallItems[pos];
+        sizeClass.bumpPointer = chunk;
+        sizeClass.bumpLimit = chunk + allocation.memory.size() / size * size;
+        m = takeFreeItem(sizeClass, size);
+        Q_ASSERT(m);
+
         const size_t increase = allocation.memory.size()/size - 1;
         m_d->availableItems[pos] += uint(increase);
         m_d->totalItems += int(increase);
@@ -315,14 +612,53 @@ Heap::Base *MemoryManager::allocData(std::size_t size)
 #endif
     Q_V4_PROFILE_ALLOC(m_d->engine, size, Profiling::SmallItem);
 
-    ++m_d->allocCount[pos];
-    ++m_d->totalAlloc;
-    m_d->smallItems[pos] = m->nextFree();
+    ++sizeClass.allocCount;
+    if (m_d->generational)
+        m_d->youngItems[pos].append(m);
+    if (m_d->markingInProgress)
+        m_d->itemsAllocatedWhileMarking.append(m);
     return m;
 }
 
-static void drainMarkStack(QV4::ExecutionEngine *engine, Value *markBase)
+void Heap::Base::remember()
 {
+    internalClass->engine->memoryManager->remember(this);
+}
+
+void MemoryManager::remember(Heap::Base *base)
+{
+    if (!m_d->generational && !m_d->markingInProgress)
+        return;
+    base->isRemembered = 1;
+    m_d->rememberedSet.append(base);
+}
+
+// Like the regular draining, but reports every object reached to the heap visitor. Whatever is
+// on the stack when entering has been pushed by marking the roots.
+static void traverseMarkStack(MemoryManager::Data *d, Value *markBase)
+{
+    ExecutionEngine *engine = d->engine;
+    for (Value *v = markBase; v < engine->jsStackTop; ++v)
+        d->heapVisitor->visit(v->heapObject(), d->itemSize(v->heapObject()), 0);
+
+    while (engine->jsStackTop > markBase) {
+        Heap::Base *h = engine->popForGC();
+        Value *children = engine->jsStackTop;
+        Q_ASSERT (h->internalClass->vtable->markObjects);
+        h->internalClass->vtable->markObjects(h, engine);
+        for (Value *v = children; v < engine->jsStackTop; ++v)
+            d->heapVisitor->visit(v->heapObject(), d->itemSize(v->heapObject()), h);
+    }
+}
+
+static void drainMarkStack(MemoryManager::Data *d, Value *markBase)
+{
+    if (d->heapVisitor) {
+        traverseMarkStack(d, markBase);
+        return;
+    }
+
+    ExecutionEngine *engine = d->engine;
     while (engine->jsStackTop > markBase) {
         Heap::Base *h = engine->popForGC();
         Q_ASSERT (h->internalClass->vtable->markObjects);
@@ -334,6 +670,26 @@ void MemoryManager::mark()
 {
     Value *markBase = m_d->engine->jsStackTop;
 
+    // Finish an incremental cycle in one go, starting with what's left from the last slice.
+    for (int i = 0; i < m_d->greyItems.size(); ++i) {
+        m_d->engine->pushForGC(m_d->greyItems.at(i));
+        if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
+            drainMarkStack(m_d.data(), markBase);
+    }
+    m_d->greyItems.resize(0);
+
+    markRoots(markBase);
+
+    drainMarkStack(m_d.data(), markBase);
+
+    if (m_d->generational || m_d->markingInProgress)
+        markRemembered();
+    m_d->markingInProgress = false;
+    updateInlineAllocation();
+}
+
+void MemoryManager::markRoots(Value *markBase)
+{
     m_d->engine->markObjects();
 
     PersistentValuePrivate *persistent = m_persistentValues;
@@ -349,7 +705,7 @@ void MemoryManager::mark()
         persistent = persistent->next;
 
         if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
-            drainMarkStack(m_d->engine, markBase);
+            drainMarkStack(m_d.data(), markBase);
     }
 
     collectFromJSStack();
@@ -384,69 +740,223 @@ void MemoryManager::mark()
             qobjectWrapper->mark(m_d->engine);
 
         if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
-            drainMarkStack(m_d->engine, markBase);
+            drainMarkStack(m_d.data(), markBase);
+    }
+}
+
+void MemoryManager::markRemembered()
+{
+    Value *markBase = m_d->engine->jsStackTop;
+
+    for (int i = 0; i < m_d->rememberedSet.size(); ++i) {
+        Heap::Base *h = m_d->rememberedSet.at(i);
+        h->isRemembered = 0;
+        markChildren(h, m_d->engine);
+        if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
+            drainMarkStack(m_d.data(), markBase);
+    }
+    m_d->rememberedSet.resize(0);
+
+    for (int i = 0; i < m_d->oldContexts.size(); ++i) {
+        Heap::Base *c = m_d->oldContexts.at(i);
+        c->internalClass->vtable->markObjects(c, m_d->engine);
+        if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
+            drainMarkStack(m_d.data(), markBase);
+    }
+
+    if (m_d->markingInProgress) {
+        for (int i = 0; i < m_d->markedContexts.size(); ++i) {
+            Heap::Base *c = m_d->markedContexts.at(i);
+            c->internalClass->vtable->markObjects(c, m_d->engine);
+            if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
+                drainMarkStack(m_d.data(), markBase);
+        }
+        m_d->markedContexts.resize(0);
+
+        for (int i = 0; i < m_d->itemsAllocatedWhileMarking.size(); ++i) {
+            m_d->itemsAllocatedWhileMarking.at(i)->mark(m_d->engine);
+            if (m_d->engine->jsStackTop >= m_d->engine->jsStackLimit)
+                drainMarkStack(m_d.data(), markBase);
+        }
+        m_d->itemsAllocatedWhileMarking.resize(0);
+
+        for (Data::LargeItem *i = m_d->largeItems; i != m_d->largeItemsAtMarkingStart; i = i->next)
+            i->heapObject()->mark(m_d->engine);
+        m_d->largeItemsAtMarkingStart = 0;
     }
 
-    drainMarkStack(m_d->engine, markBase);
+    drainMarkStack(m_d.data(), markBase);
+}
+
+void MemoryManager::startIncrementalMarking()
+{
+    Q_ASSERT(!m_d->markingInProgress);
+
+    if (m_d->generational)
+        clearMarkBits();
+
+    m_d->markingInProgress = true;
+    updateInlineAllocation();
+    m_d->largeItemsAtMarkingStart = m_d->largeItems;
+    ++m_d->incrementalCycles;
+
+    // The JS stack is needed by the program between two slices, so the grey items are kept
+    // aside. All roots are marked again when marking finishes, so it's enough to start with
+    // the engine's objects and the persistent values here.
+    ExecutionEngine *engine = m_d->engine;
+    Value *markBase = engine->jsStackTop;
+    engine->markObjects();
+    while (engine->jsStackTop > markBase)
+        m_d->greyItems.append(engine->popForGC());
+
+    // The current contexts are marked without going through the mark stack.
+    for (Heap::ExecutionContext *c = engine->currentContext(); c; c = c->parent)
+        m_d->markedContexts.append(c);
+
+    for (PersistentValuePrivate *persistent = m_persistentValues; persistent; persistent = persistent->next) {
+        if (persistent->refcount)
+            persistent->value.mark(engine);
+        while (engine->jsStackTop > markBase)
+            m_d->greyItems.append(engine->popForGC());
+    }
+}
+
+bool MemoryManager::markSlice()
+{
+    Q_ASSERT(m_d->markingInProgress);
+
+    ExecutionEngine *engine = m_d->engine;
+    Value *markBase = engine->jsStackTop;
+    const qint64 budget = qint64(m_d->incrementalMarkingBudget) * 1000;
+    QElapsedTimer timer;
+    timer.start();
+    ++m_d->markingSlices;
+
+    int marked = 0;
+    while (!m_d->greyItems.isEmpty()) {
+        Heap::Base *h = m_d->greyItems.takeLast();
+        Q_ASSERT(h->internalClass->vtable->markObjects);
+        h->internalClass->vtable->markObjects(h, engine);
+        if (h->internalClass->vtable->isExecutionContext)
+            m_d->markedContexts.append(h);
+        while (engine->jsStackTop > markBase)
+            m_d->greyItems.append(engine->popForGC());
+
+        // Checking the time is not for free, so only do it every now and then.
+        if (!(++marked % 64) && timer.nsecsElapsed() > budget)
+            return false;
+    }
+    return true;
+}
+
+void MemoryManager::clearMarkBits()
+{
+    for (QVector<Data::Chunk>::const_iterator i = m_d->heapChunks.constBegin(), ei = m_d->heapChunks.constEnd(); i != ei; ++i) {
+        char *chunkStart = reinterpret_cast<char *>(i->memory.base());
+        char *chunkEnd = chunkStart + i->memory.size() - i->chunkSize;
+        for (char *chunk = chunkStart; chunk <= chunkEnd; chunk += i->chunkSize) {
+            Heap::Base *m = reinterpret_cast<Heap::Base *>(chunk);
+            // Don't dirty pages that were never allocated from.
+            if (m->inUse) {
+                m->markBit = 0;
+                m->isRemembered = 0;
+            }
+        }
+    }
+    for (Data::LargeItem *i = m_d->largeItems; i; i = i->next) {
+        Heap::Base *m = i->heapObject();
+        m->markBit = 0;
+        m->isRemembered = 0;
+    }
+    m_d->rememberedSet.resize(0);
 }
 
 void MemoryManager::sweep(bool lastSweep)
 {
-    PersistentValuePrivate *weak = m_weakValues;
-    while (weak) {
-        if (!weak->refcount) {
-            PersistentValuePrivate *n = weak->next;
-            weak->removeFromList();
-            delete weak;
-            weak = n;
-            continue;
+    sweepWeakValues(this, m_d->engine);
+
+    if (m_d->generational) {
+        // Everything that survives a major collection ends up in the old generation.
+        for (int pos = 0; pos < NumSizeClasses; ++pos) {
+            QVector<Heap::Base *> &young = m_d->youngItems[pos];
+            for (int i = 0; i < young.size(); ++i) {
+                Heap::Base *m = young.at(i);
+                if (m->markBit && m->internalClass->vtable->isExecutionContext)
+                    m_d->oldContexts.append(m);
+            }
+            young.resize(0);
         }
-        if (Managed *m = weak->value.asManaged()) {
-            if (!m->markBit()) {
-                weak->value = Primitive::undefinedValue();
-                PersistentValuePrivate *n = weak->next;
-                weak->removeFromList();
-                weak = n;
-                continue;
+        QVector<Heap::Base *>::iterator it = std::remove_if(m_d->oldContexts.begin(), m_d->oldContexts.end(), isUnmarked);
+        m_d->oldContexts.erase(it, m_d->oldContexts.end());
+    }
+
+    const int nChunks = m_d->heapChunks.size();
+    QVarLengthArray<ChunkSweepData> chunkSweepData(nChunks);
+
+    // The part of a chunk that is still being handed out by bump allocation holds no items yet.
+    for (int pos = 0; pos < NumSizeClasses; ++pos) {
+        char *bumpPointer = m_sizeClasses[pos].bumpPointer;
+        if (bumpPointer == m_sizeClasses[pos].bumpLimit)
+            continue;
+        for (int i = 0; i < nChunks; ++i) {
+            char *chunkStart = reinterpret_cast<char *>(m_d->heapChunks.at(i).memory.base());
+            if (bumpPointer >= chunkStart && bumpPointer < chunkStart + m_d->heapChunks.at(i).memory.size()) {
+                chunkSweepData[i].end = bumpPointer;
+                break;
             }
         }
-        weak = weak->next;
     }
 
-    if (MultiplyWrappedQObjectMap *multiplyWrappedQObjects = m_d->engine->m_multiplyWrappedQObjects) {
-        for (MultiplyWrappedQObjectMap::Iterator it = multiplyWrappedQObjects->begin(); it != multiplyWrappedQObjects->end();) {
-            if (!it.value()->markBit())
-                it = multiplyWrappedQObjects->erase(it);
-            else
-                ++it;
+    if (m_d->parallelSweep && nChunks >= 4) {
+        if (!m_d->sweepThreadPool) {
+            m_d->sweepThreadPool.reset(new QThreadPool);
+            m_d->sweepThreadPool->setMaxThreadCount(QThread::idealThreadCount() - 1);
         }
+
+        // Items with a destroy function are left to the GUI thread, as those may touch
+        // QObjects or other thread affine data.
+        const int partitions = qMin(m_d->sweepThreadPool->maxThreadCount() + 1, nChunks);
+        const int chunksPerPartition = (nChunks + partitions - 1) / partitions;
+        for (int begin = chunksPerPartition; begin < nChunks; begin += chunksPerPartition) {
+            m_d->sweepThreadPool->start(new ChunkSweeper(m_d->heapChunks, chunkSweepData.data(), begin,
+                                                         qMin(begin + chunksPerPartition, nChunks),
+                                                         m_d->generational));
+        }
+        for (int i = 0; i < chunksPerPartition; ++i)
+            sweepChunk(m_d->heapChunks.at(i), &chunkSweepData[i], m_d->engine, m_d->generational, true);
+        m_d->sweepThreadPool->waitForDone();
+
+        for (int i = 0; i < nChunks; ++i)
+            finishChunkSweep(m_d->heapChunks.at(i), &chunkSweepData[i], m_d->engine);
+    } else {
+        for (int i = 0; i < nChunks; ++i)
+            sweepChunk(m_d->heapChunks.at(i), &chunkSweepData[i], m_d->engine, m_d->generational, false);
     }
 
-    QVarLengthArray<ChunkSweepData> chunkSweepData(m_d->heapChunks.size());
-    uint itemsInUse[MemoryManager::Data::MaxItemSize/16];
+    uint itemsInUse[NumSizeClasses];
     memset(itemsInUse, 0, sizeof(itemsInUse));
+    for (int i = 0; i < nChunks; ++i)
+        itemsInUse[m_d->heapChunks.at(i).chunkSize >> SlotSizeShift] += chunkSweepData[i].itemsInUse;
 
-    for (int i = 0; i < m_d->heapChunks.size(); ++i) {
-        const MemoryManager::Data::Chunk &chunk = m_d->heapChunks[i];
-        sweepChunk(chunk, &chunkSweepData[i], &itemsInUse[chunk.chunkSize >> 4], m_d->engine);
+    Heap::Base **tails[NumSizeClasses];
+    for (int pos = 0; pos < NumSizeClasses; ++pos) {
+        m_sizeClasses[pos].freeItems = 0;
+        tails[pos] = &m_sizeClasses[pos].freeItems;
     }
 
-    Heap::Base **tails[MemoryManager::Data::MaxItemSize/16];
-    memset(m_d->smallItems, 0, sizeof(m_d->smallItems));
-    for (int pos = 0; pos < MemoryManager::Data::MaxItemSize/16; ++pos)
-        tails[pos] = &m_d->smallItems[pos];
-
 #ifdef V4_USE_VALGRIND
     VALGRIND_DISABLE_ERROR_REPORTING;
 #endif
     QVector<Data::Chunk>::iterator chunkIter = m_d->heapChunks.begin();
     for (int i = 0; i < chunkSweepData.size(); ++i) {
         Q_ASSERT(chunkIter != m_d->heapChunks.end());
-        const size_t pos = chunkIter->chunkSize >> 4;
+        const size_t pos = chunkIter->chunkSize >> SlotSizeShift;
         const size_t decrease = chunkIter->memory.size()/chunkIter->chunkSize - 1;
 
         // Release that chunk if it could have been spared since the last GC run without any difference.
         if (chunkSweepData[i].isEmpty && m_d->availableItems[pos] - decrease >= itemsInUse[pos]) {
+            if (chunkSweepData[i].end)
+                m_sizeClasses[pos].bumpPointer = m_sizeClasses[pos].bumpLimit = 0;
             Q_V4_PROFILE_DEALLOC(m_d->engine, 0, chunkIter->memory.size(), Profiling::HeapPage);
             --m_d->nChunks[pos];
             m_d->availableItems[pos] -= uint(decrease);
@@ -469,39 +979,58 @@ void MemoryManager::sweep(bool lastSweep)
 
 #ifdef V4_USE_VALGRIND
     VALGRIND_DISABLE_ERROR_REPORTING;
-    for (int pos = 0; pos < MemoryManager::Data::MaxItemSize/16; ++pos)
+    for (int pos = 0; pos < NumSizeClasses; ++pos)
         Q_ASSERT(*tails[pos] == 0);
     VALGRIND_ENABLE_ERROR_REPORTING;
 #endif
 
-    Data::LargeItem *i = m_d->largeItems;
-    Data::LargeItem **last = &m_d->largeItems;
-    while (i) {
-        Heap::Base *m = i->heapObject();
-        Q_ASSERT(m->inUse);
-        if (m->markBit) {
-            m->markBit = 0;
-            last = &i->next;
-            i = i->next;
-            continue;
-        }
-        if (m->internalClass->vtable->destroy)
-            m->internalClass->vtable->destroy(m);
+    sweepLargeItems(m_d.data());
+    sweepDeletables(m_d.data(), lastSweep);
+}
 
-        *last = i->next;
-        free(Q_V4_PROFILE_DEALLOC(m_d->engine, i, i->size + sizeof(Data::LargeItem),
-                                  Profiling::LargeItem));
-        i = *last;
-    }
+void MemoryManager::sweepYoungItems()
+{
+    sweepWeakValues(this, m_d->engine);
 
-    GCDeletable *deletable = m_d->deletable;
-    m_d->deletable = 0;
-    while (deletable) {
-        GCDeletable *next = deletable->next;
-        deletable->lastCall = lastSweep;
-        delete deletable;
-        deletable = next;
+#ifdef V4_USE_VALGRIND
+    VALGRIND_DISABLE_ERROR_REPORTING;
+#endif
+    for (int pos = 0; pos < NumSizeClasses; ++pos) {
+        const std::size_t itemSize = pos << SlotSizeShift;
+        QVector<Heap::Base *> &young = m_d->youngItems[pos];
+        for (int i = 0; i < young.size(); ++i) {
+            Heap::Base *m = young.at(i);
+            Q_ASSERT(m->inUse);
+            if (m->markBit) {
+                ++m_d->promotedSinceMajor;
+                if (m->internalClass->vtable->isExecutionContext)
+                    m_d->oldContexts.append(m);
+                continue;
+            }
+
+#ifdef V4_USE_VALGRIND
+            VALGRIND_ENABLE_ERROR_REPORTING;
+#endif
+            if (m->internalClass->vtable->destroy)
+                m->internalClass->vtable->destroy(m);
+
+            memset(m, 0, itemSize);
+#ifdef V4_USE_VALGRIND
+            VALGRIND_DISABLE_ERROR_REPORTING;
+            VALGRIND_MEMPOOL_FREE(this, m);
+#endif
+            Q_V4_PROFILE_DEALLOC(m_d->engine, m, itemSize, Profiling::SmallItem);
+            m->setNextFree(m_sizeClasses[pos].freeItems);
+            m_sizeClasses[pos].freeItems = m;
+        }
+        young.resize(0);
     }
+#ifdef V4_USE_VALGRIND
+    VALGRIND_ENABLE_ERROR_REPORTING;
+#endif
+
+    sweepLargeItems(m_d.data());
+    sweepDeletables(m_d.data(), false);
 }
 
 bool MemoryManager::isGCBlocked() const
@@ -521,6 +1050,14 @@ void MemoryManager::runGC()
         return;
     }
 
+    QElapsedTimer pause;
+    pause.start();
+
+    // Old objects carry their mark bit from one collection to the next, which a full
+    // collection can't use, as it has to find out about dead old objects, too.
+    if (m_d->generational && !m_d->markingInProgress)
+        clearMarkBits();
+
     if (!m_d->gcStats) {
         mark();
         sweep();
@@ -549,9 +1086,120 @@ void MemoryManager::runGC()
         qDebug() << "======== End GC ========";
     }
 
-    memset(m_d->allocCount, 0, sizeof(m_d->allocCount));
-    m_d->totalAlloc = 0;
+    resetAllocCounts();
     m_d->totalLargeItemsAllocated = 0;
+    m_d->minorCollectionsSinceMajor = 0;
+    m_d->promotedSinceMajor = 0;
+
+    const qint64 pauseTime = pause.nsecsElapsed();
+    ++m_d->majorCollections;
+    m_d->majorPauseTime += pauseTime;
+    m_d->maxMajorPauseTime = qMax(m_d->maxMajorPauseTime, pauseTime);
+}
+
+void MemoryManager::collectGarbage()
+{
+    // Fall back to a full collection once too many objects got promoted, as dead old objects
+    // are only ever found by those.
+    if (!m_d->generational || m_d->markingInProgress
+            || m_d->minorCollectionsSinceMajor >= m_d->maxMinorCollections
+            || m_d->promotedSinceMajor > uint(m_d->totalItems >> 2)) {
+        runGC();
+        return;
+    }
+
+    if (m_d->gcBlocked)
+        return;
+
+    QElapsedTimer pause;
+    pause.start();
+
+    int usedBefore = m_d->gcStats ? getUsedMem() : 0;
+    uint promotedBefore = m_d->promotedSinceMajor;
+
+    mark();
+    sweepYoungItems();
+
+    resetAllocCounts();
+    m_d->totalLargeItemsAllocated = 0;
+    ++m_d->minorCollectionsSinceMajor;
+
+    const qint64 pauseTime = pause.nsecsElapsed();
+    ++m_d->minorCollections;
+    m_d->minorPauseTime += pauseTime;
+    m_d->maxMinorPauseTime = qMax(m_d->maxMinorPauseTime, pauseTime);
+
+    if (m_d->gcStats) {
+        int usedAfter = getUsedMem();
+        qDebug() << "========== Minor GC ==========";
+        qDebug() << "Collected young objects in" << (pauseTime / 1000) << "us.";
+        qDebug() << "Used memory before GC:" << usedBefore;
+        qDebug() << "Used memory after GC:" << usedAfter;
+        qDebug() << "Freed up bytes:" << (usedBefore - usedAfter);
+        qDebug() << "Promoted objects:" << (m_d->promotedSinceMajor - promotedBefore);
+        qDebug() << "Remembered old contexts:" << m_d->oldContexts.size();
+        qDebug() << "======== End Minor GC ========";
+    }
+}
+
+void MemoryManager::runGCSlice()
+{
+    if (m_d->gcBlocked || !m_d->incrementalMarkingBudget)
+        return;
+    m_d->allocationsSinceSlice = 0;
+
+    if (!m_d->markingInProgress) {
+        // Start a new cycle once half of the allocations that would trigger a collection are done.
+        if (allocatedItems() <= uint(m_d->totalItems >> 2) && m_d->totalLargeItemsAllocated <= 4 * 1024 * 1024)
+            return;
+        startIncrementalMarking();
+    }
+
+    if (markSlice())
+        runGC();
+}
+
+int MemoryManager::incrementalMarkingBudget() const
+{
+    return m_d->incrementalMarkingBudget;
+}
+
+void MemoryManager::setIncrementalMarkingBudget(int usecs)
+{
+    m_d->incrementalMarkingBudget = qMax(0, usecs);
+}
+
+uint MemoryManager::incrementalMarkingCycles() const
+{
+    return m_d->incrementalCycles;
+}
+
+bool MemoryManager::traverseHeap(HeapVisitor *visitor)
+{
+    if (m_d->gcBlocked)
+        return false;
+
+    // Start with only the live objects left, and without any mark bits, which then tell
+    // what has been visited already.
+    runGC();
+    if (m_d->generational)
+        clearMarkBits();
+
+    for (Data::LargeItem *i = m_d->largeItems; i; i = i->next)
+        m_d->largeItemSizes.insert(i->heapObject(), i->size);
+    m_d->heapVisitor = visitor;
+
+    Value *markBase = m_d->engine->jsStackTop;
+    markRoots(markBase);
+    drainMarkStack(m_d.data(), markBase);
+
+    m_d->heapVisitor = 0;
+    m_d->largeItemSizes.clear();
+
+    // The generational mode expects survivors to stay marked, like after a regular collection.
+    if (!m_d->generational)
+        clearMarkBits();
+    return true;
 }
 
 size_t MemoryManager::getUsedMem() const
@@ -562,7 +1210,7 @@ size_t MemoryManager::getUsedMem() const
         char *chunkEnd = chunkStart + i->memory.size() - i->chunkSize;
         for (char *chunk = chunkStart; chunk <= chunkEnd; chunk += i->chunkSize) {
             Heap::Base *m = reinterpret_cast<Heap::Base *>(chunk);
-            Q_ASSERT((qintptr) chunk % 16 == 0);
+            Q_ASSERT((qintptr) chunk % SlotSize == 0);
             if (m->inUse)
                 usedMem += i->chunkSize;
         }
@@ -586,6 +1234,11 @@ size_t MemoryManager::getLargeItemsMem() const
     return total;
 }
 
+quint64 MemoryManager::totalAllocations() const
+{
+    return m_d->allocationsBeforeReset + allocatedItems();
+}
+
 MemoryManager::~MemoryManager()
 {
     PersistentValuePrivate *persistent = m_persistentValues;
@@ -598,6 +1251,11 @@ MemoryManager::~MemoryManager()
         persistent = n;
     }
 
+    m_d->greyItems.clear();
+    if (m_d->generational || m_d->markingInProgress)
+        clearMarkBits();
+    m_d->markingInProgress = false;
+    updateInlineAllocation();
     sweep(/*lastSweep*/true);
 #ifdef V4_USE_VALGRIND
     VALGRIND_DESTROY_MEMPOOL(this);
@@ -616,13 +1274,26 @@ void MemoryManager::setExecutionEngine(ExecutionEngine *engine)
 
 void MemoryManager::dumpStats() const
 {
+    if (m_d->gcStats) {
+        std::cerr << "=================" << std::endl;
+        std::cerr << "Collection stats:" << std::endl;
+        std::cerr << "\tmajor collections: " << m_d->majorCollections
+                  << ", total pause " << m_d->majorPauseTime / 1000 << " us"
+                  << ", max pause " << m_d->maxMajorPauseTime / 1000 << " us" << std::endl;
+        std::cerr << "\tminor collections: " << m_d->minorCollections
+                  << ", total pause " << m_d->minorPauseTime / 1000 << " us"
+                  << ", max pause " << m_d->maxMinorPauseTime / 1000 << " us" << std::endl;
+        std::cerr << "\tincremental marking cycles: " << m_d->incrementalCycles
+                  << ", marking slices: " << m_d->markingSlices << std::endl;
+    }
+
 #ifdef DETAILED_MM_STATS
     std::cerr << "=================" << std::endl;
     std::cerr << "Allocation stats:" << std::endl;
     std::cerr << "Requests for each chunk size:" << std::endl;
     for (int i = 0; i < m_d->allocSizeCounters.size(); ++i) {
         if (unsigned count = m_d->allocSizeCounters[i]) {
-            std::cerr << "\t" << (i << 4) << " bytes chunks: " << count << std::endl;
+            std::cerr << "\t" << (i << SlotSizeShift) << " bytes chunks: " << count << std::endl;
         }
     }
 #endif // DETAILED_MM_STATS
@@ -637,7 +1308,7 @@ void MemoryManager::registerDeletable(GCDeletable *d)
 #ifdef DETAILED_MM_STATS
 void MemoryManager::willAllocate(std::size_t size)
 {
-    unsigned alignedSize = (size + 15) >> 4;
+    unsigned alignedSize = (size + SlotSize - 1) >> SlotSizeShift;
     QVector<unsigned> &counters = m_d->allocSizeCounters;
     if ((unsigned) counters.size() < alignedSize + 1)
         counters.resize(alignedSize + 1);
@@ -46,6 +46,14 @@ namespace QV4 {
 
 struct GCDeletable;
 
+struct HeapVisitor
+{
+    virtual ~HeapVisitor() {}
+    // Called once for every live object, after the object it was first reached from.
+    // The retainer is 0 for objects referenced from the roots.
+    virtual void visit(Heap::Base *object, std::size_t size, Heap::Base *retainer) = 0;
+};
+
 class Q_QML_EXPORT MemoryManager
 {
     MemoryManager(const MemoryManager &);
@@ -78,16 +86,33 @@ public:
     MemoryManager();
     ~MemoryManager();
 
-    // TODO: this is only for 64bit (and x86 with SSE/AVX), so exend it for other architectures to be slightly more efficient (meaning, align on 8-byte boundaries).
-    // Note: all occurrences of "16" in alloc/dealloc are also due to the alignment.
+    // Small items are allocated in multiples of the slot size, each multiple having its own chunks.
+    // 64 bit systems keep 16 byte alignment (for x86 with SSE/AVX), everything else can do with 8 bytes.
+    enum {
+#if QT_POINTER_SIZE == 8
+        SlotSizeShift = 4,
+#else
+        SlotSizeShift = 3,
+#endif
+        SlotSize = 1 << SlotSizeShift,
+        MaxItemSize = 512,
+        NumSizeClasses = MaxItemSize / SlotSize
+    };
+
     static inline std::size_t align(std::size_t size)
-    { return (size + 15) & ~0xf; }
+    { return (size + SlotSize - 1) & ~std::size_t(SlotSize - 1); }
 
     inline Heap::Base *allocManaged(std::size_t size)
     {
         size = align(size);
-        Heap::Base *o = allocData(size);
-        return o;
+        if (size < MaxItemSize && m_inlineAllocation) {
+            SizeClass &sizeClass = m_sizeClasses[size >> SlotSizeShift];
+            if (Heap::Base *m = takeFreeItem(sizeClass, size)) {
+                ++sizeClass.allocCount;
+                return m;
+            }
+        }
+        return allocData(size);
     }
 
     template <typename ManagedType>
@@ -148,6 +173,17 @@ public:
     void setGCBlocked(bool blockGC);
     void runGC();
 
+    // Marks for at most incrementalMarkingBudget() microseconds, and finishes the collection
+    // once everything is marked. Meant to be called in between frames, the allocator also runs
+    // slices while a cycle is in progress.
+    void runGCSlice();
+    int incrementalMarkingBudget() const;
+    void setIncrementalMarkingBudget(int usecs);
+    uint incrementalMarkingCycles() const;
+
+    // Slow path of Heap::Base::writeBarrier()
+    void remember(Heap::Base *base);
+
     ExecutionEngine *engine() const;
     void setExecutionEngine(ExecutionEngine *engine);
 
@@ -158,10 +194,18 @@ public:
     size_t getUsedMem() const;
     size_t getAllocatedMem() const;
     size_t getLargeItemsMem() const;
+    // Number of items allocated since the memory manager was created, for benchmarks.
+    quint64 totalAllocations() const;
+
+    // The profiler needs to see every allocation, which the inline fast path skips.
+    void setAllocationTracking(bool enabled);
+
+    // Collects the garbage and then passes all live objects to the visitor. Returns false if
+    // the GC is blocked.
+    bool traverseHeap(HeapVisitor *visitor);
 
 protected:
     /// expects size to be aligned
-    // TODO: try to inline
     Heap::Base *allocData(std::size_t size);
 
 #ifdef DETAILED_MM_STATS
@@ -169,17 +213,52 @@ protected:
 #endif // DETAILED_MM_STATS
 
 private:
+    struct SizeClass {
+        Heap::Base *freeItems;
+        // Not yet used part of the chunk allocated last for this size.
+        char *bumpPointer;
+        char *bumpLimit;
+        uint allocCount;
+    };
+
+    static inline Heap::Base *takeFreeItem(SizeClass &sizeClass, std::size_t size);
+    uint allocatedItems() const;
+    void resetAllocCounts();
+    void collectGarbage();
+    void updateInlineAllocation();
     void collectFromJSStack() const;
     void mark();
+    void markRoots(Value *markBase);
+    void markRemembered();
+    void startIncrementalMarking();
+    bool markSlice();
+    void clearMarkBits();
     void sweep(bool lastSweep = false);
+    void sweepYoungItems();
 
 protected:
     QScopedPointer<Data> m_d;
+    SizeClass m_sizeClasses[NumSizeClasses];
+    bool m_inlineAllocation;
 public:
     PersistentValuePrivate *m_persistentValues;
     PersistentValuePrivate *m_weakValues;
 };
 
+inline Heap::Base *MemoryManager::takeFreeItem(SizeClass &sizeClass, std::size_t size)
+{
+    if (Heap::Base *m = sizeClass.freeItems) {
+        sizeClass.freeItems = m->nextFree();
+        return m;
+    }
+    if (sizeClass.bumpPointer + size <= sizeClass.bumpLimit) {
+        Heap::Base *m = reinterpret_cast<Heap::Base *>(sizeClass.bumpPointer);
+        sizeClass.bumpPointer += size;
+        return m;
+    }
+    return 0;
+}
+
 }
 
 QT_END_NAMESPACE
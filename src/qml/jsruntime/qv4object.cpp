@@ -70,6 +70,7 @@ bool Object::setPrototype(Object *proto)
         pp = pp->prototype;
     }
     d()->prototype = proto ? proto->d() : 0;
+    d()->writeBarrier();
     return true;
 }
 
@@ -116,6 +117,7 @@ void Object::putValue(Property *pd, PropertyAttributes attrs, const ValueRef val
         goto reject;
 
     pd->value = *value;
+    d()->writeBarrier();
     return;
 
   reject:
@@ -199,6 +201,7 @@ void Object::markObjects(Heap::Base *that, ExecutionEngine *e)
 void Object::ensureMemberIndex(uint idx)
 {
     d()->memberData = MemberData::reallocate(engine(), d()->memberData, idx);
+    d()->writeBarrier();
 }
 
 void Object::insertMember(String *s, const Property *p, PropertyAttributes attributes)
@@ -217,6 +220,7 @@ void Object::insertMember(String *s, const Property *p, PropertyAttributes attri
     } else {
         d()->memberData->data[idx] = p->value;
     }
+    d()->writeBarrier();
 }
 
 // Section 8.12.1
@@ -238,9 +242,23 @@ Property *Object::__getOwnProperty__(String *name, PropertyAttributes *attrs)
     return 0;
 }
 
+// Copies the element to the engine's scratch Property, which stays valid until the next lookup,
+// so that reading packed elements through a Property doesn't unpack the array.
+static Property *packedElement(ExecutionEngine *engine, const Heap::ArrayData *arrayData, uint index)
+{
+    const Heap::PackedArrayData *pa = static_cast<const Heap::PackedArrayData *>(arrayData);
+    if (index >= pa->len)
+        return 0;
+    engine->packedElement.value = pa->data(index);
+    engine->packedElement.set = Primitive::emptyValue();
+    return &engine->packedElement;
+}
+
 Property *Object::__getOwnProperty__(uint index, PropertyAttributes *attrs)
 {
-    Property *p = arrayData() ? arrayData()->getProperty(index) : 0;
+    Property *p = 0;
+    if (arrayData())
+        p = arrayData()->isPacked() ? packedElement(engine(), arrayData(), index) : arrayData()->getProperty(index);
     if (p) {
         if (attrs)
             *attrs = arrayData()->attributes(index);
@@ -285,7 +303,9 @@ Property *Object::__getPropertyDescriptor__(uint index, PropertyAttributes *attr
 {
     const Heap::Object *o = d();
     while (o) {
-        Property *p = o->arrayData ? o->arrayData->getProperty(index) : 0;
+        Property *p = 0;
+        if (o->arrayData)
+            p = o->arrayData->isPacked() ? packedElement(engine(), o->arrayData, index) : o->arrayData->getProperty(index);
         if (p) {
             if (attrs)
                 *attrs = o->arrayData->attributes(index);
@@ -469,7 +489,7 @@ void Object::setLookup(Managed *m, Lookup *l, const ValueRef value)
 {
     Scope scope(m->engine());
     ScopedObject o(scope, static_cast<Object *>(m));
-    ScopedString name(scope, scope.engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+    ScopedString name(scope, scope.engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
 
     InternalClass *c = o->internalClass();
     uint idx = c->find(name);
@@ -479,6 +499,7 @@ void Object::setLookup(Managed *m, Lookup *l, const ValueRef value)
             l->index = idx;
             l->setter = Lookup::setter0;
             o->memberData()->data[idx] = *value;
+            o->d()->writeBarrier();
             return;
         }
 
@@ -547,6 +568,17 @@ void Object::advanceIterator(Managed *m, ObjectIterator *it, Heap::String **name
             it->arrayNode = 0;
             it->arrayIndex = UINT_MAX;
         }
+        // packed arrays have neither holes nor attributes
+        if (o->d()->arrayData->isPacked()) {
+            Heap::PackedArrayData *pa = static_cast<Heap::PackedArrayData *>(o->d()->arrayData);
+            if (it->arrayIndex < pa->len) {
+                *index = it->arrayIndex;
+                *attrs = Attr_Data;
+                pd->value = pa->data(it->arrayIndex);
+                ++it->arrayIndex;
+                return;
+            }
+        }
         // dense arrays
         while (it->arrayIndex < o->d()->arrayData->len) {
             Heap::SimpleArrayData *sa = static_cast<Heap::SimpleArrayData *>(o->d()->arrayData);
@@ -619,6 +651,16 @@ ReturnedValue Object::internalGetIndexed(uint index, bool *hasProperty)
     Scope scope(engine());
     ScopedObject o(scope, this);
     while (o) {
+        if (o->arrayData() && o->arrayData()->isPacked()) {
+            ReturnedValue v = o->arrayData()->get(index);
+            if (v != Primitive::emptyValue().asReturnedValue()) {
+                if (hasProperty)
+                    *hasProperty = true;
+                return v;
+            }
+            o = o->prototype();
+            continue;
+        }
         Property *p = o->arrayData() ? o->arrayData()->getProperty(index) : 0;
         if (p) {
             pd = p;
@@ -687,6 +729,7 @@ void Object::internalPut(String *name, const ValueRef value)
                 goto reject;
         } else {
             pd->value = *value;
+            d()->writeBarrier();
         }
         return;
     } else if (!prototype()) {
@@ -741,7 +784,15 @@ void Object::internalPutIndexed(uint index, const ValueRef value)
 
     PropertyAttributes attrs;
 
-    Property *pd = arrayData() ? arrayData()->getProperty(index) : 0;
+    if (arrayData() && arrayData()->isPacked()) {
+        // existing elements of a packed store are plain writable data properties
+        if (index < arrayData()->length()) {
+            arrayPut(index, value);
+            return;
+        }
+    }
+
+    Property *pd = arrayData() && !arrayData()->isPacked() ? arrayData()->getProperty(index) : 0;
     if (pd)
         attrs = arrayData()->attributes(index);
 
@@ -762,6 +813,7 @@ void Object::internalPutIndexed(uint index, const ValueRef value)
             goto reject;
         else
             pd->value = *value;
+        d()->writeBarrier();
         return;
     } else if (!prototype()) {
         if (!isExtensible())
@@ -933,6 +985,7 @@ bool Object::defineOwnProperty2(ExecutionEngine *engine, uint index, const Prope
 
     // Clause 1
     if (arrayData()) {
+        ArrayData::unpack(this);
         current = arrayData()->getProperty(index);
         if (!current && isStringObject())
             current = static_cast<StringObject *>(this)->getIndex(index);
@@ -975,6 +1028,7 @@ bool Object::__defineOwnProperty__(ExecutionEngine *engine, uint index, String *
         current = propertyAt(index);
         cattrs = internalClass()->propertyData[index];
     } else if (arrayData()) {
+        ArrayData::unpack(this);
         current = arrayData()->getProperty(index);
         cattrs = arrayData()->attributes(index);
     }
@@ -1042,6 +1096,7 @@ bool Object::__defineOwnProperty__(ExecutionEngine *engine, uint index, String *
   accept:
 
     current->merge(cattrs, p, attrs);
+    d()->writeBarrier();
     if (member) {
         InternalClass::changeMember(this, member, cattrs);
     } else {
@@ -1088,6 +1143,13 @@ void Object::copyArrayData(Object *other)
             v = other->getValue(reinterpret_cast<Property *>(osa->arrayData + it->value), osa->attrs[it->value]);
             arraySet(it->key(), v);
         }
+    } else if (other->d()->arrayData->isPacked()) {
+        Q_ASSERT(!arrayData());
+        const Heap::PackedArrayData *od = static_cast<const Heap::PackedArrayData *>(other->d()->arrayData);
+        ArrayData::realloc(this, od->type, od->len, false);
+        Heap::PackedArrayData *dd = static_cast<Heap::PackedArrayData *>(d()->arrayData);
+        dd->len = od->len;
+        memcpy(dd->payload(), od->payload(), od->len*Heap::PackedArrayData::elementSize(od->type));
     } else {
         Q_ASSERT(!arrayData() && other->arrayData());
         ArrayData::realloc(this, other->d()->arrayData->type, other->d()->arrayData->alloc, false);
@@ -1102,6 +1164,7 @@ void Object::copyArrayData(Object *other)
             dd->offset = other->d()->arrayData->offset;
         }
         memcpy(d()->arrayData->arrayData, other->d()->arrayData->arrayData, d()->arrayData->alloc*sizeof(Value));
+        d()->writeBarrier();
     }
     setArrayLengthUnchecked(other->getLength());
 }
@@ -1170,7 +1233,7 @@ Heap::ArrayObject::ArrayObject(ExecutionEngine *engine, const QStringList &list)
 ReturnedValue ArrayObject::getLookup(Managed *m, Lookup *l)
 {
     Scope scope(m->engine());
-    ScopedString name(scope, m->engine()->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+    ScopedString name(scope, m->engine()->currentContext()->compilationUnit->runtimeString(l->nameIndex));
     if (name->equals(m->engine()->id_length)) {
         // special case, as the property is on the object itself
         l->getter = Lookup::arrayLengthGetter;
@@ -72,7 +72,7 @@ struct Q_QML_EXPORT Object: Managed {
     Heap::MemberData *memberData() { return d()->memberData; }
     const Heap::MemberData *memberData() const { return d()->memberData; }
     Heap::ArrayData *arrayData() const { return d()->arrayData; }
-    void setArrayData(ArrayData *a) { d()->arrayData = a->d(); }
+    void setArrayData(ArrayData *a) { d()->arrayData = a->d(); d()->writeBarrier(); }
 
     const Property *propertyAt(uint index) const { return d()->propertyAt(index); }
     Property *propertyAt(uint index) { return d()->propertyAt(index); }
@@ -128,6 +128,7 @@ struct Q_QML_EXPORT Object: Managed {
 
     void ensureMemberIndex(QV4::ExecutionEngine *e, uint idx) {
         d()->memberData = MemberData::reallocate(e, d()->memberData, idx);
+        d()->writeBarrier();
     }
 
     void insertMember(String *s, const ValueRef v, PropertyAttributes attributes = Attr_Data) {
@@ -380,6 +381,7 @@ inline void Object::arraySet(uint index, const Property *p, PropertyAttributes a
     pd->value = p->value;
     if (attributes.isAccessor())
         pd->set = p->set;
+    d()->writeBarrier();
     if (isArrayObject() && index >= getLength())
         setArrayLengthUnchecked(index + 1);
 }
@@ -387,12 +389,21 @@ inline void Object::arraySet(uint index, const Property *p, PropertyAttributes a
 
 inline void Object::arraySet(uint index, ValueRef value)
 {
-    arrayCreate();
-    if (index > 0x1000 && index > 2*d()->arrayData->alloc) {
-        initSparseArray();
+    if (!arrayData() && !index && value && isArrayObject())
+        ArrayData::realloc(this, ArrayData::packedType(value, 1), 0, false);
+    else
+        arrayCreate();
+    if (d()->arrayData->isPacked() && value && index <= d()->arrayData->len) {
+        arrayReserve(index + 1);
+        arrayPut(index, value);
+    } else {
+        if (index > 0x1000 && index > 2*d()->arrayData->alloc) {
+            initSparseArray();
+        }
+        Property *pd = ArrayData::insert(this, index);
+        pd->value = value ? *value : Primitive::undefinedValue();
+        d()->writeBarrier();
     }
-    Property *pd = ArrayData::insert(this, index);
-    pd->value = value ? *value : Primitive::undefinedValue();
     if (isArrayObject() && index >= getLength())
         setArrayLengthUnchecked(index + 1);
 }
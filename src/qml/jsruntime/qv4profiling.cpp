@@ -33,6 +33,9 @@
 
 #include "qv4profiling_p.h"
 #include "qv4mm_p.h"
+#include "qv4context_p.h"
+#include "qv4functionobject_p.h"
+#include "qv4string_p.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -53,15 +56,206 @@ FunctionCallProperties FunctionCall::resolve() const
 }
 
 
-Profiler::Profiler(QV4::ExecutionEngine *engine) : featuresEnabled(0), m_engine(engine)
+Profiler::Profiler(QV4::ExecutionEngine *engine) :
+    featuresEnabled(0), m_engine(engine), m_bytesUntilSample(AllocationSamplingInterval),
+    m_bytesSinceSample(0)
 {
     static int metatype = qRegisterMetaType<QList<QV4::Profiling::FunctionCallProperties> >();
     static int metatype2 = qRegisterMetaType<QList<QV4::Profiling::MemoryAllocationProperties> >();
+    static int metatype3 = qRegisterMetaType<QList<QV4::Profiling::AllocationSiteProperties> >();
+    static int metatype4 = qRegisterMetaType<QList<QV4::Profiling::HeapSnapshotProperties> >();
+    static int metatype5 = qRegisterMetaType<QList<QV4::Profiling::TierUpProperties> >();
+    static int metatype6 = qRegisterMetaType<QList<QV4::Profiling::JitStatisticsProperties> >();
     Q_UNUSED(metatype);
     Q_UNUSED(metatype2);
+    Q_UNUSED(metatype3);
+    Q_UNUSED(metatype4);
+    Q_UNUSED(metatype5);
+    Q_UNUSED(metatype6);
     m_timer.start();
 }
 
+Profiler::~Profiler()
+{
+    clearAllocationSites();
+}
+
+void Profiler::sampleAllocation()
+{
+    m_bytesUntilSample += AllocationSamplingInterval;
+    const qint64 size = m_bytesSinceSample;
+    m_bytesSinceSample = 0;
+
+    // Attribute the allocation to the innermost JavaScript function on the stack.
+    Function *function = m_engine->globalCode;
+    for (Heap::ExecutionContext *c = m_engine->currentContext(); c; c = c->parent) {
+        if (c->type < Heap::ExecutionContext::Type_SimpleCallContext)
+            continue;
+        Heap::FunctionObject *f = static_cast<Heap::CallContext *>(c)->function;
+        if (f && f->function) {
+            function = f->function;
+            break;
+        }
+    }
+    if (!function)
+        return;
+
+    QHash<Function *, AllocationSite>::iterator it = m_allocation_sites.find(function);
+    if (it == m_allocation_sites.end()) {
+        // Keep the function alive until the data is reported.
+        function->compilationUnit->addref();
+        AllocationSite site = {0, 0};
+        it = m_allocation_sites.insert(function, site);
+    }
+    ++it->samples;
+    it->size += size;
+}
+
+void Profiler::trackTierUp(Function *function, qint64 start, quint32 calls, quint32 backEdges)
+{
+    TierUpProperties props = {
+        start,
+        m_timer.nsecsElapsed(),
+        function->name()->toQString(),
+        function->compilationUnit->fileName(),
+        function->compiledFunction->location.line,
+        function->compiledFunction->location.column,
+        calls,
+        backEdges
+    };
+    m_tier_up_data.append(props);
+}
+
+void Profiler::trackJitStatistics(Function *function, const JitStatistics &statistics)
+{
+    JitStatisticsProperties props = {
+        m_timer.nsecsElapsed(),
+        function->name()->toQString(),
+        function->compilationUnit->fileName(),
+        function->compiledFunction->location.line,
+        function->compiledFunction->location.column,
+        statistics
+    };
+    m_jit_data.append(props);
+}
+
+void Profiler::clearAllocationSites()
+{
+    for (QHash<Function *, AllocationSite>::const_iterator it = m_allocation_sites.constBegin(),
+         end = m_allocation_sites.constEnd(); it != end; ++it) {
+        it.key()->compilationUnit->release();
+    }
+    m_allocation_sites.clear();
+}
+
+namespace {
+
+class HeapSnapshotVisitor : public HeapVisitor
+{
+public:
+    struct Group {
+        Group() : count(0), shallowSize(0), retainedSize(0), example(0) {}
+        qint64 count;
+        qint64 shallowSize;
+        qint64 retainedSize;
+        Heap::Base *example;
+    };
+
+    void visit(Heap::Base *object, std::size_t size, Heap::Base *retainer) Q_DECL_OVERRIDE
+    {
+        Node node = {object, retainer, qint64(size)};
+        nodes.append(node);
+        indexes.insert(object, nodes.size() - 1);
+    }
+
+    void group()
+    {
+        // Retainers are visited before the objects they retain, so going backwards adds up
+        // the retained sizes along the tree of first references.
+        QVector<qint64> retained(nodes.size());
+        for (int i = nodes.size() - 1; i >= 0; --i) {
+            retained[i] += nodes.at(i).size;
+            if (nodes.at(i).retainer)
+                retained[indexes.value(nodes.at(i).retainer)] += retained.at(i);
+        }
+
+        for (int i = 0; i < nodes.size(); ++i) {
+            const Node &node = nodes.at(i);
+            Group &group = groups[node.object->internalClass];
+            ++group.count;
+            group.shallowSize += node.size;
+            // Objects reached through one of the same kind are already part of its retained size.
+            if (!node.retainer || node.retainer->internalClass != node.object->internalClass)
+                group.retainedSize += retained.at(i);
+            if (!group.example)
+                group.example = node.object;
+        }
+    }
+
+    static QString className(InternalClass *internalClass)
+    {
+        QString name = QString::fromLatin1(internalClass->vtable->className);
+        if (!internalClass->size)
+            return name;
+
+        QStringList members;
+        for (uint i = 0; i < internalClass->size && i < 4; ++i) {
+            if (Identifier *id = internalClass->nameMap.at(i))
+                members.append(id->string);
+        }
+        if (internalClass->size > 4)
+            members.append(QStringLiteral("..."));
+        return name + QLatin1Char('{') + members.join(QLatin1Char(',')) + QLatin1Char('}');
+    }
+
+    // The chain of objects through which the example was first reached, starting at a root.
+    QString retainerPath(Heap::Base *object) const
+    {
+        QStringList path;
+        for (int depth = 0; object && depth < 8; ++depth) {
+            path.prepend(QString::fromLatin1(object->internalClass->vtable->className));
+            object = nodes.at(indexes.value(object)).retainer;
+        }
+        if (object)
+            path.prepend(QStringLiteral("..."));
+        return path.join(QStringLiteral(" > "));
+    }
+
+    struct Node {
+        Heap::Base *object;
+        Heap::Base *retainer;
+        qint64 size;
+    };
+
+    QVector<Node> nodes;
+    QHash<Heap::Base *, int> indexes;
+    QHash<InternalClass *, Group> groups;
+};
+
+}
+
+void Profiler::takeHeapSnapshot()
+{
+    HeapSnapshotVisitor visitor;
+    if (!m_engine->memoryManager->traverseHeap(&visitor))
+        return;
+    visitor.group();
+
+    const qint64 timestamp = m_timer.nsecsElapsed();
+    for (QHash<InternalClass *, HeapSnapshotVisitor::Group>::const_iterator it = visitor.groups.constBegin(),
+         end = visitor.groups.constEnd(); it != end; ++it) {
+        HeapSnapshotProperties props = {
+            timestamp,
+            HeapSnapshotVisitor::className(it.key()),
+            it->count,
+            it->shallowSize,
+            it->retainedSize,
+            visitor.retainerPath(it->example)
+        };
+        m_heap_data.append(props);
+    }
+}
+
 struct FunctionCallComparator {
     bool operator()(const FunctionCallProperties &p1, const FunctionCallProperties &p2)
     { return p1.start < p2.start; }
@@ -69,6 +263,10 @@ struct FunctionCallComparator {
 
 void Profiler::stopProfiling()
 {
+    if (featuresEnabled & AllocationFeatures)
+        m_engine->memoryManager->setAllocationTracking(false);
+    if (featuresEnabled & (1 << FeatureHeapSnapshot))
+        takeHeapSnapshot();
     featuresEnabled = 0;
     reportData();
 }
@@ -82,6 +280,28 @@ void Profiler::reportData()
         FunctionCallProperties props = call.resolve();
         resolved.insert(std::upper_bound(resolved.begin(), resolved.end(), props, comp), props);
     }
+
+    QList<AllocationSiteProperties> sites;
+    const qint64 timestamp = m_timer.nsecsElapsed();
+    for (QHash<Function *, AllocationSite>::const_iterator it = m_allocation_sites.constBegin(),
+         end = m_allocation_sites.constEnd(); it != end; ++it) {
+        Function *function = it.key();
+        AllocationSiteProperties props = {
+            timestamp,
+            function->name()->toQString(),
+            function->compilationUnit->fileName(),
+            function->compiledFunction->location.line,
+            function->compiledFunction->location.column,
+            it->samples,
+            it->size
+        };
+        sites.append(props);
+    }
+
+    // Sent first, so that it's there when the regular data is passed on.
+    emit heapDataReady(sites, m_heap_data);
+    emit tierUpDataReady(m_tier_up_data);
+    emit jitDataReady(m_jit_data);
     emit dataReady(resolved, m_memory_data);
 }
 
@@ -90,6 +310,12 @@ void Profiler::startProfiling(quint64 features)
     if (featuresEnabled == 0) {
         m_data.clear();
         m_memory_data.clear();
+        m_heap_data.clear();
+        m_tier_up_data.clear();
+        m_jit_data.clear();
+        clearAllocationSites();
+        m_bytesUntilSample = AllocationSamplingInterval;
+        m_bytesSinceSample = 0;
 
         if (features & (1 << FeatureMemoryAllocation)) {
             qint64 timestamp = m_timer.nsecsElapsed();
@@ -106,6 +332,8 @@ void Profiler::startProfiling(quint64 features)
                                                 LargeItem};
             m_memory_data.append(large);
         }
+        if (features & AllocationFeatures)
+            m_engine->memoryManager->setAllocationTracking(true);
 
         featuresEnabled = features;
     }
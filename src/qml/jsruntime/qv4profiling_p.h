@@ -39,6 +39,7 @@
 #include "qv4function_p.h"
 
 #include <QElapsedTimer>
+#include <QHash>
 
 QT_BEGIN_NAMESPACE
 
@@ -48,7 +49,13 @@ namespace Profiling {
 
 enum Features {
     FeatureFunctionCall,
-    FeatureMemoryAllocation
+    FeatureMemoryAllocation,
+
+    // The bits in between are taken by the other QML profiler features.
+    FeatureAllocationSites = 11,
+    FeatureHeapSnapshot,
+    FeatureTierUp,
+    FeatureJitStatistics
 };
 
 enum MemoryType {
@@ -72,6 +79,69 @@ struct MemoryAllocationProperties {
     MemoryType type;
 };
 
+// Allocations sampled while running a function, every AllocationSamplingInterval bytes. The
+// size is the number of bytes allocated over the intervals ending in the function.
+struct AllocationSiteProperties {
+    qint64 timestamp;
+    QString name;
+    QString file;
+    int line;
+    int column;
+    qint64 samples;
+    qint64 size;
+};
+
+// Live objects of one internal class. The retained size is what would become garbage if
+// those objects were gone, approximated by the objects first reached through them.
+struct HeapSnapshotProperties {
+    qint64 timestamp;
+    QString className;
+    qint64 count;
+    qint64 shallowSize;
+    qint64 retainedSize;
+    QString retainerPath;
+};
+
+// A function the JIT compiled after it ran in the interpreter for a while, see qv4tiering_p.h.
+// start and end delimit the compilation.
+struct TierUpProperties {
+    qint64 start;
+    qint64 end;
+    QString name;
+    QString file;
+    int line;
+    int column;
+    quint32 calls;
+    quint32 backEdges;
+};
+
+// What the JIT spent on compiling a function, collected by the instruction selection. The
+// times are in nanoseconds, the sizes in bytes.
+struct JitStatistics {
+    JitStatistics()
+        : irStatements(0), basicBlocks(0), optimizeTime(0), regallocTime(0), spills(0)
+        , codeSize(0), executableSize(0)
+    {}
+
+    quint32 irStatements;
+    quint32 basicBlocks;
+    qint64 optimizeTime;
+    qint64 regallocTime;
+    quint32 spills;
+    quint32 codeSize;
+    quint32 executableSize;
+};
+
+// A function compiled by the JIT, reported when its unit is linked to the engine.
+struct JitStatisticsProperties {
+    qint64 timestamp;
+    QString name;
+    QString file;
+    int line;
+    int column;
+    JitStatistics statistics;
+};
+
 class FunctionCall {
 public:
 
@@ -112,7 +182,7 @@ private:
 
 #define Q_V4_PROFILE_ALLOC(engine, size, type)\
     (engine->profiler &&\
-            (engine->profiler->featuresEnabled & (1 << Profiling::FeatureMemoryAllocation)) ?\
+            (engine->profiler->featuresEnabled & Profiling::Profiler::AllocationFeatures) ?\
         engine->profiler->trackAlloc(size, type) : size)
 
 #define Q_V4_PROFILE_DEALLOC(engine, pointer, size, type) \
@@ -130,15 +200,34 @@ class Q_QML_EXPORT Profiler : public QObject {
     Q_OBJECT
     Q_DISABLE_COPY(Profiler)
 public:
+    enum {
+        AllocationFeatures = (1 << FeatureMemoryAllocation) | (1 << FeatureAllocationSites),
+        AllocationSamplingInterval = 64 * 1024
+    };
+
     Profiler(QV4::ExecutionEngine *engine);
+    ~Profiler();
 
     size_t trackAlloc(size_t size, MemoryType type)
     {
-        MemoryAllocationProperties allocation = {m_timer.nsecsElapsed(), (qint64)size, type};
-        m_memory_data.append(allocation);
+        if (featuresEnabled & (1 << FeatureMemoryAllocation)) {
+            MemoryAllocationProperties allocation = {m_timer.nsecsElapsed(), (qint64)size, type};
+            m_memory_data.append(allocation);
+        }
+        if (type != HeapPage && (featuresEnabled & (1 << FeatureAllocationSites))) {
+            m_bytesSinceSample += qint64(size);
+            m_bytesUntilSample -= qint64(size);
+            if (m_bytesUntilSample <= 0)
+                sampleAllocation();
+        }
         return size;
     }
 
+    qint64 timestamp() const { return m_timer.nsecsElapsed(); }
+
+    void trackTierUp(Function *function, qint64 start, quint32 calls, quint32 backEdges);
+    void trackJitStatistics(Function *function, const JitStatistics &statistics);
+
     void *trackDealloc(void *pointer, size_t size, MemoryType type)
     {
         MemoryAllocationProperties allocation = {m_timer.nsecsElapsed(), -(qint64)size, type};
@@ -157,12 +246,31 @@ public slots:
 signals:
     void dataReady(const QList<QV4::Profiling::FunctionCallProperties> &,
                    const QList<QV4::Profiling::MemoryAllocationProperties> &);
+    void heapDataReady(const QList<QV4::Profiling::AllocationSiteProperties> &,
+                       const QList<QV4::Profiling::HeapSnapshotProperties> &);
+    void tierUpDataReady(const QList<QV4::Profiling::TierUpProperties> &);
+    void jitDataReady(const QList<QV4::Profiling::JitStatisticsProperties> &);
 
 private:
+    struct AllocationSite {
+        qint64 samples;
+        qint64 size;
+    };
+
+    void sampleAllocation();
+    void clearAllocationSites();
+    void takeHeapSnapshot();
+
     QV4::ExecutionEngine *m_engine;
     QElapsedTimer m_timer;
     QVector<FunctionCall> m_data;
     QList<MemoryAllocationProperties> m_memory_data;
+    qint64 m_bytesUntilSample;
+    qint64 m_bytesSinceSample;
+    QHash<Function *, AllocationSite> m_allocation_sites;
+    QList<HeapSnapshotProperties> m_heap_data;
+    QList<TierUpProperties> m_tier_up_data;
+    QList<JitStatisticsProperties> m_jit_data;
 
     friend class FunctionCallProfiler;
 };
@@ -200,9 +308,18 @@ public:
 Q_DECLARE_TYPEINFO(QV4::Profiling::MemoryAllocationProperties, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QV4::Profiling::FunctionCallProperties, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QV4::Profiling::FunctionCall, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QV4::Profiling::AllocationSiteProperties, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QV4::Profiling::HeapSnapshotProperties, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QV4::Profiling::TierUpProperties, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QV4::Profiling::JitStatistics, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(QV4::Profiling::JitStatisticsProperties, Q_MOVABLE_TYPE);
 
 QT_END_NAMESPACE
 Q_DECLARE_METATYPE(QList<QV4::Profiling::FunctionCallProperties>)
 Q_DECLARE_METATYPE(QList<QV4::Profiling::MemoryAllocationProperties>)
+Q_DECLARE_METATYPE(QList<QV4::Profiling::AllocationSiteProperties>)
+Q_DECLARE_METATYPE(QList<QV4::Profiling::HeapSnapshotProperties>)
+Q_DECLARE_METATYPE(QList<QV4::Profiling::TierUpProperties>)
+Q_DECLARE_METATYPE(QList<QV4::Profiling::JitStatisticsProperties>)
 
 #endif // QV4PROFILING_H
@@ -373,7 +373,7 @@ ReturnedValue QObjectWrapper::getProperty(QObject *object, ExecutionContext *ctx
             if (property->accessors->notifier) {
                 if (n)
                     ep->captureProperty(n);
-            } else {
+            } else if (!property->isConstant()) {
                 ep->captureProperty(object, property->coreIndex, property->notifyIndex);
             }
         }
@@ -35,6 +35,7 @@
 #include "qv4engine_p.h"
 #include "qv4scopedvalue_p.h"
 #include "qv4mm_p.h"
+#include "qv4executableallocator_p.h"
 
 using namespace QV4;
 
@@ -99,7 +100,8 @@ Heap::RegExp::RegExp(ExecutionEngine* engine, const QString &pattern, bool ignor
     subPatternCount = yarrPattern.m_numSubpatterns;
     byteCode = JSC::Yarr::byteCompile(yarrPattern, engine->bumperPointerAllocator);
 #if ENABLE(YARR_JIT)
-    if (!yarrPattern.m_containsBackreferences && engine->iselFactory->jitCompileRegexps()) {
+    if (!yarrPattern.m_containsBackreferences && engine->iselFactory->jitCompileRegexps()
+            && !engine->regExpAllocator->isLimitReached()) {
         JSC::JSGlobalData dummy(engine->regExpAllocator);
         JSC::Yarr::jitCompile(yarrPattern, JSC::Yarr::Char16, &dummy, jitCode);
     }
@@ -393,10 +393,12 @@ ReturnedValue RegExpPrototype::method_exec(CallContext *ctx)
     array->setArrayLengthUnchecked(len);
     array->memberData()->data[Index_ArrayIndex] = Primitive::fromInt32(result);
     array->memberData()->data[Index_ArrayInput] = arg.asReturnedValue();
+    array->d()->writeBarrier();
 
     RegExpCtor::Data *dd = regExpCtor->d();
     dd->lastMatch = array;
     dd->lastInput = arg->stringValue();
+    dd->writeBarrier();
     dd->lastMatchStart = matchOffsets[0];
     dd->lastMatchEnd = matchOffsets[1];
 
@@ -437,6 +439,7 @@ ReturnedValue RegExpPrototype::method_compile(CallContext *ctx)
 
     r->d()->value = re->value();
     r->d()->global = re->global();
+    r->d()->writeBarrier();
     return Encode::undefined();
 }
 
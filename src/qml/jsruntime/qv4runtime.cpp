@@ -272,6 +272,37 @@ ReturnedValue Runtime::closure(ExecutionEngine *engine, int functionId)
     return FunctionObject::createScriptFunction(ScopedContext(scope, engine->currentContext()), clos)->asReturnedValue();
 }
 
+static inline CompiledData::CompilationUnit *baseUnit(CompiledData::CompilationUnit *unit)
+{
+    return unit->baseUnit ? unit->baseUnit : unit;
+}
+
+// Whether value is still the closure an inlined call was compiled for: a closure of functionId,
+// created in the context scopeDepth levels out, or in the script's top-level context if
+// scopeDepth is negative.
+// With tiered compilation the caller may run in a unit compiled by a tier-up, and the closure
+// may have been created by either unit, so functions are compared through the base unit.
+ReturnedValue Runtime::isClosure(ExecutionEngine *engine, const ValueRef value, int functionId, int scopeDepth)
+{
+    Heap::ExecutionContext *context = engine->currentContext();
+    FunctionObject *f = value->asFunctionObject();
+    Function *function = f ? f->function() : 0;
+    if (!function || function->compiledFunction->index != uint(functionId)
+        || baseUnit(function->compilationUnit) != baseUnit(context->compilationUnit))
+        return Encode(false);
+
+    if (scopeDepth < 0) {
+        while (context->type != Heap::ExecutionContext::Type_GlobalContext
+               && context->type != Heap::ExecutionContext::Type_QmlContext) {
+            context = context->outer;
+        }
+    } else {
+        for (int i = 0; i < scopeDepth; ++i)
+            context = context->outer;
+    }
+    return Encode(f->scope() == context);
+}
+
 ReturnedValue Runtime::deleteElement(ExecutionEngine *engine, const ValueRef base, const ValueRef index)
 {
     Scope scope(engine);
@@ -290,7 +321,7 @@ ReturnedValue Runtime::deleteElement(ExecutionEngine *engine, const ValueRef bas
 ReturnedValue Runtime::deleteMember(ExecutionEngine *engine, const ValueRef base, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     return deleteMemberString(engine, base, name);
 }
 
@@ -306,7 +337,7 @@ ReturnedValue Runtime::deleteMemberString(ExecutionEngine *engine, const ValueRe
 ReturnedValue Runtime::deleteName(ExecutionEngine *engine, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedContext ctx(scope, engine->currentContext());
     return Encode(ctx->deleteProperty(name));
 }
@@ -561,7 +592,7 @@ QV4::ReturnedValue Runtime::addString(ExecutionEngine *engine, const QV4::ValueR
 void Runtime::setProperty(ExecutionEngine *engine, const ValueRef object, int nameIndex, const ValueRef value)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedObject o(scope, object->toObject(engine));
     if (!o)
         return;
@@ -624,6 +655,7 @@ void Runtime::setElement(ExecutionEngine *engine, const ValueRef object, const V
             Heap::SimpleArrayData *s = static_cast<Heap::SimpleArrayData *>(o->arrayData());
             if (s && idx < s->len && !s->data(idx).isEmpty()) {
                 s->data(idx) = value;
+                o->d()->writeBarrier();
                 return;
             }
         }
@@ -658,7 +690,7 @@ ReturnedValue Runtime::foreachNextPropertyName(const ValueRef foreach_iterator)
 void Runtime::setActivationProperty(ExecutionEngine *engine, int nameIndex, const ValueRef value)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedContext ctx(scope, engine->currentContext());
     ctx->setProperty(name, value);
 }
@@ -666,7 +698,7 @@ void Runtime::setActivationProperty(ExecutionEngine *engine, int nameIndex, cons
 ReturnedValue Runtime::getProperty(ExecutionEngine *engine, const ValueRef object, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
 
     ScopedObject o(scope, object);
     if (o)
@@ -686,7 +718,7 @@ ReturnedValue Runtime::getProperty(ExecutionEngine *engine, const ValueRef objec
 ReturnedValue Runtime::getActivationProperty(ExecutionEngine *engine, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedContext ctx(scope, engine->currentContext());
     return ctx->getProperty(name);
 }
@@ -909,7 +941,7 @@ ReturnedValue Runtime::callGlobalLookup(ExecutionEngine *engine, uint index, Cal
     if (!o)
         return engine->throwTypeError();
 
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[l->nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(l->nameIndex));
     if (o->d() == scope.engine->evalFunction && name->equals(scope.engine->id_eval))
         return static_cast<EvalFunction *>(o.getPointer())->evalCall(callData, true);
 
@@ -921,7 +953,7 @@ ReturnedValue Runtime::callActivationProperty(ExecutionEngine *engine, int nameI
 {
     Q_ASSERT(callData->thisObject.isUndefined());
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
 
     ScopedObject base(scope);
     ScopedContext ctx(scope, engine->currentContext());
@@ -951,7 +983,7 @@ ReturnedValue Runtime::callActivationProperty(ExecutionEngine *engine, int nameI
 ReturnedValue Runtime::callProperty(ExecutionEngine *engine, int nameIndex, CallData *callData)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedObject baseObject(scope, callData->thisObject);
     if (!baseObject) {
         Q_ASSERT(!callData->thisObject.isEmpty());
@@ -1030,7 +1062,7 @@ ReturnedValue Runtime::constructActivationProperty(ExecutionEngine *engine, int
 {
     Scope scope(engine);
     ScopedContext ctx(scope, engine->currentContext());
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedValue func(scope, ctx->getProperty(name));
     if (scope.engine->hasException)
         return Encode::undefined();
@@ -1055,7 +1087,7 @@ ReturnedValue Runtime::constructProperty(ExecutionEngine *engine, int nameIndex,
 {
     Scope scope(engine);
     ScopedObject thisObject(scope, callData->thisObject.toObject(engine));
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     if (scope.engine->hasException)
         return Encode::undefined();
 
@@ -1116,7 +1148,7 @@ ReturnedValue Runtime::typeofValue(ExecutionEngine *engine, const ValueRef value
 QV4::ReturnedValue Runtime::typeofName(ExecutionEngine *engine, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedContext ctx(scope, engine->currentContext());
     ScopedValue prop(scope, ctx->getProperty(name));
     // typeof doesn't throw. clear any possible exception
@@ -1127,7 +1159,7 @@ QV4::ReturnedValue Runtime::typeofName(ExecutionEngine *engine, int nameIndex)
 QV4::ReturnedValue Runtime::typeofMember(ExecutionEngine *engine, const ValueRef base, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedObject obj(scope, base->toObject(engine));
     if (scope.engine->hasException)
         return Encode::undefined();
@@ -1165,7 +1197,7 @@ void Runtime::pushCatchScope(NoThrowEngine *engine, int exceptionVarNameIndex)
 {
     Scope scope(engine);
     ScopedValue v(scope, engine->catchException(0));
-    ScopedString exceptionVarName(scope, engine->currentContext()->compilationUnit->runtimeStrings[exceptionVarNameIndex]);
+    ScopedString exceptionVarName(scope, engine->currentContext()->compilationUnit->runtimeString(exceptionVarNameIndex));
     ScopedContext ctx(scope, engine->currentContext());
     ctx->newCatchContext(exceptionVarName, v);
 }
@@ -1178,7 +1210,7 @@ void Runtime::popScope(ExecutionEngine *engine)
 void Runtime::declareVar(ExecutionEngine *engine, bool deletable, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     ScopedContext ctx(scope, engine->currentContext());
     ctx->createMutableBinding(name, deletable);
 }
@@ -1189,7 +1221,7 @@ ReturnedValue Runtime::arrayLiteral(ExecutionEngine *engine, Value *values, uint
     ScopedArrayObject a(scope, engine->newArrayObject());
 
     if (length) {
-        a->arrayReserve(length);
+        ArrayData::realloc(a, ArrayData::packedType(values, length), length, false);
         a->arrayPut(0, values, length);
         a->setArrayLengthUnchecked(length);
     }
@@ -1199,7 +1231,7 @@ ReturnedValue Runtime::arrayLiteral(ExecutionEngine *engine, Value *values, uint
 ReturnedValue Runtime::objectLiteral(ExecutionEngine *engine, const QV4::Value *args, int classId, int arrayValueCount, int arrayGetterSetterCountAndFlags)
 {
     Scope scope(engine);
-    QV4::InternalClass *klass = engine->currentContext()->compilationUnit->runtimeClasses[classId];
+    QV4::InternalClass *klass = engine->currentContext()->compilationUnit->runtimeClass(classId);
     ScopedObject o(scope, engine->newObject(klass, engine->objectPrototype.asObject()));
 
     {
@@ -1329,7 +1361,12 @@ unsigned Runtime::doubleToUInt(const double &d)
 
 ReturnedValue Runtime::regexpLiteral(ExecutionEngine *engine, int id)
 {
-    return engine->currentContext()->compilationUnit->runtimeRegularExpressions[id].asReturnedValue();
+    return engine->currentContext()->compilationUnit->runtimeRegularExpression(id);
+}
+
+ReturnedValue Runtime::stringLiteral(ExecutionEngine *engine, int id)
+{
+    return engine->currentContext()->compilationUnit->runtimeString(id)->asReturnedValue();
 }
 
 ReturnedValue Runtime::getQmlIdArray(NoThrowEngine *engine)
@@ -1415,7 +1452,7 @@ ReturnedValue Runtime::getQmlImportedScripts(NoThrowEngine *engine)
 QV4::ReturnedValue Runtime::getQmlSingleton(QV4::NoThrowEngine *engine, int nameIndex)
 {
     Scope scope(engine);
-    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeStrings[nameIndex]);
+    ScopedString name(scope, engine->currentContext()->compilationUnit->runtimeString(nameIndex));
     Scoped<QmlContextWrapper> wrapper(scope, engine->qmlContextObject());
     return wrapper->qmlSingletonWrapper(engine->v8Engine, name);
 }
@@ -131,6 +131,7 @@ struct Q_QML_PRIVATE_EXPORT Runtime {
 
     // closures
     static ReturnedValue closure(ExecutionEngine *engine, int functionId);
+    static ReturnedValue isClosure(ExecutionEngine *engine, const ValueRef value, int functionId, int scopeDepth);
 
     // function header
     static void declareVar(ExecutionEngine *engine, bool deletable, int nameIndex);
@@ -141,6 +142,7 @@ struct Q_QML_PRIVATE_EXPORT Runtime {
     static ReturnedValue arrayLiteral(ExecutionEngine *engine, Value *values, uint length);
     static ReturnedValue objectLiteral(ExecutionEngine *engine, const Value *args, int classId, int arrayValueCount, int arrayGetterSetterCountAndFlags);
     static ReturnedValue regexpLiteral(ExecutionEngine *engine, int id);
+    static ReturnedValue stringLiteral(ExecutionEngine *engine, int id);
 
     // foreach
     static ReturnedValue foreachIterator(ExecutionEngine *engine, const ValueRef in);
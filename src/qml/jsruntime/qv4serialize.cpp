@@ -42,6 +42,8 @@
 #include <private/qv4regexpobject_p.h>
 #include <private/qv4sequenceobject_p.h>
 #include <private/qv4objectproto_p.h>
+#include <private/qv4arraybuffer_p.h>
+#include <private/qv4typedarray_p.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -59,7 +61,13 @@ using namespace QV4;
 //    + Number
 //    + Date
 //    + RegExp
+//    + ArrayBuffer
+//    + Typed arrays
 // <quint8 type><quint24 size><data>
+//
+// Arrays holding only numbers and typed arrays are written as raw element
+// storage. ArrayBuffers in the transfer list are not copied at all: the
+// message carries a reference to their data, and the sender is neutered.
 
 enum Type {
     WorkerUndefined,
@@ -76,7 +84,12 @@ enum Type {
     WorkerDate,
     WorkerRegexp,
     WorkerListModel,
-    WorkerSequence
+    WorkerSequence,
+    WorkerArrayBuffer,
+    WorkerTransferredArrayBuffer,
+    WorkerTypedArray,
+    WorkerInt32Array,
+    WorkerNumberArray
 };
 
 static inline quint32 valueheader(Type type, quint32 size = 0)
@@ -135,11 +148,79 @@ static inline void *popPtr(const char *&data)
     return rv;
 }
 
+static inline void pushData(QByteArray &data, const char *bytes, uint size)
+{
+    data.append(bytes, size);
+    if (size % 4)
+        data.append(4 - size % 4, 0);
+}
+
 // XXX TODO: Check that worker script is exception safe in the case of
 // serialization/deserialization failures
 
 #define ALIGN(size) (((size) + 3) & ~3)
-void Serialize::serialize(QByteArray &data, const QV4::ValueRef v, ExecutionEngine *engine)
+
+// size bytes of buffer starting at offset, either copied or as a reference
+// to the buffer's data if it is transferred
+static void serializeBuffer(QByteArray &data, Heap::ArrayBuffer *buffer, uint offset, uint size,
+                            const QVector<Heap::ArrayBuffer *> &transfer)
+{
+    if (transfer.contains(buffer)) {
+        buffer->data->ref.ref();
+        push(data, valueheader(WorkerTransferredArrayBuffer));
+        push(data, (void *)buffer->data);
+        return;
+    }
+    reserve(data, 2 * sizeof(quint32) + ALIGN(size));
+    push(data, valueheader(WorkerArrayBuffer));
+    push(data, (quint32)size);
+    pushData(data, buffer->data->data() + offset, size);
+}
+
+// Arrays of numbers are written as their int32 or double elements. Packed
+// array data is copied as is.
+static bool serializeNumberArray(QByteArray &data, ArrayObject *array, uint length)
+{
+    Heap::ArrayData *d = array->arrayData();
+    if (!length || !d || d->isSparse() || d->len != length || d->attrs)
+        return false;
+
+    if (d->isPacked()) {
+        Heap::PackedArrayData *pd = static_cast<Heap::PackedArrayData *>(d);
+        const uint size = length * Heap::PackedArrayData::elementSize(pd->type);
+        reserve(data, sizeof(quint32) + size);
+        push(data, valueheader(pd->type == Heap::ArrayData::PackedInt32 ? WorkerInt32Array : WorkerNumberArray, length));
+        pushData(data, pd->payload(), size);
+        return true;
+    }
+
+    Heap::SimpleArrayData *sd = static_cast<Heap::SimpleArrayData *>(d);
+    bool integers = true;
+    for (uint ii = 0; ii < length; ++ii) {
+        const Value &v = sd->data(ii);
+        if (v.isInteger())
+            continue;
+        if (!v.isNumber())
+            return false;
+        integers = false;
+    }
+
+    if (integers) {
+        reserve(data, sizeof(quint32) + length * sizeof(quint32));
+        push(data, valueheader(WorkerInt32Array, length));
+        for (uint ii = 0; ii < length; ++ii)
+            push(data, (quint32)sd->data(ii).integerValue());
+    } else {
+        reserve(data, sizeof(quint32) + length * sizeof(double));
+        push(data, valueheader(WorkerNumberArray, length));
+        for (uint ii = 0; ii < length; ++ii)
+            push(data, sd->data(ii).asDouble());
+    }
+    return true;
+}
+
+void Serialize::serialize(QByteArray &data, const QV4::ValueRef v, ExecutionEngine *engine,
+                          const QVector<Heap::ArrayBuffer *> &transfer)
 {
     QV4::Scope scope(engine);
 
@@ -179,11 +260,13 @@ void Serialize::serialize(QByteArray &data, const QV4::ValueRef v, ExecutionEngi
             push(data, valueheader(WorkerUndefined));
             return;
         }
+        if (serializeNumberArray(data, array, length))
+            return;
         reserve(data, sizeof(quint32) + length * sizeof(quint32));
         push(data, valueheader(WorkerArray, length));
         ScopedValue val(scope);
         for (uint ii = 0; ii < length; ++ii)
-            serialize(data, (val = array->getIndexed(ii)), engine);
+            serialize(data, (val = array->getIndexed(ii)), engine, transfer);
     } else if (v->isInteger()) {
         reserve(data, 2 * sizeof(quint32));
         push(data, valueheader(WorkerInt32));
@@ -220,6 +303,18 @@ void Serialize::serialize(QByteArray &data, const QV4::ValueRef v, ExecutionEngi
         char *buffer = data.data() + offset;
 
         memcpy(buffer, pattern.constData(), length*sizeof(QChar));
+    } else if (v->as<ArrayBuffer>()) {
+        Scoped<ArrayBuffer> buffer(scope, v);
+        serializeBuffer(data, buffer->d(), 0, buffer->byteLength(), transfer);
+    } else if (v->as<TypedArray>()) {
+        // a copied buffer only holds the elements in view
+        Scoped<TypedArray> array(scope, v);
+        Heap::ArrayBuffer *buffer = array->d()->buffer;
+        const bool transferred = transfer.contains(buffer);
+        push(data, valueheader(WorkerTypedArray, array->arrayType()));
+        push(data, (quint32)(transferred ? array->d()->byteOffset : 0));
+        push(data, (quint32)array->byteLength());
+        serializeBuffer(data, buffer, array->d()->byteOffset, array->byteLength(), transfer);
     } else if (v->as<QV4::QObjectWrapper>()) {
         Scoped<QObjectWrapper> qobjectWrapper(scope, v);
         // XXX TODO: Generalize passing objects between the main thread and worker scripts so
@@ -246,10 +341,10 @@ void Serialize::serialize(QByteArray &data, const QV4::ValueRef v, ExecutionEngi
             }
             reserve(data, sizeof(quint32) + length * sizeof(quint32));
             push(data, valueheader(WorkerSequence, length));
-            serialize(data, QV4::Primitive::fromInt32(QV4::SequencePrototype::metaTypeForSequence(o)), engine); // sequence type
+            serialize(data, QV4::Primitive::fromInt32(QV4::SequencePrototype::metaTypeForSequence(o)), engine, transfer); // sequence type
             ScopedValue val(scope);
             for (uint ii = 0; ii < seqLength; ++ii)
-                serialize(data, (val = o->getIndexed(ii)), engine); // sequence elements
+                serialize(data, (val = o->getIndexed(ii)), engine, transfer); // sequence elements
 
             return;
         }
@@ -268,14 +363,14 @@ void Serialize::serialize(QByteArray &data, const QV4::ValueRef v, ExecutionEngi
         QV4::ScopedString str(scope);
         for (quint32 ii = 0; ii < length; ++ii) {
             s = properties->getIndexed(ii);
-            serialize(data, s, engine);
+            serialize(data, s, engine, transfer);
 
             str = s;
             val = o->get(str);
             if (scope.hasException())
                 scope.engine->catchException();
 
-            serialize(data, val, engine);
+            serialize(data, val, engine, transfer);
         }
         return;
     } else {
@@ -385,6 +480,50 @@ ReturnedValue Serialize::deserialize(const char *&data, ExecutionEngine *engine)
         QVariant seqVariant = QV4::SequencePrototype::toVariant(array, sequenceType, &succeeded);
         return QV4::SequencePrototype::fromVariant(engine, seqVariant, &succeeded);
     }
+    case WorkerArrayBuffer:
+    {
+        quint32 size = popUint32(data);
+        Scoped<ArrayBuffer> buffer(scope, engine->memoryManager->alloc<ArrayBuffer>(engine, (int)size));
+        if (scope.hasException())
+            return Encode::undefined();
+        memcpy(buffer->data(), data, size);
+        data += ALIGN(size);
+        return buffer.asReturnedValue();
+    }
+    case WorkerTransferredArrayBuffer:
+    {
+        QTypedArrayData<char> *bufferData = (QTypedArrayData<char> *)popPtr(data);
+        return Encode(engine->memoryManager->alloc<ArrayBuffer>(engine, bufferData));
+    }
+    case WorkerTypedArray:
+    {
+        Heap::TypedArray::Type arrayType = (Heap::TypedArray::Type)headersize(header);
+        quint32 byteOffset = popUint32(data);
+        quint32 byteLength = popUint32(data);
+        Scoped<ArrayBuffer> buffer(scope, deserialize(data, engine));
+        if (!buffer)
+            return Encode::undefined();
+        Scoped<TypedArray> array(scope, engine->memoryManager->alloc<TypedArray>(engine, arrayType));
+        array->d()->buffer = buffer->d();
+        array->d()->byteOffset = byteOffset;
+        array->d()->byteLength = byteLength;
+        return array.asReturnedValue();
+    }
+    case WorkerInt32Array:
+    case WorkerNumberArray:
+    {
+        quint32 size = headersize(header);
+        Heap::ArrayData::Type arrayType = type == WorkerInt32Array ? Heap::ArrayData::PackedInt32 : Heap::ArrayData::PackedDouble;
+        ScopedArrayObject a(scope, engine->newArrayObject());
+        ArrayData::realloc(a, arrayType, size, false);
+        Heap::PackedArrayData *pd = static_cast<Heap::PackedArrayData *>(a->arrayData());
+        uint bytes = size * Heap::PackedArrayData::elementSize(arrayType);
+        memcpy(pd->payload(), data, bytes);
+        data += ALIGN(bytes);
+        pd->len = size;
+        a->setArrayLengthUnchecked(size);
+        return a.asReturnedValue();
+    }
     }
     Q_ASSERT(!"Unreachable");
     return QV4::Encode::undefined();
@@ -393,7 +532,39 @@ ReturnedValue Serialize::deserialize(const char *&data, ExecutionEngine *engine)
 QByteArray Serialize::serialize(const QV4::ValueRef value, ExecutionEngine *engine)
 {
     QByteArray rv;
-    serialize(rv, value, engine);
+    serialize(rv, value, engine, QVector<Heap::ArrayBuffer *>());
+    return rv;
+}
+
+QByteArray Serialize::serialize(const QV4::ValueRef value, const QV4::ValueRef transfer, ExecutionEngine *engine)
+{
+    Scope scope(engine);
+    // Getters run while serializing can modify the transfer list, the buffers
+    // are kept alive by a copy of it.
+    QVector<Heap::ArrayBuffer *> buffers;
+    ScopedArrayObject transferred(scope, engine->newArrayObject());
+    ScopedArrayObject list(scope, transfer);
+    if (list) {
+        uint length = list->getLength();
+        Scoped<ArrayBuffer> buffer(scope);
+        for (uint ii = 0; ii < length; ++ii) {
+            buffer = list->getIndexed(ii);
+            if (buffer && !buffers.contains(buffer->d())) {
+                transferred->push_back(buffer);
+                buffers.append(buffer->d());
+            }
+        }
+    }
+
+    QByteArray rv;
+    serialize(rv, value, engine, buffers);
+
+    // the message holds references to the transferred data now
+    Scoped<ArrayBuffer> buffer(scope);
+    foreach (Heap::ArrayBuffer *b, buffers) {
+        buffer = b;
+        buffer->neuter();
+    }
     return rv;
 }
 
@@ -46,6 +46,7 @@
 //
 
 #include <QtCore/qbytearray.h>
+#include <QtCore/qvector.h>
 #include <private/qv4value_inl_p.h>
 
 QT_BEGIN_NAMESPACE
@@ -58,10 +59,13 @@ class Serialize {
 public:
 
     static QByteArray serialize(const ValueRef, ExecutionEngine *);
+    // ArrayBuffers in the transfer array are moved into the message
+    static QByteArray serialize(const ValueRef, const ValueRef transfer, ExecutionEngine *);
     static ReturnedValue deserialize(const QByteArray &, ExecutionEngine *);
 
 private:
-    static void serialize(QByteArray &, const ValueRef, ExecutionEngine *);
+    // the transferred buffers have to be kept alive by the caller
+    static void serialize(QByteArray &, const ValueRef, ExecutionEngine *, const QVector<Heap::ArrayBuffer *> &transfer);
     static ReturnedValue deserialize(const char *&, ExecutionEngine *);
 };
 
@@ -231,7 +231,7 @@ ReturnedValue TypedArrayCtor::construct(Managed *m, CallData *callData)
         Scoped<ArrayBuffer> buffer(scope, typedArray->d()->buffer);
         uint srcElementSize = typedArray->d()->type->bytesPerElement;
         uint destElementSize = operations[that->d()->type].bytesPerElement;
-        uint byteLength = typedArray->d()->byteLength;
+        uint byteLength = typedArray->byteLength();
         uint destByteLength = byteLength*destElementSize/srcElementSize;
 
         Scoped<ArrayBuffer> newBuffer(scope, scope.engine->memoryManager->alloc<ArrayBuffer>(scope.engine, destByteLength));
@@ -333,6 +333,11 @@ ReturnedValue TypedArrayCtor::call(Managed *that, CallData *callData)
     return construct(that, callData);
 }
 
+Heap::TypedArray::Type TypedArray::arrayType() const
+{
+    return (Heap::TypedArray::Type)(d()->type - operations);
+}
+
 Heap::TypedArray::TypedArray(ExecutionEngine *e, Type t)
     : Heap::Object(e->typedArrayClasses[t], e->typedArrayPrototype[t].asObject()),
       type(operations + t)
@@ -370,12 +375,21 @@ void TypedArray::putIndexed(Managed *m, uint index, const ValueRef value)
     Scope scope(m->engine());
     Scoped<TypedArray> a(scope, static_cast<TypedArray *>(m));
 
+    // Converting the value can call valueOf(), which may neuter the buffer. Do it before the
+    // bounds check, the write itself then doesn't run any JavaScript.
+    ScopedValue v(scope, value->asReturnedValue());
+    if (!v->isNumber()) {
+        v = Primitive::fromDouble(v->toNumber());
+        if (scope.engine->hasException)
+            return;
+    }
+
     uint bytesPerElement = a->d()->type->bytesPerElement;
     uint byteOffset = a->d()->byteOffset + index * bytesPerElement;
     if (byteOffset + bytesPerElement > (uint)a->d()->buffer->byteLength())
         goto reject;
 
-    a->d()->type->write(scope.engine, a->d()->buffer->data->data(), byteOffset, value);
+    a->d()->type->write(scope.engine, a->d()->buffer->data->data(), byteOffset, v);
     return;
 
 reject:
@@ -418,7 +432,7 @@ ReturnedValue TypedArrayPrototype::method_get_byteLength(CallContext *ctx)
     if (!v)
         return scope.engine->throwTypeError();
 
-    return Encode(v->d()->byteLength);
+    return Encode(v->byteLength());
 }
 
 ReturnedValue TypedArrayPrototype::method_get_byteOffset(CallContext *ctx)
@@ -438,7 +452,7 @@ ReturnedValue TypedArrayPrototype::method_get_length(CallContext *ctx)
     if (!v)
         return scope.engine->throwTypeError();
 
-    return Encode(v->d()->byteLength/v->d()->type->bytesPerElement);
+    return Encode(v->length());
 }
 
 ReturnedValue TypedArrayPrototype::method_set(CallContext *ctx)
@@ -476,15 +490,20 @@ ReturnedValue TypedArrayPrototype::method_set(CallContext *ctx)
             return scope.engine->throwRangeError(QStringLiteral("TypedArray.set: out of range"));
 
         uint idx = 0;
-        char *b = buffer->d()->data->data() + a->d()->byteOffset + offset*elementSize;
         ScopedValue val(scope);
         while (idx < l) {
+            // Getters and valueOf() may neuter the buffer, so every element is converted before
+            // the bounds are checked and the data is looked up again.
             val = o->getIndexed(idx);
-            a->d()->type->write(scope.engine, b, 0, val);
+            if (!scope.engine->hasException && !val->isNumber())
+                val = Primitive::fromDouble(val->toNumber());
             if (scope.engine->hasException)
                 return Encode::undefined();
+            if (offset + l > a->length())
+                return scope.engine->throwTypeError();
+            char *b = buffer->d()->data->data() + a->d()->byteOffset + (offset + idx)*elementSize;
+            a->d()->type->write(scope.engine, b, 0, val);
             ++idx;
-            b += elementSize;
         }
         return Encode::undefined();
     }
@@ -502,15 +521,15 @@ ReturnedValue TypedArrayPrototype::method_set(CallContext *ctx)
     const char *src = srcBuffer->d()->data->data() + srcTypedArray->d()->byteOffset;
     if (srcTypedArray->d()->type == a->d()->type) {
         // same type of typed arrays, use memmove (as srcbuffer and buffer could be the same)
-        memmove(dest, src, srcTypedArray->d()->byteLength);
+        memmove(dest, src, srcTypedArray->byteLength());
         return Encode::undefined();
     }
 
     char *srcCopy = 0;
     if (buffer->d() == srcBuffer->d()) {
         // same buffer, need to take a temporary copy, to not run into problems
-        srcCopy = new char[srcTypedArray->d()->byteLength];
-        memcpy(srcCopy, src, srcTypedArray->d()->byteLength);
+        srcCopy = new char[srcTypedArray->byteLength()];
+        memcpy(srcCopy, src, srcTypedArray->byteLength());
         src = srcCopy;
     }
 
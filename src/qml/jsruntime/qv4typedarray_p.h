@@ -94,9 +94,14 @@ struct TypedArray : Object
 {
     V4_OBJECT2(TypedArray, Object)
 
+    // views on a neutered buffer have no elements
+    uint byteLength() const {
+        return d()->buffer->byteLength() ? d()->byteLength : 0;
+    }
     uint length() const {
-        return d()->byteLength/d()->type->bytesPerElement;
+        return byteLength()/d()->type->bytesPerElement;
     }
+    Heap::TypedArray::Type arrayType() const;
 
 
     static void markObjects(Heap::Base *that, ExecutionEngine *e);
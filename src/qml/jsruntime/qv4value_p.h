@@ -52,6 +52,7 @@ struct Q_QML_EXPORT Base {
         , markBit(0)
         , inUse(1)
         , extensible(1)
+        , isRemembered(0)
     {
         // ####
     //            Q_ASSERT(internal && internal->vtable);
@@ -61,7 +62,7 @@ struct Q_QML_EXPORT Base {
         uchar markBit :  1;
         uchar inUse   :  1;
         uchar extensible : 1; // used by Object
-        uchar _unused : 1;
+        uchar isRemembered : 1; // used by the MemoryManager's write barrier
         uchar needsActivation : 1; // used by FunctionObject
         uchar strictMode : 1; // used by FunctionObject
         uchar bindingKeyFlag : 1;
@@ -76,6 +77,15 @@ struct Q_QML_EXPORT Base {
     inline ReturnedValue asReturnedValue() const;
     inline void mark(QV4::ExecutionEngine *engine);
 
+    // Needs to be called when storing a reference to another heap object into this one.
+    // Objects that survived a collection keep their mark bit while the generational collector
+    // is enabled, so such stores have to be recorded for the next minor collection to see them.
+    void writeBarrier() {
+        if (markBit && !isRemembered)
+            remember();
+    }
+    void remember();
+
     Base **nextFreeRef() {
         return reinterpret_cast<Base **>(this);
     }
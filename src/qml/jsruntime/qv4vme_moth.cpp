@@ -39,6 +39,7 @@
 #include <private/qv4scopedvalue_p.h>
 #include <private/qv4lookup_p.h>
 #include <iostream>
+#include <algorithm>
 
 #include "qv4alloca_p.h"
 
@@ -52,14 +53,72 @@
 #  define TRACE(n, str, ...)
 #endif // DO_TRACE_INSTR
 
+#undef DO_COUNT_INSTR_PAIRS // define to print a histogram of executed instruction pairs at exit
+
 using namespace QV4;
 using namespace QV4::Moth;
 
+#ifdef DO_COUNT_INSTR_PAIRS
+namespace {
+
+#define MOTH_COUNT_INSTR(I, FMT) + 1
+const int instructionCount = 0 FOR_EACH_MOTH_INSTR(MOTH_COUNT_INSTR);
+#undef MOTH_COUNT_INSTR
+
+#define MOTH_INSTR_NAME(I, FMT) #I,
+const char *const instructionNames[] = {
+    FOR_EACH_MOTH_INSTR(MOTH_INSTR_NAME)
+};
+#undef MOTH_INSTR_NAME
+
+// Not thread safe, the counts are only meant to pick candidates for fused instructions.
+struct InstructionPairCounts
+{
+    quint64 counts[instructionCount][instructionCount];
+
+    InstructionPairCounts() { memset(counts, 0, sizeof(counts)); }
+    ~InstructionPairCounts()
+    {
+        QVector<QPair<quint64, int> > pairs;
+        quint64 total = 0;
+        for (int i = 0; i < instructionCount; ++i) {
+            for (int j = 0; j < instructionCount; ++j) {
+                if (counts[i][j]) {
+                    pairs.append(qMakePair(counts[i][j], i * instructionCount + j));
+                    total += counts[i][j];
+                }
+            }
+        }
+        std::sort(pairs.begin(), pairs.end());
+        qDebug("Executed instruction pairs: %llu", total);
+        for (int i = pairs.size() - 1; i >= 0 && i >= pairs.size() - 40; --i) {
+            const int first = pairs.at(i).second / instructionCount;
+            const int second = pairs.at(i).second % instructionCount;
+            qDebug("  %12llu %5.2f%%  %s -> %s", pairs.at(i).first, 100. * pairs.at(i).first / total,
+                   instructionNames[first], instructionNames[second]);
+        }
+    }
+};
+
+InstructionPairCounts instructionPairCounts;
+
+} // anonymous namespace
+
+#  define COUNT_INSTR_PAIR(I) { \
+    if (previousInstr >= 0) \
+        ++instructionPairCounts.counts[previousInstr][Instr::I]; \
+    previousInstr = Instr::I; \
+    }
+#else
+#  define COUNT_INSTR_PAIR(I)
+#endif // DO_COUNT_INSTR_PAIRS
+
 #define MOTH_BEGIN_INSTR_COMMON(I) { \
     const InstrMeta<(int)Instr::I>::DataType &instr = InstrMeta<(int)Instr::I>::data(*genericInstr); \
     code += InstrMeta<(int)Instr::I>::Size; \
     Q_UNUSED(instr); \
-    TRACE_INSTR(I)
+    TRACE_INSTR(I) \
+    COUNT_INSTR_PAIR(I)
 
 #ifdef MOTH_THREADED_INTERPRETER
 
@@ -116,6 +175,12 @@ Param traceParam(const Param &param)
     if (engine->hasException) \
         goto catchException
 
+#define TAKE_JUMP(offset) { \
+    if (offset < 0 && backEdgeCount) \
+        ++*backEdgeCount; \
+    code = ((uchar *)&offset) + offset; \
+    }
+
 QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
 #ifdef MOTH_THREADED_INTERPRETER
         , void ***storeJumpTable
@@ -142,6 +207,9 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
     unsigned stackSize = 0;
 
     const uchar *exceptionHandler = 0;
+#ifdef DO_COUNT_INSTR_PAIRS
+    int previousInstr = -1;
+#endif
 
     QV4::Scope scope(engine);
     QV4::ScopedContext context(scope, engine->currentContext());
@@ -205,12 +273,12 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
 
     MOTH_BEGIN_INSTR(LoadRuntimeString)
 //        TRACE(value, "%s", instr.value.toString(context)->toQString().toUtf8().constData());
-        VALUE(instr.result) = context->d()->compilationUnit->runtimeStrings[instr.stringId];
+        VALUE(instr.result) = context->d()->compilationUnit->runtimeString(instr.stringId);
     MOTH_END_INSTR(LoadRuntimeString)
 
     MOTH_BEGIN_INSTR(LoadRegExp)
 //        TRACE(value, "%s", instr.value.toString(context)->toQString().toUtf8().constData());
-        VALUE(instr.result) = context->d()->compilationUnit->runtimeRegularExpressions[instr.regExpId];
+        VALUE(instr.result) = context->d()->compilationUnit->runtimeRegularExpression(instr.regExpId);
     MOTH_END_INSTR(LoadRegExp)
 
     MOTH_BEGIN_INSTR(LoadClosure)
@@ -218,7 +286,7 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
     MOTH_END_INSTR(LoadClosure)
 
     MOTH_BEGIN_INSTR(LoadName)
-        TRACE(inline, "property name = %s", runtimeStrings[instr.name]->toQString().toUtf8().constData());
+        TRACE(inline, "property name = %s", runtimeString(instr.name)->toQString().toUtf8().constData());
         STOREVALUE(instr.result, Runtime::getActivationProperty(engine, instr.name));
     MOTH_END_INSTR(LoadName)
 
@@ -228,7 +296,7 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
     MOTH_END_INSTR(GetGlobalLookup)
 
     MOTH_BEGIN_INSTR(StoreName)
-        TRACE(inline, "property name = %s", runtimeStrings[instr.name]->toQString().toUtf8().constData());
+        TRACE(inline, "property name = %s", runtimeString(instr.name)->toQString().toUtf8().constData());
         Runtime::setActivationProperty(engine, instr.name, VALUEPTR(instr.source));
         CHECK_EXCEPTION;
     MOTH_END_INSTR(StoreName)
@@ -262,6 +330,22 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
         STOREVALUE(instr.result, l->getter(l, engine, VALUEPTR(instr.base)));
     MOTH_END_INSTR(GetLookup)
 
+    MOTH_BEGIN_INSTR(RecordType)
+        if (typeFeedback) {
+            const QV4::Value *value = VALUEPTR(instr.value);
+            if (value->isInteger())
+                typeFeedback[instr.slot] |= ObservedInteger;
+            else if (value->isDouble())
+                typeFeedback[instr.slot] |= ObservedDouble;
+            else if (value->isBoolean())
+                typeFeedback[instr.slot] |= ObservedBoolean;
+            else if (value->isString())
+                typeFeedback[instr.slot] |= ObservedString;
+            else
+                typeFeedback[instr.slot] |= ObservedOther;
+        }
+    MOTH_END_INSTR(RecordType)
+
     MOTH_BEGIN_INSTR(StoreProperty)
         Runtime::setProperty(engine, VALUEPTR(instr.base), instr.name, VALUEPTR(instr.source));
         CHECK_EXCEPTION;
@@ -317,7 +401,7 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
     MOTH_END_INSTR(CallValue)
 
     MOTH_BEGIN_INSTR(CallProperty)
-        TRACE(property name, "%s, args=%u, argc=%u, this=%s", qPrintable(runtimeStrings[instr.name]->toQString()), instr.callData, instr.argc, (VALUE(instr.base)).toString(context)->toQString().toUtf8().constData());
+        TRACE(property name, "%s, args=%u, argc=%u, this=%s", qPrintable(runtimeString(instr.name)->toQString()), instr.callData, instr.argc, (VALUE(instr.base)).toString(context)->toQString().toUtf8().constData());
         Q_ASSERT(instr.callData + instr.argc + qOffsetOf(QV4::CallData, args)/sizeof(QV4::Value) <= stackSize);
         QV4::CallData *callData = reinterpret_cast<QV4::CallData *>(stack + instr.callData);
         callData->tag = QV4::Value::Integer_Type;
@@ -451,6 +535,10 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
         CHECK_EXCEPTION;
     MOTH_END_INSTR(CallBuiltinConvertThisToObject)
 
+    MOTH_BEGIN_INSTR(CallBuiltinIsClosure)
+        STOREVALUE(instr.result, Runtime::isClosure(engine, VALUEPTR(instr.value), instr.functionId, instr.scopeDepth));
+    MOTH_END_INSTR(CallBuiltinIsClosure)
+
     MOTH_BEGIN_INSTR(CreateValue)
         Q_ASSERT(instr.callData + instr.argc + qOffsetOf(QV4::CallData, args)/sizeof(QV4::Value) <= stackSize);
         QV4::CallData *callData = reinterpret_cast<QV4::CallData *>(stack + instr.callData);
@@ -497,23 +585,39 @@ QV4::ReturnedValue VME::run(ExecutionEngine *engine, const uchar *code
     MOTH_END_INSTR(ConstructGlobalLookup)
 
     MOTH_BEGIN_INSTR(Jump)
-        code = ((uchar *)&instr.offset) + instr.offset;
+        TAKE_JUMP(instr.offset);
     MOTH_END_INSTR(Jump)
 
     MOTH_BEGIN_INSTR(JumpEq)
         bool cond = VALUEPTR(instr.condition)->toBoolean();
         TRACE(condition, "%s", cond ? "TRUE" : "FALSE");
         if (cond)
-            code = ((uchar *)&instr.offset) + instr.offset;
+            TAKE_JUMP(instr.offset);
     MOTH_END_INSTR(JumpEq)
 
     MOTH_BEGIN_INSTR(JumpNe)
         bool cond = VALUEPTR(instr.condition)->toBoolean();
         TRACE(condition, "%s", cond ? "TRUE" : "FALSE");
         if (!cond)
-            code = ((uchar *)&instr.offset) + instr.offset;
+            TAKE_JUMP(instr.offset);
     MOTH_END_INSTR(JumpNe)
 
+    MOTH_BEGIN_INSTR(CompareJumpEq)
+        bool cond = instr.compare(VALUEPTR(instr.lhs), VALUEPTR(instr.rhs));
+        CHECK_EXCEPTION;
+        TRACE(condition, "%s", cond ? "TRUE" : "FALSE");
+        if (cond)
+            TAKE_JUMP(instr.offset);
+    MOTH_END_INSTR(CompareJumpEq)
+
+    MOTH_BEGIN_INSTR(CompareJumpNe)
+        bool cond = instr.compare(VALUEPTR(instr.lhs), VALUEPTR(instr.rhs));
+        CHECK_EXCEPTION;
+        TRACE(condition, "%s", cond ? "TRUE" : "FALSE");
+        if (!cond)
+            TAKE_JUMP(instr.offset);
+    MOTH_END_INSTR(CompareJumpNe)
+
     MOTH_BEGIN_INSTR(UNot)
         STOREVALUE(instr.result, Runtime::uNot(VALUEPTR(instr.source)));
     MOTH_END_INSTR(UNot)
@@ -684,7 +788,13 @@ void **VME::instructionJumpTable()
 
 QV4::ReturnedValue VME::exec(ExecutionEngine *engine, const uchar *code)
 {
-    VME vme;
+    return exec(engine, code, 0, 0);
+}
+
+QV4::ReturnedValue VME::exec(ExecutionEngine *engine, const uchar *code, quint32 *backEdgeCount,
+                             quint8 *typeFeedback)
+{
+    VME vme(backEdgeCount, typeFeedback);
     QV4::Debugging::Debugger *debugger = engine->debugger;
     if (debugger)
         debugger->enteringFunction();
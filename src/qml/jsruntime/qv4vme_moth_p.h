@@ -46,17 +46,27 @@ class VME
 {
 public:
     static QV4::ReturnedValue exec(QV4::ExecutionEngine *, const uchar *);
+    // Also counts the backward jumps taken and records the types read by RecordType, for the
+    // tiered execution mode.
+    static QV4::ReturnedValue exec(QV4::ExecutionEngine *, const uchar *, quint32 *backEdgeCount,
+                                   quint8 *typeFeedback);
 
 #ifdef MOTH_THREADED_INTERPRETER
     static void **instructionJumpTable();
 #endif
 
 private:
+    explicit VME(quint32 *backEdgeCount = 0, quint8 *typeFeedback = 0)
+        : backEdgeCount(backEdgeCount), typeFeedback(typeFeedback) {}
+
     QV4::ReturnedValue run(QV4::ExecutionEngine *, const uchar *code
 #ifdef MOTH_THREADED_INTERPRETER
             , void ***storeJumpTable = 0
 #endif
             );
+
+    quint32 *backEdgeCount;
+    quint8 *typeFeedback;
 };
 
 } // namespace Moth
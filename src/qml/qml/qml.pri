@@ -59,7 +59,8 @@ SOURCES += \
     $$PWD/qqmlvaluetypewrapper.cpp \
     $$PWD/qqmltypewrapper.cpp \
     $$PWD/qqmlfileselector.cpp \
-    $$PWD/qqmlobjectcreator.cpp
+    $$PWD/qqmlobjectcreator.cpp \
+    $$PWD/qqmldiskcache.cpp
 
 HEADERS += \
     $$PWD/qqmlglobal_p.h \
@@ -133,7 +134,8 @@ HEADERS += \
     $$PWD/qqmltypewrapper_p.h \
     $$PWD/qqmlfileselector_p.h \
     $$PWD/qqmlfileselector.h \
-    $$PWD/qqmlobjectcreator_p.h
+    $$PWD/qqmlobjectcreator_p.h \
+    $$PWD/qqmldiskcache_p.h
 
 include(ftw/ftw.pri)
 include(v8/v8.pri)
@@ -38,11 +38,19 @@
 
 QT_BEGIN_NAMESPACE
 
+struct StaticMetaCallProperty {
+    QMetaObject::StaticMetacallFunction metaCall;
+    int index;
+};
+
 struct AccessorProperties {
     AccessorProperties();
+    ~AccessorProperties();
 
     QReadWriteLock lock;
     QHash<const QMetaObject *, QQmlAccessorProperties::Properties> properties;
+    // One entry per property of the meta object, relative to its property offset
+    QHash<const QMetaObject *, StaticMetaCallProperty *> staticMetaCallProperties;
 };
 
 Q_GLOBAL_STATIC(AccessorProperties, accessorProperties)
@@ -65,6 +73,22 @@ AccessorProperties::AccessorProperties()
 {
 }
 
+AccessorProperties::~AccessorProperties()
+{
+    QHash<const QMetaObject *, StaticMetaCallProperty *>::ConstIterator it = staticMetaCallProperties.constBegin();
+    for (; it != staticMetaCallProperties.constEnd(); ++it)
+        delete [] it.value();
+}
+
+static void staticMetaCallRead(QObject *object, qintptr property, void *output)
+{
+    const StaticMetaCallProperty *p = reinterpret_cast<const StaticMetaCallProperty *>(property);
+    void *args[] = { output, 0 };
+    p->metaCall(object, QMetaObject::ReadProperty, p->index, args);
+}
+
+static QQmlAccessors qml_static_metacall_accessors = { staticMetaCallRead, 0 };
+
 QQmlAccessorProperties::Properties::Properties(Property *properties, int count)
 : count(count), properties(properties)
 {
@@ -96,4 +120,35 @@ void QQmlAccessorProperties::registerProperties(const QMetaObject *mo, int count
     This->properties.insert(mo, properties);
 }
 
+QQmlAccessors *QQmlAccessorProperties::staticMetaCallAccessors()
+{
+    return &qml_static_metacall_accessors;
+}
+
+qintptr QQmlAccessorProperties::staticMetaCallData(const QMetaObject *mo, int relativePropertyIndex)
+{
+    Q_ASSERT(mo->d.static_metacall);
+    Q_ASSERT(relativePropertyIndex >= 0 && relativePropertyIndex < mo->propertyCount() - mo->propertyOffset());
+
+    AccessorProperties *This = accessorProperties();
+
+    {
+        QReadLocker lock(&This->lock);
+        if (StaticMetaCallProperty *properties = This->staticMetaCallProperties.value(mo))
+            return reinterpret_cast<qintptr>(properties + relativePropertyIndex);
+    }
+
+    QWriteLocker lock(&This->lock);
+    StaticMetaCallProperty *&properties = This->staticMetaCallProperties[mo];
+    if (!properties) {
+        const int count = mo->propertyCount() - mo->propertyOffset();
+        properties = new StaticMetaCallProperty[count];
+        for (int ii = 0; ii < count; ++ii) {
+            properties[ii].metaCall = mo->d.static_metacall;
+            properties[ii].index = ii;
+        }
+    }
+    return reinterpret_cast<qintptr>(properties + relativePropertyIndex);
+}
+
 QT_END_NAMESPACE
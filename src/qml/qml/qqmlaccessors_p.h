@@ -126,6 +126,12 @@ namespace QQmlAccessorProperties {
 
     Properties properties(const QMetaObject *);
     void Q_QML_PRIVATE_EXPORT registerProperties(const QMetaObject *, int, Property *);
+
+    // Generic accessors for simple properties of C++ types without registered accessors.
+    // They read through the static metacall of the class declaring the property, which
+    // skips the qt_metacall chain of the object. There is no notifier.
+    QQmlAccessors *staticMetaCallAccessors();
+    qintptr staticMetaCallData(const QMetaObject *, int relativePropertyIndex);
 };
 
 QQmlAccessorProperties::Property *
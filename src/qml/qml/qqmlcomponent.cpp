@@ -1471,6 +1471,7 @@ QV4::ReturnedValue QV4::QmlIncubatorObject::method_set_statusChanged(QV4::CallCo
 
 
     o->d()->statusChanged = ctx->d()->callData->args[0];
+    o->d()->writeBarrier();
     return QV4::Encode::undefined();
 }
 
@@ -396,6 +396,7 @@ ReturnedValue QmlContextWrapper::idObjectsArray()
     if (!d()->idObjectsWrapper) {
         ExecutionEngine *v4 = engine();
         d()->idObjectsWrapper = v4->memoryManager->alloc<QQmlIdObjectsArray>(v4, this);
+        d()->writeBarrier();
     }
     return d()->idObjectsWrapper->asReturnedValue();
 }
@@ -0,0 +1,398 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qqmldiskcache_p.h"
+
+#include <private/qv4compileddata_p.h>
+#include <private/qv4instr_moth_p.h>
+#include <private/qv4engine_p.h>
+#include <private/qv4isel_p.h>
+
+#include <QtCore/qbuffer.h>
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlibraryinfo.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qsavefile.h>
+#include <QtCore/qstandardpaths.h>
+#include <QtCore/qsysinfo.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+const char cacheMagic[] = "qv4cache";
+enum { CacheFormatVersion = 3 };
+enum { HashSize = 20 }; // SHA-1
+
+struct CacheFileHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 unitOffset;
+    quint32 unitSize;
+    quint32 codeOffset;
+    quint32 codeSize;
+    char buildId[HashSize];
+    char sourceChecksum[HashSize];
+};
+
+inline quint32 alignedOffset(quint64 offset)
+{
+    return (offset + 7) & ~quint64(7);
+}
+
+#define MOTH_INSTR_NAME(I, FMT) #I ","
+const char instructionNames[] = FOR_EACH_MOTH_INSTR(MOTH_INSTR_NAME);
+#undef MOTH_INSTR_NAME
+
+#define MOTH_INSTR_SIZE_ENTRY(I, FMT) quint32(MOTH_INSTR_SIZE(I, FMT)),
+const quint32 instructionSizes[] = { FOR_EACH_MOTH_INSTR(MOTH_INSTR_SIZE_ENTRY) };
+#undef MOTH_INSTR_SIZE_ENTRY
+
+const quint32 dataStructureSizes[] = {
+    sizeof(QV4::CompiledData::Unit),
+    sizeof(QV4::CompiledData::Function),
+    sizeof(QV4::CompiledData::Location),
+    sizeof(QV4::CompiledData::RegExp),
+    sizeof(QV4::CompiledData::Lookup),
+    sizeof(QV4::CompiledData::JSClass),
+    sizeof(QV4::CompiledData::JSClassMember),
+    sizeof(QV4::CompiledData::String),
+    sizeof(QV4::CompiledData::Binding),
+    sizeof(QV4::CompiledData::Parameter),
+    sizeof(QV4::CompiledData::Signal),
+    sizeof(QV4::CompiledData::Property),
+    sizeof(QV4::CompiledData::Object),
+    sizeof(QV4::CompiledData::Import)
+};
+
+// Identifies the format of the cached data, which depends on the layout of the
+// compiled data structures and on the interpreter's instruction set. Rebuilding
+// Qt without changing either keeps the cache valid. The sizes catch layout
+// changes that were not accompanied by a QV4_DATA_STRUCTURE_VERSION bump.
+QByteArray computeBuildId()
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const quint32 dataStructureVersion = QV4_DATA_STRUCTURE_VERSION;
+    hash.addData(reinterpret_cast<const char *>(&dataStructureVersion), sizeof(dataStructureVersion));
+    hash.addData(instructionNames, sizeof(instructionNames) - 1);
+    hash.addData(reinterpret_cast<const char *>(instructionSizes), sizeof(instructionSizes));
+    hash.addData(reinterpret_cast<const char *>(dataStructureSizes), sizeof(dataStructureSizes));
+    hash.addData(QLibraryInfo::build());
+    hash.addData(QSysInfo::buildAbi().toLatin1());
+    return hash.result();
+}
+
+const QByteArray &buildId()
+{
+    static const QByteArray id = computeBuildId();
+    return id;
+}
+
+// Cache files are mapped once per process and shared by all units loaded from
+// them. A mapping counts the units using it and is unmapped when the last one
+// is released, also when the file has been replaced on disk in the meantime.
+// Units loaded from the cache are not StaticData, their runtime strings are
+// copies and may outlive the mapping.
+struct MappedCacheFile
+{
+    QString path;
+    QFile *file;
+    const uchar *data;
+    qint64 size;
+    int unitCount;
+};
+
+struct MappedCacheFiles
+{
+    ~MappedCacheFiles()
+    {
+        foreach (MappedCacheFile *mapping, files) {
+            delete mapping->file;
+            delete mapping;
+        }
+    }
+
+    QMutex mutex;
+    QHash<QString, MappedCacheFile *> files;
+};
+
+Q_GLOBAL_STATIC(MappedCacheFiles, mappedCacheFiles)
+
+// Held by each unit loaded from a mapping, see CompilationUnit::dataOwner.
+class MappedCacheFileRef : public QQmlRefCount
+{
+public:
+    MappedCacheFileRef(MappedCacheFile *mapping) : mapping(mapping) {}
+    ~MappedCacheFileRef();
+
+    const uchar *data() const { return mapping->data; }
+
+private:
+    MappedCacheFile *mapping;
+};
+
+MappedCacheFileRef::~MappedCacheFileRef()
+{
+    MappedCacheFiles *mappedFiles = mappedCacheFiles();
+    if (!mappedFiles)
+        return; // Already unmapped at exit.
+    QMutexLocker locker(&mappedFiles->mutex);
+    if (--mapping->unitCount > 0)
+        return;
+    QHash<QString, MappedCacheFile *>::iterator it = mappedFiles->files.find(mapping->path);
+    if (it != mappedFiles->files.end() && *it == mapping)
+        mappedFiles->files.erase(it);
+    delete mapping->file;
+    delete mapping;
+}
+
+bool validateCacheFile(const uchar *mapped, qint64 fileSize, const QByteArray &sourceChecksum, QString *errorString)
+{
+    const CacheFileHeader *header = reinterpret_cast<const CacheFileHeader *>(mapped);
+    if (memcmp(header->magic, cacheMagic, sizeof(header->magic)) != 0
+        || header->version != CacheFormatVersion) {
+        *errorString = QStringLiteral("Cache file format mismatch");
+        return false;
+    }
+    if (memcmp(header->buildId, buildId().constData(), HashSize) != 0) {
+        *errorString = QStringLiteral("Cache file was written by a different Qt build");
+        return false;
+    }
+    if (memcmp(header->sourceChecksum, sourceChecksum.constData(), HashSize) != 0) {
+        *errorString = QStringLiteral("Source has changed");
+        return false;
+    }
+    if (header->unitOffset % 8 || header->codeOffset % 8
+        || header->unitSize < sizeof(QV4::CompiledData::Unit)
+        || quint64(header->unitOffset) + header->unitSize > quint64(fileSize)
+        || quint64(header->codeOffset) + header->codeSize > quint64(fileSize)) {
+        *errorString = QStringLiteral("Cache file is corrupt");
+        return false;
+    }
+
+    const QV4::CompiledData::Unit *unitData = reinterpret_cast<const QV4::CompiledData::Unit *>(mapped + header->unitOffset);
+    if (unitData->unitSize != header->unitSize || !(unitData->flags & QV4::CompiledData::Unit::IsQml)
+        || (unitData->flags & QV4::CompiledData::Unit::StaticData)) {
+        *errorString = QStringLiteral("Cache file is corrupt");
+        return false;
+    }
+    return true;
+}
+
+// Returns a reference to the read-only mapping of the cache file at \a path if
+// it is valid for the given source, mapping the file if it isn't mapped yet or
+// was replaced.
+MappedCacheFileRef *mapCacheFile(const QString &path, const QByteArray &sourceChecksum, QString *errorString)
+{
+    MappedCacheFiles *mappedFiles = mappedCacheFiles();
+    if (!mappedFiles) {
+        *errorString = QStringLiteral("Disk cache is not available");
+        return 0;
+    }
+    QMutexLocker locker(&mappedFiles->mutex);
+
+    MappedCacheFile *existing = mappedFiles->files.value(path);
+    if (existing && validateCacheFile(existing->data, existing->size, sourceChecksum, errorString)) {
+        ++existing->unitCount;
+        return new MappedCacheFileRef(existing);
+    }
+
+    QScopedPointer<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly)) {
+        *errorString = file->errorString();
+        return 0;
+    }
+
+    const qint64 fileSize = file->size();
+    if (fileSize < qint64(sizeof(CacheFileHeader))) {
+        *errorString = QStringLiteral("Cache file is truncated");
+        return 0;
+    }
+
+    const uchar *mapped = file->map(0, fileSize);
+    if (!mapped) {
+        *errorString = file->errorString();
+        return 0;
+    }
+    if (!validateCacheFile(mapped, fileSize, sourceChecksum, errorString))
+        return 0;
+
+    // Units loaded from a previous mapping keep it until they are released.
+    MappedCacheFile *mapping = new MappedCacheFile;
+    mapping->path = path;
+    mapping->file = file.take();
+    mapping->data = mapped;
+    mapping->size = fileSize;
+    mapping->unitCount = 1;
+    mappedFiles->files.insert(path, mapping);
+    return new MappedCacheFileRef(mapping);
+}
+
+}
+
+bool QQmlDiskCache::isEnabled(QV4::ExecutionEngine *engine)
+{
+    static const bool disabled = !qgetenv("QML_DISABLE_DISK_CACHE").isEmpty();
+    // Units compiled for the debugger contain extra instructions. JIT generated code
+    // is not stored, so there is nothing to load with it either.
+    return !disabled && !engine->debugger && engine->iselFactory->canLoadUnits();
+}
+
+QString QQmlDiskCache::cacheDirectory()
+{
+    const QString path = QString::fromLocal8Bit(qgetenv("QML_DISK_CACHE_PATH"));
+    if (!path.isEmpty())
+        return path;
+    const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheLocation.isEmpty())
+        return QString();
+    return cacheLocation + QLatin1String("/qmlcache");
+}
+
+QString QQmlDiskCache::cacheFilePath(const QUrl &url)
+{
+    const QString directory = cacheDirectory();
+    if (directory.isEmpty())
+        return QString();
+    const QByteArray name = QCryptographicHash::hash(url.toString().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return directory + QLatin1Char('/') + QString::fromLatin1(name) + QLatin1String(".qv4c");
+}
+
+QByteArray QQmlDiskCache::checksum(const char *source, int size)
+{
+    return QCryptographicHash::hash(QByteArray::fromRawData(source, size), QCryptographicHash::Sha1);
+}
+
+QQmlRefPointer<QV4::CompiledData::CompilationUnit> QQmlDiskCache::loadUnit(QV4::ExecutionEngine *engine, const QUrl &url,
+                                                                           const QByteArray &sourceChecksum, QString *errorString)
+{
+    typedef QQmlRefPointer<QV4::CompiledData::CompilationUnit> UnitPointer;
+    Q_ASSERT(sourceChecksum.size() == HashSize);
+
+    const QString path = cacheFilePath(url);
+    if (path.isEmpty()) {
+        *errorString = QStringLiteral("No cache directory available");
+        return UnitPointer();
+    }
+
+    QQmlRefPointer<QQmlRefCount> mapping;
+    MappedCacheFileRef *mappingRef = mapCacheFile(path, sourceChecksum, errorString);
+    if (!mappingRef)
+        return UnitPointer();
+    mapping.take(mappingRef);
+    const uchar *mapped = mappingRef->data();
+    const CacheFileHeader *header = reinterpret_cast<const CacheFileHeader *>(mapped);
+
+    UnitPointer unit = engine->iselFactory->createUnitForLoading();
+    if (!unit) {
+        *errorString = QStringLiteral("Loading from the disk cache is not supported by this backend");
+        return UnitPointer();
+    }
+
+    // The unit only reads from the mapping, so every engine loading the same
+    // file shares its pages.
+    unit->data = reinterpret_cast<QV4::CompiledData::Unit *>(const_cast<uchar *>(mapped) + header->unitOffset);
+    unit->dataOwner = mapping;
+
+    if (!unit->loadCodeFromDisk(reinterpret_cast<const char *>(mapped + header->codeOffset), header->codeSize, errorString)) {
+        unit->data = 0;
+        unit->dataOwner = QQmlRefPointer<QQmlRefCount>();
+        return UnitPointer();
+    }
+
+    return unit;
+}
+
+bool QQmlDiskCache::saveUnit(QV4::CompiledData::CompilationUnit *unit, const QUrl &url,
+                             const QByteArray &sourceChecksum, QString *errorString)
+{
+    Q_ASSERT(unit->data);
+    Q_ASSERT(sourceChecksum.size() == HashSize);
+
+    QBuffer code;
+    code.open(QIODevice::WriteOnly);
+    if (!unit->saveCodeToDisk(&code, errorString))
+        return false;
+
+    const QString path = cacheFilePath(url);
+    if (path.isEmpty()) {
+        *errorString = QStringLiteral("No cache directory available");
+        return false;
+    }
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        *errorString = QStringLiteral("Unable to create cache directory");
+        return false;
+    }
+
+    CacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(header.magic));
+    header.version = CacheFormatVersion;
+    header.unitOffset = alignedOffset(sizeof(CacheFileHeader));
+    header.unitSize = unit->data->unitSize;
+    header.codeOffset = alignedOffset(quint64(header.unitOffset) + header.unitSize);
+    header.codeSize = code.data().size();
+    memcpy(header.buildId, buildId().constData(), HashSize);
+    memcpy(header.sourceChecksum, sourceChecksum.constData(), HashSize);
+
+    static const char padding[8] = { 0 };
+
+    // Write to a temporary file and rename, so that concurrent readers never see
+    // a partially written cache file.
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *errorString = file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding, header.unitOffset - sizeof(header));
+    // Units are used straight from the read-only mapping when loaded. The mapping
+    // doesn't outlive them, so they are not StaticData and copy their strings.
+    QByteArray unitData(reinterpret_cast<const char *>(unit->data), header.unitSize);
+    reinterpret_cast<QV4::CompiledData::Unit *>(unitData.data())->flags &= ~QV4::CompiledData::Unit::StaticData;
+    file.write(unitData);
+    file.write(padding, header.codeOffset - header.unitOffset - header.unitSize);
+    file.write(code.data());
+    if (!file.commit()) {
+        *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QT_END_NAMESPACE
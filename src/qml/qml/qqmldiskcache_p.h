@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the QtQml module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QQMLDISKCACHE_P_H
+#define QQMLDISKCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qurl.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qbytearray.h>
+#include <private/qtqmlglobal_p.h>
+#include <private/qqmlrefcount_p.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QV4 {
+struct ExecutionEngine;
+namespace CompiledData {
+struct CompilationUnit;
+}
+}
+
+// Stores compiled units on disk so that they don't need to be compiled again
+// the next time the same source is loaded. Entries are keyed by the url of the
+// source and validated against a checksum of the source and the Qt build that
+// wrote them. Cached files are mapped read-only once per process, all engines
+// loading the same file (e.g. WorkerScript engines) share the mapped unit.
+//
+// Only JavaScript files (.js imports and WorkerScript sources) compiled for
+// the interpreter are cached. QML documents are always compiled from source,
+// and engines using the JIT bypass the cache as machine code is not stored.
+//
+// The cache directory defaults to a "qmlcache" directory in the writable cache
+// location and can be changed with QML_DISK_CACHE_PATH. Setting
+// QML_DISABLE_DISK_CACHE disables the cache.
+class Q_QML_PRIVATE_EXPORT QQmlDiskCache
+{
+public:
+    static bool isEnabled(QV4::ExecutionEngine *engine);
+    static QString cacheDirectory();
+    static QString cacheFilePath(const QUrl &url);
+    static QByteArray checksum(const char *source, int size);
+
+    static QQmlRefPointer<QV4::CompiledData::CompilationUnit> loadUnit(QV4::ExecutionEngine *engine, const QUrl &url,
+                                                                       const QByteArray &sourceChecksum, QString *errorString);
+    static bool saveUnit(QV4::CompiledData::CompilationUnit *unit, const QUrl &url,
+                         const QByteArray &sourceChecksum, QString *errorString);
+};
+
+QT_END_NAMESPACE
+
+#endif // QQMLDISKCACHE_P_H
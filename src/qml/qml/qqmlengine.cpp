@@ -195,6 +195,7 @@ void QQmlEnginePrivate::registerQtQuick2Types(const char *uri, int versionMajor,
     qmlRegisterType<QQmlListElement>(uri, versionMajor, versionMinor, "ListElement"); // Now in QtQml.Models, here for compatibility
     qmlRegisterCustomType<QQmlListModel>(uri, versionMajor, versionMinor, "ListModel", new QQmlListModelParser); // Now in QtQml.Models, here for compatibility
     qmlRegisterType<QQuickWorkerScript>(uri, versionMajor, versionMinor, "WorkerScript");
+    qmlRegisterType<QQuickWorkerScript, 1>(uri, versionMajor, (versionMinor < 6 ? 6 : versionMinor), "WorkerScript"); //Only available in >=2.6
     qmlRegisterType<QQuickPackage>(uri, versionMajor, versionMinor, "Package");
     qmlRegisterType<QQmlDelegateModel>(uri, versionMajor, versionMinor, "VisualDataModel");
     qmlRegisterType<QQmlDelegateModelGroup>(uri, versionMajor, versionMinor, "VisualDataGroup");
@@ -555,7 +556,7 @@ QQmlEnginePrivate::QQmlEnginePrivate(QQmlEngine *e)
 : propertyCapture(0), rootContext(0), isDebugging(false),
   profiler(0), outputWarningsToMsgLog(true),
   cleanup(0), erroredBindings(0), inProgressCreations(0),
-  workerScriptEngine(0),
+  workerScriptThreads(1), nextWorkerScriptEngine(0),
   activeObjectCreator(0),
   networkAccessManager(0), networkAccessManagerFactory(0), urlInterceptor(0),
   scarceResourcesRefCount(0), typeLoader(e), importDatabase(e), uniqueId(1),
@@ -822,12 +823,38 @@ void QQmlEnginePrivate::init()
     }
 }
 
-QQuickWorkerScriptEngine *QQmlEnginePrivate::getWorkerScriptEngine()
+/*
+    Returns the worker script thread with index \a affinity, or the next
+    one of the first QML_WORKERSCRIPT_THREADS threads (one by default) in
+    turn if \a affinity is negative.
+*/
+QQuickWorkerScriptEngine *QQmlEnginePrivate::getWorkerScriptEngine(int affinity)
 {
     Q_Q(QQmlEngine);
-    if (!workerScriptEngine)
-        workerScriptEngine = new QQuickWorkerScriptEngine(q);
-    return workerScriptEngine;
+    if (workerScriptEngines.isEmpty()) {
+        bool ok = false;
+        const int threads = qgetenv("QML_WORKERSCRIPT_THREADS").toInt(&ok);
+        if (ok && threads > 0)
+            workerScriptThreads = threads;
+    }
+
+    if (affinity < 0) {
+        affinity = nextWorkerScriptEngine;
+        nextWorkerScriptEngine = (nextWorkerScriptEngine + 1) % workerScriptThreads;
+    } else {
+        // Every index starts a thread of its own, don't let a typo start thousands of them.
+        const int maxThreads = qMax(workerScriptThreads, int(MaxWorkerScriptAffinity));
+        if (affinity >= maxThreads) {
+            qWarning("QQuickWorkerScript: affinity %d is out of range, using %d", affinity, affinity % maxThreads);
+            affinity %= maxThreads;
+        }
+    }
+
+    if (affinity >= workerScriptEngines.size())
+        workerScriptEngines.resize(affinity + 1);
+    if (!workerScriptEngines.at(affinity))
+        workerScriptEngines[affinity] = new QQuickWorkerScriptEngine(q);
+    return workerScriptEngines.at(affinity);
 }
 
 /*!
@@ -153,8 +153,14 @@ public:
     QV8Engine *v8engine() const { return q_func()->handle(); }
     QV4::ExecutionEngine *v4engine() const { return QV8Engine::getV4(q_func()->handle()); }
 
-    QQuickWorkerScriptEngine *getWorkerScriptEngine();
-    QQuickWorkerScriptEngine *workerScriptEngine;
+    // WorkerScripts run on a pool of threads, each with its own engine.
+    // Threads are started on demand. Explicit affinities wrap around at
+    // MaxWorkerScriptAffinity, or the pool size if that is larger.
+    enum { MaxWorkerScriptAffinity = 64 };
+    QQuickWorkerScriptEngine *getWorkerScriptEngine(int affinity = -1);
+    QVector<QQuickWorkerScriptEngine *> workerScriptEngines;
+    int workerScriptThreads;
+    int nextWorkerScriptEngine;
 
     QUrl baseUrl;
 
@@ -140,6 +140,22 @@ QQmlPropertyData::flagsForProperty(const QMetaProperty &p, QQmlEngine *engine)
     return fastFlagsForProperty(p) | flagsForPropertyType(p.userType(), engine);
 }
 
+static bool hasStaticMetaCallRead(const QQmlPropertyData *data)
+{
+    if (data->getFlags() & QQmlPropertyData::NotFullyResolved)
+        return false;
+
+    switch (data->propType) {
+    case QMetaType::Int:
+    case QMetaType::Bool:
+    case QMetaType::QReal:
+    case QMetaType::QString:
+        return true;
+    default:
+        return false;
+    }
+}
+
 void QQmlPropertyData::lazyLoad(const QMetaProperty &p)
 {
     coreIndex = p.propertyIndex();
@@ -726,6 +742,16 @@ void QQmlPropertyCache::append(const QMetaObject *metaObject,
     int propCount = metaObject->propertyCount();
     int propOffset = metaObject->propertyOffset();
 
+    // Simple properties of C++ QObjects are read straight through the static metacall of this
+    // class, unless the class registered accessors of its own. Gadgets are excluded, their
+    // static metacall doesn't take a QObject.
+    bool isQObject = false;
+    for (const QMetaObject *mo = metaObject; mo && !isQObject; mo = mo->superClass())
+        isQObject = mo == &QObject::staticMetaObject;
+    const bool staticPropertyAccess = !dynamicMetaObject && isQObject
+            && metaObject->d.static_metacall
+            && (QMetaObjectPrivate::get(metaObject)->flags & PropertyAccessInStaticMetaCall);
+
     // update() should have reserved enough space in the vector that this doesn't cause a realloc
     // and invalidate the stringCache.
     propertyIndexCache.resize(propCount - propertyIndexCacheStart);
@@ -778,6 +804,10 @@ void QQmlPropertyCache::append(const QMetaObject *metaObject,
             data->accessorData = accessorProperty->data;
         } else if (old) {
             data->markAsOverrideOf(old);
+        } else if (staticPropertyAccess && data->revision == 0 && hasStaticMetaCallRead(data)) {
+            data->flags |= QQmlPropertyData::HasAccessors;
+            data->accessors = QQmlAccessorProperties::staticMetaCallAccessors();
+            data->accessorData = QQmlAccessorProperties::staticMetaCallData(metaObject, ii - propOffset);
         }
     }
 }
@@ -44,6 +44,7 @@
 #include <private/qqmlprofiler_p.h>
 #include <private/qqmlmemoryprofiler_p.h>
 #include <private/qqmltypecompiler_p.h>
+#include <private/qqmldiskcache_p.h>
 
 #include <QtCore/qdir.h>
 #include <QtCore/qfile.h>
@@ -2581,9 +2582,22 @@ struct EmptyCompilationUnit : public QV4::CompiledData::CompilationUnit
 
 void QQmlScriptBlob::dataReceived(const Data &data)
 {
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(m_typeLoader->engine());
+
+    const bool useDiskCache = QQmlDiskCache::isEnabled(v4);
+    QByteArray sourceChecksum;
+    if (useDiskCache) {
+        sourceChecksum = QQmlDiskCache::checksum(data.data(), data.size());
+        QString errorString;
+        QQmlRefPointer<QV4::CompiledData::CompilationUnit> unit = QQmlDiskCache::loadUnit(v4, finalUrl(), sourceChecksum, &errorString);
+        if (unit) {
+            initializeFromCompilationUnit(unit);
+            return;
+        }
+    }
+
     QString source = QString::fromUtf8(data.data(), data.size());
 
-    QV4::ExecutionEngine *v4 = QV8Engine::getV4(m_typeLoader->engine());
     QmlIR::Document irUnit(v4->debugger != 0);
     QQmlJS::DiagnosticMessage metaDataError;
     irUnit.extractScriptMetaData(source, &metaDataError);
@@ -2616,6 +2630,12 @@ void QQmlScriptBlob::dataReceived(const Data &data)
     // The js unit owns the data and will free the qml unit.
     unit->data = unitData;
 
+    if (useDiskCache) {
+        // Failing to store the unit is not an error, it just gets compiled again next time.
+        QString errorString;
+        QQmlDiskCache::saveUnit(unit, finalUrl(), sourceChecksum, &errorString);
+    }
+
     initializeFromCompilationUnit(unit);
 }
 
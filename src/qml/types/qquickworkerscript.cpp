@@ -37,6 +37,7 @@
 #include <private/qqmlengine_p.h>
 #include <private/qqmlexpression_p.h>
 #include <private/qqmlcontextwrapper_p.h>
+#include <private/qqmldiskcache_p.h>
 
 #include <QtCore/qcoreevent.h>
 #include <QtCore/qcoreapplication.h>
@@ -57,6 +58,7 @@
 #include <private/qv4value_inl_p.h>
 #include <private/qv4functionobject_p.h>
 #include <private/qv4script_p.h>
+#include <private/qv4compileddata_p.h>
 #include <private/qv4scopedvalue_p.h>
 
 QT_BEGIN_NAMESPACE
@@ -123,7 +125,9 @@ class QQuickWorkerScriptEnginePrivate : public QObject
     Q_OBJECT
 public:
     enum WorkerEventTypes {
-        WorkerDestroyEvent = QEvent::User + 100
+        WorkerDestroyEvent = QEvent::User + 100,
+        // Posted to the owner, so that pendingMessagesChanged is emitted on its thread
+        WorkerMessageHandledEvent
     };
 
     QQuickWorkerScriptEnginePrivate(QQmlEngine *eng);
@@ -157,6 +161,9 @@ public:
     QMutex m_lock;
     QWaitCondition m_wait;
 
+    // messages posted to this thread that have not been handled yet
+    QAtomicInt m_pendingMessages;
+
     struct WorkerScript {
         WorkerScript();
         ~WorkerScript();
@@ -166,6 +173,7 @@ public:
         bool initialized;
         QQuickWorkerScript *owner;
         QV4::PersistentValue object;
+        QAtomicInt pendingMessages;
     };
 
     QHash<int, WorkerScript *> workers;
@@ -214,8 +222,8 @@ void QQuickWorkerScriptEnginePrivate::WorkerEngine::init()
 #define SEND_MESSAGE_CREATE_SCRIPT \
     "(function(method, engine) { "\
         "return (function(id) { "\
-            "return (function(message) { "\
-                "if (arguments.length) method(engine, id, message); "\
+            "return (function(message, transfer) { "\
+                "if (arguments.length) method(engine, id, message, transfer); "\
             "}); "\
         "}); "\
     "})"
@@ -281,7 +289,8 @@ QV4::ReturnedValue QQuickWorkerScriptEnginePrivate::method_sendMessage(QV4::Call
 
     QV4::Scope scope(ctx);
     QV4::ScopedValue v(scope, ctx->d()->callData->argument(2));
-    QByteArray data = QV4::Serialize::serialize(v, scope.engine);
+    QV4::ScopedValue transfer(scope, ctx->d()->callData->argument(3));
+    QByteArray data = QV4::Serialize::serialize(v, transfer, scope.engine);
 
     QMutexLocker locker(&engine->p->m_lock);
     WorkerScript *script = engine->p->workers.value(id);
@@ -332,6 +341,7 @@ bool QQuickWorkerScriptEnginePrivate::event(QEvent *event)
         return true;
     } else if (event->type() == (QEvent::Type)WorkerRemoveEvent::WorkerRemove) {
         WorkerRemoveEvent *workerEvent = static_cast<WorkerRemoveEvent *>(event);
+        QMutexLocker locker(&m_lock);
         QHash<int, WorkerScript *>::iterator itr = workers.find(workerEvent->workerId());
         if (itr != workers.end()) {
             delete itr.value();
@@ -345,9 +355,16 @@ bool QQuickWorkerScriptEnginePrivate::event(QEvent *event)
 
 void QQuickWorkerScriptEnginePrivate::processMessage(int id, const QByteArray &data)
 {
+    m_pendingMessages.deref();
     WorkerScript *script = workers.value(id);
     if (!script)
         return;
+    script->pendingMessages.deref();
+    {
+        QMutexLocker locker(&m_lock);
+        if (script->owner)
+            QCoreApplication::postEvent(script->owner, new QEvent((QEvent::Type)WorkerMessageHandledEvent));
+    }
 
     QV4::ExecutionEngine *v4 = QV8Engine::getV4(workerEngine);
     QV4::Scope scope(v4);
@@ -397,11 +414,23 @@ void QQuickWorkerScriptEnginePrivate::processLoad(int id, const QUrl &url)
         }
 
         QByteArray data = f.readAll();
-        QString sourceCode = QString::fromUtf8(data);
-        QmlIR::Document::removeScriptPragmas(sourceCode);
 
-        program.reset(new QV4::Script(v4, activation, sourceCode, url.toString()));
-        program->parse();
+        // Share the unit the type loader stored for this script, if any.
+        QQmlRefPointer<QV4::CompiledData::CompilationUnit> jsUnit;
+        if (QQmlDiskCache::isEnabled(v4)) {
+            QString errorString;
+            jsUnit = QQmlDiskCache::loadUnit(v4, url, QQmlDiskCache::checksum(data.constData(), data.size()), &errorString);
+        }
+
+        if (jsUnit) {
+            program.reset(new QV4::Script(v4, activation, jsUnit));
+        } else {
+            QString sourceCode = QString::fromUtf8(data);
+            QmlIR::Document::removeScriptPragmas(sourceCode);
+
+            program.reset(new QV4::Script(v4, activation, sourceCode, url.toString()));
+            program->parse();
+        }
     }
 
     if (!v4->hasException)
@@ -533,6 +562,8 @@ int QQuickWorkerScriptEngine::registerWorkerScript(QQuickWorkerScript *owner)
 
 void QQuickWorkerScriptEngine::removeWorkerScript(int id)
 {
+    // The worker thread posts events to the owner while holding the lock.
+    QMutexLocker locker(&d->m_lock);
     QQuickWorkerScriptEnginePrivate::WorkerScript* script = d->workers.value(id);
     if (script) {
         script->owner = 0;
@@ -547,9 +578,31 @@ void QQuickWorkerScriptEngine::executeUrl(int id, const QUrl &url)
 
 void QQuickWorkerScriptEngine::sendMessage(int id, const QByteArray &data)
 {
+    d->m_lock.lock();
+    if (QQuickWorkerScriptEnginePrivate::WorkerScript *script = d->workers.value(id))
+        script->pendingMessages.ref();
+    d->m_lock.unlock();
+
+    d->m_pendingMessages.ref();
     QCoreApplication::postEvent(d, new WorkerDataEvent(id, data));
 }
 
+/*
+    Returns the number of messages sent to scripts on this thread that
+    have not been handled yet.
+*/
+int QQuickWorkerScriptEngine::pendingMessages() const
+{
+    return d->m_pendingMessages.load();
+}
+
+int QQuickWorkerScriptEngine::pendingMessages(int id) const
+{
+    QMutexLocker locker(&d->m_lock);
+    QQuickWorkerScriptEnginePrivate::WorkerScript *script = d->workers.value(id);
+    return script ? script->pendingMessages.load() : 0;
+}
+
 void QQuickWorkerScriptEngine::run()
 {
     d->m_lock.lock();
@@ -617,7 +670,7 @@ void QQuickWorkerScriptEngine::run()
         {Threaded ListModel Example}
 */
 QQuickWorkerScript::QQuickWorkerScript(QObject *parent)
-: QObject(parent), m_engine(0), m_scriptId(-1), m_componentComplete(true)
+: QObject(parent), m_engine(0), m_scriptId(-1), m_affinity(-1), m_componentComplete(true)
 {
 }
 
@@ -651,7 +704,61 @@ void QQuickWorkerScript::setSource(const QUrl &source)
 }
 
 /*!
-    \qmlmethod WorkerScript::sendMessage(jsobject message)
+    \qmlproperty int WorkerScript::affinity
+
+    This holds the index of the thread the worker script runs in.
+
+    Worker scripts are run by a pool of threads, each with its own
+    JavaScript engine. By default (-1), worker scripts are assigned to the
+    threads of the pool in turn. The size of the pool is one thread unless
+    the \c QML_WORKERSCRIPT_THREADS environment variable is set.
+
+    Setting the affinity to a value of 0 or higher runs the worker script
+    in that thread, which is started if needed. Worker scripts that share
+    a ListModel should run in the same thread.
+
+    The affinity cannot be changed once the worker script has started.
+    Affinities of 64 or higher, or higher than the pool size if that is
+    larger, wrap around.
+
+    This property was introduced in QtQuick 2.6.
+*/
+int QQuickWorkerScript::affinity() const
+{
+    return m_affinity;
+}
+
+void QQuickWorkerScript::setAffinity(int affinity)
+{
+    if (affinity < 0)
+        affinity = -1;
+    if (m_affinity == affinity)
+        return;
+
+    if (m_engine) {
+        qWarning("QQuickWorkerScript: Cannot change the affinity of a running WorkerScript");
+        return;
+    }
+
+    m_affinity = affinity;
+    emit affinityChanged();
+}
+
+/*!
+    \qmlproperty int WorkerScript::pendingMessages
+
+    This holds the number of messages sent to the worker script that it
+    has not handled yet.
+
+    This property was introduced in QtQuick 2.6.
+*/
+int QQuickWorkerScript::pendingMessages() const
+{
+    return m_engine ? m_engine->pendingMessages(m_scriptId) : 0;
+}
+
+/*!
+    \qmlmethod WorkerScript::sendMessage(jsobject message, array transfer)
 
     Sends the given \a message to a worker script handler in another
     thread. The other worker script handler can receive this message
@@ -663,12 +770,18 @@ void QQuickWorkerScript::setSource(const QUrl &source)
     \list
     \li boolean, number, string
     \li JavaScript objects and arrays
+    \li ArrayBuffer and typed array objects
     \li ListModel objects (any other type of QObject* is not allowed)
     \endlist
 
     All objects and arrays are copied to the \c message. With the exception
     of ListModel objects, any modifications by the other thread to an object
     passed in \c message will not be reflected in the original object.
+
+    ArrayBuffers listed in the optional \a transfer array are moved to the
+    other thread instead of being copied. Their contents are no longer
+    accessible from the sending side: the buffers and all views on them
+    have a length of zero afterwards.
 */
 void QQuickWorkerScript::sendMessage(QQmlV4Function *args)
 {
@@ -679,10 +792,14 @@ void QQuickWorkerScript::sendMessage(QQmlV4Function *args)
 
     QV4::Scope scope(args->v4engine());
     QV4::ScopedValue argument(scope, QV4::Primitive::undefinedValue());
+    QV4::ScopedValue transfer(scope, QV4::Primitive::undefinedValue());
     if (args->length() != 0)
         argument = (*args)[0];
+    if (args->length() > 1)
+        transfer = (*args)[1];
 
-    m_engine->sendMessage(m_scriptId, QV4::Serialize::serialize(argument, scope.engine));
+    m_engine->sendMessage(m_scriptId, QV4::Serialize::serialize(argument, transfer, scope.engine));
+    emit pendingMessagesChanged();
 }
 
 void QQuickWorkerScript::classBegin()
@@ -700,7 +817,7 @@ QQuickWorkerScriptEngine *QQuickWorkerScript::engine()
             return 0;
         }
 
-        m_engine = QQmlEnginePrivate::get(engine)->getWorkerScriptEngine();
+        m_engine = QQmlEnginePrivate::get(engine)->getWorkerScriptEngine(m_affinity);
         m_scriptId = m_engine->registerWorkerScript(this);
 
         if (m_source.isValid())
@@ -742,6 +859,9 @@ bool QQuickWorkerScript::event(QEvent *event)
         WorkerErrorEvent *workerEvent = static_cast<WorkerErrorEvent *>(event);
         QQmlEnginePrivate::warning(qmlEngine(this), workerEvent->error());
         return true;
+    } else if (event->type() == (QEvent::Type)QQuickWorkerScriptEnginePrivate::WorkerMessageHandledEvent) {
+        emit pendingMessagesChanged();
+        return true;
     } else {
         return QObject::event(event);
     }
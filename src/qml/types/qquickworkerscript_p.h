@@ -69,6 +69,9 @@ public:
     void executeUrl(int, const QUrl &);
     void sendMessage(int, const QByteArray &);
 
+    int pendingMessages() const;
+    int pendingMessages(int) const;
+
 protected:
     virtual void run();
 
@@ -82,6 +85,8 @@ class Q_AUTOTEST_EXPORT QQuickWorkerScript : public QObject, public QQmlParserSt
 {
     Q_OBJECT
     Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int affinity READ affinity WRITE setAffinity NOTIFY affinityChanged REVISION 1)
+    Q_PROPERTY(int pendingMessages READ pendingMessages NOTIFY pendingMessagesChanged REVISION 1)
 
     Q_INTERFACES(QQmlParserStatus)
 public:
@@ -91,11 +96,18 @@ public:
     QUrl source() const;
     void setSource(const QUrl &);
 
+    int affinity() const;
+    void setAffinity(int);
+
+    int pendingMessages() const;
+
 public Q_SLOTS:
     void sendMessage(QQmlV4Function*);
 
 Q_SIGNALS:
     void sourceChanged();
+    Q_REVISION(1) void affinityChanged();
+    Q_REVISION(1) void pendingMessagesChanged();
     void message(const QQmlV4Handle &messageObject);
 
 protected:
@@ -107,6 +119,7 @@ private:
     QQuickWorkerScriptEngine *engine();
     QQuickWorkerScriptEngine *m_engine;
     int m_scriptId;
+    int m_affinity;
     QUrl m_source;
     bool m_componentComplete;
 };
@@ -66,6 +66,8 @@
 
 #include <private/qqmlprofilerservice_p.h>
 #include <private/qqmlmemoryprofiler_p.h>
+#include <private/qv8engine_p.h>
+#include <private/qv4mm_p.h>
 
 #include <private/qopenglvertexarrayobject_p.h>
 
@@ -138,6 +140,10 @@ public slots:
                     incubateAgain();
             }
         }
+
+        // Use the rest of the idle time for incremental garbage collection, if enabled.
+        if (QQmlEngine *e = engine())
+            QV8Engine::getV4(e)->memoryManager->runGCSlice();
     }
 
     void animationStopped() { incubate(); }
@@ -33,6 +33,7 @@
 
 #include <qtest.h>
 #include <QLibraryInfo>
+#include <limits>
 
 #include "debugutil_p.h"
 #include "qqmldebugclient.h"
@@ -54,6 +55,7 @@ struct QQmlProfilerData
     int framerate;      //used by animation events
     int animationcount; //used by animation events
     qint64 amount;      //used by heap events
+    qint64 size;        //used by heap snapshot and allocation site events
 
     QByteArray toByteArray() const;
 };
@@ -73,6 +75,10 @@ public:
         PixmapCacheEvent,
         SceneGraphFrame,
         MemoryAllocation,
+        AllocationSite,
+        HeapSnapshot,
+        TierUp,
+        JitStatistics,
 
         MaximumMessage
     };
@@ -139,6 +145,8 @@ public:
     QList<QQmlProfilerData> qmlMessages;
     QList<QQmlProfilerData> javascriptMessages;
     QList<QQmlProfilerData> jsHeapMessages;
+    QList<QQmlProfilerData> heapSnapshotMessages;
+    QList<QQmlProfilerData> jitMessages;
     QList<QQmlProfilerData> asynchronousMessages;
     QList<QQmlProfilerData> pixmapMessages;
 
@@ -149,6 +157,13 @@ public:
         sendMessage(message);
     }
 
+    void setTraceState(bool enabled, quint64 features) {
+        QByteArray message;
+        QDataStream stream(&message, QIODevice::WriteOnly);
+        stream << enabled << -1 << features;
+        sendMessage(message);
+    }
+
 signals:
     void complete();
 
@@ -177,6 +192,7 @@ private:
     void connect(bool block, const QString &testFile);
     void checkTraceReceived();
     void checkJsHeap();
+    void checkHeapSnapshot(bool expected);
 
 private slots:
     void cleanup();
@@ -310,6 +326,50 @@ void QQmlProfilerClient::messageReceived(const QByteArray &message)
         stream >> data.amount;
         break;
     }
+    case QQmlProfilerClient::AllocationSite: {
+        // amount: number of samples, size: sampled bytes
+        QString function;
+        stream >> data.detailData >> data.line >> data.column >> function >> data.amount
+               >> data.size;
+        QVERIFY(data.amount > 0);
+        QVERIFY(data.size > 0);
+        break;
+    }
+    case QQmlProfilerClient::HeapSnapshot: {
+        // amount: number of objects, size: retained size
+        QString retainerPath;
+        qint64 shallowSize;
+        stream >> data.detailData >> data.amount >> shallowSize >> data.size >> retainerPath;
+        QVERIFY(!data.detailData.isEmpty());
+        QVERIFY(data.amount > 0);
+        QVERIFY(shallowSize > 0);
+        QVERIFY(data.size >= shallowSize);
+        QVERIFY(!retainerPath.isEmpty());
+        break;
+    }
+    case QQmlProfilerClient::JitStatistics: {
+        // amount: IR statements, size: generated code size
+        QString function;
+        quint32 irStatements;
+        quint32 basicBlocks;
+        qint64 optimizeTime;
+        qint64 regallocTime;
+        quint32 spills;
+        quint32 codeSize;
+        quint32 executableSize;
+        stream >> data.detailData >> data.line >> data.column >> function >> irStatements
+               >> basicBlocks >> optimizeTime >> regallocTime >> spills >> codeSize
+               >> executableSize;
+        QVERIFY(irStatements > 0);
+        QVERIFY(basicBlocks > 0);
+        QVERIFY(optimizeTime >= 0);
+        QVERIFY(regallocTime >= 0);
+        QVERIFY(codeSize > 0);
+        QVERIFY(executableSize >= codeSize);
+        data.amount = irStatements;
+        data.size = codeSize;
+        break;
+    }
     default:
         QString failMsg = QString("Unknown message type:") + data.messageType;
         QFAIL(qPrintable(failMsg));
@@ -323,6 +383,11 @@ void QQmlProfilerClient::messageReceived(const QByteArray &message)
         asynchronousMessages.append(data);
     else if (data.messageType == QQmlProfilerClient::MemoryAllocation)
         jsHeapMessages.append(data);
+    else if (data.messageType == QQmlProfilerClient::HeapSnapshot ||
+             data.messageType == QQmlProfilerClient::AllocationSite)
+        heapSnapshotMessages.append(data);
+    else if (data.messageType == QQmlProfilerClient::JitStatistics)
+        jitMessages.append(data);
     else if (data.detailType == QQmlProfilerClient::Javascript)
         javascriptMessages.append(data);
     else
@@ -408,6 +473,19 @@ void tst_QQmlProfilerService::checkJsHeap()
     QVERIFY2(seen_large, "No large item seen");
 }
 
+void tst_QQmlProfilerService::checkHeapSnapshot(bool expected)
+{
+    bool seen_snapshot = false;
+    foreach (const QQmlProfilerData &message, m_client->heapSnapshotMessages) {
+        if (message.messageType == QQmlProfilerClient::HeapSnapshot)
+            seen_snapshot = true;
+    }
+    if (expected)
+        QVERIFY2(seen_snapshot, "No heap snapshot seen");
+    else
+        QVERIFY2(!seen_snapshot, "Heap snapshot taken without being requested");
+}
+
 void tst_QQmlProfilerService::cleanup()
 {
     if (QTest::currentTestFailed()) {
@@ -468,6 +546,7 @@ void tst_QQmlProfilerService::blockingConnectWithTraceEnabled()
     m_client->setTraceState(false);
     checkTraceReceived();
     checkJsHeap();
+    checkHeapSnapshot(false);
 }
 
 void tst_QQmlProfilerService::blockingConnectWithTraceDisabled()
@@ -629,12 +708,13 @@ void tst_QQmlProfilerService::javascript()
     QVERIFY(m_client);
     QTRY_COMPARE(m_client->state(), QQmlDebugClient::Enabled);
 
-    m_client->setTraceState(true);
+    m_client->setTraceState(true, std::numeric_limits<quint64>::max());
     while (!(m_process->output().contains(QLatin1String("done"))))
         QVERIFY(QQmlDebugTest::waitForSignal(m_process, SIGNAL(readyReadStandardOutput())));
     m_client->setTraceState(false);
     checkTraceReceived();
     checkJsHeap();
+    checkHeapSnapshot(true);
 
     QVERIFY2(m_client->javascriptMessages.count() >= 22,
              QString::number(m_client->javascriptMessages.count()).toUtf8().constData());
@@ -43,6 +43,17 @@
 #include <qqmlcomponent.h>
 #include <stdlib.h>
 #include <private/qv4alloca_p.h>
+#include <private/qv8engine_p.h>
+#include <private/qv4mm_p.h>
+#include <private/qv4lookup_p.h>
+#include <private/qv4script_p.h>
+#include <private/qv4functionobject_p.h>
+#include <private/qv4tiering_p.h>
+#include <private/qv4isel_moth_p.h>
+#include <private/qv4executableallocator_p.h>
+#include <private/qv4jsonobject_p.h>
+#include <private/qv4serialize_p.h>
+#include <private/qv4runtime_p.h>
 
 #ifdef Q_CC_MSVC
 #define NO_INLINE __declspec(noinline)
@@ -97,6 +108,27 @@ private slots:
     void castWithMultipleInheritance();
     void collectGarbage();
     void gcWithNestedDataStructure();
+    void generationalGC();
+    void generationalWriteBarrier();
+    void incrementalMarking();
+    void incrementalMarkingFromAllocator();
+    void parallelSweep();
+    void bumpAllocation();
+    void polymorphicLookups();
+    void polymorphicAccessorLookups();
+    void tieredExecution();
+    void tieredClosureCheck();
+    void inlinedCalls();
+    void numericLoops();
+    void scalarReplacement();
+    void typeSpeculation();
+    void packedArrays();
+    void interpreterCompareJumps();
+    void executableMemory();
+    void jsonStringify();
+    void jsonParseShapes();
+    void jsonParseLargeObject();
+    void serializeTransfer();
     void stacktrace();
     void numberParsing_data();
     void numberParsing();
@@ -1502,6 +1534,905 @@ void tst_QJSEngine::gcWithNestedDataStructure()
     }
 }
 
+void tst_QJSEngine::generationalGC()
+{
+    // Young objects that are only referenced from old ones have to survive minor collections.
+    qputenv("QV4_MM_GENERATIONAL", "1");
+    QJSEngine eng;
+    qunsetenv("QV4_MM_GENERATIONAL");
+
+    QJSValue ret = eng.evaluate(
+        "var old = { list: [], last: null };"
+        "gc();"
+        "for (var i = 0; i < 100000; ++i) {"
+        "    old.last = { value: i + \"\" };"
+        "    if (i % 1000 == 0)"
+        "        old.list.push({ value: i });"
+        "}");
+    QVERIFY(!ret.isError());
+    QCOMPARE(eng.evaluate("old.last.value").toString(), QString::fromLatin1("99999"));
+    QCOMPARE(eng.evaluate("old.list.length").toInt(), 100);
+    for (int i = 0; i < 100; ++i)
+        QCOMPARE(eng.evaluate(QString::fromLatin1("old.list[%0].value").arg(i)).toInt(), i * 1000);
+
+    eng.collectGarbage();
+    QCOMPARE(eng.evaluate("old.list[99].value").toInt(), 99000);
+}
+
+void tst_QJSEngine::incrementalMarking()
+{
+    // Objects only stored into already marked ones in between two slices must survive.
+    QJSEngine eng;
+    QV4::MemoryManager *mm = QV8Engine::getV4(&eng)->memoryManager;
+    mm->setIncrementalMarkingBudget(1);
+    QCOMPARE(mm->incrementalMarkingBudget(), 1);
+
+    QJSValue ret = eng.evaluate(
+        "var holder = { items: [] };"
+        "function step(n) {"
+        "    for (var i = 0; i < 1000; ++i)"
+        "        holder.last = { value: n * 1000 + i };"
+        "    holder.items.push({ value: n });"
+        "}");
+    QVERIFY(!ret.isError());
+
+    QJSValue step = eng.globalObject().property("step");
+    for (int i = 0; i < 200; ++i) {
+        QVERIFY(!step.call(QJSValueList() << i).isError());
+        mm->runGCSlice();
+    }
+
+    eng.collectGarbage();
+    QCOMPARE(eng.evaluate("holder.items.length").toInt(), 200);
+    for (int i = 0; i < 200; ++i)
+        QCOMPARE(eng.evaluate(QString::fromLatin1("holder.items[%0].value").arg(i)).toInt(), i);
+    QCOMPARE(eng.evaluate("holder.last.value").toInt(), 199999);
+}
+
+void tst_QJSEngine::incrementalMarkingFromAllocator()
+{
+    // Without anybody calling runGCSlice(), the allocator starts and finishes the cycles.
+    QJSEngine eng;
+    QV4::MemoryManager *mm = QV8Engine::getV4(&eng)->memoryManager;
+    mm->setIncrementalMarkingBudget(1);
+    const uint cyclesBefore = mm->incrementalMarkingCycles();
+
+    QJSValue ret = eng.evaluate(
+        "var holder = { items: [] };"
+        "for (var n = 0; n < 200; ++n) {"
+        "    for (var i = 0; i < 1000; ++i)"
+        "        holder.last = { value: n * 1000 + i };"
+        "    holder.items.push({ value: n });"
+        "}");
+    QVERIFY(!ret.isError());
+    QVERIFY(mm->incrementalMarkingCycles() > cyclesBefore);
+
+    eng.collectGarbage();
+    QCOMPARE(eng.evaluate("holder.items.length").toInt(), 200);
+    for (int i = 0; i < 200; ++i)
+        QCOMPARE(eng.evaluate(QString::fromLatin1("holder.items[%0].value").arg(i)).toInt(), i);
+    QCOMPARE(eng.evaluate("holder.last.value").toInt(), 199999);
+}
+
+void tst_QJSEngine::parallelSweep()
+{
+    qputenv("QV4_MM_PARALLEL_SWEEP", "1");
+    QJSEngine eng;
+    qunsetenv("QV4_MM_PARALLEL_SWEEP");
+
+    // Strings have a destroy function and are thus finalized on the GUI thread, plain objects
+    // get swept by the worker threads.
+    QJSValue ret = eng.evaluate(
+        "var kept = [];"
+        "for (var i = 0; i < 50000; ++i) {"
+        "    var o = { name: \"item\" + i };"
+        "    if (i % 100 == 0)"
+        "        kept.push(o);"
+        "}");
+    QVERIFY(!ret.isError());
+    eng.collectGarbage();
+    eng.collectGarbage();
+    QCOMPARE(eng.evaluate("kept.length").toInt(), 500);
+    for (int i = 0; i < 500; ++i)
+        QCOMPARE(eng.evaluate(QString::fromLatin1("kept[%0].name").arg(i)).toString(), QString::fromLatin1("item%1").arg(i * 100));
+}
+
+void tst_QJSEngine::bumpAllocation()
+{
+    QJSEngine eng;
+    QV4::MemoryManager *mm = QV8Engine::getV4(&eng)->memoryManager;
+    QCOMPARE(QV4::MemoryManager::align(1), std::size_t(QV4::MemoryManager::SlotSize));
+    QCOMPARE(QV4::MemoryManager::align(QV4::MemoryManager::SlotSize + 1), std::size_t(2 * QV4::MemoryManager::SlotSize));
+
+    // Mix objects of several sizes, so that items are taken from fresh chunks as well as from
+    // the free lists rebuilt by the collections in between.
+    QVERIFY(!eng.evaluate("var kept = [];").isError());
+    for (int round = 0; round < 5; ++round) {
+        QJSValue ret = eng.evaluate(
+            "for (var i = 0; i < 20000; ++i) {"
+            "    var o = { index: i, a: 1, b: 2, c: \"x\" + i };"
+            "    if (i % 1000 == 0)"
+            "        kept.push(o);"
+            "}");
+        QVERIFY(!ret.isError());
+        eng.collectGarbage();
+    }
+    QVERIFY(mm->getUsedMem() <= mm->getAllocatedMem());
+    QCOMPARE(eng.evaluate("kept.length").toInt(), 100);
+    for (int i = 0; i < 100; ++i)
+        QCOMPARE(eng.evaluate(QString::fromLatin1("kept[%0].c").arg(i)).toString(), QString::fromLatin1("x%1").arg((i % 20) * 1000));
+}
+
+void tst_QJSEngine::polymorphicLookups()
+{
+    QJSEngine eng;
+    QV4::ExecutionEngine *v4 = QV8Engine::getV4(&eng);
+
+    // Each object has its own shape, with x either on the object or on its prototype.
+    QJSValue ret = eng.evaluate(
+        "function getX(o) { return o.x; }"
+        "var objects = [];"
+        "for (var i = 0; i < 16; ++i) {"
+        "    var o = {};"
+        "    o[\"p\" + i] = i;"
+        "    if (i % 2) {"
+        "        o.x = i;"
+        "    } else {"
+        "        var proto = { x: i };"
+        "        proto[\"q\" + i] = i;"
+        "        o = Object.create(proto);"
+        "    }"
+        "    objects.push(o);"
+        "}"
+        "function run(count) {"
+        "    var sum = 0;"
+        "    for (var i = 0; i < count; ++i)"
+        "        sum += getX(objects[i]);"
+        "    return sum;"
+        "}");
+    QVERIFY(!ret.isError());
+
+    QCOMPARE(eng.evaluate("run(4)").toInt(), 0 + 1 + 2 + 3);
+    QVERIFY(v4->megamorphicLookupCache);
+    QVERIFY(v4->megamorphicLookupCache->polymorphicSites >= 1);
+
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(eng.evaluate("run(16)").toInt(), 120);
+    QVERIFY(v4->megamorphicLookupCache->megamorphicSites >= 1);
+    QVERIFY(v4->megamorphicLookupCache->hits > 0);
+
+    // Changing a shape after the fact must not return stale values.
+    QCOMPARE(eng.evaluate("Object.getPrototypeOf(objects[0]).x = 100; delete objects[1].p1; run(16)").toInt(), 120 + 100);
+}
+
+void tst_QJSEngine::polymorphicAccessorLookups()
+{
+    // Accessors found while a site changes to the polymorphic cache run exactly once.
+    QJSEngine eng;
+    QJSValue ret = eng.evaluate(
+        "var calls = 0;"
+        "function getX(o) { return o.x; }"
+        "function getY(o) { return o.y; }"
+        "var accessor = { get x() { ++calls; return 'a'; }, get y() { ++calls; return 'a'; } };"
+        "var results = [];"
+        "results.push(getX({ x: 1 }));"
+        "results.push(getX(accessor));"
+        "results.push(getY({ y: 1 }));"
+        "results.push(getY({ z: 0, y: 2 }));"
+        "results.push(getY(accessor));"
+        "results.push(getY(accessor));"
+        "results.join() + ' ' + calls");
+    QVERIFY(!ret.isError());
+    QCOMPARE(ret.toString(), QStringLiteral("1,a,1,2,a,a 3"));
+}
+
+#ifdef V4_ENABLE_JIT
+static QV4::JIT::TieredFunction *tieredFunction(QV4::ExecutionEngine *engine, const QString &name)
+{
+    QV4::Scope scope(engine);
+    QV4::ScopedString s(scope, engine->newString(name));
+    QV4::ScopedFunctionObject f(scope, engine->globalObject->get(s));
+    if (!f || !f->function())
+        return 0;
+    return reinterpret_cast<QV4::JIT::TieredFunction *>(const_cast<uchar *>(f->function()->codeData));
+}
+
+// The compiled code is installed by the first call after the background compilation finished.
+static bool waitForJitCode(QV4::ExecutionContext *ctx, QV4::JIT::TieredFunction *function, const QString &call)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!function->jitCode && timer.elapsed() < 5000) {
+        QTest::qWait(10);
+        QV4::Script script(ctx, call);
+        script.parse();
+        script.run();
+    }
+    return function->jitCode;
+}
+#endif
+
+void tst_QJSEngine::tieredExecution()
+{
+#ifdef V4_ENABLE_JIT
+    QV4::ExecutionEngine engine(new QV4::JIT::TieredISelFactory);
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "function sum(n) { var s = 0; for (var i = 0; i < n; ++i) s += i; return s; }"
+        "function square(x) { return x * x; }"
+        "function adder(a) { return function(b) { return a + b; }; }"
+        "function once() { return 1; }"
+        "var total = once();"
+        "for (var i = 0; i < 200; ++i)"
+        "    total += square(i) + adder(i)(1);"
+        "sum(5000) + sum(5000) + total"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toNumber(), 2 * 12497500. + 2666800. + 1.);
+
+    // Hot functions are queued on the call that crosses a threshold and keep running in the
+    // interpreter until their code is ready.
+    QV4::JIT::TieredFunction *square = tieredFunction(&engine, QStringLiteral("square"));
+    QVERIFY(square);
+    QVERIFY(square->triedTierUp);
+    QVERIFY(square->callCount < 200);
+    QVERIFY(waitForJitCode(ctx, square, QStringLiteral("square(2)")));
+    QVERIFY(waitForJitCode(ctx, tieredFunction(&engine, QStringLiteral("adder")), QStringLiteral("adder(1)(2)")));
+
+    QV4::JIT::TieredFunction *sum = tieredFunction(&engine, QStringLiteral("sum"));
+    QVERIFY(sum->triedTierUp);
+    QCOMPARE(sum->callCount, 2u);
+    QVERIFY(sum->backEdgeCount >= 1000);
+    QVERIFY(waitForJitCode(ctx, sum, QStringLiteral("sum(3)")));
+
+    QV4::JIT::TieredFunction *once = tieredFunction(&engine, QStringLiteral("once"));
+    QVERIFY(!once->triedTierUp);
+    QVERIFY(!once->job);
+    QVERIFY(!once->jitCode);
+    QCOMPARE(once->callCount, 1u);
+
+    QV4::Script again(ctx, QStringLiteral("square(12) + adder(2)(3) + sum(10)"));
+    again.parse();
+    result = again.run();
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toNumber(), 144. + 5. + 45.);
+#else
+    QSKIP("The JIT is not available on this platform");
+#endif
+}
+
+void tst_QJSEngine::tieredClosureCheck()
+{
+#ifdef V4_ENABLE_JIT
+    QV4::ExecutionEngine engine(new QV4::JIT::TieredISelFactory);
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "function twice(x) { return 2 * x; }"
+        "function hot(n) { var s = 0; for (var i = 0; i < n; ++i) s += twice(i); return s; }"
+        "hot(5000)"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toNumber(), 24995000.);
+
+    QV4::JIT::TieredFunction *hot = tieredFunction(&engine, QStringLiteral("hot"));
+    QVERIFY(waitForJitCode(ctx, hot, QStringLiteral("hot(10)")));
+    QV4::JIT::TieredFunction *twice = tieredFunction(&engine, QStringLiteral("twice"));
+    QVERIFY(twice);
+
+    // The guard of the inlined call to twice() has to accept the closure created by the
+    // interpreted global code while running in the unit the tier-up compiled hot() into.
+    QV4::ScopedString name(scope, engine.newString(QStringLiteral("twice")));
+    QV4::ScopedValue closure(scope, engine.globalObject->get(name));
+    name = engine.newString(QStringLiteral("hot"));
+    QV4::ScopedValue otherClosure(scope, engine.globalObject->get(name));
+
+    QV4::Heap::ExecutionContext *context = engine.currentContext();
+    QV4::CompiledData::CompilationUnit *unit = context->compilationUnit;
+    context->compilationUnit = hot->jitUnit;
+    const bool matchesInJitUnit = QV4::Value::fromReturnedValue(QV4::Runtime::isClosure(&engine, closure, twice->index, -1)).toBoolean();
+    const bool otherMatches = QV4::Value::fromReturnedValue(QV4::Runtime::isClosure(&engine, otherClosure, twice->index, -1)).toBoolean();
+    context->compilationUnit = twice->unit;
+    const bool matchesInBaseUnit = QV4::Value::fromReturnedValue(QV4::Runtime::isClosure(&engine, closure, twice->index, -1)).toBoolean();
+    context->compilationUnit = unit;
+    QVERIFY(matchesInJitUnit);
+    QVERIFY(!otherMatches);
+    QVERIFY(matchesInBaseUnit);
+
+    QV4::Script again(ctx, QStringLiteral("twice = function(x) { return 3 * x; }; hot(4)"));
+    again.parse();
+    result = again.run();
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toNumber(), 18.);
+#else
+    QSKIP("The JIT is not available on this platform");
+#endif
+}
+
+void tst_QJSEngine::inlinedCalls()
+{
+    QJSEngine eng;
+
+    // Global helpers, called from global code and from other functions.
+    QJSValue result = eng.evaluate(
+        "function clamp(x, lo, hi) { return Math.min(Math.max(x, lo), hi); }"
+        "function lerp(a, b, t) { return a + (b - a) * clamp(t, 0, 1); }"
+        "function noResult(x) { var y = x * 2; }"
+        "var sum = 0;"
+        "for (var i = -5; i < 15; ++i)"
+        "    sum += lerp(0, 10, i / 10) + clamp(i, 0, 9);"
+        "sum + (noResult(1) === undefined ? 1 : 0)");
+    QVERIFY(!result.isError());
+    QCOMPARE(result.toInt(), 95 + 90 + 1);
+
+    // Missing arguments are undefined, extra ones are evaluated and dropped.
+    result = eng.evaluate(
+        "function second(a, b) { return b; }"
+        "var n = 0;"
+        "function count() { return ++n; }"
+        "[second(1), second(1, 2, count())].join() + ',' + n");
+    QCOMPARE(result.toString(), QStringLiteral(",2,1"));
+
+    // Overwriting the callee falls back to a regular call.
+    result = eng.evaluate(
+        "function twice(x) { return 2 * x; }"
+        "function apply(x) { return twice(x); }"
+        "var before = apply(3);"
+        "twice = function(x) { return 3 * x; };"
+        "before + ',' + apply(3)");
+    QCOMPARE(result.toString(), QStringLiteral("6,9"));
+
+    // Helpers declared in a function use the variables of their scope, not the caller's.
+    result = eng.evaluate(
+        "(function() {"
+        "    var scale = 10;"
+        "    function scaled(x) { var offset = 1; return x * scale + offset; }"
+        "    function run(scale) {"
+        "        var total = 0;"
+        "        for (var i = 0; i < 3; ++i)"
+        "            total += scaled(i);"
+        "        return total + scale;"
+        "    }"
+        "    var r = run(1000);"
+        "    scale = 100;"
+        "    return r + ',' + run(0);"
+        "})()");
+    QCOMPARE(result.toString(), QStringLiteral("1033,303"));
+
+    // Each inlined call starts with fresh locals.
+    result = eng.evaluate(
+        "function fresh(set) { var v; if (set) v = 1; return v; }"
+        "var values = [];"
+        "for (var i = 0; i < 2; ++i)"
+        "    values.push(fresh(i == 0));"
+        "values.join()");
+    QCOMPARE(result.toString(), QStringLiteral("1,"));
+
+    // Also when the locals are not initialized and the call site is in a function.
+    result = eng.evaluate(
+        "function f(c) { var r; if (c) r = 1; return r; }"
+        "function g() {"
+        "    var values = [];"
+        "    for (var i = 0; i < 2; ++i)"
+        "        values.push(f(i == 0));"
+        "    return values.join() + ',' + (values[1] === undefined);"
+        "}"
+        "g()");
+    QCOMPARE(result.toString(), QStringLiteral("1,,true"));
+
+    // Exceptions thrown by inlined code reach the caller's handlers.
+    result = eng.evaluate(
+        "function check(x) { if (x < 0) throw new RangeError('negative'); return x; }"
+        "function safe(x) { try { return check(x); } catch (e) { return e.message; } }"
+        "safe(1) + ',' + safe(-1)");
+    QCOMPARE(result.toString(), QStringLiteral("1,negative"));
+}
+
+void tst_QJSEngine::numericLoops()
+{
+    QJSEngine eng;
+
+    // Summing arrays: dense, with holes that are found in the prototype, with strings, and
+    // array-likes that are not arrays.
+    QJSValue result = eng.evaluate(
+        "function sum(a) { var s = 0; for (var i = 0; i < a.length; ++i) s += a[i]; return s; }"
+        "var dense = [];"
+        "for (var i = 0; i < 1000; ++i) dense.push(i / 2);"
+        "var holes = [1, , 3];"
+        "Array.prototype[1] = 100;"
+        "var r = [sum(dense), sum(holes), sum(['a', 'b']), sum({ length: 2, 0: 5, 1: 6 }), sum('12')];"
+        "delete Array.prototype[1];"
+        "r.join()");
+    QVERIFY(!result.isError());
+    QCOMPARE(result.toString(), QStringLiteral("249750,104,0ab,11,012"));
+
+    // The array can change while looping over it.
+    result = eng.evaluate(
+        "(function() {"
+        "    var a = [1, 2, 3], n = 0;"
+        "    for (var i = 0; i < a.length; ++i) {"
+        "        if (a[i] < 3) a.push(a[i] + 10);"
+        "        ++n;"
+        "    }"
+        "    a.shift();"
+        "    return n + ':' + a[0] + ',' + a[-1] + ',' + a[1.5] + ',' + a[a.length];"
+        "})()");
+    QCOMPARE(result.toString(), QStringLiteral("5:2,undefined,undefined,undefined"));
+
+    // Counters that are compared against int32 bounds cannot overflow, the others can.
+    result = eng.evaluate(
+        "(function() {"
+        "    var n = 0, i, j;"
+        "    for (i = 2147483640; i < 2147483647; ++i) ++n;"
+        "    for (j = 2147483640; j <= 2147483647; j++) ++n;"
+        "    var k = -2147483640;"
+        "    while (k >= -2147483648) { --k; ++n; }"
+        "    return [n, i, j, k].join();"
+        "})()");
+    QCOMPARE(result.toString(), QStringLiteral("24,2147483647,2147483648,-2147483649"));
+
+    // Invariant computations in conditionally executed parts of a loop.
+    result = eng.evaluate(
+        "(function(x, y, count) {"
+        "    var total = 0;"
+        "    for (var i = 0; i < count; ++i) {"
+        "        for (var j = 0; j < count; ++j) {"
+        "            if (j & 1) total += x * y + i;"
+        "            else total -= (x | y) / 2;"
+        "        }"
+        "    }"
+        "    return total;"
+        "})(3, 5, 10)");
+    QCOMPARE(result.toNumber(), double(10 * 5 * 15 + 5 * 45 - 50 * 3.5));
+}
+
+void tst_QJSEngine::scalarReplacement()
+{
+    QJSEngine eng;
+
+    // Results of inlined helpers that are destructured right away, also after the helpers
+    // were replaced by functions returning something else.
+    QJSValue result = eng.evaluate(
+        "function point(x, y) { return { x: x, y: y }; }"
+        "function pair(x, y) { return [x, y]; }"
+        "function norm(x, y) { var p = point(x, y); var px = p.x, py = p.y; return px * px + py * py; }"
+        "function sum(x, y) { var p = pair(x, y); var a = p[0], b = p[1], n = p.length; return a + b + n; }"
+        "var r = [norm(3, 4), sum(3, 4)];"
+        "point = function(x, y) { return { x: y, y: x, z: 1 }; };"
+        "pair = function(x, y) { return 'ab'; };"
+        "r.push(norm(1, 2), sum(1, 2));"
+        "r.join()");
+    QVERIFY(!result.isError());
+    QCOMPARE(result.toString(), QStringLiteral("25,9,5,ab2"));
+
+    // Literals that are only read from, merged ones, and ones that escape, are written to or
+    // have accessors.
+    result = eng.evaluate(
+        "(function(a, b, c) {"
+        "    var o = { x: a, y: b };"
+        "    var s = [a, b, a + b];"
+        "    var m = c ? { x: 1, y: 2 } : { x: 3, y: 4 };"
+        "    var e = { v: a };"
+        "    var w = { v: a };"
+        "    w.v = b;"
+        "    var g = { get v() { return 7; } };"
+        "    return [o.x + o['y'], s[2] + s.length, s[5], m.x + m.y, e, w.v, g.v].join();"
+        "})(2, 3, false)");
+    QCOMPARE(result.toString(), QStringLiteral("5,8,,7,[object Object],3,7"));
+}
+
+void tst_QJSEngine::typeSpeculation()
+{
+#ifdef V4_ENABLE_JIT
+    QV4::ExecutionEngine engine(new QV4::JIT::TieredISelFactory);
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "function weigh(p) {"
+        "    var w = 0;"
+        "    for (var i = 0; i < p.length; ++i)"
+        "        w += p[i].x * p[i].x + p[i].y;"
+        "    return w;"
+        "}"
+        "var points = [{ x: 1, y: 2 }, { x: 3, y: 0.5 }];"
+        "var total = 0;"
+        "for (var i = 0; i < 100; ++i)"
+        "    total += weigh(points);"
+        "total"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toNumber(), 100 * 12.5);
+
+    // The interpreter recorded what the reads returned until the function was queued.
+    QV4::JIT::TieredFunction *weigh = tieredFunction(&engine, QStringLiteral("weigh"));
+    QVERIFY(weigh);
+    QVERIFY(weigh->triedTierUp);
+    QVERIFY(weigh->typeFeedback.contains(QV4::Moth::ObservedInteger));
+    QVERIFY(weigh->typeFeedback.contains(quint8(QV4::Moth::ObservedInteger | QV4::Moth::ObservedDouble)));
+    QVERIFY(weigh->typeFeedback.contains(QV4::Moth::ObservedOther));
+    QVERIFY(waitForJitCode(ctx, weigh, QStringLiteral("weigh(points)")));
+
+    // Values of other types fail the checks and continue in the generic code, also in the
+    // middle of the loop.
+    QV4::Script mixed(ctx, QStringLiteral(
+        "[weigh(points),"
+        " weigh([{ x: 1, y: 2 }, { x: 2.5, y: 1 }]),"
+        " weigh([{ x: '2', y: 1 }, { x: 1.5, y: 'a' }, { x: 2, y: null }]),"
+        " weigh(points)].join()"));
+    mixed.parse();
+    result = mixed.run();
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral("12.5,10.25,52.25a4,12.5"));
+#else
+    QSKIP("The JIT is not available on this platform");
+#endif
+}
+
+static QV4::Heap::ArrayData::Type globalArrayType(QV4::ExecutionEngine *engine, const QString &name)
+{
+    QV4::Scope scope(engine);
+    QV4::ScopedString s(scope, engine->newString(name));
+    QV4::ScopedObject a(scope, engine->globalObject->get(s));
+    return a->arrayType();
+}
+
+void tst_QJSEngine::packedArrays()
+{
+    QV4::ExecutionEngine engine;
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "var ints = [3, 1, 20, 100, -5];"
+        "var doubles = [];"
+        "for (var i = 0; i < 20; ++i)"
+        "    doubles.push(i);"
+        "doubles[3] = 0.5;"
+        "var mixed = new Array(1, 2, 3);"
+        "mixed[1] = 'two';"
+        "var queue = [1, 2, 3, 4];"
+        "queue.shift();"
+        "queue.unshift(7, 8);"
+        "[ints.sort().join(), ints.indexOf(20), ints.indexOf('20'), ints.indexOf(7),"
+        " doubles.indexOf(0.5), doubles.indexOf(19), doubles.length, mixed.join(),"
+        " queue.join(), ints.concat(doubles).length].join(';')"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral("-5,1,100,20,3;3;-1;-1;3;19;20;1,two,3;7,8,2,3,4;25"));
+
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("ints")), QV4::Heap::ArrayData::PackedInt32);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("doubles")), QV4::Heap::ArrayData::PackedDouble);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("mixed")), QV4::Heap::ArrayData::Simple);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("queue")), QV4::Heap::ArrayData::PackedInt32);
+
+    // Holes, attributes and deleted elements fall back to the generic store
+    QV4::Script fallback(ctx, QStringLiteral(
+        "var holes = [1, 2, 3];"
+        "holes[5] = 6;"
+        "var frozen = Object.freeze([1, 2]);"
+        "frozen[0] = 5;"
+        "var deleted = [1, 2, 3];"
+        "delete deleted[2];"
+        "var middle = [1.5, 2.5, 3.5];"
+        "delete middle[1];"
+        "[holes.join(), frozen.join(), deleted.length, deleted.join(), 1 in middle, middle.join()].join(';')"));
+    fallback.parse();
+    result = fallback.run();
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral("1,2,3,,,6;1,2;3;1,2,;false;1.5,,3.5"));
+
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("holes")), QV4::Heap::ArrayData::Simple);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("frozen")), QV4::Heap::ArrayData::Complex);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("deleted")), QV4::Heap::ArrayData::PackedInt32);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("middle")), QV4::Heap::ArrayData::Simple);
+
+    // Reading property descriptors, also through the prototype chain, keeps the store packed
+    QV4::Script descriptors(ctx, QStringLiteral(
+        "var described = [4, 5.5];"
+        "var d = Object.getOwnPropertyDescriptor(described, 1);"
+        "var proto = [10, 20, 30];"
+        "var derived = Object.create(proto);"
+        "derived[1] = 7;"
+        "[d.value, d.writable, d.enumerable, d.configurable, described.propertyIsEnumerable(0),"
+        " described.propertyIsEnumerable(2), derived[1], proto[1], derived[2]].join(';')"));
+    descriptors.parse();
+    result = descriptors.run();
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral("5.5;true;true;true;true;false;7;20;30"));
+
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("described")), QV4::Heap::ArrayData::PackedDouble);
+    QCOMPARE(globalArrayType(&engine, QStringLiteral("proto")), QV4::Heap::ArrayData::PackedInt32);
+}
+
+void tst_QJSEngine::interpreterCompareJumps()
+{
+    QV4::ExecutionEngine engine(new QV4::Moth::ISelFactory);
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "function count(a, b) {"
+        "    var n = 0;"
+        "    if (a < b) n += 1;"
+        "    if (a <= b) n += 2;"
+        "    if (a > b) n += 4;"
+        "    if (a >= b) n += 8;"
+        "    if (a == b) n += 16;"
+        "    if (a != b) n += 32;"
+        "    if (a === b) n += 64;"
+        "    if (a !== b) n += 128;"
+        "    return n;"
+        "}"
+        "var loops = 0;"
+        "for (var i = 0; i < 10; ++i)"
+        "    for (var j = 10; j > i; --j)"
+        "        ++loops;"
+        "var thrown = false;"
+        "try { if ({ valueOf: function() { throw 1; } } < 1) thrown = 'no'; } catch (e) { thrown = e === 1; }"
+        "[count(1, 2), count(2, 2), count(3, 2), count(NaN, 1), count('2', 2), count(null, undefined),"
+        " loops, thrown].join()"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral("163,90,172,160,154,144,55,true"));
+}
+
+void tst_QJSEngine::executableMemory()
+{
+    {
+        QV4::ExecutableAllocator allocator;
+        QV4::ExecutableAllocator::Allocation *large = allocator.allocate(64 * 1024 + 16);
+        QV4::ExecutableAllocator::Allocation *small = allocator.allocate(16);
+        QCOMPARE(allocator.chunkCount(), 1);
+        const size_t committed = allocator.committedSize();
+        QVERIFY(committed > 64 * 1024);
+
+        // The pages of released code are given back while other code keeps the chunk alive.
+        allocator.free(large);
+        QCOMPARE(allocator.chunkCount(), 1);
+        QCOMPARE(allocator.committedSize(), committed - 64 * 1024);
+
+        large = allocator.allocate(64 * 1024);
+        QCOMPARE(allocator.chunkCount(), 1);
+        QCOMPARE(allocator.committedSize(), committed);
+
+        allocator.setMemoryLimit(committed + 1);
+        QVERIFY(!allocator.isLimitReached());
+        allocator.setMemoryLimit(committed);
+        QVERIFY(allocator.isLimitReached());
+
+        allocator.free(large);
+        allocator.free(small);
+        QCOMPARE(allocator.chunkCount(), 0);
+        QCOMPARE(allocator.committedSize(), size_t(0));
+    }
+
+    // Once the limit is reached, new code runs in the interpreter.
+    QV4::ExecutionEngine engine;
+    engine.executableAllocator->setMemoryLimit(1);
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script first(ctx, QStringLiteral("function inc(x) { return x + 1; } inc(1)"));
+    first.parse();
+    QV4::ScopedValue result(scope, first.run());
+    QCOMPARE(result->toNumber(), 2.);
+    const size_t committed = engine.executableAllocator->committedSize();
+
+    QV4::Script second(ctx, QStringLiteral("function twice(x) { return x * 2; } twice(21)"));
+    second.parse();
+    result = second.run();
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toNumber(), 42.);
+    QCOMPARE(engine.executableAllocator->committedSize(), committed);
+}
+
+void tst_QJSEngine::jsonStringify()
+{
+    QV4::ExecutionEngine engine;
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "var packed = [1, -2, 2147483647, -2147483648];"
+        "var doubles = [0.5, -0, 1e21, NaN, Infinity];"
+        "var holes = [1, , 3]; holes.length = 5;"
+        "var nested = { a: [1, { b: 'x\\ny\"\\\\\\u0001\\ud83d\\ude00' }], c: null, d: undefined, e: function() {}, f: true };"
+        "var getter = { get g() { return 42; }, h: 1 };"
+        "var mutated = { a: { toJSON: function() { delete mutated.b; mutated.z = 1; return 'A'; } }, b: 2, c: 3 };"
+        "var shrinking = [1, 2, 3]; shrinking[1] = { toJSON: function(k) { shrinking.length = 2; return k; } };"
+        "var hidden = {}; Object.defineProperty(hidden, 'x', { value: 1, enumerable: false }); hidden.y = 2;"
+        "[JSON.stringify(packed), JSON.stringify(doubles), JSON.stringify(holes),"
+        " JSON.stringify(nested), JSON.stringify(nested, null, 2), JSON.stringify(getter),"
+        " JSON.stringify(mutated), JSON.stringify(shrinking), JSON.stringify(hidden),"
+        " JSON.stringify(packed, function(k, v) { return typeof v === 'number' ? v * 2 : v; }),"
+        " JSON.stringify({ b: 1, a: 2, c: 3 }, ['c', 'a']), JSON.stringify([[], {}], null, '--'),"
+        " JSON.stringify(undefined), JSON.stringify(function() {})].join('|')"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QString::fromUtf8(
+        "[1,-2,2147483647,-2147483648]|[0.5,0,1e+21,null,null]|[1,null,3,null,null]|"
+        "{\"a\":[1,{\"b\":\"x\\ny\\\"\\\\\\u0001\xf0\x9f\x98\x80\"}],\"c\":null,\"f\":true}|"
+        "{\n  \"a\": [\n    1,\n    {\n      \"b\": \"x\\ny\\\"\\\\\\u0001\xf0\x9f\x98\x80\"\n    }\n  ],\n  \"c\": null,\n  \"f\": true\n}|"
+        "{\"g\":42,\"h\":1}|{\"a\":\"A\",\"c\":3}|[1,\"1\",null]|{\"y\":2}|[2,-4,4294967294,-4294967296]|"
+        "{\"c\":3,\"a\":2}|[\n--[],\n--{}\n]||"));
+
+    // C++ callers get the same text, also when it is written out in chunks
+    QV4::Script big(ctx, QStringLiteral(
+        "var big = [];"
+        "for (var i = 0; i < 5000; ++i)"
+        "    big.push({ name: 'item' + i + '\\u00e9\\ud83d\\ude00', values: [i, i / 2], even: { flag: i % 2 == 0 } });"
+        "big"));
+    big.parse();
+    result = big.run();
+    QVERIFY(!engine.hasException);
+    const QString text = QV4::JsonObject::stringify(&engine, result, QStringLiteral("  "));
+    QVERIFY(text.size() > 100 * 1024);
+    QCOMPARE(QV4::JsonObject::stringifyToUtf8(&engine, result, QStringLiteral("  ")), text.toUtf8());
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(QV4::JsonObject::stringify(&engine, result, &buffer));
+    QCOMPARE(buffer.data(), QV4::JsonObject::stringify(&engine, result).toUtf8());
+
+    QV4::ScopedValue undefined(scope, QV4::Primitive::undefinedValue());
+    QVERIFY(QV4::JsonObject::stringify(&engine, undefined).isNull());
+    QVERIFY(QV4::JsonObject::stringifyToUtf8(&engine, undefined).isEmpty());
+}
+
+void tst_QJSEngine::jsonParseShapes()
+{
+    QV4::ExecutionEngine engine;
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "var text = '[{\"id\":1,\"name\":\"a\",\"tags\":{\"x\":1,\"y\":[1,{\"z\":2}]}},{\"id\":2,\"name\":\"b\",\"tags\":{\"x\":3,\"y\":[]}},'"
+        "    + '{\"id\":3,\"name\":\"c\",\"id\":4},{\"id\":5,\"2\":\"two\",\"name\":\"d\",\"0\":\"zero\"},{\"ab\":1},{\"abc\":2},{\"ab\":3,\"abc\":4},'"
+        "    + '{\"a\\\\\"b\":5,\"a\\\\\\\\b\":6,\"\\\\u0061\":7},{\"a\\\\\"b\":8,\"a\\\\\\\\b\":9,\"a\":10},{}]';"
+        "var records = JSON.parse(text);"
+        "var keys = [];"
+        "for (var i = 0; i < records.length; ++i)"
+        "    keys.push(Object.keys(records[i]).join(' '));"
+        "var thrown = false;"
+        "try { JSON.parse('[{\"a\":1},{\"a\" 1}]'); } catch (e) { thrown = e instanceof SyntaxError; }"
+        "[keys.join('|'), JSON.stringify(records), thrown].join('#')"));
+    script.parse();
+    QV4::ScopedValue result(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral(
+        "id name tags|id name tags|id name|0 2 id name|ab|abc|ab abc|a\"b a\\b a|a\"b a\\b a|#"
+        "[{\"id\":1,\"name\":\"a\",\"tags\":{\"x\":1,\"y\":[1,{\"z\":2}]}},{\"id\":2,\"name\":\"b\",\"tags\":{\"x\":3,\"y\":[]}},{\"id\":4,\"name\":\"c\"},"
+        "{\"0\":\"zero\",\"2\":\"two\",\"id\":5,\"name\":\"d\"},{\"ab\":1},{\"abc\":2},{\"ab\":3,\"abc\":4},{\"a\\\"b\":5,\"a\\\\b\":6,\"a\":7},{\"a\\\"b\":8,\"a\\\\b\":9,\"a\":10},{}]#true"));
+
+    // records with the same keys share their internal class
+    QV4::Script records(ctx, QStringLiteral("JSON.parse('[{\"id\":1,\"name\":\"a\"},{\"id\":2,\"name\":\"b\"}]')"));
+    records.parse();
+    result = records.run();
+    QV4::ScopedArrayObject array(scope, result);
+    QVERIFY(array);
+    QV4::ScopedObject first(scope, array->getIndexed(0));
+    QV4::ScopedObject second(scope, array->getIndexed(1));
+    QVERIFY(first && second);
+    QCOMPARE(first->internalClass(), second->internalClass());
+    QCOMPARE(first->internalClass()->size, 2u);
+}
+
+void tst_QJSEngine::jsonParseLargeObject()
+{
+    // Only the first members of an object are collected on the JS stack.
+    const int count = 1000;
+    QString text;
+    text.reserve(count * 16);
+    text += QLatin1Char('{');
+    for (int i = 0; i < count; ++i) {
+        if (i)
+            text += QLatin1Char(',');
+        text += QString::fromLatin1("\"k%1\":%1").arg(i);
+    }
+    text += QLatin1String(",\"k0\":-1}");
+
+    QJSEngine eng;
+    eng.globalObject().setProperty("text", text);
+    QJSValue result = eng.evaluate(
+        "var o = JSON.parse(text);"
+        "[Object.keys(o).length, o.k0, o.k63, o.k64, o.k999].join()");
+    QVERIFY(!result.isError());
+    QCOMPARE(result.toString(), QStringLiteral("1000,-1,63,64,999"));
+}
+
+void tst_QJSEngine::serializeTransfer()
+{
+    QV4::ExecutionEngine engine;
+    QV4::Scope scope(&engine);
+    QV4::ScopedContext ctx(scope, engine.rootContext());
+    QV4::Script script(ctx, QStringLiteral(
+        "var buf = new ArrayBuffer(8);"
+        "var bytes = new Uint8Array(buf);"
+        "for (var i = 0; i < 8; ++i) bytes[i] = i + 1;"
+        "var moved = new ArrayBuffer(16);"
+        "var f64 = new Float64Array(moved); f64[0] = 1.5; f64[1] = -2;"
+        "transfer = [moved];"
+        "({ copied: buf, view: new Int16Array(buf, 2, 2), moved: f64, ints: [1, 2, 3], doubles: [0.5, 2, -1e300], mixed: [1, 'a'] })"));
+    script.parse();
+    QV4::ScopedValue message(scope, script.run());
+    QVERIFY(!engine.hasException);
+    QV4::ScopedString name(scope, engine.newString(QStringLiteral("transfer")));
+    QV4::ScopedValue transfer(scope, engine.globalObject()->get(name));
+
+    const QByteArray data = QV4::Serialize::serialize(message, transfer, &engine);
+    QV4::ScopedObject received(scope, QV4::Serialize::deserialize(data, &engine));
+    QVERIFY(received);
+    name = engine.newString(QStringLiteral("received"));
+    engine.globalObject()->put(name, received);
+
+    // numbers only arrays arrive packed
+    name = engine.newString(QStringLiteral("ints"));
+    QV4::ScopedArrayObject ints(scope, received->get(name));
+    QVERIFY(ints && ints->arrayData());
+    QCOMPARE(ints->arrayType(), QV4::Heap::ArrayData::PackedInt32);
+
+    QV4::Script check(ctx, QStringLiteral(
+        "function list(a) { var l = []; for (var i = 0; i < a.length; ++i) l.push(a[i]); return l.join(); }"
+        "[received.copied.byteLength, list(new Uint8Array(received.copied)),"
+        " received.view.byteOffset, list(received.view), received.moved.byteOffset, list(received.moved),"
+        " received.ints.join(), received.doubles.join(), received.mixed.join(),"
+        " buf.byteLength, moved.byteLength, f64.length, f64[0]].join('|')"));
+    check.parse();
+    QV4::ScopedValue result(scope, check.run());
+    QVERIFY(!engine.hasException);
+    QCOMPARE(result->toQStringNoThrow(), QStringLiteral(
+        "8|1,2,3,4,5,6,7,8|0|1027,1541|0|1.5,-2|1,2,3|0.5,2,-1e+300|1,a|8|0|0|"));
+}
+
+void tst_QJSEngine::generationalWriteBarrier()
+{
+    // Collect after every allocation, so that young objects stored into old ones without a
+    // write barrier are swept right away.
+    qputenv("QV4_MM_GENERATIONAL", "1");
+    qputenv("QV4_MM_AGGRESSIVE_GC", "1");
+    QJSEngine eng;
+    qunsetenv("QV4_MM_GENERATIONAL");
+    qunsetenv("QV4_MM_AGGRESSIVE_GC");
+
+    QJSValue ret = eng.evaluate(
+        "var re = /a/;"
+        "gc();"
+        "for (var i = 0; i < 50; ++i)"
+        "    re.compile('b' + i + 'c', 'g');"
+        "[re.source, re.global, re.test('xb49c')].join()");
+    QVERIFY(!ret.isError());
+    QCOMPARE(ret.toString(), QString::fromLatin1("b49c,true,true"));
+
+    ret = eng.evaluate(
+        "/b(\\d+)c/.exec('xb42c');"
+        "var junk = [];"
+        "for (var i = 0; i < 50; ++i) junk.push({ i: i });"
+        "RegExp.lastMatch");
+    QCOMPARE(ret.toString(), QString::fromLatin1("b42c"));
+
+    ret = eng.evaluate(
+        "function f(a, b) {"
+        "    gc();"
+        "    arguments[0] = { v: 'x' + a };"
+        "    arguments[5] = { v: 'y' };"
+        "    Object.defineProperty(arguments, '1', { value: { v: 'z' } });"
+        "    var junk = [];"
+        "    for (var i = 0; i < 50; ++i) junk.push({ i: i });"
+        "    return arguments[0].v + arguments[5].v + arguments[1].v + a.v;"
+        "}"
+        "f(1, 2)");
+    QVERIFY(!ret.isError());
+    QCOMPARE(ret.toString(), QString::fromLatin1("x1yzx1"));
+
+    ret = eng.evaluate(
+        "var old = [1, 2, 3];"
+        "gc();"
+        "for (var i = 0; i < 50; ++i) old[i % 3] = { v: 'v' + i };"
+        "old[0].v + old[1].v + old[2].v");
+    QCOMPARE(ret.toString(), QString::fromLatin1("v48v49v47"));
+}
+
 void tst_QJSEngine::stacktrace()
 {
     QString script = QString::fromLatin1(
@@ -77,6 +77,7 @@ private slots:
     void timeFormat();
 #if defined(Q_OS_UNIX)
     void timeZoneUpdated();
+    void daylightSaving();
 #endif
 
     void dateToLocaleString_data();
@@ -1309,6 +1310,60 @@ void tst_qqmllocale::timeZoneUpdated()
 
     QCOMPARE(obj->property("success").toBool(), true);
 }
+
+void tst_qqmllocale::daylightSaving()
+{
+    QByteArray original(qgetenv("TZ"));
+
+    // Central European time, changing on March 29th and October 25th 2015
+    setTimeZone(QByteArray("CET-1CEST,M3.5.0,M10.5.0/3"));
+
+    QQmlEngine e;
+    QJSValue offsets = e.evaluate(
+        "Date.timeZoneUpdated();"
+        "(function(start, step, count) {"
+        "    var r = [];"
+        "    for (var i = 0; i < count; ++i)"
+        "        r.push(new Date(start + i * step).getTimezoneOffset());"
+        "    return r;"
+        "})");
+    QVERIFY(offsets.isCallable());
+
+    const qint64 hour = 3600 * 1000;
+    const qint64 start = QDateTime(QDate(2015, 1, 1), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch();
+    const qint64 end = QDateTime(QDate(2016, 1, 1), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch();
+
+    // forwards, backwards and in steps larger than the cached spans
+    const qint64 steps[] = { hour, -hour, 23 * 24 * hour + hour };
+    for (int i = 0; i < 3; ++i) {
+        const qint64 from = steps[i] > 0 ? start : end - hour;
+        const int count = int((end - start) / qAbs(steps[i]));
+        QJSValueList args;
+        args << double(from) << double(steps[i]) << count;
+        const QVariantList result = offsets.call(args).toVariant().toList();
+        QCOMPARE(result.size(), count);
+        for (int j = 0; j < count; ++j) {
+            const QDateTime dt = QDateTime::fromMSecsSinceEpoch(from + j * steps[i]);
+            QCOMPARE(result.at(j).toInt(), -dt.offsetFromUtc() / 60);
+        }
+    }
+
+    QCOMPARE(e.evaluate("new Date(2015, 2, 29, 3, 30).getHours()").toInt(), 3);
+    QCOMPARE(e.evaluate("new Date(2015, 9, 25, 12).getTimezoneOffset()").toInt(), -60);
+
+    // the cached offsets are dropped with the timezone
+    setTimeZone(QByteArray("AEST-10:00"));
+    e.evaluate("Date.timeZoneUpdated()");
+    QJSValueList args;
+    args << double(start) << double(hour) << int((end - start) / hour);
+    const QVariantList result = offsets.call(args).toVariant().toList();
+    QCOMPARE(result.size(), args.at(2).toInt());
+    foreach (const QVariant &offset, result)
+        QCOMPARE(offset.toInt(), -600);
+
+    setTimeZone(original);
+    e.evaluate("Date.timeZoneUpdated()");
+}
 #endif
 
 QTEST_MAIN(tst_qqmllocale)
@@ -49,6 +49,7 @@ private slots:
     void methodsDerived();
     void signalHandlers();
     void signalHandlersDerived();
+    void staticMetaCallAccessors();
 
 private:
     QQmlEngine engine;
@@ -94,6 +95,28 @@ Q_SIGNALS:
     void signalB();
 };
 
+class TypedObject : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int intProperty READ intProperty CONSTANT)
+    Q_PROPERTY(qreal realProperty READ realProperty CONSTANT)
+    Q_PROPERTY(bool boolProperty READ boolProperty CONSTANT)
+    Q_PROPERTY(QString stringProperty READ stringProperty NOTIFY stringPropertyChanged)
+    Q_PROPERTY(QVariant variantProperty READ variantProperty CONSTANT)
+    Q_PROPERTY(int revisionedProperty READ intProperty CONSTANT REVISION 1)
+public:
+    TypedObject(QObject *parent = 0) : QObject(parent) {}
+
+    int intProperty() const { return 42; }
+    qreal realProperty() const { return 1.5; }
+    bool boolProperty() const { return true; }
+    QString stringProperty() const { return QStringLiteral("text"); }
+    QVariant variantProperty() const { return QVariant(7); }
+
+Q_SIGNALS:
+    void stringPropertyChanged();
+};
+
 QQmlPropertyData *cacheProperty(QQmlPropertyCache *cache, const char *name)
 {
     return cache->property(QLatin1String(name), 0, 0);
@@ -270,6 +293,50 @@ void tst_qqmlpropertycache::signalHandlersDerived()
     QCOMPARE(data->coreIndex, metaObject->indexOfMethod("propertyDChanged()"));
 }
 
+void tst_qqmlpropertycache::staticMetaCallAccessors()
+{
+    TypedObject object;
+
+    QQmlRefPointer<QQmlPropertyCache> cache(new QQmlPropertyCache(&engine, object.metaObject()));
+    QQmlPropertyData *data;
+
+    QVERIFY(data = cacheProperty(cache, "intProperty"));
+    QVERIFY(data->hasAccessors());
+    int intValue = 0;
+    data->accessors->read(&object, data->accessorData, &intValue);
+    QCOMPARE(intValue, 42);
+
+    QVERIFY(data = cacheProperty(cache, "realProperty"));
+    QVERIFY(data->hasAccessors());
+    qreal realValue = 0;
+    data->accessors->read(&object, data->accessorData, &realValue);
+    QCOMPARE(realValue, qreal(1.5));
+
+    QVERIFY(data = cacheProperty(cache, "boolProperty"));
+    QVERIFY(data->hasAccessors());
+
+    QVERIFY(data = cacheProperty(cache, "stringProperty"));
+    QVERIFY(data->hasAccessors());
+    QString stringValue;
+    data->accessors->read(&object, data->accessorData, &stringValue);
+    QCOMPARE(stringValue, QStringLiteral("text"));
+
+    QVERIFY(data = cacheProperty(cache, "variantProperty"));
+    QVERIFY(!data->hasAccessors());
+
+    QVERIFY(data = cacheProperty(cache, "revisionedProperty"));
+    QVERIFY(!data->hasAccessors());
+
+    // Inherited properties are registered by the cache of the class declaring them
+    QVERIFY(data = cacheProperty(cache, "objectName"));
+    QVERIFY(data->hasAccessors());
+
+    engine.globalObject().setProperty("typed", engine.newQObject(&object));
+    QQmlEngine::setObjectOwnership(&object, QQmlEngine::CppOwnership);
+    QJSValue result = engine.evaluate("typed.intProperty + typed.realProperty + ' ' + typed.boolProperty + ' ' + typed.stringProperty + ' ' + typed.variantProperty");
+    QCOMPARE(result.toString(), QStringLiteral("43.5 true text 7"));
+}
+
 QTEST_MAIN(tst_qqmlpropertycache)
 
 #include "tst_qqmlpropertycache.moc"
@@ -0,0 +1,8 @@
+.pragma library
+
+function compute(n) {
+    var result = 0;
+    for (var i = 0; i < n; ++i)
+        result += i % 3 == 0 ? i * 2 : i - 1;
+    return result + " " + (n instanceof Object) + " " + ("length" in [1, 2]);
+}
@@ -0,0 +1,6 @@
+import QtQml 2.0
+import "diskcache.js" as Script
+
+QtObject {
+    property string result: Script.compute(10)
+}
@@ -33,8 +33,12 @@
 
 #include <QtTest/QtTest>
 #include <QtQml/qqmlengine.h>
+#include <QtQml/qqmlcomponent.h>
 #include <QtQuick/qquickview.h>
 #include <QtQuick/qquickitem.h>
+#include <private/qqmldiskcache_p.h>
+#include <private/qv4compileddata_p.h>
+#include <private/qv8engine_p.h>
 #include "../../shared/util.h"
 
 class tst_QQMLTypeLoader : public QQmlDataTest
@@ -42,9 +46,23 @@ class tst_QQMLTypeLoader : public QQmlDataTest
     Q_OBJECT
 
 private slots:
+    void initTestCase();
     void testLoadComplete();
+    void diskCache();
+
+private:
+    QTemporaryDir m_cacheDir;
 };
 
+void tst_QQMLTypeLoader::initTestCase()
+{
+    QQmlDataTest::initTestCase();
+    // Only interpreter code can be stored in the disk cache.
+    qputenv("QV4_FORCE_INTERPRETER", "1");
+    QVERIFY(m_cacheDir.isValid());
+    qputenv("QML_DISK_CACHE_PATH", m_cacheDir.path().toLocal8Bit());
+}
+
 void tst_QQMLTypeLoader::testLoadComplete()
 {
     QQuickView *window = new QQuickView();
@@ -62,6 +80,60 @@ void tst_QQMLTypeLoader::testLoadComplete()
     delete window;
 }
 
+void tst_QQMLTypeLoader::diskCache()
+{
+    const QUrl scriptUrl = testFileUrl("diskcache.js");
+    const QString cacheFile = QQmlDiskCache::cacheFilePath(scriptUrl);
+    QVERIFY(cacheFile.startsWith(m_cacheDir.path()));
+    QFile::remove(cacheFile);
+
+    QString expected;
+    {
+        QQmlEngine engine;
+        QQmlComponent component(&engine, testFileUrl("diskcache.qml"));
+        QScopedPointer<QObject> object(component.create());
+        QVERIFY2(object, qPrintable(component.errorString()));
+        expected = object->property("result").toString();
+        QCOMPARE(expected, QStringLiteral("57 false true"));
+    }
+    QVERIFY(QFile::exists(cacheFile));
+
+    QFile source(testFile("diskcache.js"));
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    const QByteArray contents = source.readAll();
+
+    {
+        QQmlEngine engine;
+        QV4::ExecutionEngine *v4 = QV8Engine::getV4(&engine);
+        QString errorString;
+        QQmlRefPointer<QV4::CompiledData::CompilationUnit> unit
+                = QQmlDiskCache::loadUnit(v4, scriptUrl, QQmlDiskCache::checksum(contents.constData(), contents.size()), &errorString);
+        QVERIFY2(unit, qPrintable(errorString));
+        QVERIFY(unit->dataOwner);
+        QCOMPARE(unit->data->functionTableSize, 2u);
+
+        // A second engine shares the mapped unit data.
+        QQmlEngine otherEngine;
+        QQmlRefPointer<QV4::CompiledData::CompilationUnit> otherUnit
+                = QQmlDiskCache::loadUnit(QV8Engine::getV4(&otherEngine), scriptUrl, QQmlDiskCache::checksum(contents.constData(), contents.size()), &errorString);
+        QVERIFY2(otherUnit, qPrintable(errorString));
+        QVERIFY(otherUnit != unit);
+        QCOMPARE(otherUnit->data, unit->data);
+
+        const QByteArray modified = contents + "\n";
+        unit = QQmlDiskCache::loadUnit(v4, scriptUrl, QQmlDiskCache::checksum(modified.constData(), modified.size()), &errorString);
+        QVERIFY(!unit);
+    }
+
+    {
+        QQmlEngine engine;
+        QQmlComponent component(&engine, testFileUrl("diskcache.qml"));
+        QScopedPointer<QObject> object(component.create());
+        QVERIFY2(object, qPrintable(component.errorString()));
+        QCOMPARE(object->property("result").toString(), expected);
+    }
+}
+
 QTEST_MAIN(tst_QQMLTypeLoader)
 
 #include "tst_qqmltypeloader.moc"
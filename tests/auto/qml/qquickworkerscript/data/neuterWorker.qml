@@ -0,0 +1,32 @@
+import QtQuick 2.0
+
+Item {
+    id: root
+
+    // Each write is given a value whose valueOf() transfers the buffer written to.
+    function attempt(write) {
+        var buffer = new ArrayBuffer(16)
+        var value = { valueOf: function() { worker.sendMessage(0, [buffer]); return 1 } }
+        try {
+            write(buffer, value)
+        } catch (e) {
+            return e.name + ":" + buffer.byteLength
+        }
+        return "written:" + buffer.byteLength
+    }
+
+    function testNeuterWhileWriting() {
+        return [
+            attempt(function(buffer, value) { new DataView(buffer).setInt8(0, value) }),
+            attempt(function(buffer, value) { new DataView(buffer).setInt32(0, value) }),
+            attempt(function(buffer, value) { new DataView(buffer).setFloat64(0, value) }),
+            attempt(function(buffer, value) { "use strict"; new Int32Array(buffer)[0] = value }),
+            attempt(function(buffer, value) { new Float64Array(buffer).set([value]) })
+        ].join()
+    }
+
+    WorkerScript {
+        id: worker
+        source: "script.js"
+    }
+}
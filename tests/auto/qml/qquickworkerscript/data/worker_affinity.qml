@@ -0,0 +1,23 @@
+import QtQuick 2.6
+
+WorkerScript {
+    id: worker
+    source: "script.js"
+    affinity: 2
+
+    property variant response
+    property int pendingChanges: 0
+
+    signal done()
+
+    function testSend(value) {
+        worker.sendMessage(value)
+    }
+
+    onPendingMessagesChanged: ++pendingChanges
+
+    onMessage: {
+        worker.response = messageObject
+        worker.done()
+    }
+}
@@ -0,0 +1,6 @@
+import QtQuick 2.6
+
+WorkerScript {
+    source: "script.js"
+    affinity: 100000
+}
@@ -35,6 +35,7 @@
 #include <QtCore/qtimer.h>
 #include <QtCore/qdir.h>
 #include <QtCore/qfileinfo.h>
+#include <QtCore/qregularexpression.h>
 #include <QtQml/qjsengine.h>
 
 #include <QtQml/qqmlcomponent.h>
@@ -56,6 +57,7 @@ private slots:
     void messaging_sendQObjectList();
     void messaging_sendJsObject();
     void messaging_sendExternalObject();
+    void messaging_neuterWhileWriting();
     void script_with_pragma();
     void script_included();
     void scriptError_onLoad();
@@ -63,6 +65,7 @@ private slots:
     void script_function();
     void script_var();
     void script_global();
+    void affinity();
     void stressDispose();
 
 private:
@@ -203,6 +206,22 @@ void tst_QQuickWorkerScript::messaging_sendExternalObject()
     delete obj;
 }
 
+void tst_QQuickWorkerScript::messaging_neuterWhileWriting()
+{
+    QQmlComponent component(&m_engine, testFileUrl("neuterWorker.qml"));
+    QObject *obj = component.create();
+    QVERIFY(obj);
+
+    // Buffers transferred while converting the value are no longer written to.
+    QVariant result;
+    QVERIFY(QMetaObject::invokeMethod(obj, "testNeuterWhileWriting", Qt::DirectConnection,
+            Q_RETURN_ARG(QVariant, result)));
+    QCOMPARE(result.toString(), QStringLiteral("TypeError:0,TypeError:0,TypeError:0,TypeError:0,TypeError:0"));
+
+    qApp->processEvents();
+    delete obj;
+}
+
 void tst_QQuickWorkerScript::script_with_pragma()
 {
     QVariant value(100);
@@ -359,6 +378,47 @@ void tst_QQuickWorkerScript::script_global()
     }
 }
 
+void tst_QQuickWorkerScript::affinity()
+{
+    QQmlComponent component(&m_engine, testFileUrl("worker_affinity.qml"));
+    QQuickWorkerScript *worker = qobject_cast<QQuickWorkerScript*>(component.create());
+    QVERIFY(worker != 0);
+    QCOMPARE(worker->affinity(), 2);
+
+    // the worker gets a thread of its own
+    QQmlEnginePrivate *ep = QQmlEnginePrivate::get(&m_engine);
+    QVERIFY(ep->workerScriptEngines.size() > 2);
+    QQuickWorkerScriptEngine *thread = ep->workerScriptEngines.at(2);
+    QVERIFY(thread != 0);
+    QVERIFY(thread != ep->workerScriptEngines.at(0));
+
+    QVariant value(42);
+    QVERIFY(QMetaObject::invokeMethod(worker, "testSend", Q_ARG(QVariant, value)));
+    waitForEchoMessage(worker);
+    const QMetaObject *mo = worker->metaObject();
+    QCOMPARE(mo->property(mo->indexOfProperty("response")).read(worker).value<QVariant>(), value);
+    QCOMPARE(worker->pendingMessages(), 0);
+    QCOMPARE(thread->pendingMessages(), 0);
+    // once when the message was queued, once when it was handled
+    QCOMPARE(worker->property("pendingChanges").toInt(), 2);
+
+    // the affinity is fixed once the worker runs
+    QTest::ignoreMessage(QtWarningMsg, "QQuickWorkerScript: Cannot change the affinity of a running WorkerScript");
+    worker->setAffinity(0);
+    QCOMPARE(worker->affinity(), 2);
+
+    qApp->processEvents();
+    delete worker;
+
+    // affinities wrap around instead of starting a thread for each index
+    QQmlComponent outOfRange(&m_engine, testFileUrl("worker_affinity_range.qml"));
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("QQuickWorkerScript: affinity 100000 is out of range, using \\d+"));
+    worker = qobject_cast<QQuickWorkerScript*>(outOfRange.create());
+    QVERIFY(worker != 0);
+    QVERIFY(ep->workerScriptEngines.size() <= qMax(int(QQmlEnginePrivate::MaxWorkerScriptAffinity), ep->workerScriptThreads));
+    delete worker;
+}
+
 // Rapidly create and destroy worker scripts to test resources are being disposed
 // in the correct isolate
 void tst_QQuickWorkerScript::stressDispose()
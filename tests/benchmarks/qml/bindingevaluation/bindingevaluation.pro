@@ -0,0 +1,13 @@
+CONFIG += testcase
+TEMPLATE = app
+TARGET = tst_bindingevaluation
+QT += qml qml-private core-private testlib
+macx:CONFIG -= app_bundle
+
+SOURCES += tst_bindingevaluation.cpp testtypes.cpp
+HEADERS += testtypes.h
+
+OTHER_FILES += data/*.qml
+
+# Define SRCDIR equal to test's source directory
+DEFINES += SRCDIR=\\\"$$PWD\\\"
@@ -0,0 +1,8 @@
+import Test 1.0
+
+MyQmlObject {
+    id: root
+    property QtObject target: root
+
+    result: driver.value
+}
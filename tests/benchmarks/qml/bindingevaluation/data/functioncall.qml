@@ -0,0 +1,10 @@
+import Test 1.0
+
+MyQmlObject {
+    id: root
+    property QtObject target: root
+
+    function scaled(v) { return v * 2 }
+
+    result: scaled(value)
+}
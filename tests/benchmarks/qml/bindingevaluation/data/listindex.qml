@@ -0,0 +1,9 @@
+import Test 1.0
+
+MyQmlObject {
+    id: root
+    property QtObject target: root
+    property var items: [0, 10, 20, 30]
+
+    result: items[value % 4]
+}
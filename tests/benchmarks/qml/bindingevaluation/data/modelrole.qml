@@ -0,0 +1,15 @@
+import QtQml 2.1
+import Test 1.0
+
+MyQmlObject {
+    id: root
+    property QtObject target: instantiator.object
+
+    property Instantiator instantiator: Instantiator {
+        id: instantiator
+        model: listModel
+        delegate: MyQmlObject {
+            result: modelValue
+        }
+    }
+}
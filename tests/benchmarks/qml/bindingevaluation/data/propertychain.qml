@@ -0,0 +1,12 @@
+import Test 1.0
+
+MyQmlObject {
+    id: root
+    property QtObject target: root
+
+    object: MyQmlObject {
+        object: MyQmlObject {}
+    }
+
+    result: root.object.object.value
+}
@@ -0,0 +1,211 @@
+/****************************************************************************
+**
+** Copyright (C) 2014 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL21$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia. For licensing terms and
+** conditions see http://qt.digia.com/licensing. For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights. These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <qtest.h>
+#include <QQmlEngine>
+#include <QQmlContext>
+#include <QQmlComponent>
+#include <private/qqmlengine_p.h>
+#include <private/qv4engine_p.h>
+#include <private/qv4mm_p.h>
+#include "testtypes.h"
+
+// Measures bindings of the shapes commonly found in applications. For each shape the
+// benchmarks report the time to create an object with the binding, which includes its
+// initial evaluation, the time to re-evaluate it after one of its dependencies notified
+// a change, and the number of JS heap allocations per re-evaluation.
+class tst_bindingevaluation : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Shape {
+        PropertyChain,
+        ContextLookup,
+        AttachedProperty,
+        ModelRole,
+        FunctionCall,
+        ListIndex
+    };
+
+    tst_bindingevaluation();
+
+public slots:
+    void initTestCase();
+
+private slots:
+    void initialEvaluation_data() { shapes(); }
+    void initialEvaluation();
+    void reevaluation_data() { shapes(); }
+    void reevaluation();
+    void allocations_data() { shapes(); }
+    void allocations();
+
+private:
+    void shapes();
+    void changeInput(Shape shape, QObject *root, int value);
+    static int expectedResult(Shape shape, int value);
+
+    QQmlEngine engine;
+    MyQmlObject driver;
+    MyListModel listModel;
+};
+
+Q_DECLARE_METATYPE(tst_bindingevaluation::Shape)
+
+tst_bindingevaluation::tst_bindingevaluation()
+{
+}
+
+void tst_bindingevaluation::initTestCase()
+{
+    registerTypes();
+    engine.rootContext()->setContextProperty("driver", &driver);
+    engine.rootContext()->setContextProperty("listModel", &listModel);
+}
+
+void tst_bindingevaluation::shapes()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<Shape>("shape");
+
+    QTest::newRow("property chain") << SRCDIR "/data/propertychain.qml" << PropertyChain;
+    QTest::newRow("context lookup") << SRCDIR "/data/contextlookup.qml" << ContextLookup;
+    QTest::newRow("attached property") << SRCDIR "/data/attachedproperty.qml" << AttachedProperty;
+    QTest::newRow("model role") << SRCDIR "/data/modelrole.qml" << ModelRole;
+    QTest::newRow("function call") << SRCDIR "/data/functioncall.qml" << FunctionCall;
+    QTest::newRow("list index") << SRCDIR "/data/listindex.qml" << ListIndex;
+}
+
+// Changes the dependency of the binding under test, which re-evaluates it
+void tst_bindingevaluation::changeInput(Shape shape, QObject *root, int value)
+{
+    switch (shape) {
+    case PropertyChain:
+        static_cast<MyQmlObject *>(root)->object()->object()->setValue(value);
+        break;
+    case ContextLookup:
+        driver.setValue(value);
+        break;
+    case AttachedProperty:
+        static_cast<MyAttachedObject *>(qmlAttachedPropertiesObject<MyQmlObject>(root))->setCount(value);
+        break;
+    case ModelRole:
+        listModel.setValue(value);
+        break;
+    case FunctionCall:
+    case ListIndex:
+        static_cast<MyQmlObject *>(root)->setValue(value);
+        break;
+    }
+}
+
+int tst_bindingevaluation::expectedResult(Shape shape, int value)
+{
+    switch (shape) {
+    case FunctionCall:
+        return value * 2;
+    case ListIndex:
+        return (value % 4) * 10;
+    default:
+        return value;
+    }
+}
+
+#define COMPONENT(filename) \
+    QQmlComponent c(&engine, QUrl::fromLocalFile(filename)); \
+    QVERIFY2(c.isReady(), qPrintable(c.errorString()));
+
+#define TARGET(root) \
+    qobject_cast<MyQmlObject *>(root->property("target").value<QObject *>())
+
+void tst_bindingevaluation::initialEvaluation()
+{
+    QFETCH(QString, file);
+
+    COMPONENT(file);
+
+    QBENCHMARK {
+        QObject *o = c.create();
+        delete o;
+    }
+}
+
+void tst_bindingevaluation::reevaluation()
+{
+    QFETCH(QString, file);
+    QFETCH(Shape, shape);
+
+    COMPONENT(file);
+
+    QScopedPointer<QObject> root(c.create());
+    QVERIFY(root);
+    MyQmlObject *target = TARGET(root);
+    QVERIFY(target);
+
+    int value = 0;
+    QBENCHMARK {
+        changeInput(shape, root.data(), ++value);
+    }
+    QCOMPARE(target->result(), expectedResult(shape, value));
+}
+
+void tst_bindingevaluation::allocations()
+{
+    QFETCH(QString, file);
+    QFETCH(Shape, shape);
+
+    COMPONENT(file);
+
+    QScopedPointer<QObject> root(c.create());
+    QVERIFY(root);
+    MyQmlObject *target = TARGET(root);
+    QVERIFY(target);
+
+    // Let lookups and lazily created data settle first
+    for (int i = 1; i <= 10; ++i)
+        changeInput(shape, root.data(), i);
+
+    const int evaluations = 1000;
+    QV4::MemoryManager *mm = QQmlEnginePrivate::getV4Engine(&engine)->memoryManager;
+    const quint64 before = mm->totalAllocations();
+    for (int i = 0; i < evaluations; ++i)
+        changeInput(shape, root.data(), i);
+    const quint64 after = mm->totalAllocations();
+
+    QCOMPARE(target->result(), expectedResult(shape, evaluations - 1));
+    QTest::setBenchmarkResult(qreal(after - before) / evaluations, QTest::Events);
+}
+
+QTEST_MAIN(tst_bindingevaluation)
+#include "tst_bindingevaluation.moc"
@@ -55,6 +55,8 @@ private slots:
 #endif
     void evaluate_data();
     void evaluate();
+    void jsonParse_data();
+    void jsonParse();
 #if 0 // No program
     void evaluateProgram_data();
     void evaluateProgram();
@@ -223,6 +225,37 @@ void tst_QJSEngine::evaluate()
     }
 }
 
+void tst_QJSEngine::jsonParse_data()
+{
+    QTest::addColumn<QString>("record");
+    QTest::newRow("flat records") << QString::fromLatin1("{ id: i, name: 'item' + i, price: i / 4, active: i % 2 == 0 }");
+    QTest::newRow("nested records") << QString::fromLatin1("{ id: i, owner: { name: 'user' + i % 100, email: 'user' + i % 100 + '@example.com' }, tags: ['a', 'b'] }");
+    QTest::newRow("optional keys") << QString::fromLatin1("i % 3 ? { id: i, name: 'item' + i } : { id: i, name: 'item' + i, note: 'n' + i }");
+}
+
+// Parses an array of 10000 records built from the record expression
+void tst_QJSEngine::jsonParse()
+{
+    QFETCH(QString, record);
+    newEngine();
+    QJSValue text = m_engine->evaluate(QString::fromLatin1(
+        "(function() {"
+        "    var records = [];"
+        "    for (var i = 0; i < 10000; ++i)"
+        "        records.push(%1);"
+        "    return JSON.stringify(records);"
+        "})()").arg(record));
+    QVERIFY(text.isString());
+    QJSValue parse = m_engine->evaluate(QString::fromLatin1("(function(text) { return JSON.parse(text); })"));
+    QVERIFY(parse.isCallable());
+    QJSValueList args;
+    args << text;
+
+    QBENCHMARK {
+        (void)parse.call(args);
+    }
+}
+
 #if 0
 void tst_QJSEngine::connectAndDisconnect()
 {
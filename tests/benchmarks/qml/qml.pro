@@ -2,6 +2,7 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
            binding \
+           bindingevaluation \
            creation \
            compilation \
            javascript \
@@ -56,6 +56,9 @@ static const char usageTextC[] =
 "    -help  Show this information and exit.\n"
 "    -fromStart\n"
 "           Record as soon as the engine is started, default is false.\n"
+"    -heapSnapshot\n"
+"           Take a snapshot of the JavaScript heap when recording stops. This\n"
+"           forces a full garbage collection, default is false.\n"
 "    -p <number>, -port <number>\n"
 "           TCP/IP port to use, default is 3768.\n"
 "    -v, -verbose\n"
@@ -113,6 +116,24 @@ QmlProfilerApplication::QmlProfilerApplication(int &argc, char **argv) :
                                                           qint64)),
             &m_profilerData, SLOT(addMemoryEvent(QQmlProfilerService::MemoryType,qint64,
                                                  qint64)));
+    connect(&m_qmlProfilerClient, SIGNAL(allocationSite(qint64,QmlEventLocation,QString,qint64,
+                                                        qint64)),
+            &m_profilerData, SLOT(addAllocationSite(qint64,QmlEventLocation,QString,qint64,
+                                                    qint64)));
+    connect(&m_qmlProfilerClient, SIGNAL(heapSnapshot(qint64,QString,qint64,qint64,qint64,
+                                                      QString)),
+            &m_profilerData, SLOT(addHeapSnapshotEntry(qint64,QString,qint64,qint64,qint64,
+                                                       QString)));
+    connect(&m_qmlProfilerClient, SIGNAL(tierUp(qint64,QmlEventLocation,QString,qint64,quint32,
+                                                quint32)),
+            &m_profilerData, SLOT(addTierUp(qint64,QmlEventLocation,QString,qint64,quint32,
+                                            quint32)));
+    connect(&m_qmlProfilerClient, SIGNAL(jitStatistics(qint64,QmlEventLocation,QString,quint32,
+                                                       quint32,qint64,qint64,quint32,quint32,
+                                                       quint32)),
+            &m_profilerData, SLOT(addJitStatistics(qint64,QmlEventLocation,QString,quint32,
+                                                   quint32,qint64,qint64,quint32,quint32,
+                                                   quint32)));
 
     connect(&m_qmlProfilerClient, SIGNAL(complete()), this, SLOT(qmlComplete()));
 
@@ -164,6 +185,8 @@ bool QmlProfilerApplication::parseArguments()
         } else if (arg == QLatin1String("-fromStart")) {
             m_qmlProfilerClient.setRecording(true);
             m_v8profilerClient.setRecording(true);
+        } else if (arg == QLatin1String("-heapSnapshot")) {
+            m_qmlProfilerClient.setHeapSnapshot(true);
         } else if (arg == QLatin1String("-help") || arg == QLatin1String("-h") || arg == QLatin1String("/h") || arg == QLatin1String("/?")) {
             return false;
         } else if (arg == QLatin1String("-verbose") || arg == QLatin1String("-v")) {
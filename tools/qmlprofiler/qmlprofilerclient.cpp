@@ -35,6 +35,7 @@
 
 #include <QtCore/QStack>
 #include <QtCore/QStringList>
+#include <limits>
 
 ProfilerClient::ProfilerClient(const QString &clientName,
                              QQmlDebugConnection *client)
@@ -101,6 +102,7 @@ public:
     QmlProfilerClientPrivate()
         : inProgressRanges(0)
         , maximumTime(0)
+        , heapSnapshot(false)
     {
         ::memset(rangeCount, 0,
                  QQmlProfilerService::MaximumRangeType * sizeof(int));
@@ -113,6 +115,7 @@ public:
     QStack<QQmlProfilerService::BindingType> bindingTypes;
     int rangeCount[QQmlProfilerService::MaximumRangeType];
     qint64 maximumTime;
+    bool heapSnapshot;
 };
 
 QmlProfilerClient::QmlProfilerClient(
@@ -135,11 +138,19 @@ void QmlProfilerClient::clearData()
     ProfilerClient::clearData();
 }
 
+void QmlProfilerClient::setHeapSnapshot(bool enabled)
+{
+    d->heapSnapshot = enabled;
+}
+
 void QmlProfilerClient::sendRecordingStatus()
 {
     QByteArray ba;
     QDataStream stream(&ba, QIODevice::WriteOnly);
     stream << isRecording();
+    // The service leaves heap snapshots out unless they are requested explicitly.
+    if (isRecording() && d->heapSnapshot)
+        stream << -1 << std::numeric_limits<quint64>::max();
     sendMessage(ba);
 }
 
@@ -214,6 +225,55 @@ void QmlProfilerClient::messageReceived(const QByteArray &data)
         stream >> type >> delta;
         emit memoryAllocation((QQmlProfilerService::MemoryType)type, time, delta);
         d->maximumTime = qMax(time, d->maximumTime);
+    } else if (messageType == QQmlProfilerService::AllocationSite) {
+        QString fileName;
+        QString function;
+        int line;
+        int column;
+        qint64 samples;
+        qint64 size;
+        stream >> fileName >> line >> column >> function >> samples >> size;
+        emit allocationSite(time, QmlEventLocation(fileName, line, column), function, samples, size);
+        d->maximumTime = qMax(time, d->maximumTime);
+    } else if (messageType == QQmlProfilerService::HeapSnapshot) {
+        QString className;
+        QString retainerPath;
+        qint64 count;
+        qint64 shallowSize;
+        qint64 retainedSize;
+        stream >> className >> count >> shallowSize >> retainedSize >> retainerPath;
+        emit heapSnapshot(time, className, count, shallowSize, retainedSize, retainerPath);
+        d->maximumTime = qMax(time, d->maximumTime);
+    } else if (messageType == QQmlProfilerService::TierUp) {
+        QString fileName;
+        QString function;
+        int line;
+        int column;
+        qint64 duration;
+        quint32 calls;
+        quint32 backEdges;
+        stream >> fileName >> line >> column >> function >> duration >> calls >> backEdges;
+        emit tierUp(time, QmlEventLocation(fileName, line, column), function, duration, calls,
+                    backEdges);
+        d->maximumTime = qMax(time + duration, d->maximumTime);
+    } else if (messageType == QQmlProfilerService::JitStatistics) {
+        QString fileName;
+        QString function;
+        int line;
+        int column;
+        quint32 irStatements;
+        quint32 basicBlocks;
+        qint64 optimizeTime;
+        qint64 regallocTime;
+        quint32 spills;
+        quint32 codeSize;
+        quint32 executableSize;
+        stream >> fileName >> line >> column >> function >> irStatements >> basicBlocks
+               >> optimizeTime >> regallocTime >> spills >> codeSize >> executableSize;
+        emit jitStatistics(time, QmlEventLocation(fileName, line, column), function, irStatements,
+                           basicBlocks, optimizeTime, regallocTime, spills, codeSize,
+                           executableSize);
+        d->maximumTime = qMax(time, d->maximumTime);
     } else {
         int range;
         stream >> range;
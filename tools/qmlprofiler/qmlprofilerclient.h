@@ -82,6 +82,8 @@ public:
     QmlProfilerClient(QQmlDebugConnection *client);
     ~QmlProfilerClient();
 
+    void setHeapSnapshot(bool enabled);
+
 public slots:
     void clearData();
     void sendRecordingStatus();
@@ -101,6 +103,16 @@ signals:
     void pixmapCache(QQmlProfilerService::PixmapEventType, qint64 time,
                      const QmlEventLocation &location, int width, int height, int refCount);
     void memoryAllocation(QQmlProfilerService::MemoryType type, qint64 time, qint64 amount);
+    void allocationSite(qint64 time, const QmlEventLocation &location, const QString &function,
+                        qint64 samples, qint64 size);
+    void heapSnapshot(qint64 time, const QString &className, qint64 count, qint64 shallowSize,
+                      qint64 retainedSize, const QString &retainerPath);
+    void tierUp(qint64 time, const QmlEventLocation &location, const QString &function,
+                qint64 duration, quint32 calls, quint32 backEdges);
+    void jitStatistics(qint64 time, const QmlEventLocation &location, const QString &function,
+                       quint32 irStatements, quint32 basicBlocks, qint64 optimizeTime,
+                       qint64 regallocTime, quint32 spills, quint32 codeSize,
+                       quint32 executableSize);
 
 protected:
     virtual void messageReceived(const QByteArray &);
@@ -62,7 +62,11 @@ static const char *MESSAGE_STRINGS[] = {
     "Complete",
     "PixmapCache",
     "SceneGraph",
-    "MemoryAllocation"
+    "MemoryAllocation",
+    "AllocationSite",
+    "HeapSnapshot",
+    "TierUp",
+    "JitStatistics"
 };
 
 Q_STATIC_ASSERT(sizeof(MESSAGE_STRINGS) ==
@@ -125,6 +129,73 @@ Q_DECLARE_TYPEINFO(QmlRangeEventData, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QmlRangeEventStartInstance, Q_MOVABLE_TYPE);
 QT_END_NAMESPACE
 
+struct QmlAllocationSite {
+    qint64 time;
+    QmlEventLocation location;
+    QString function;
+    qint64 samples;
+    qint64 size;
+};
+
+struct QmlHeapSnapshotEntry {
+    qint64 time;
+    QString className;
+    qint64 count;
+    qint64 shallowSize;
+    qint64 retainedSize;
+    QString retainerPath;
+};
+
+struct QmlTierUp {
+    qint64 time;
+    QmlEventLocation location;
+    QString function;
+    qint64 duration;
+    quint32 calls;
+    quint32 backEdges;
+};
+
+struct QmlJitStatistics {
+    qint64 time;
+    QmlEventLocation location;
+    QString function;
+    quint32 irStatements;
+    quint32 basicBlocks;
+    qint64 optimizeTime;
+    qint64 regallocTime;
+    quint32 spills;
+    quint32 codeSize;
+    quint32 executableSize;
+};
+
+// JIT statistics summed up over all functions of a file.
+struct QmlJitFileTotals {
+    QmlJitFileTotals()
+        : functions(0), irStatements(0), compileTime(0), spills(0), codeSize(0), executableSize(0)
+    {}
+
+    QString filename;
+    int functions;
+    qint64 irStatements;
+    qint64 compileTime;
+    qint64 spills;
+    qint64 codeSize;
+    qint64 executableSize;
+};
+
+static bool compileTimeGreaterThan(const QmlJitFileTotals &a, const QmlJitFileTotals &b)
+{
+    return a.compileTime > b.compileTime;
+}
+
+QT_BEGIN_NAMESPACE
+Q_DECLARE_TYPEINFO(QmlAllocationSite, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QmlHeapSnapshotEntry, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QmlTierUp, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QmlJitStatistics, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QmlJitFileTotals, Q_MOVABLE_TYPE);
+QT_END_NAMESPACE
+
 struct QV8EventInfo {
     QString displayName;
     QString eventHashStr;
@@ -147,6 +218,10 @@ public:
     QHash<QString, QmlRangeEventData *> eventDescriptions;
     QVector<QmlRangeEventStartInstance> startInstanceList;
     QHash<QString, QV8EventInfo *> v8EventHash;
+    QVector<QmlAllocationSite> allocationSites;
+    QVector<QmlHeapSnapshotEntry> heapSnapshot;
+    QVector<QmlTierUp> tierUps;
+    QVector<QmlJitStatistics> jitStatistics;
 
     qint64 traceStartTime;
     qint64 traceEndTime;
@@ -180,6 +255,10 @@ void QmlProfilerData::clear()
     qDeleteAll(d->eventDescriptions.values());
     d->eventDescriptions.clear();
     d->startInstanceList.clear();
+    d->allocationSites.clear();
+    d->heapSnapshot.clear();
+    d->tierUps.clear();
+    d->jitStatistics.clear();
 
     qDeleteAll(d->v8EventHash.values());
     d->v8EventHash.clear();
@@ -388,6 +467,45 @@ void QmlProfilerData::addMemoryEvent(QQmlProfilerService::MemoryType type, qint6
     d->startInstanceList.append(rangeEventStartInstance);
 }
 
+void QmlProfilerData::addAllocationSite(qint64 time, const QmlEventLocation &location,
+                                        const QString &function, qint64 samples, qint64 size)
+{
+    setState(AcquiringData);
+    QmlAllocationSite site = {time, location, function, samples, size};
+    d->allocationSites.append(site);
+}
+
+void QmlProfilerData::addHeapSnapshotEntry(qint64 time, const QString &className, qint64 count,
+                                           qint64 shallowSize, qint64 retainedSize,
+                                           const QString &retainerPath)
+{
+    setState(AcquiringData);
+    QmlHeapSnapshotEntry entry = {time, className, count, shallowSize, retainedSize,
+                                  retainerPath};
+    d->heapSnapshot.append(entry);
+}
+
+void QmlProfilerData::addTierUp(qint64 time, const QmlEventLocation &location,
+                                const QString &function, qint64 duration, quint32 calls,
+                                quint32 backEdges)
+{
+    setState(AcquiringData);
+    QmlTierUp tierUp = {time, location, function, duration, calls, backEdges};
+    d->tierUps.append(tierUp);
+}
+
+void QmlProfilerData::addJitStatistics(qint64 time, const QmlEventLocation &location,
+                                       const QString &function, quint32 irStatements,
+                                       quint32 basicBlocks, qint64 optimizeTime,
+                                       qint64 regallocTime, quint32 spills, quint32 codeSize,
+                                       quint32 executableSize)
+{
+    setState(AcquiringData);
+    QmlJitStatistics statistics = {time, location, function, irStatements, basicBlocks,
+                                   optimizeTime, regallocTime, spills, codeSize, executableSize};
+    d->jitStatistics.append(statistics);
+}
+
 QString QmlProfilerData::rootEventName()
 {
     return tr("<program>");
@@ -541,7 +659,9 @@ void QmlProfilerData::complete()
 
 bool QmlProfilerData::isEmpty() const
 {
-    return d->startInstanceList.isEmpty() && d->v8EventHash.isEmpty();
+    return d->startInstanceList.isEmpty() && d->v8EventHash.isEmpty()
+            && d->allocationSites.isEmpty() && d->heapSnapshot.isEmpty() && d->tierUps.isEmpty()
+            && d->jitStatistics.isEmpty();
 }
 
 bool QmlProfilerData::save(const QString &filename)
@@ -656,6 +776,102 @@ bool QmlProfilerData::save(const QString &filename)
     }
     stream.writeEndElement(); // profilerDataModel
 
+    if (!d->allocationSites.isEmpty()) {
+        stream.writeStartElement(QStringLiteral("allocationSites"));
+        foreach (const QmlAllocationSite &site, d->allocationSites) {
+            stream.writeStartElement(QStringLiteral("site"));
+            stream.writeAttribute(QStringLiteral("time"), QString::number(site.time));
+            stream.writeAttribute(QStringLiteral("samples"), QString::number(site.samples));
+            stream.writeAttribute(QStringLiteral("size"), QString::number(site.size));
+            stream.writeTextElement(QStringLiteral("function"), site.function);
+            stream.writeTextElement(QStringLiteral("filename"), site.location.filename);
+            stream.writeTextElement(QStringLiteral("line"), QString::number(site.location.line));
+            stream.writeTextElement(QStringLiteral("column"), QString::number(site.location.column));
+            stream.writeEndElement();
+        }
+        stream.writeEndElement(); // allocationSites
+    }
+
+    if (!d->heapSnapshot.isEmpty()) {
+        stream.writeStartElement(QStringLiteral("heapSnapshot"));
+        foreach (const QmlHeapSnapshotEntry &entry, d->heapSnapshot) {
+            stream.writeStartElement(QStringLiteral("class"));
+            stream.writeAttribute(QStringLiteral("time"), QString::number(entry.time));
+            stream.writeAttribute(QStringLiteral("count"), QString::number(entry.count));
+            stream.writeAttribute(QStringLiteral("shallowSize"), QString::number(entry.shallowSize));
+            stream.writeAttribute(QStringLiteral("retainedSize"), QString::number(entry.retainedSize));
+            stream.writeTextElement(QStringLiteral("name"), entry.className);
+            stream.writeTextElement(QStringLiteral("retainerPath"), entry.retainerPath);
+            stream.writeEndElement();
+        }
+        stream.writeEndElement(); // heapSnapshot
+    }
+
+    if (!d->tierUps.isEmpty()) {
+        stream.writeStartElement(QStringLiteral("tierUps"));
+        foreach (const QmlTierUp &tierUp, d->tierUps) {
+            stream.writeStartElement(QStringLiteral("function"));
+            stream.writeAttribute(QStringLiteral("time"), QString::number(tierUp.time));
+            stream.writeAttribute(QStringLiteral("duration"), QString::number(tierUp.duration));
+            stream.writeAttribute(QStringLiteral("calls"), QString::number(tierUp.calls));
+            stream.writeAttribute(QStringLiteral("backEdges"), QString::number(tierUp.backEdges));
+            stream.writeTextElement(QStringLiteral("name"), tierUp.function);
+            stream.writeTextElement(QStringLiteral("filename"), tierUp.location.filename);
+            stream.writeTextElement(QStringLiteral("line"), QString::number(tierUp.location.line));
+            stream.writeTextElement(QStringLiteral("column"), QString::number(tierUp.location.column));
+            stream.writeEndElement();
+        }
+        stream.writeEndElement(); // tierUps
+    }
+
+    if (!d->jitStatistics.isEmpty()) {
+        QHash<QString, QmlJitFileTotals> totalsByFile;
+        stream.writeStartElement(QStringLiteral("jitStatistics"));
+        foreach (const QmlJitStatistics &statistics, d->jitStatistics) {
+            stream.writeStartElement(QStringLiteral("function"));
+            stream.writeAttribute(QStringLiteral("time"), QString::number(statistics.time));
+            stream.writeAttribute(QStringLiteral("irStatements"), QString::number(statistics.irStatements));
+            stream.writeAttribute(QStringLiteral("basicBlocks"), QString::number(statistics.basicBlocks));
+            stream.writeAttribute(QStringLiteral("optimizeTime"), QString::number(statistics.optimizeTime));
+            stream.writeAttribute(QStringLiteral("regallocTime"), QString::number(statistics.regallocTime));
+            stream.writeAttribute(QStringLiteral("spills"), QString::number(statistics.spills));
+            stream.writeAttribute(QStringLiteral("codeSize"), QString::number(statistics.codeSize));
+            stream.writeAttribute(QStringLiteral("executableSize"), QString::number(statistics.executableSize));
+            stream.writeTextElement(QStringLiteral("name"), statistics.function);
+            stream.writeTextElement(QStringLiteral("filename"), statistics.location.filename);
+            stream.writeTextElement(QStringLiteral("line"), QString::number(statistics.location.line));
+            stream.writeTextElement(QStringLiteral("column"), QString::number(statistics.location.column));
+            stream.writeEndElement();
+
+            QmlJitFileTotals &totals = totalsByFile[statistics.location.filename];
+            totals.filename = statistics.location.filename;
+            ++totals.functions;
+            totals.irStatements += statistics.irStatements;
+            totals.compileTime += statistics.optimizeTime + statistics.regallocTime;
+            totals.spills += statistics.spills;
+            totals.codeSize += statistics.codeSize;
+            totals.executableSize += statistics.executableSize;
+        }
+
+        // The files that took longest to compile come first.
+        QVector<QmlJitFileTotals> files;
+        foreach (const QmlJitFileTotals &totals, totalsByFile)
+            files.append(totals);
+        std::sort(files.begin(), files.end(), compileTimeGreaterThan);
+        foreach (const QmlJitFileTotals &totals, files) {
+            stream.writeStartElement(QStringLiteral("file"));
+            stream.writeAttribute(QStringLiteral("functions"), QString::number(totals.functions));
+            stream.writeAttribute(QStringLiteral("irStatements"), QString::number(totals.irStatements));
+            stream.writeAttribute(QStringLiteral("compileTime"), QString::number(totals.compileTime));
+            stream.writeAttribute(QStringLiteral("spills"), QString::number(totals.spills));
+            stream.writeAttribute(QStringLiteral("codeSize"), QString::number(totals.codeSize));
+            stream.writeAttribute(QStringLiteral("executableSize"), QString::number(totals.executableSize));
+            stream.writeTextElement(QStringLiteral("filename"), totals.filename);
+            stream.writeEndElement();
+        }
+        stream.writeEndElement(); // jitStatistics
+    }
+
     stream.writeStartElement(QStringLiteral("v8profile")); // v8 profiler output
     stream.writeAttribute(QStringLiteral("totalTime"), QString::number(d->v8MeasuredTime));
     foreach (QV8EventInfo *v8event, d->v8EventHash.values()) {
@@ -88,6 +88,17 @@ public slots:
     void addPixmapCacheEvent(QQmlProfilerService::PixmapEventType type, qint64 time,
                              const QmlEventLocation &location, int width, int height, int refcount);
     void addMemoryEvent(QQmlProfilerService::MemoryType type, qint64 time, qint64 size);
+    void addAllocationSite(qint64 time, const QmlEventLocation &location, const QString &function,
+                           qint64 samples, qint64 size);
+    void addHeapSnapshotEntry(qint64 time, const QString &className, qint64 count,
+                              qint64 shallowSize, qint64 retainedSize,
+                              const QString &retainerPath);
+    void addTierUp(qint64 time, const QmlEventLocation &location, const QString &function,
+                   qint64 duration, quint32 calls, quint32 backEdges);
+    void addJitStatistics(qint64 time, const QmlEventLocation &location, const QString &function,
+                          quint32 irStatements, quint32 basicBlocks, qint64 optimizeTime,
+                          qint64 regallocTime, quint32 spills, quint32 codeSize,
+                          quint32 executableSize);
 
     void complete();
     bool save(const QString &filename);